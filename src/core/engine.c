@@ -5,6 +5,7 @@
 #include "core/meminc.h"
 #include "core/platform.h"
 #include "core/profiler.h"
+#include "core/job_system.h"
 #include "defines.h"
 #include "game/game.h"
 #include "renderer/renderer.h"
@@ -15,7 +16,7 @@
 #include "engine.h"
 
 
-GRGlobals* global = nullptr;
+_Thread_local GRGlobals* global = nullptr;
 
 // Forward declarations
 static bool OnQuit(EventCode type, EventData data);
@@ -48,6 +49,7 @@ void EngineInit(EngineInitSettings settings)
 	InitializeEvent();
 	InitializeInput();
 	InitializePlatform(settings.windowTitle, settings.startResolution.x, settings.startResolution.y);
+	InitializeJobSystem();
 	INITIALIZE_PROFILER();
 	InitializeRenderer(rendererInitSettings);
 	InitializeTextRenderer();
@@ -115,6 +117,7 @@ void EngineShutdown()
 	ShutdownTextRenderer();
 	ShutdownRenderer();
 	SHUTDOWN_PROFILER();
+	ShutdownJobSystem();
 	ShutdownPlatform();
 	ShutdownInput();
 	ShutdownEvent();
@@ -25,7 +25,9 @@ typedef struct GRGlobals
 	bool appSuspended;
 } GRGlobals;
 
-extern GRGlobals* global;
+// Thread local so threads that run engine code outside of the main thread (e.g. background world generation) can point it at their own
+// arena and allocators. It is nullptr on threads that don't set it, like the job system workers, so jobs can't use it.
+extern _Thread_local GRGlobals* global;
 
 void EngineInit(EngineInitSettings settings);
 bool EngineUpdate();
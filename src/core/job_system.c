@@ -0,0 +1,155 @@
+#include "job_system.h"
+
+#include "core/platform.h"
+#include "core/meminc.h"
+#include "core/asserts.h"
+#include "core/logger.h"
+
+
+typedef struct JobBatch
+{
+	PFN_JobFunction jobFunction;
+	void* jobData;
+	u32 jobCount;
+	volatile i32 nextJobIndex;
+} JobBatch;
+
+typedef struct JobSystemState
+{
+	PlatformThread workerThreads[MAX_JOB_WORKER_THREADS];
+	PlatformSemaphore workAvailableSemaphore;	// Signaled once for every worker that should help with the current batch
+	PlatformSemaphore workerDoneSemaphore;		// Signaled by every worker that runs out of jobs in the current batch
+	JobBatch currentBatch;
+	u32 workerThreadCount;
+	volatile i32 batchActive;					// Used as a non recursive try lock so only one batch runs at a time
+	volatile i32 shuttingDown;
+} JobSystemState;
+
+static JobSystemState* state = nullptr;
+
+
+static void RunBatchJobs(JobBatch* batch)
+{
+	i32 jobIndex = PlatformAtomicAdd(&batch->nextJobIndex, 1) - 1;
+	while (jobIndex < (i32)batch->jobCount)
+	{
+		batch->jobFunction(batch->jobData, jobIndex);
+		jobIndex = PlatformAtomicAdd(&batch->nextJobIndex, 1) - 1;
+	}
+}
+
+static void WorkerThreadMain(void* userData)
+{
+	while (true)
+	{
+		PlatformSemaphoreWait(state->workAvailableSemaphore);
+
+		if (state->shuttingDown)
+			return;
+
+		RunBatchJobs(&state->currentBatch);
+
+		PlatformSemaphoreSignal(state->workerDoneSemaphore, 1);
+	}
+}
+
+bool InitializeJobSystem()
+{
+	GRASSERT_DEBUG(state == nullptr); // If this fails init job system was called twice
+	_INFO("Initializing job system...");
+	state = Alloc(GetGlobalAllocator(), sizeof(*state));
+	MemoryZero(state, sizeof(*state));
+
+	state->workAvailableSemaphore = PlatformSemaphoreCreate(0);
+	state->workerDoneSemaphore = PlatformSemaphoreCreate(0);
+
+	// The thread that calls parallel for also runs jobs so one less worker than there are processors is needed
+	u32 processorCount = PlatformGetProcessorCount();
+	state->workerThreadCount = processorCount > 1 ? processorCount - 1 : 0;
+	if (state->workerThreadCount > MAX_JOB_WORKER_THREADS)
+		state->workerThreadCount = MAX_JOB_WORKER_THREADS;
+
+	for (u32 i = 0; i < state->workerThreadCount; i++)
+		state->workerThreads[i] = PlatformThreadCreate(WorkerThreadMain, nullptr);
+
+	_INFO("Job system started %u worker threads", state->workerThreadCount);
+
+	return true;
+}
+
+void ShutdownJobSystem()
+{
+	if (state == nullptr)
+	{
+		_INFO("Job system startup failed, skipping shutdown");
+		return;
+	}
+	else
+	{
+		_INFO("Shutting down job system...");
+	}
+
+	state->shuttingDown = true;
+	PlatformSemaphoreSignal(state->workAvailableSemaphore, state->workerThreadCount);
+
+	for (u32 i = 0; i < state->workerThreadCount; i++)
+		PlatformThreadJoin(state->workerThreads[i]);
+
+	PlatformSemaphoreDestroy(state->workAvailableSemaphore);
+	PlatformSemaphoreDestroy(state->workerDoneSemaphore);
+
+	Free(GetGlobalAllocator(), state);
+	state = nullptr;
+}
+
+u32 JobSystemGetThreadCount()
+{
+	if (state == nullptr)
+		return 1;
+	return state->workerThreadCount + 1;
+}
+
+void JobSystemParallelFor(PFN_JobFunction jobFunction, void* jobData, u32 jobCount, u32 maxThreadCount)
+{
+	if (jobCount == 0)
+		return;
+
+	// Calculating how many workers should help the calling thread
+	u32 helperCount = state ? state->workerThreadCount : 0;
+	if (maxThreadCount == 0)
+		maxThreadCount = 1;
+	if (helperCount > maxThreadCount - 1)
+		helperCount = maxThreadCount - 1;
+	if (helperCount > jobCount - 1)
+		helperCount = jobCount - 1;
+
+	// Running the jobs on this thread if there is nobody to help or if another batch is already running
+	bool runOnCallingThread = helperCount == 0;
+	if (!runOnCallingThread && PlatformAtomicAdd(&state->batchActive, 1) != 1)
+	{
+		PlatformAtomicAdd(&state->batchActive, -1);
+		runOnCallingThread = true;
+	}
+
+	if (runOnCallingThread)
+	{
+		for (u32 i = 0; i < jobCount; i++)
+			jobFunction(jobData, i);
+		return;
+	}
+
+	state->currentBatch.jobFunction = jobFunction;
+	state->currentBatch.jobData = jobData;
+	state->currentBatch.jobCount = jobCount;
+	state->currentBatch.nextJobIndex = 0;
+
+	PlatformSemaphoreSignal(state->workAvailableSemaphore, helperCount);
+
+	RunBatchJobs(&state->currentBatch);
+
+	// Waiting for every woken worker to leave the batch so the batch can safely be overwritten by the next parallel for
+	for (u32 i = 0; i < helperCount; i++)
+		PlatformSemaphoreWait(state->workerDoneSemaphore);
+
+	PlatformAtomicAdd(&state->batchActive, -1);
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "defines.h"
+
+// Maximum amount of worker threads the job system starts, regardless of the processor count
+#define MAX_JOB_WORKER_THREADS 31
+
+// Function that gets called by the job system, jobIndex is in the range [0, jobCount) of the JobSystemParallelFor call
+typedef void (*PFN_JobFunction)(void* jobData, u32 jobIndex);
+
+bool InitializeJobSystem();
+void ShutdownJobSystem();
+
+// Returns the amount of threads that can work on jobs at the same time, this includes the thread that calls JobSystemParallelFor
+u32 JobSystemGetThreadCount();
+
+// Calls jobFunction once for every job index in [0, jobCount), spread over at most maxThreadCount threads (including the calling thread).
+// Returns when all jobs are done. If another parallel for is already running (e.g. when called from inside a job) the jobs are run on the calling thread.
+// Jobs should not use the frame arena or any allocators, they are not thread safe.
+void JobSystemParallelFor(PFN_JobFunction jobFunction, void* jobData, u32 jobCount, u32 maxThreadCount);
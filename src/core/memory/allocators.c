@@ -282,7 +282,7 @@ static bool FreelistPrimitiveTryReAlloc(void* backendState, void* block, size_t
 	if (oldSize > newSize)
 	{
 		u32 freedSize = (u32)oldSize - (u32)newSize;
-		FreelistPrimitiveFree(backendState, (u8*)block + oldSize, freedSize); // Freeing the memory
+		FreelistPrimitiveFree(backendState, (u8*)block + newSize, freedSize); // Freeing the memory at the end of the block
 		return true;
 	}
 	else
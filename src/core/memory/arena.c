@@ -48,6 +48,11 @@ ArenaMarker ArenaGetMarker(Arena* arena)
 	return (ArenaMarker)arena->arenaPointer;
 }
 
+size_t ArenaGetRemainingCapacity(Arena* arena)
+{
+	return (size_t)arena->memoryBlock + arena->arenaCapacity - (size_t)arena->arenaPointer;
+}
+
 void ArenaFreeMarker(Arena* arena, ArenaMarker marker)
 {
 	arena->arenaPointer = (void*)marker;
@@ -19,4 +19,6 @@ void* ArenaAlloc(Arena* arena, size_t allocSize);
 void* ArenaAlignedAlloc(Arena* arena, size_t allocSize, size_t allocAlignment);
 void ArenaClear(Arena* arena);
 ArenaMarker ArenaGetMarker(Arena* arena);
+// Returns how many bytes can still be allocated from the arena (not counting alignment)
+size_t ArenaGetRemainingCapacity(Arena* arena);
 void ArenaFreeMarker(Arena* arena, ArenaMarker marker);
@@ -7,6 +7,7 @@
 #include "containers/hashmap_u64.h"
 #include "core/asserts.h"
 #include "core/logger.h"
+#include "core/platform.h"
 #include <stdlib.h>
 
 
@@ -63,12 +64,26 @@ typedef struct MemoryDebugState
     Allocator* allocInfoPool;                               // Pool allocator that contains all the alloc info structs
     u64 totalUserAllocated;                                 // Amount of memory allocated by the game
     u64 totalUserAllocationCount;                           // Amount of allocations done by the game
+    volatile i32 lock;                                      // Spin lock around the bookkeeping, allocators can be used from other threads (one thread per allocator)
 } MemoryDebugState;
 
 static bool memoryDebuggingAllocatorsCreated = false;
 static Allocator* memoryDebugAllocator;
 static MemoryDebugState* state = nullptr;
 
+// The bookkeeping of all allocators is shared, so it is locked even though every allocator is only used by one thread at a time.
+// The debug allocators (id 0) are only used inside the lock or on the main thread and don't need it.
+static inline void LockDebugState()
+{
+    while (PlatformAtomicAdd(&state->lock, 1) != 1)
+        PlatformAtomicAdd(&state->lock, -1);
+}
+
+static inline void UnlockDebugState()
+{
+    PlatformAtomicAdd(&state->lock, -1);
+}
+
 // ========================================= startup and shutdown =============================================
 void _StartMemoryDebugSubsys()
 {
@@ -288,7 +303,9 @@ void _UnregisterAllocator(u32 allocatorId, AllocatorType allocatorType)
         if (state->registeredAllocatorDarray->data[i].allocatorId == allocatorId)
         {
             // Removing all the info about the allocations that the allocator still contained
+            LockDebugState();
             u32 freedCount = _DebugFlushAllocator(state->registeredAllocatorDarray->data[i].allocator, state->registeredAllocatorDarray->data[i].muteDestruction);
+            UnlockDebugState();
             if (freedCount > 0 && !state->registeredAllocatorDarray->data[i].muteDestruction)
                 _WARN("Destroyed allocator with %u active allocation(s)", freedCount);
             DarrayPopAt(state->registeredAllocatorDarray, i);
@@ -344,6 +361,8 @@ void* DebugAlignedAlloc(Allocator* allocator, u64 size, u32 alignment, const cha
     }
     else // if normal allocation
     {
+        LockDebugState();
+
         // Updating total game allocation state
         state->totalUserAllocated += size;
         state->totalUserAllocationCount++;
@@ -364,6 +383,8 @@ void* DebugAlignedAlloc(Allocator* allocator, u64 size, u32 alignment, const cha
         allocInfo->file = file;
         allocInfo->line = line;
         MapU64Insert(state->allocationsMap, (u64)allocation, allocInfo);
+
+        UnlockDebugState();
         return allocation;
     }
 }
@@ -377,6 +398,8 @@ void* DebugRealloc(Allocator* allocator, void* block, u64 newSize, const char* f
     }
     else // if normal allocation
     {
+        LockDebugState();
+
         // Deleting the old alloc info
         AllocInfo* oldAllocInfo = MapU64Delete(state->allocationsMap, (u64)block);
 
@@ -436,6 +459,7 @@ void* DebugRealloc(Allocator* allocator, void* block, u64 newSize, const char* f
 
         Free(state->allocInfoPool, oldAllocInfo);
 
+        UnlockDebugState();
         return reallocation;
     }
 }
@@ -449,6 +473,8 @@ void DebugFree(Allocator* allocator, void* block, const char* file, u32 line)
     }
     else // if normal allocation
     {
+        LockDebugState();
+
         // Deleting the alloc info
         AllocInfo* allocInfo = MapU64Delete(state->allocationsMap, (u64)block);
         if (allocInfo == nullptr)
@@ -495,6 +521,8 @@ void DebugFree(Allocator* allocator, void* block, const char* file, u32 line)
             _aligned_free(block);
         else
             allocator->BackendFree(allocator, block);
+
+        UnlockDebugState();
     }
 }
 
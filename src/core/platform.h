@@ -22,4 +22,79 @@ void ToggleFullscreen();
 void SetFullscreen(bool enabled);
 
 // Returns time since system boot in seconds
-f64 PlatformGetTime();
\ No newline at end of file
+f64 PlatformGetTime();
+
+// ============================================ Threading ============================================
+typedef void (*PFN_PlatformThreadStart)(void* userData);
+
+// Handle to an OS thread
+typedef struct PlatformThread
+{
+	void* internalState;
+} PlatformThread;
+
+// Handle to a counting semaphore
+typedef struct PlatformSemaphore
+{
+	void* internalState;
+} PlatformSemaphore;
+
+// Handle to a mutex
+typedef struct PlatformMutex
+{
+	void* internalState;
+} PlatformMutex;
+
+// Returns the amount of logical processors on the system
+u32 PlatformGetProcessorCount();
+
+// Starts a thread that calls startFunction with userData
+PlatformThread PlatformThreadCreate(PFN_PlatformThreadStart startFunction, void* userData);
+// Blocks until the thread has returned from its start function and releases the thread handle
+void PlatformThreadJoin(PlatformThread thread);
+
+PlatformSemaphore PlatformSemaphoreCreate(u32 initialCount);
+void PlatformSemaphoreDestroy(PlatformSemaphore semaphore);
+// Increases the semaphore count by count, waking up to count waiting threads
+void PlatformSemaphoreSignal(PlatformSemaphore semaphore, u32 count);
+// Blocks until the semaphore count is above zero and decrements it
+void PlatformSemaphoreWait(PlatformSemaphore semaphore);
+
+PlatformMutex PlatformMutexCreate();
+void PlatformMutexDestroy(PlatformMutex mutex);
+void PlatformMutexLock(PlatformMutex mutex);
+// Returns true if the mutex was acquired, never blocks
+bool PlatformMutexTryLock(PlatformMutex mutex);
+void PlatformMutexUnlock(PlatformMutex mutex);
+
+// Atomically adds value to the i32 at addend and returns the resulting value
+i32 PlatformAtomicAdd(volatile i32* addend, i32 value);
+
+// ============================================ Files ============================================
+#define PLATFORM_MAX_FILE_NAME_LENGTH 260
+
+// Read only memory mapping of a whole file
+typedef struct PlatformMappedFile
+{
+	void* data;
+	u64 size;
+} PlatformMappedFile;
+
+typedef struct PlatformFileInfo
+{
+	char name[PLATFORM_MAX_FILE_NAME_LENGTH];	// Without the directory
+	u64 size;
+	u64 lastWriteTime;							// Only meaningful compared to other last write times
+} PlatformFileInfo;
+
+// Maps the whole file into memory read only, returns false if the file doesn't exist, is empty or can't be mapped
+bool PlatformMapFile(const char* path, PlatformMappedFile* out_mappedFile);
+void PlatformUnmapFile(PlatformMappedFile* mappedFile);
+// Writes info about up to maxFileCount files in the directory whose name ends with extension to out_files.
+// Returns the amount of matching files, which can be larger than maxFileCount.
+u32 PlatformListFiles(const char* directory, const char* extension, PlatformFileInfo* out_files, u32 maxFileCount);
+bool PlatformDeleteFile(const char* path);
+// Sets the last write time of the file to the current time without changing its contents
+bool PlatformTouchFile(const char* path);
+// Returns true if the directory exists after the call
+bool PlatformCreateDirectory(const char* path);
@@ -10,6 +10,7 @@
 #include <windows.h>
 #include <windowsx.h>
 #include <vulkan/vulkan_win32.h>
+#include <stdio.h>
 #include "core/logger.h"
 #include "core/asserts.h"
 #include "core/meminc.h"
@@ -261,6 +262,196 @@ f64 PlatformGetTime()
     return (f64)now_time.QuadPart * state->clockFrequency;
 }
 
+// ============ Threading =======================
+typedef struct Win32ThreadStartInfo
+{
+	PFN_PlatformThreadStart startFunction;
+	void* userData;
+	HANDLE handle;
+} Win32ThreadStartInfo;
+
+static DWORD WINAPI Win32ThreadStart(LPVOID parameter)
+{
+	Win32ThreadStartInfo* startInfo = parameter;
+	startInfo->startFunction(startInfo->userData);
+	return 0;
+}
+
+u32 PlatformGetProcessorCount()
+{
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	return systemInfo.dwNumberOfProcessors;
+}
+
+PlatformThread PlatformThreadCreate(PFN_PlatformThreadStart startFunction, void* userData)
+{
+	// The start info has to outlive this function, it gets freed when the thread is joined
+	Win32ThreadStartInfo* startInfo = Alloc(GetGlobalAllocator(), sizeof(*startInfo));
+	startInfo->startFunction = startFunction;
+	startInfo->userData = userData;
+	startInfo->handle = CreateThread(NULL, 0, Win32ThreadStart, startInfo, 0, NULL);
+	GRASSERT_MSG(startInfo->handle != NULL, "Thread creation failed");
+
+	PlatformThread thread = {};
+	thread.internalState = startInfo;
+	return thread;
+}
+
+void PlatformThreadJoin(PlatformThread thread)
+{
+	Win32ThreadStartInfo* startInfo = thread.internalState;
+	WaitForSingleObject(startInfo->handle, INFINITE);
+	CloseHandle(startInfo->handle);
+	Free(GetGlobalAllocator(), startInfo);
+}
+
+PlatformSemaphore PlatformSemaphoreCreate(u32 initialCount)
+{
+	PlatformSemaphore semaphore = {};
+	semaphore.internalState = CreateSemaphoreA(NULL, initialCount, INT32_MAX, NULL);
+	GRASSERT_MSG(semaphore.internalState != NULL, "Semaphore creation failed");
+	return semaphore;
+}
+
+void PlatformSemaphoreDestroy(PlatformSemaphore semaphore)
+{
+	CloseHandle(semaphore.internalState);
+}
+
+void PlatformSemaphoreSignal(PlatformSemaphore semaphore, u32 count)
+{
+	ReleaseSemaphore(semaphore.internalState, count, NULL);
+}
+
+void PlatformSemaphoreWait(PlatformSemaphore semaphore)
+{
+	WaitForSingleObject(semaphore.internalState, INFINITE);
+}
+
+PlatformMutex PlatformMutexCreate()
+{
+	PlatformMutex mutex = {};
+	mutex.internalState = Alloc(GetGlobalAllocator(), sizeof(CRITICAL_SECTION));
+	InitializeCriticalSection(mutex.internalState);
+	return mutex;
+}
+
+void PlatformMutexDestroy(PlatformMutex mutex)
+{
+	DeleteCriticalSection(mutex.internalState);
+	Free(GetGlobalAllocator(), mutex.internalState);
+}
+
+void PlatformMutexLock(PlatformMutex mutex)
+{
+	EnterCriticalSection(mutex.internalState);
+}
+
+bool PlatformMutexTryLock(PlatformMutex mutex)
+{
+	return TryEnterCriticalSection(mutex.internalState);
+}
+
+void PlatformMutexUnlock(PlatformMutex mutex)
+{
+	LeaveCriticalSection(mutex.internalState);
+}
+
+i32 PlatformAtomicAdd(volatile i32* addend, i32 value)
+{
+	return InterlockedExchangeAdd((volatile LONG*)addend, value) + value;
+}
+
+bool PlatformMapFile(const char* path, PlatformMappedFile* out_mappedFile)
+{
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	// The view keeps the mapping and the file open, so the handles can be closed right away
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL)
+		return false;
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (data == NULL)
+		return false;
+
+	out_mappedFile->data = data;
+	out_mappedFile->size = fileSize.QuadPart;
+	return true;
+}
+
+void PlatformUnmapFile(PlatformMappedFile* mappedFile)
+{
+	UnmapViewOfFile(mappedFile->data);
+	mappedFile->data = nullptr;
+	mappedFile->size = 0;
+}
+
+u32 PlatformListFiles(const char* directory, const char* extension, PlatformFileInfo* out_files, u32 maxFileCount)
+{
+	char searchPattern[MAX_PATH];
+	snprintf(searchPattern, sizeof(searchPattern), "%s\\*%s", directory, extension);
+
+	WIN32_FIND_DATAA findData;
+	HANDLE find = FindFirstFileA(searchPattern, &findData);
+	if (find == INVALID_HANDLE_VALUE)
+		return 0;
+
+	u32 fileCount = 0;
+	do
+	{
+		if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			continue;
+
+		if (fileCount < maxFileCount)
+		{
+			PlatformFileInfo* fileInfo = &out_files[fileCount];
+			snprintf(fileInfo->name, sizeof(fileInfo->name), "%s", findData.cFileName);
+			fileInfo->size = ((u64)findData.nFileSizeHigh << 32) | findData.nFileSizeLow;
+			fileInfo->lastWriteTime = ((u64)findData.ftLastWriteTime.dwHighDateTime << 32) | findData.ftLastWriteTime.dwLowDateTime;
+		}
+		fileCount++;
+	} while (FindNextFileA(find, &findData));
+
+	FindClose(find);
+	return fileCount;
+}
+
+bool PlatformDeleteFile(const char* path)
+{
+	return DeleteFileA(path);
+}
+
+bool PlatformTouchFile(const char* path)
+{
+	HANDLE file = CreateFileA(path, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	FILETIME now;
+	GetSystemTimeAsFileTime(&now);
+	bool success = SetFileTime(file, NULL, NULL, &now);
+	CloseHandle(file);
+	return success;
+}
+
+bool PlatformCreateDirectory(const char* path)
+{
+	return CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
 static LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
 	switch (uMsg)
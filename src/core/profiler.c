@@ -8,6 +8,7 @@
 #include <string.h>
 
 #define MAX_SCOPE_DEPTH 16
+#define MAX_COUNTERS 32
 
 
 typedef struct Scope
@@ -19,10 +20,19 @@ typedef struct Scope
 
 DEFINE_DARRAY_TYPE(Scope);
 
+typedef struct Counter
+{
+	const char* name;
+	u64 count;
+} Counter;
+
+DEFINE_DARRAY_TYPE(Counter);
+
 typedef struct ProfilerState
 {
 	Timer perfTimer;
 	ScopeDarray* scopesDarray;
+	CounterDarray* countersDarray;
 	u32 scopeDepth;
 } ProfilerState;
 
@@ -33,11 +43,13 @@ void _InitializeProfiler()
 {
 	StartOrResetTimer(&state.perfTimer);
 	state.scopesDarray = ScopeDarrayCreate(MAX_SCOPE_DEPTH, GetGlobalAllocator());
+	state.countersDarray = CounterDarrayCreate(MAX_COUNTERS, GetGlobalAllocator());
 	state.scopeDepth = 0;
 }
 
 void _ShutdownProfiler()
 {
+	DarrayDestroy(state.countersDarray);
 	DarrayDestroy(state.scopesDarray);
 }
 
@@ -65,4 +77,46 @@ void _EndScope()
 	DarrayPop(state.scopesDarray);
 }
 
+void _EndScopeThroughput(u64 itemCount, const char* itemName)
+{
+	state.scopeDepth--;
+	GRASSERT(state.scopeDepth >= 0 && state.scopeDepth != UINT32_MAX);
+
+	Scope scope = state.scopesDarray->data[state.scopeDepth];
+	f64 seconds = TimerSecondsSinceStart(state.perfTimer) - scope.startTime;
+	_DEBUG("Profiler: Scope \"%s\", took %f seconds for %llu %s, %.0f %s per second.", scope.name, seconds, (unsigned long long)itemCount, itemName, itemCount / seconds, itemName);
+
+	DarrayPop(state.scopesDarray);
+}
+
+static Counter* FindCounter(const char* name)
+{
+	for (u32 i = 0; i < state.countersDarray->size; i++)
+	{
+		if (strcmp(state.countersDarray->data[i].name, name) == 0)
+			return &state.countersDarray->data[i];
+	}
+	return nullptr;
+}
+
+void _IncrementCounter(const char* name)
+{
+	Counter* counter = FindCounter(name);
+	if (!counter)
+	{
+		GRASSERT(state.countersDarray->size < MAX_COUNTERS);
+		Counter newCounter = {};
+		newCounter.name = name;
+		CounterDarrayPushback(state.countersDarray, &newCounter);
+		counter = &state.countersDarray->data[state.countersDarray->size - 1];
+	}
+
+	counter->count++;
+	_DEBUG("Profiler: Counter \"%s\", now at %llu.", counter->name, counter->count);
+}
 
+u64 _GetCounter(const char* name)
+{
+	Counter* counter = FindCounter(name);
+	return counter ? counter->count : 0;
+}
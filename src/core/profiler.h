@@ -15,6 +15,18 @@ void _EndScope();
 #define START_SCOPE(name) _StartScope(name)
 #define END_SCOPE() _EndScope()
 
+// Ends the scope like END_SCOPE and also logs how many items (e.g. rays) per second were processed in it, itemName is the plural name of the items
+void _EndScopeThroughput(u64 itemCount, const char* itemName);
+
+#define END_SCOPE_THROUGHPUT(itemCount, itemName) _EndScopeThroughput(itemCount, itemName)
+
+// Named counters for events that aren't timed, e.g. cache hits and misses. Counters are identified by their name string.
+void _IncrementCounter(const char* name);
+u64 _GetCounter(const char* name);
+
+#define INCREMENT_COUNTER(name) _IncrementCounter(name)
+#define GET_COUNTER(name) _GetCounter(name)
+
 #else
 
 #define INITIALIZE_PROFILER()
@@ -22,6 +34,10 @@ void _EndScope();
 
 #define START_SCOPE(name)
 #define END_SCOPE()
+#define END_SCOPE_THROUGHPUT(itemCount, itemName)
+
+#define INCREMENT_COUNTER(name)
+#define GET_COUNTER(name) 0
 
 #endif
 
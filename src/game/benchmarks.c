@@ -0,0 +1,2309 @@
+#include "benchmarks.h"
+
+#include "core/engine.h"
+#include "core/timer.h"
+#include "core/logger.h"
+#include "core/job_system.h"
+#include "renderer/ui/debug_ui.h"
+#include "marching_cubes/marching_cubes.h"
+#include "marching_cubes/terrain_density_functions.h"
+#include "marching_cubes/density_map_raycast.h"
+#include "renderer/mesh_optimizer.h"
+#include "math/random_utils.h"
+#include "collision.h"
+#include "world_generation.h"
+#include <float.h>
+
+// Every benchmark is run this many times and the fastest run is reported
+#define BENCHMARK_REPEAT_COUNT 3
+#define BENCHMARK_SEED 0
+// Resolution at which the benchmark terrain settings are defined, they get scaled to the resolution of the density map
+#define BENCHMARK_REFERENCE_RESOLUTION 100
+
+typedef struct BenchmarksState
+{
+	DebugMenu* benchmarksMenu;
+	bool runMarchingCubesThreadScaling;
+	bool runIndexedMarchingCubes;
+	bool runCellClassification;
+	bool runBrickSkipping;
+	bool runChunkRemeshing;
+	bool runSeparableBlur;
+	bool runBoxBlur;
+	bool runTunnelGrid;
+	bool runDensityEvaluation;
+	bool runQuantizedDensity;
+	bool runDensityLayouts;
+	bool runSurfaceNets;
+	bool runSimplification;
+	bool runVertexCacheOptimization;
+	bool runVertexPacking;
+	bool runVertexWelding;
+	bool runMeshBvh;
+	bool runRayPackets;
+	bool runRaycastBatches;
+	bool runDensityRaycasts;
+	bool runSweeps;
+} BenchmarksState;
+
+static BenchmarksState state;
+
+static void BenchmarkMarchingCubesThreadScaling();
+static void BenchmarkIndexedMarchingCubes();
+static void BenchmarkCellClassification();
+static void BenchmarkBrickSkipping();
+static void BenchmarkChunkRemeshing();
+static void BenchmarkSeparableBlur();
+static void BenchmarkBoxBlur();
+static void BenchmarkTunnelGrid();
+static void BenchmarkDensityEvaluation();
+static void BenchmarkQuantizedDensity();
+static void BenchmarkDensityLayouts();
+static void BenchmarkSurfaceNets();
+static void BenchmarkSimplification();
+static void BenchmarkVertexCacheOptimization();
+static void BenchmarkVertexPacking();
+static void BenchmarkVertexWelding();
+static void BenchmarkMeshBvh();
+static void BenchmarkRayPackets();
+static void BenchmarkRaycastBatches();
+static void BenchmarkDensityRaycasts();
+static void BenchmarkSweeps();
+
+
+void BenchmarksInit()
+{
+	state.benchmarksMenu = DebugUICreateMenu("Benchmarks", DEBUG_UI_DEFAULT_MENU_GROUP_NAME, 0);
+	DebugUIAddButton(state.benchmarksMenu, "Marching cubes thread scaling", nullptr, &state.runMarchingCubesThreadScaling);
+	DebugUIAddButton(state.benchmarksMenu, "Indexed marching cubes", nullptr, &state.runIndexedMarchingCubes);
+	DebugUIAddButton(state.benchmarksMenu, "Marching cubes cell classification", nullptr, &state.runCellClassification);
+	DebugUIAddButton(state.benchmarksMenu, "Density brick skipping", nullptr, &state.runBrickSkipping);
+	DebugUIAddButton(state.benchmarksMenu, "Chunk remeshing after edits", nullptr, &state.runChunkRemeshing);
+	DebugUIAddButton(state.benchmarksMenu, "Separable gaussian blur", nullptr, &state.runSeparableBlur);
+	DebugUIAddButton(state.benchmarksMenu, "Summed volume table box blur", nullptr, &state.runBoxBlur);
+	DebugUIAddButton(state.benchmarksMenu, "Bezier tunnel grid", nullptr, &state.runTunnelGrid);
+	DebugUIAddButton(state.benchmarksMenu, "Density function evaluation", nullptr, &state.runDensityEvaluation);
+	DebugUIAddButton(state.benchmarksMenu, "Quantized density maps", nullptr, &state.runQuantizedDensity);
+	DebugUIAddButton(state.benchmarksMenu, "Flat vs bricked density layout", nullptr, &state.runDensityLayouts);
+	DebugUIAddButton(state.benchmarksMenu, "Surface nets vs marching cubes", nullptr, &state.runSurfaceNets);
+	DebugUIAddButton(state.benchmarksMenu, "Quadric mesh simplification", nullptr, &state.runSimplification);
+	DebugUIAddButton(state.benchmarksMenu, "Vertex cache optimization", nullptr, &state.runVertexCacheOptimization);
+	DebugUIAddButton(state.benchmarksMenu, "Packed chunk vertices", nullptr, &state.runVertexPacking);
+	DebugUIAddButton(state.benchmarksMenu, "Vertex welding", nullptr, &state.runVertexWelding);
+	DebugUIAddButton(state.benchmarksMenu, "Mesh bvh raycasts", nullptr, &state.runMeshBvh);
+	DebugUIAddButton(state.benchmarksMenu, "Bvh ray packets", nullptr, &state.runRayPackets);
+	DebugUIAddButton(state.benchmarksMenu, "Raycast batch thread scaling", nullptr, &state.runRaycastBatches);
+	DebugUIAddButton(state.benchmarksMenu, "Density map raycasts", nullptr, &state.runDensityRaycasts);
+	DebugUIAddButton(state.benchmarksMenu, "Sphere and capsule sweeps", nullptr, &state.runSweeps);
+}
+
+void BenchmarksUpdate()
+{
+	if (state.runMarchingCubesThreadScaling)
+	{
+		state.runMarchingCubesThreadScaling = false;
+		BenchmarkMarchingCubesThreadScaling();
+	}
+
+	if (state.runIndexedMarchingCubes)
+	{
+		state.runIndexedMarchingCubes = false;
+		BenchmarkIndexedMarchingCubes();
+	}
+
+	if (state.runCellClassification)
+	{
+		state.runCellClassification = false;
+		BenchmarkCellClassification();
+	}
+
+	if (state.runBrickSkipping)
+	{
+		state.runBrickSkipping = false;
+		BenchmarkBrickSkipping();
+	}
+
+	if (state.runChunkRemeshing)
+	{
+		state.runChunkRemeshing = false;
+		BenchmarkChunkRemeshing();
+	}
+
+	if (state.runSeparableBlur)
+	{
+		state.runSeparableBlur = false;
+		BenchmarkSeparableBlur();
+	}
+
+	if (state.runBoxBlur)
+	{
+		state.runBoxBlur = false;
+		BenchmarkBoxBlur();
+	}
+
+	if (state.runTunnelGrid)
+	{
+		state.runTunnelGrid = false;
+		BenchmarkTunnelGrid();
+	}
+
+	if (state.runDensityEvaluation)
+	{
+		state.runDensityEvaluation = false;
+		BenchmarkDensityEvaluation();
+	}
+
+	if (state.runQuantizedDensity)
+	{
+		state.runQuantizedDensity = false;
+		BenchmarkQuantizedDensity();
+	}
+
+	if (state.runDensityLayouts)
+	{
+		state.runDensityLayouts = false;
+		BenchmarkDensityLayouts();
+	}
+
+	if (state.runSurfaceNets)
+	{
+		state.runSurfaceNets = false;
+		BenchmarkSurfaceNets();
+	}
+
+	if (state.runSimplification)
+	{
+		state.runSimplification = false;
+		BenchmarkSimplification();
+	}
+
+	if (state.runVertexCacheOptimization)
+	{
+		state.runVertexCacheOptimization = false;
+		BenchmarkVertexCacheOptimization();
+	}
+
+	if (state.runVertexPacking)
+	{
+		state.runVertexPacking = false;
+		BenchmarkVertexPacking();
+	}
+
+	if (state.runVertexWelding)
+	{
+		state.runVertexWelding = false;
+		BenchmarkVertexWelding();
+	}
+
+	if (state.runMeshBvh)
+	{
+		state.runMeshBvh = false;
+		BenchmarkMeshBvh();
+	}
+
+	if (state.runRayPackets)
+	{
+		state.runRayPackets = false;
+		BenchmarkRayPackets();
+	}
+
+	if (state.runRaycastBatches)
+	{
+		state.runRaycastBatches = false;
+		BenchmarkRaycastBatches();
+	}
+
+	if (state.runDensityRaycasts)
+	{
+		state.runDensityRaycasts = false;
+		BenchmarkDensityRaycasts();
+	}
+
+	if (state.runSweeps)
+	{
+		state.runSweeps = false;
+		BenchmarkSweeps();
+	}
+}
+
+void BenchmarksShutdown()
+{
+	DebugUIDestroyMenu(state.benchmarksMenu);
+}
+
+// Settings of the bezier hole terrain that all world generation benchmarks run on
+static BezierDensityFuncSettings GetBenchmarkTerrainSettings(u32 resolution)
+{
+	BezierDensityFuncSettings settings = {};
+	settings.baseSphereRadius = 0.4f * resolution;
+	settings.bezierTunnelCount = 5;
+	settings.bezierTunnelRadius = 5.f * resolution / BENCHMARK_REFERENCE_RESOLUTION;
+	settings.bezierTunnelControlPoints = 4;
+	settings.sphereHoleCount = 3;
+	settings.sphereHoleRadius = 6.f * resolution / BENCHMARK_REFERENCE_RESOLUTION;
+	return settings;
+}
+
+// Generates the bezier hole terrain that all world generation benchmarks run on, free with Free(GetGlobalAllocator(), densityMap)
+static f32* CreateBenchmarkDensityMap(u32 resolution)
+{
+	f32* densityMap = Alloc(GetGlobalAllocator(), sizeof(*densityMap) * resolution * resolution * resolution);
+
+	BezierDensityFuncSettings settings = GetBenchmarkTerrainSettings(resolution);
+	u32 seed = BENCHMARK_SEED;
+	DensityFuncBezierCurveHole(&seed, &settings, densityMap, resolution, nullptr);
+
+	return densityMap;
+}
+
+// Copy of a mesh in the global allocator, used to compare benchmark outputs without keeping two large meshes alive in the large object allocator
+typedef struct ReferenceMesh
+{
+	void* vertices;
+	u32* indices;
+	u32 vertexCount;
+	u32 indexCount;
+	u32 vertexStride;
+} ReferenceMesh;
+
+static ReferenceMesh CreateReferenceMesh(MeshData mesh)
+{
+	ReferenceMesh reference = {};
+	reference.vertexCount = mesh.vertexCount;
+	reference.indexCount = mesh.indexCount;
+	reference.vertexStride = mesh.vertexStride;
+	reference.vertices = Alloc(GetGlobalAllocator(), mesh.vertexCount * mesh.vertexStride);
+	reference.indices = Alloc(GetGlobalAllocator(), mesh.indexCount * sizeof(*mesh.indices));
+	MemoryCopy(reference.vertices, mesh.vertices, mesh.vertexCount * mesh.vertexStride);
+	MemoryCopy(reference.indices, mesh.indices, mesh.indexCount * sizeof(*mesh.indices));
+	return reference;
+}
+
+static void DestroyReferenceMesh(ReferenceMesh reference)
+{
+	Free(GetGlobalAllocator(), reference.vertices);
+	Free(GetGlobalAllocator(), reference.indices);
+}
+
+static bool MeshEqualsReference(MeshData mesh, ReferenceMesh reference)
+{
+	return mesh.vertexCount == reference.vertexCount && mesh.indexCount == reference.indexCount && mesh.vertexStride == reference.vertexStride &&
+		   MemoryCompare(mesh.vertices, reference.vertices, mesh.vertexCount * mesh.vertexStride) &&
+		   MemoryCompare(mesh.indices, reference.indices, mesh.indexCount * sizeof(*mesh.indices));
+}
+
+static void BenchmarkMarchingCubesThreadScaling()
+{
+	u32 resolutions[] = { 50, 100, 200 };
+	u32 resolutionCount = sizeof(resolutions) / sizeof(*resolutions);
+	u32 maxThreadCount = JobSystemGetThreadCount();
+
+	_INFO("==================== Benchmark: marching cubes thread scaling ====================");
+
+	for (u32 i = 0; i < resolutionCount; i++)
+	{
+		u32 resolution = resolutions[i];
+		f32* densityMap = CreateBenchmarkDensityMap(resolution);
+
+		// Serial version is the baseline
+		f64 serialTime = 1000000;
+		ReferenceMesh serialMesh = {};
+		for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+		{
+			Timer timer;
+			StartOrResetTimer(&timer);
+			MeshData mesh = MarchingCubesGenerateMesh(densityMap, resolution, resolution, resolution, nullptr);
+			f64 time = TimerSecondsSinceStart(timer);
+			if (time < serialTime)
+				serialTime = time;
+			if (repeat == 0)
+				serialMesh = CreateReferenceMesh(mesh);
+			MarchingCubesFreeMeshData(mesh);
+		}
+
+		_INFO("Resolution %u, %u vertices, serial: %.3f ms", resolution, serialMesh.vertexCount, serialTime * 1000);
+
+		// Doubling the thread count every step and always ending with the maximum amount of threads
+		u32 threadCount = 1;
+		while (true)
+		{
+			f64 bestTime = 1000000;
+			bool identical = true;
+			for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+			{
+				Timer timer;
+				StartOrResetTimer(&timer);
+				MeshData mesh = MarchingCubesGenerateMeshMultithreaded(densityMap, resolution, resolution, resolution, nullptr, threadCount);
+				f64 time = TimerSecondsSinceStart(timer);
+				if (time < bestTime)
+					bestTime = time;
+				identical = identical && MeshEqualsReference(mesh, serialMesh);
+				MarchingCubesFreeMeshData(mesh);
+			}
+
+			_INFO("Resolution %u, %2u threads: %.3f ms, %.2fx speedup, output %s", resolution, threadCount, bestTime * 1000, serialTime / bestTime, identical ? "identical" : "DIFFERENT");
+
+			if (threadCount == maxThreadCount)
+				break;
+			threadCount *= 2;
+			if (threadCount > maxThreadCount)
+				threadCount = maxThreadCount;
+		}
+
+		DestroyReferenceMesh(serialMesh);
+		Free(GetGlobalAllocator(), densityMap);
+	}
+}
+
+static void BenchmarkIndexedMarchingCubes()
+{
+	// The unindexed mesh and the merged mesh of a 200 resolution map don't fit in the large object allocator at the same time
+	u32 resolutions[] = { 50, 100, 150 };
+	u32 resolutionCount = sizeof(resolutions) / sizeof(*resolutions);
+
+	_INFO("==================== Benchmark: indexed marching cubes vs marching cubes + merge normals ====================");
+
+	for (u32 i = 0; i < resolutionCount; i++)
+	{
+		u32 resolution = resolutions[i];
+		f32* densityMap = CreateBenchmarkDensityMap(resolution);
+
+		// Old path, unshared vertices that get welded afterwards
+		f64 mergeTime = 1000000;
+		u32 unsharedVertexCount = 0;
+		u32 mergedVertexCount = 0;
+		u32 mergedIndexCount = 0;
+		for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+		{
+			Timer timer;
+			StartOrResetTimer(&timer);
+			MeshData mesh = MarchingCubesGenerateMesh(densityMap, resolution, resolution, resolution, nullptr);
+			MeshData mergedMesh = MeshOptimizerMergeNormals(mesh, offsetof(VertexT2, position), offsetof(VertexT2, normal));
+			f64 time = TimerSecondsSinceStart(timer);
+			if (time < mergeTime)
+				mergeTime = time;
+			unsharedVertexCount = mesh.vertexCount;
+			mergedVertexCount = mergedMesh.vertexCount;
+			mergedIndexCount = mergedMesh.indexCount;
+			MeshOptimizerFreeMeshData(mergedMesh);
+			MarchingCubesFreeMeshData(mesh);
+		}
+
+		// New path, vertices are shared while extracting
+		f64 indexedTime = 1000000;
+		u32 indexedVertexCount = 0;
+		u32 indexedIndexCount = 0;
+		for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+		{
+			Timer timer;
+			StartOrResetTimer(&timer);
+			MeshData mesh = MarchingCubesGenerateMeshIndexed(densityMap, resolution, resolution, resolution, nullptr);
+			f64 time = TimerSecondsSinceStart(timer);
+			if (time < indexedTime)
+				indexedTime = time;
+			indexedVertexCount = mesh.vertexCount;
+			indexedIndexCount = mesh.indexCount;
+			MarchingCubesFreeMeshData(mesh);
+		}
+
+		_INFO("Resolution %u, marching cubes + merge: %.3f ms, %u unshared vertices (%.2f MiB) merged to %u vertices",
+			  resolution, mergeTime * 1000, unsharedVertexCount, unsharedVertexCount * sizeof(VertexT2) / (1024.0 * 1024.0), mergedVertexCount);
+		_INFO("Resolution %u, indexed marching cubes: %.3f ms, %u vertices (%.2f MiB), %.2fx speedup, %.2fx less vertex memory, %u triangles (merged mesh has %u)",
+			  resolution, indexedTime * 1000, indexedVertexCount, indexedVertexCount * sizeof(VertexT2) / (1024.0 * 1024.0), mergeTime / indexedTime,
+			  unsharedVertexCount / (f64)indexedVertexCount, indexedIndexCount / 3, mergedIndexCount / 3);
+
+		Free(GetGlobalAllocator(), densityMap);
+	}
+}
+
+static void BenchmarkCellClassification()
+{
+	u32 resolutions[] = { 50, 100, 200 };
+	u32 resolutionCount = sizeof(resolutions) / sizeof(*resolutions);
+
+	_INFO("==================== Benchmark: marching cubes cell classification ====================");
+
+	for (u32 i = 0; i < resolutionCount; i++)
+	{
+		u32 resolution = resolutions[i];
+		f32* densityMap = CreateBenchmarkDensityMap(resolution);
+		u64 cellCount = (u64)(resolution - 1) * (resolution - 1) * (resolution - 1);
+
+		f64 scalarTime = 1000000;
+		f64 simdTime = 1000000;
+		u64 scalarActiveCellCount = 0;
+		u64 simdActiveCellCount = 0;
+		for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+		{
+			Timer timer;
+			StartOrResetTimer(&timer);
+			scalarActiveCellCount = MarchingCubesCountActiveCells(densityMap, resolution, resolution, resolution, nullptr, true);
+			f64 time = TimerSecondsSinceStart(timer);
+			if (time < scalarTime)
+				scalarTime = time;
+
+			StartOrResetTimer(&timer);
+			simdActiveCellCount = MarchingCubesCountActiveCells(densityMap, resolution, resolution, resolution, nullptr, false);
+			time = TimerSecondsSinceStart(timer);
+			if (time < simdTime)
+				simdTime = time;
+		}
+
+		_INFO("Resolution %u, %llu cells, %llu active (%.2f%%), %s", resolution, cellCount, simdActiveCellCount, 100.0 * simdActiveCellCount / cellCount,
+			  scalarActiveCellCount == simdActiveCellCount ? "scalar and SIMD agree" : "scalar and SIMD DIFFER");
+		_INFO("Resolution %u, scalar: %.3f ms (%.1f Mcells/s), SIMD: %.3f ms (%.1f Mcells/s), %.2fx speedup", resolution,
+			  scalarTime * 1000, cellCount / scalarTime / 1000000, simdTime * 1000, cellCount / simdTime / 1000000, scalarTime / simdTime);
+
+		Free(GetGlobalAllocator(), densityMap);
+	}
+}
+
+// Amount of random rays that are cast at the terrain in the brick skipping benchmark
+#define BRICK_SKIPPING_RAY_COUNT 200
+#define BRICK_SKIPPING_BLUR_RESOLUTION 100
+#define BRICK_SKIPPING_BLUR_KERNEL_SIZE 5
+
+static void BenchmarkBrickSkipping()
+{
+	u32 resolutions[] = { 50, 100, 200 };
+	u32 resolutionCount = sizeof(resolutions) / sizeof(*resolutions);
+
+	_INFO("==================== Benchmark: density brick skipping ====================");
+
+	for (u32 i = 0; i < resolutionCount; i++)
+	{
+		u32 resolution = resolutions[i];
+		f32* densityMap = CreateBenchmarkDensityMap(resolution);
+
+		// Building the brick map
+		DensityBrickMap brickMap = DensityBrickMapCreate(GetGlobalAllocator(), resolution, resolution, resolution);
+		f64 brickMapTime = 1000000;
+		for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+		{
+			Timer timer;
+			StartOrResetTimer(&timer);
+			DensityBrickMapUpdate(&brickMap, densityMap);
+			f64 time = TimerSecondsSinceStart(timer);
+			if (time < brickMapTime)
+				brickMapTime = time;
+		}
+
+		u32 brickCount = brickMap.brickCountX * brickMap.brickCountY * brickMap.brickCountZ;
+		u32 surfaceBrickCount = 0;
+		for (u32 brick = 0; brick < brickCount; brick++)
+			surfaceBrickCount += DensityBrickMapBrickHasSurface(&brickMap, brick);
+
+		_INFO("Resolution %u, %u of %u bricks contain surface (%.2f%%), building the brick map: %.3f ms", resolution, surfaceBrickCount, brickCount, 100.0 * surfaceBrickCount / brickCount, brickMapTime * 1000);
+
+		// Meshing with and without the brick map
+		f64 meshTimes[2] = { 1000000, 1000000 };
+		ReferenceMesh referenceMesh = {};
+		bool identical = true;
+		for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+		{
+			for (u32 useBricks = 0; useBricks < 2; useBricks++)
+			{
+				Timer timer;
+				StartOrResetTimer(&timer);
+				MeshData mesh = MarchingCubesGenerateMeshIndexed(densityMap, resolution, resolution, resolution, useBricks ? &brickMap : nullptr);
+				f64 time = TimerSecondsSinceStart(timer);
+				if (time < meshTimes[useBricks])
+					meshTimes[useBricks] = time;
+				if (repeat == 0 && useBricks == 0)
+					referenceMesh = CreateReferenceMesh(mesh);
+				else
+					identical = identical && MeshEqualsReference(mesh, referenceMesh);
+				MarchingCubesFreeMeshData(mesh);
+			}
+		}
+
+		_INFO("Resolution %u, indexed marching cubes without bricks: %.3f ms, with bricks: %.3f ms, %.2fx speedup, output %s",
+			  resolution, meshTimes[0] * 1000, meshTimes[1] * 1000, meshTimes[0] / meshTimes[1], identical ? "identical" : "DIFFERENT");
+
+		// Casting random rays from outside of the map towards random points in the map, rays the brick map rejects have to miss the mesh.
+		// The reference mesh is used as the collider.
+		MeshData mesh = {};
+		mesh.vertices = referenceMesh.vertices;
+		mesh.indices = referenceMesh.indices;
+		mesh.vertexCount = referenceMesh.vertexCount;
+		mesh.indexCount = referenceMesh.indexCount;
+		mesh.vertexStride = referenceMesh.vertexStride;
+		vec3 mapCenter = vec3_from_float(resolution * 0.5f);
+
+		u32 seed = BENCHMARK_SEED;
+		u32 rejectedRayCount = 0;
+		u32 wronglyRejectedRayCount = 0;
+		f64 bruteForceTime = 0;
+		f64 brickTime = 0;
+		for (u32 ray = 0; ray < BRICK_SKIPPING_RAY_COUNT; ray++)
+		{
+			vec3 origin = vec3_add_vec3(vec3_mul_f32(RandomPointOnUnitSphere(&seed), resolution), mapCenter);
+			vec3 target = vec3_add_vec3(vec3_mul_f32(RandomPointInUnitSphere(&seed), resolution * 0.6f), mapCenter);
+			vec3 direction = vec3_normalize(vec3_sub_vec3(target, origin));
+
+			Timer timer;
+			StartOrResetTimer(&timer);
+			RaycastHit bruteForceHit = RaycastMesh(origin, direction, mesh, mat4_identity(), offsetof(VertexT2, position), offsetof(VertexT2, normal));
+			bruteForceTime += TimerSecondsSinceStart(timer);
+
+			StartOrResetTimer(&timer);
+			bool mayHit = DensityBrickMapRayMayHitSurface(&brickMap, origin, direction);
+			if (mayHit)
+				RaycastMesh(origin, direction, mesh, mat4_identity(), offsetof(VertexT2, position), offsetof(VertexT2, normal));
+			brickTime += TimerSecondsSinceStart(timer);
+
+			if (!mayHit)
+				rejectedRayCount++;
+			if (!mayHit && bruteForceHit.hit)
+				wronglyRejectedRayCount++;
+		}
+
+		_INFO("Resolution %u, %u raycasts, %u rejected by the brick map (%u wrongly), brute force: %.3f ms, with brick map early out: %.3f ms",
+			  resolution, BRICK_SKIPPING_RAY_COUNT, rejectedRayCount, wronglyRejectedRayCount, bruteForceTime * 1000, brickTime * 1000);
+
+		DestroyReferenceMesh(referenceMesh);
+
+		// Blurring with and without skipping uniform bricks
+		if (resolution == BRICK_SKIPPING_BLUR_RESOLUTION)
+		{
+			u32 valueCount = resolution * resolution * resolution;
+			f32* blurredMaps[2];
+			f64 blurTimes[2];
+			for (u32 skipBricks = 0; skipBricks < 2; skipBricks++)
+			{
+				blurredMaps[skipBricks] = Alloc(GetGlobalAllocator(), sizeof(*densityMap) * valueCount);
+				MemoryCopy(blurredMaps[skipBricks], densityMap, sizeof(*densityMap) * valueCount);
+				Timer timer;
+				StartOrResetTimer(&timer);
+				BlurDensityMapGaussianReference(1, BRICK_SKIPPING_BLUR_KERNEL_SIZE, blurredMaps[skipBricks], resolution, resolution, resolution, skipBricks);
+				blurTimes[skipBricks] = TimerSecondsSinceStart(timer);
+			}
+
+			f32 maxDifference = 0;
+			for (u32 value = 0; value < valueCount; value++)
+			{
+				f32 difference = fabsf(blurredMaps[0][value] - blurredMaps[1][value]);
+				if (difference > maxDifference)
+					maxDifference = difference;
+			}
+
+			_INFO("Resolution %u, reference gaussian blur (kernel %u) without bricks: %.3f ms, skipping uniform bricks: %.3f ms, %.2fx speedup, max difference %g",
+				  resolution, BRICK_SKIPPING_BLUR_KERNEL_SIZE, blurTimes[0] * 1000, blurTimes[1] * 1000, blurTimes[0] / blurTimes[1], maxDifference);
+
+			Free(GetGlobalAllocator(), blurredMaps[0]);
+			Free(GetGlobalAllocator(), blurredMaps[1]);
+		}
+
+		DensityBrickMapDestroy(GetGlobalAllocator(), &brickMap);
+		Free(GetGlobalAllocator(), densityMap);
+	}
+}
+
+#define CHUNK_REMESHING_EDIT_COUNT 20
+// Edit radius at BENCHMARK_REFERENCE_RESOLUTION
+#define CHUNK_REMESHING_EDIT_RADIUS 4.f
+
+static void BenchmarkChunkRemeshing()
+{
+	u32 resolutions[] = { 100, 200 };
+	u32 resolutionCount = sizeof(resolutions) / sizeof(*resolutions);
+
+	_INFO("==================== Benchmark: chunk remeshing after edits ====================");
+
+	for (u32 i = 0; i < resolutionCount; i++)
+	{
+		u32 resolution = resolutions[i];
+		f32* densityMap = CreateBenchmarkDensityMap(resolution);
+		DensityBrickMap brickMap = DensityBrickMapCreate(GetGlobalAllocator(), resolution, resolution, resolution);
+		DensityBrickMapUpdate(&brickMap, densityMap);
+
+		// Meshing the whole map at once, this is what every edit cost before the world was split into chunks
+		f64 fullMeshTime = 1000000;
+		u32 fullMeshIndexCount = 0;
+		for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+		{
+			Timer timer;
+			StartOrResetTimer(&timer);
+			MeshData mesh = MarchingCubesGenerateMeshIndexed(densityMap, resolution, resolution, resolution, &brickMap);
+			f64 time = TimerSecondsSinceStart(timer);
+			if (time < fullMeshTime)
+				fullMeshTime = time;
+			fullMeshIndexCount = mesh.indexCount;
+			MarchingCubesFreeMeshData(mesh);
+		}
+
+		// Meshing every chunk
+		u32 cubeCount = resolution - 1;
+		u32 chunksPerAxis = (cubeCount + WORLD_CHUNK_SIZE - 1) / WORLD_CHUNK_SIZE;
+		u32 chunkCount = chunksPerAxis * chunksPerAxis * chunksPerAxis;
+		MarchingCubesRegion* chunkRegions = Alloc(GetGlobalAllocator(), sizeof(*chunkRegions) * chunkCount);
+		MeshData* chunkMeshes = Alloc(GetGlobalAllocator(), sizeof(*chunkMeshes) * chunkCount);
+		bool* dirtyChunks = Alloc(GetGlobalAllocator(), sizeof(*dirtyChunks) * chunkCount);
+
+		Timer timer;
+		StartOrResetTimer(&timer);
+		u32 chunkIndexCount = 0;
+		for (u32 chunk = 0; chunk < chunkCount; chunk++)
+		{
+			u32 chunkCoords[3] = { chunk / (chunksPerAxis * chunksPerAxis), (chunk / chunksPerAxis) % chunksPerAxis, chunk % chunksPerAxis };
+			u32 regionStart[3];
+			u32 regionEnd[3];
+			for (u32 axis = 0; axis < 3; axis++)
+			{
+				regionStart[axis] = chunkCoords[axis] * WORLD_CHUNK_SIZE;
+				regionEnd[axis] = regionStart[axis] + WORLD_CHUNK_SIZE < cubeCount ? regionStart[axis] + WORLD_CHUNK_SIZE : cubeCount;
+			}
+			chunkRegions[chunk] = (MarchingCubesRegion){ regionStart[0], regionStart[1], regionStart[2], regionEnd[0], regionEnd[1], regionEnd[2] };
+			chunkMeshes[chunk] = MarchingCubesGenerateMeshIndexedRegion(densityMap, resolution, resolution, resolution, &brickMap, chunkRegions[chunk]);
+			chunkIndexCount += chunkMeshes[chunk].indexCount;
+		}
+		f64 allChunksTime = TimerSecondsSinceStart(timer);
+
+		_INFO("Resolution %u, full indexed mesh: %.3f ms, %u chunks of %u cubes: %.3f ms, triangles %s",
+			  resolution, fullMeshTime * 1000, chunkCount, WORLD_CHUNK_SIZE, allChunksTime * 1000, chunkIndexCount == fullMeshIndexCount ? "match" : "DON'T MATCH");
+
+		// Alternating between digging and filling spheres on the surface of the base sphere, timing the edit and remeshing the dirty chunks
+		u32 seed = BENCHMARK_SEED;
+		vec3 mapCenter = vec3_from_float(resolution * 0.5f);
+		f32 editRadius = CHUNK_REMESHING_EDIT_RADIUS * resolution / BENCHMARK_REFERENCE_RESOLUTION;
+		f64 totalEditTime = 0;
+		f64 maxEditTime = 0;
+		u32 totalRemeshedChunks = 0;
+		for (u32 edit = 0; edit < CHUNK_REMESHING_EDIT_COUNT; edit++)
+		{
+			vec3 center = vec3_add_vec3(vec3_mul_f32(RandomPointOnUnitSphere(&seed), resolution * 0.4f), mapCenter);
+
+			StartOrResetTimer(&timer);
+			u32 editStart[3];
+			u32 editEnd[3];
+			if (!DensityMapEditSphere(densityMap, resolution, resolution, resolution, center, editRadius, edit % 2 == 1, editStart, editEnd))
+				continue;
+			DensityBrickMapUpdateRegion(&brickMap, densityMap, editStart[0], editStart[1], editStart[2], editEnd[0], editEnd[1], editEnd[2]);
+
+			// A density value is a corner of the cubes with their origin one value lower up to the value itself
+			for (u32 chunk = 0; chunk < chunkCount; chunk++)
+			{
+				MarchingCubesRegion region = chunkRegions[chunk];
+				dirtyChunks[chunk] = editStart[0] <= region.endX && editEnd[0] + 1 > region.startX &&
+									 editStart[1] <= region.endY && editEnd[1] + 1 > region.startY &&
+									 editStart[2] <= region.endZ && editEnd[2] + 1 > region.startZ;
+			}
+
+			for (u32 chunk = 0; chunk < chunkCount; chunk++)
+			{
+				if (!dirtyChunks[chunk])
+					continue;
+				if (chunkMeshes[chunk].vertexCount > 0)
+					MarchingCubesFreeMeshData(chunkMeshes[chunk]);
+				chunkMeshes[chunk] = MarchingCubesGenerateMeshIndexedRegion(densityMap, resolution, resolution, resolution, &brickMap, chunkRegions[chunk]);
+				totalRemeshedChunks++;
+			}
+			f64 time = TimerSecondsSinceStart(timer);
+			totalEditTime += time;
+			if (time > maxEditTime)
+				maxEditTime = time;
+		}
+
+		// After the edits the chunks should still add up to the mesh of the whole (edited) map
+		chunkIndexCount = 0;
+		for (u32 chunk = 0; chunk < chunkCount; chunk++)
+		{
+			chunkIndexCount += chunkMeshes[chunk].indexCount;
+			if (chunkMeshes[chunk].vertexCount > 0)
+				MarchingCubesFreeMeshData(chunkMeshes[chunk]);
+		}
+		MeshData mesh = MarchingCubesGenerateMeshIndexed(densityMap, resolution, resolution, resolution, &brickMap);
+		bool trianglesMatch = mesh.indexCount == chunkIndexCount;
+		MarchingCubesFreeMeshData(mesh);
+
+		_INFO("Resolution %u, %u edits (radius %.1f), edit + remesh average: %.3f ms, max: %.3f ms, %.1f chunks remeshed per edit, triangles after edits %s",
+			  resolution, CHUNK_REMESHING_EDIT_COUNT, editRadius, totalEditTime * 1000 / CHUNK_REMESHING_EDIT_COUNT, maxEditTime * 1000,
+			  (f64)totalRemeshedChunks / CHUNK_REMESHING_EDIT_COUNT, trianglesMatch ? "match" : "DON'T MATCH");
+
+		Free(GetGlobalAllocator(), chunkRegions);
+		Free(GetGlobalAllocator(), chunkMeshes);
+		Free(GetGlobalAllocator(), dirtyChunks);
+		DensityBrickMapDestroy(GetGlobalAllocator(), &brickMap);
+		Free(GetGlobalAllocator(), densityMap);
+	}
+}
+
+// Largest difference between a value blurred with the separable blur and with the reference blur that is still accepted
+#define SEPARABLE_BLUR_TOLERANCE 0.05f
+// The reference blur is too slow to run at the highest resolution
+#define SEPARABLE_BLUR_MAX_REFERENCE_RESOLUTION 100
+
+static void BenchmarkSeparableBlur()
+{
+	u32 resolutions[] = { 100, 200 };
+	u32 resolutionCount = sizeof(resolutions) / sizeof(*resolutions);
+	i64 kernelSizes[POSSIBLE_BLUR_KERNEL_SIZES_COUNT] = POSSIBLE_BLUR_KERNEL_SIZES;
+	u32 threadCount = JobSystemGetThreadCount();
+
+	_INFO("==================== Benchmark: separable gaussian blur (1 iteration) ====================");
+
+	for (u32 i = 0; i < resolutionCount; i++)
+	{
+		u32 resolution = resolutions[i];
+		u32 valueCount = resolution * resolution * resolution;
+		f32* densityMap = CreateBenchmarkDensityMap(resolution);
+		f32* referenceMap = Alloc(GetGlobalAllocator(), sizeof(*densityMap) * valueCount);
+		f32* blurredMap = Alloc(GetGlobalAllocator(), sizeof(*densityMap) * valueCount);
+
+		for (u32 kernel = 0; kernel < POSSIBLE_BLUR_KERNEL_SIZES_COUNT; kernel++)
+		{
+			u32 kernelSize = kernelSizes[kernel];
+			bool runReference = resolution <= SEPARABLE_BLUR_MAX_REFERENCE_RESOLUTION;
+
+			f64 referenceTime = 0;
+			if (runReference)
+			{
+				MemoryCopy(referenceMap, densityMap, sizeof(*densityMap) * valueCount);
+				Timer timer;
+				StartOrResetTimer(&timer);
+				BlurDensityMapGaussianReference(1, kernelSize, referenceMap, resolution, resolution, resolution, false);
+				referenceTime = TimerSecondsSinceStart(timer);
+			}
+
+			// Timing the separable blur on one thread and on all threads
+			f64 separableTimes[2] = { 1000000, 1000000 };
+			for (u32 multithreaded = 0; multithreaded < 2; multithreaded++)
+			{
+				for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+				{
+					MemoryCopy(blurredMap, densityMap, sizeof(*densityMap) * valueCount);
+					Timer timer;
+					StartOrResetTimer(&timer);
+					BlurDensityMapGaussian(1, kernelSize, blurredMap, resolution, resolution, resolution, false, DENSITY_MAP_FORMAT_F32, multithreaded ? threadCount : 1);
+					f64 time = TimerSecondsSinceStart(timer);
+					if (time < separableTimes[multithreaded])
+						separableTimes[multithreaded] = time;
+				}
+			}
+
+			if (!runReference)
+			{
+				_INFO("Resolution %u, kernel %u, separable 1 thread: %.3f ms, %u threads: %.3f ms",
+					  resolution, kernelSize, separableTimes[0] * 1000, threadCount, separableTimes[1] * 1000);
+				continue;
+			}
+
+			// Comparing with the reference, values that end up on the other side of the contour change the mesh
+			f32 maxDifference = 0;
+			f64 totalDifference = 0;
+			u32 signChanges = 0;
+			for (u32 value = 0; value < valueCount; value++)
+			{
+				f32 difference = fabsf(blurredMap[value] - referenceMap[value]);
+				maxDifference = difference > maxDifference ? difference : maxDifference;
+				totalDifference += difference;
+				signChanges += (blurredMap[value] < 0) != (referenceMap[value] < 0);
+			}
+
+			_INFO("Resolution %u, kernel %u, reference: %.3f ms, separable 1 thread: %.3f ms (%.2fx), %u threads: %.3f ms (%.2fx)",
+				  resolution, kernelSize, referenceTime * 1000, separableTimes[0] * 1000, referenceTime / separableTimes[0], threadCount, separableTimes[1] * 1000, referenceTime / separableTimes[1]);
+			_INFO("Resolution %u, kernel %u, difference with reference max: %g, mean: %g, %u values changed sign, %s tolerance (%g)",
+				  resolution, kernelSize, maxDifference, totalDifference / valueCount, signChanges, maxDifference <= SEPARABLE_BLUR_TOLERANCE ? "within" : "OUTSIDE", SEPARABLE_BLUR_TOLERANCE);
+		}
+
+		Free(GetGlobalAllocator(), referenceMap);
+		Free(GetGlobalAllocator(), blurredMap);
+		Free(GetGlobalAllocator(), densityMap);
+	}
+}
+
+// Kernel sizes beyond POSSIBLE_BLUR_KERNEL_SIZES that only the summed volume table blur is fast enough for
+#define BOX_BLUR_LARGE_KERNEL_SIZES { 15, 31 }
+#define BOX_BLUR_LARGE_KERNEL_SIZES_COUNT 2
+
+static void BenchmarkBoxBlur()
+{
+	u32 resolutions[] = { 100, 200 };
+	u32 resolutionCount = sizeof(resolutions) / sizeof(*resolutions);
+	i64 kernelSizes[POSSIBLE_BLUR_KERNEL_SIZES_COUNT] = POSSIBLE_BLUR_KERNEL_SIZES;
+	i64 largeKernelSizes[BOX_BLUR_LARGE_KERNEL_SIZES_COUNT] = BOX_BLUR_LARGE_KERNEL_SIZES;
+
+	_INFO("==================== Benchmark: summed volume table box blur (1 iteration) ====================");
+
+	for (u32 i = 0; i < resolutionCount; i++)
+	{
+		u32 resolution = resolutions[i];
+		u32 valueCount = resolution * resolution * resolution;
+		f32* densityMap = CreateBenchmarkDensityMap(resolution);
+		f32* referenceMap = Alloc(GetGlobalAllocator(), sizeof(*densityMap) * valueCount);
+		f32* blurredMap = Alloc(GetGlobalAllocator(), sizeof(*densityMap) * valueCount);
+
+		for (u32 kernel = 0; kernel < POSSIBLE_BLUR_KERNEL_SIZES_COUNT + BOX_BLUR_LARGE_KERNEL_SIZES_COUNT; kernel++)
+		{
+			bool largeKernel = kernel >= POSSIBLE_BLUR_KERNEL_SIZES_COUNT;
+			u32 kernelSize = largeKernel ? largeKernelSizes[kernel - POSSIBLE_BLUR_KERNEL_SIZES_COUNT] : kernelSizes[kernel];
+
+			f64 tableTime = 1000000;
+			for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+			{
+				MemoryCopy(blurredMap, densityMap, sizeof(*densityMap) * valueCount);
+				Timer timer;
+				StartOrResetTimer(&timer);
+				BlurDensityMapBokeh(1, kernelSize, blurredMap, resolution, resolution, resolution, false);
+				f64 time = TimerSecondsSinceStart(timer);
+				if (time < tableTime)
+					tableTime = time;
+			}
+
+			if (largeKernel)
+			{
+				_INFO("Resolution %u, kernel %u, summed volume table: %.3f ms", resolution, kernelSize, tableTime * 1000);
+				continue;
+			}
+
+			MemoryCopy(referenceMap, densityMap, sizeof(*densityMap) * valueCount);
+			Timer timer;
+			StartOrResetTimer(&timer);
+			BlurDensityMapBokehReference(1, kernelSize, referenceMap, resolution, resolution, resolution, false);
+			f64 referenceTime = TimerSecondsSinceStart(timer);
+
+			f32 maxDifference = 0;
+			for (u32 value = 0; value < valueCount; value++)
+			{
+				f32 difference = fabsf(blurredMap[value] - referenceMap[value]);
+				maxDifference = difference > maxDifference ? difference : maxDifference;
+			}
+
+			_INFO("Resolution %u, kernel %u, full kernel: %.3f ms, summed volume table: %.3f ms, %.2fx speedup, max difference %g",
+				  resolution, kernelSize, referenceTime * 1000, tableTime * 1000, referenceTime / tableTime, maxDifference);
+		}
+
+		Free(GetGlobalAllocator(), referenceMap);
+		Free(GetGlobalAllocator(), blurredMap);
+		Free(GetGlobalAllocator(), densityMap);
+	}
+}
+
+#define TUNNEL_GRID_RESOLUTION 200
+
+static void BenchmarkTunnelGrid()
+{
+	u32 tunnelCounts[] = { 1, MAX_BEZIER_TUNNEL_COUNT / 2, MAX_BEZIER_TUNNEL_COUNT };
+	u32 controlPointCounts[] = { MIN_BEZIER_TUNNEL_CONTROL_POINTS, MAX_BEZIER_TUNNEL_CONTROL_POINTS };
+	u32 tunnelCountCount = sizeof(tunnelCounts) / sizeof(*tunnelCounts);
+	u32 controlPointCountCount = sizeof(controlPointCounts) / sizeof(*controlPointCounts);
+
+	u32 resolution = TUNNEL_GRID_RESOLUTION;
+	u32 valueCount = resolution * resolution * resolution;
+	f32* referenceMap = Alloc(GetGlobalAllocator(), sizeof(*referenceMap) * valueCount);
+	f32* densityMap = Alloc(GetGlobalAllocator(), sizeof(*densityMap) * valueCount);
+
+	_INFO("==================== Benchmark: bezier tunnel grid (resolution %u) ====================", resolution);
+
+	for (u32 i = 0; i < tunnelCountCount; i++)
+	{
+		for (u32 j = 0; j < controlPointCountCount; j++)
+		{
+			BezierDensityFuncSettings settings = {};
+			settings.baseSphereRadius = 0.4f * resolution;
+			settings.bezierTunnelCount = tunnelCounts[i];
+			settings.bezierTunnelRadius = 5.f * resolution / BENCHMARK_REFERENCE_RESOLUTION;
+			settings.bezierTunnelControlPoints = controlPointCounts[j];
+			settings.sphereHoleCount = MAX_SPHERE_HOLE_COUNT;
+			settings.sphereHoleRadius = 6.f * resolution / BENCHMARK_REFERENCE_RESOLUTION;
+
+			u32 seed = BENCHMARK_SEED;
+			Timer timer;
+			StartOrResetTimer(&timer);
+			DensityFuncBezierCurveHoleReference(&seed, &settings, referenceMap, resolution);
+			f64 referenceTime = TimerSecondsSinceStart(timer);
+
+			f64 gridTime = 1000000;
+			for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+			{
+				seed = BENCHMARK_SEED;
+				StartOrResetTimer(&timer);
+				DensityFuncBezierCurveHole(&seed, &settings, densityMap, resolution, nullptr);
+				f64 time = TimerSecondsSinceStart(timer);
+				if (time < gridTime)
+					gridTime = time;
+			}
+
+			bool identical = MemoryCompare(densityMap, referenceMap, sizeof(*densityMap) * valueCount);
+
+			_INFO("%2u tunnels, %2u control points, every sample: %.3f ms, grid: %.3f ms, %.2fx speedup, output %s",
+				  tunnelCounts[i], controlPointCounts[j], referenceTime * 1000, gridTime * 1000, referenceTime / gridTime, identical ? "identical" : "DIFFERENT");
+		}
+	}
+
+	Free(GetGlobalAllocator(), referenceMap);
+	Free(GetGlobalAllocator(), densityMap);
+}
+
+#define DENSITY_EVALUATION_RESOLUTION 200
+
+// Times the density functions on the batched evaluation driver, and re-evaluating only the narrow band around the surface of the bezier terrain.
+// The narrow band re-evaluation uses the same settings, so every value it writes should be unchanged.
+static void BenchmarkDensityEvaluation()
+{
+	u32 resolution = DENSITY_EVALUATION_RESOLUTION;
+	u32 valueCount = resolution * resolution * resolution;
+	f32* referenceMap = Alloc(GetGlobalAllocator(), sizeof(*referenceMap) * valueCount);
+	f32* densityMap = Alloc(GetGlobalAllocator(), sizeof(*densityMap) * valueCount);
+
+	_INFO("==================== Benchmark: density function evaluation (resolution %u, %u threads) ====================", resolution, JobSystemGetThreadCount());
+
+	Timer timer;
+	f64 sphereHoleTime = 1000000;
+	f64 randomSpheresTime = 1000000;
+	for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+	{
+		StartOrResetTimer(&timer);
+		DensityFuncSphereHole(densityMap, resolution, resolution, resolution);
+		f64 time = TimerSecondsSinceStart(timer);
+		if (time < sphereHoleTime)
+			sphereHoleTime = time;
+
+		StartOrResetTimer(&timer);
+		// Every value tests all 1050 spheres, so this one runs at a lower resolution
+		DensityFuncRandomSpheres(densityMap, BENCHMARK_REFERENCE_RESOLUTION, BENCHMARK_REFERENCE_RESOLUTION, BENCHMARK_REFERENCE_RESOLUTION);
+		time = TimerSecondsSinceStart(timer);
+		if (time < randomSpheresTime)
+			randomSpheresTime = time;
+	}
+	_INFO("Sphere hole: %.3f ms", sphereHoleTime * 1000);
+	_INFO("Random spheres (resolution %u): %.3f ms", BENCHMARK_REFERENCE_RESOLUTION, randomSpheresTime * 1000);
+
+	BezierDensityFuncSettings settings = {};
+	settings.baseSphereRadius = 0.4f * resolution;
+	settings.bezierTunnelCount = MAX_BEZIER_TUNNEL_COUNT / 2;
+	settings.bezierTunnelRadius = 5.f * resolution / BENCHMARK_REFERENCE_RESOLUTION;
+	settings.bezierTunnelControlPoints = MAX_BEZIER_TUNNEL_CONTROL_POINTS;
+	settings.sphereHoleCount = MAX_SPHERE_HOLE_COUNT;
+	settings.sphereHoleRadius = 6.f * resolution / BENCHMARK_REFERENCE_RESOLUTION;
+
+	u32 seed = BENCHMARK_SEED;
+	StartOrResetTimer(&timer);
+	DensityFuncBezierCurveHoleReference(&seed, &settings, referenceMap, resolution);
+	f64 referenceTime = TimerSecondsSinceStart(timer);
+
+	f64 fullTime = 1000000;
+	for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+	{
+		seed = BENCHMARK_SEED;
+		StartOrResetTimer(&timer);
+		DensityFuncBezierCurveHole(&seed, &settings, densityMap, resolution, nullptr);
+		f64 time = TimerSecondsSinceStart(timer);
+		if (time < fullTime)
+			fullTime = time;
+	}
+	bool identical = MemoryCompare(densityMap, referenceMap, sizeof(*densityMap) * valueCount);
+	_INFO("Bezier tunnels, scalar reference: %.3f ms, batched: %.3f ms, %.2fx speedup, output %s", referenceTime * 1000, fullTime * 1000, referenceTime / fullTime, identical ? "identical" : "DIFFERENT");
+
+	DensityBrickMap brickMap = DensityBrickMapCreate(GetGlobalAllocator(), resolution, resolution, resolution);
+	DensityBrickMapUpdate(&brickMap, densityMap);
+	u32 bandBrickCount = 0;
+	u32 brickCount = brickMap.brickCountX * brickMap.brickCountY * brickMap.brickCountZ;
+	for (u32 i = 0; i < brickCount; i++)
+		bandBrickCount += DensityBrickMapBrickHasSurface(&brickMap, i);
+
+	f64 narrowBandTime = 1000000;
+	for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+	{
+		seed = BENCHMARK_SEED;
+		StartOrResetTimer(&timer);
+		DensityFuncBezierCurveHole(&seed, &settings, densityMap, resolution, &brickMap);
+		f64 time = TimerSecondsSinceStart(timer);
+		if (time < narrowBandTime)
+			narrowBandTime = time;
+	}
+	identical = MemoryCompare(densityMap, referenceMap, sizeof(*densityMap) * valueCount);
+	_INFO("Narrow band re-evaluation (%u of %u bricks with surface): %.3f ms, %.2fx faster than a full evaluation, output %s",
+		  bandBrickCount, brickCount, narrowBandTime * 1000, fullTime / narrowBandTime, identical ? "identical" : "DIFFERENT");
+
+	DensityBrickMapDestroy(GetGlobalAllocator(), &brickMap);
+	Free(GetGlobalAllocator(), referenceMap);
+	Free(GetGlobalAllocator(), densityMap);
+}
+
+#define QUANTIZED_DENSITY_RESOLUTION 200
+#define QUANTIZED_DENSITY_BLUR_ITERATIONS 2
+
+// Meshes every chunk of the density map like world generation does (the f32, the quantized or the bricked map, whichever isn't nullptr), compares the meshes to the reference meshes
+// if they are given, otherwise stores them as the reference meshes. Returns the time it took to mesh all chunks.
+static f64 MeshBenchmarkChunks(f32* densityMap, QuantizedDensityMap* quantizedDensityMap, BrickedDensityMap* brickedDensityMap, u32 resolution, DensityBrickMap* brickMap, ReferenceMesh* referenceMeshes, bool compare, bool* out_sameTriangles, f32* out_maxPositionDifference, f64* out_averagePositionDifference)
+{
+	u32 cubeCount = resolution - 1;
+	u32 chunksPerAxis = (cubeCount + WORLD_CHUNK_SIZE - 1) / WORLD_CHUNK_SIZE;
+	f64 totalTime = 0;
+	f64 positionDifferenceSum = 0;
+	u64 comparedVertexCount = 0;
+
+	for (u32 chunkIndex = 0; chunkIndex < chunksPerAxis * chunksPerAxis * chunksPerAxis; chunkIndex++)
+	{
+		MarchingCubesRegion region = {};
+		region.startX = (chunkIndex / (chunksPerAxis * chunksPerAxis)) * WORLD_CHUNK_SIZE;
+		region.startY = (chunkIndex / chunksPerAxis % chunksPerAxis) * WORLD_CHUNK_SIZE;
+		region.startZ = (chunkIndex % chunksPerAxis) * WORLD_CHUNK_SIZE;
+		region.endX = region.startX + WORLD_CHUNK_SIZE < cubeCount ? region.startX + WORLD_CHUNK_SIZE : cubeCount;
+		region.endY = region.startY + WORLD_CHUNK_SIZE < cubeCount ? region.startY + WORLD_CHUNK_SIZE : cubeCount;
+		region.endZ = region.startZ + WORLD_CHUNK_SIZE < cubeCount ? region.startZ + WORLD_CHUNK_SIZE : cubeCount;
+
+		Timer timer;
+		StartOrResetTimer(&timer);
+		MeshData meshData;
+		if (densityMap)
+			meshData = MarchingCubesGenerateMeshIndexedRegion(densityMap, resolution, resolution, resolution, brickMap, region);
+		else if (quantizedDensityMap)
+			meshData = MarchingCubesGenerateMeshIndexedRegionQuantized(quantizedDensityMap, brickMap, region);
+		else
+			meshData = MarchingCubesGenerateMeshIndexedRegionBricked(brickedDensityMap, brickMap, region);
+		totalTime += TimerSecondsSinceStart(timer);
+
+		ReferenceMesh* reference = &referenceMeshes[chunkIndex];
+		if (!compare)
+		{
+			reference->vertexCount = meshData.vertexCount;
+			reference->indexCount = meshData.indexCount;
+			reference->vertices = nullptr;
+			reference->indices = nullptr;
+			if (meshData.vertexCount > 0)
+			{
+				reference->vertices = Alloc(GetGlobalAllocator(), sizeof(VertexT2) * meshData.vertexCount);
+				reference->indices = Alloc(GetGlobalAllocator(), sizeof(u32) * meshData.indexCount);
+				MemoryCopy(reference->vertices, meshData.vertices, sizeof(VertexT2) * meshData.vertexCount);
+				MemoryCopy(reference->indices, meshData.indices, sizeof(u32) * meshData.indexCount);
+			}
+		}
+		else
+		{
+			bool sameTriangles = reference->vertexCount == meshData.vertexCount && reference->indexCount == meshData.indexCount;
+			if (sameTriangles && meshData.vertexCount > 0)
+			{
+				sameTriangles = MemoryCompare(reference->indices, meshData.indices, sizeof(u32) * meshData.indexCount);
+				VertexT2* referenceVertices = reference->vertices;
+				VertexT2* vertices = meshData.vertices;
+				for (u32 i = 0; i < meshData.vertexCount; i++)
+				{
+					f32 difference = vec3_distance(referenceVertices[i].position, vertices[i].position);
+					*out_maxPositionDifference = difference > *out_maxPositionDifference ? difference : *out_maxPositionDifference;
+					positionDifferenceSum += difference;
+				}
+				comparedVertexCount += meshData.vertexCount;
+			}
+			*out_sameTriangles = *out_sameTriangles && sameTriangles;
+		}
+
+		if (meshData.vertexCount > 0)
+			MarchingCubesFreeMeshData(meshData);
+	}
+
+	*out_averagePositionDifference = comparedVertexCount > 0 ? positionDifferenceSum / comparedVertexCount : 0;
+	return totalTime;
+}
+
+// Quantizes the blurred benchmark terrain to 16 and 8 bits and compares memory, error, dequantization speed and the chunk meshes to the f32 map.
+// Also compares the gaussian blur with a 16 bit intermediate result to the blur with an f32 intermediate result.
+static void BenchmarkQuantizedDensity()
+{
+	u32 resolution = QUANTIZED_DENSITY_RESOLUTION;
+	u32 valueCount = resolution * resolution * resolution;
+
+	_INFO("==================== Benchmark: quantized density maps (resolution %u) ====================", resolution);
+
+	f32* densityMap = CreateBenchmarkDensityMap(resolution);
+	f32* blurredMap = Alloc(GetGlobalAllocator(), sizeof(*blurredMap) * valueCount);
+	f32* decodedMap = Alloc(GetGlobalAllocator(), sizeof(*decodedMap) * valueCount);
+
+	// Blur with a quantized intermediate result
+	DensityMapFormat intermediateFormats[] = { DENSITY_MAP_FORMAT_F32, DENSITY_MAP_FORMAT_16BIT, DENSITY_MAP_FORMAT_8BIT };
+	const char* intermediateFormatNames[] = { "f32", "16 bit", "8 bit" };
+	for (u32 i = 0; i < 3; i++)
+	{
+		f64 blurTime = 1000000;
+		for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+		{
+			MemoryCopy(i == 0 ? blurredMap : decodedMap, densityMap, sizeof(*densityMap) * valueCount);
+			Timer timer;
+			StartOrResetTimer(&timer);
+			BlurDensityMapGaussian(QUANTIZED_DENSITY_BLUR_ITERATIONS, 3, i == 0 ? blurredMap : decodedMap, resolution, resolution, resolution, true, intermediateFormats[i], JobSystemGetThreadCount());
+			f64 time = TimerSecondsSinceStart(timer);
+			if (time < blurTime)
+				blurTime = time;
+		}
+
+		u64 bytesPerValue = intermediateFormats[i] == DENSITY_MAP_FORMAT_F32 ? sizeof(f32) : intermediateFormats[i] == DENSITY_MAP_FORMAT_16BIT ? sizeof(u16) : sizeof(u8);
+		f32 maxDifference = 0;
+		for (u32 j = 0; i > 0 && j < valueCount; j++)
+			maxDifference = fabsf(decodedMap[j] - blurredMap[j]) > maxDifference ? fabsf(decodedMap[j] - blurredMap[j]) : maxDifference;
+		_INFO("Gaussian blur with %s intermediate (%.2f MiB): %.3f ms, max difference to f32 intermediate: %f", intermediateFormatNames[i], bytesPerValue * valueCount / (f64)MiB, blurTime * 1000, maxDifference);
+	}
+
+	DensityBrickMap brickMap = DensityBrickMapCreate(GetGlobalAllocator(), resolution, resolution, resolution);
+	DensityBrickMapUpdate(&brickMap, blurredMap);
+
+	u32 cubeCount = resolution - 1;
+	u32 chunksPerAxis = (cubeCount + WORLD_CHUNK_SIZE - 1) / WORLD_CHUNK_SIZE;
+	u32 chunkCount = chunksPerAxis * chunksPerAxis * chunksPerAxis;
+	ReferenceMesh* referenceMeshes = Alloc(GetGlobalAllocator(), sizeof(*referenceMeshes) * chunkCount);
+	bool unused;
+	f32 unusedMaxDifference;
+	f64 unusedAverageDifference;
+	f64 f32MeshTime = MeshBenchmarkChunks(blurredMap, nullptr, nullptr, resolution, &brickMap, referenceMeshes, false, &unused, &unusedMaxDifference, &unusedAverageDifference);
+	_INFO("f32 (%.2f MiB): meshing %u chunks: %.3f ms", sizeof(f32) * valueCount / (f64)MiB, chunkCount, f32MeshTime * 1000);
+
+	DensityMapFormat formats[] = { DENSITY_MAP_FORMAT_16BIT, DENSITY_MAP_FORMAT_8BIT };
+	const char* formatNames[] = { "16 bit", "8 bit" };
+	for (u32 i = 0; i < 2; i++)
+	{
+		f32 minValue;
+		f32 maxValue;
+		DensityMapGetRange(blurredMap, valueCount, &minValue, &maxValue);
+		minValue = minValue > -1 ? -1 : minValue;
+		maxValue = maxValue < 1 ? 1 : maxValue;
+		maxValue = maxValue > QUANTIZED_TERRAIN_MAX_DENSITY ? QUANTIZED_TERRAIN_MAX_DENSITY : maxValue;
+		QuantizedDensityMap quantizedMap = QuantizedDensityMapCreate(GetGlobalAllocator(), formats[i], resolution, resolution, resolution, minValue, maxValue);
+
+		Timer timer;
+		StartOrResetTimer(&timer);
+		QuantizedDensityMapEncodeBox(&quantizedMap, nullptr, blurredMap);
+		f64 encodeTime = TimerSecondsSinceStart(timer);
+
+		f64 decodeTime = 1000000;
+		for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+		{
+			StartOrResetTimer(&timer);
+			QuantizedDensityMapDecodeBox(&quantizedMap, nullptr, decodedMap);
+			f64 time = TimerSecondsSinceStart(timer);
+			if (time < decodeTime)
+				decodeTime = time;
+		}
+
+		// Values that were clamped to the range don't count towards the error
+		f32 maxError = 0;
+		u32 signChanges = 0;
+		for (u32 j = 0; j < valueCount; j++)
+		{
+			if (blurredMap[j] <= maxValue)
+				maxError = fabsf(decodedMap[j] - blurredMap[j]) > maxError ? fabsf(decodedMap[j] - blurredMap[j]) : maxError;
+			signChanges += (decodedMap[j] < 0) != (blurredMap[j] < 0);
+		}
+
+		bool sameTriangles = true;
+		f32 maxPositionDifference = 0;
+		f64 averagePositionDifference;
+		f64 meshTime = MeshBenchmarkChunks(nullptr, &quantizedMap, nullptr, resolution, &brickMap, referenceMeshes, true, &sameTriangles, &maxPositionDifference, &averagePositionDifference);
+
+		_INFO("%s (%.2f MiB, %.1fx smaller, scale %f): encode %.3f ms, decode %.3f ms, max error %f, %u inside/outside changes",
+			  formatNames[i], QuantizedDensityMapGetSize(&quantizedMap) / (f64)MiB, sizeof(f32) * valueCount / (f64)QuantizedDensityMapGetSize(&quantizedMap), quantizedMap.scale, encodeTime * 1000, decodeTime * 1000, maxError, signChanges);
+		_INFO("%s: meshing %u chunks: %.3f ms, triangles %s, vertex position difference max %f average %f cubes",
+			  formatNames[i], chunkCount, meshTime * 1000, sameTriangles ? "identical" : "DIFFERENT", maxPositionDifference, averagePositionDifference);
+
+		QuantizedDensityMapDestroy(GetGlobalAllocator(), &quantizedMap);
+	}
+
+	for (u32 i = 0; i < chunkCount; i++)
+	{
+		if (referenceMeshes[i].vertexCount == 0)
+			continue;
+		Free(GetGlobalAllocator(), referenceMeshes[i].vertices);
+		Free(GetGlobalAllocator(), referenceMeshes[i].indices);
+	}
+	Free(GetGlobalAllocator(), referenceMeshes);
+	DensityBrickMapDestroy(GetGlobalAllocator(), &brickMap);
+	Free(GetGlobalAllocator(), decodedMap);
+	Free(GetGlobalAllocator(), blurredMap);
+	Free(GetGlobalAllocator(), densityMap);
+}
+
+#define LAYOUT_BENCHMARK_BLUR_ITERATIONS 2
+#define LAYOUT_BENCHMARK_BLUR_KERNEL_SIZE 5
+// Amount of cubes gathered at random positions, the positions take 12 bytes per cube
+#define LAYOUT_BENCHMARK_GATHER_COUNT (1 << 21)
+
+// Returns the amount of different cache lines the values at the given addresses are in
+static u32 CountCacheLines(f32** values, u32 count)
+{
+	u64 lines[8];
+	u32 lineCount = 0;
+	for (u32 i = 0; i < count; i++)
+	{
+		u64 line = (u64)values[i] / CACHE_ALIGN;
+		bool seen = false;
+		for (u32 j = 0; j < lineCount && !seen; j++)
+			seen = lines[j] == line;
+		if (!seen)
+			lines[lineCount++] = line;
+	}
+	return lineCount;
+}
+
+// Gets the eight corners of every cube in the flat or the bricked density map (whichever isn't nullptr) like marching cubes does for an active cube.
+// If out_averageCacheLines isn't nullptr, also counts the cache lines every gather touches (untimed). Returns the sum of all corners so the reads can't be optimized away.
+static f32 GatherCubeCorners(f32* densityMap, BrickedDensityMap* brickedDensityMap, u32 resolution, u32* cubes, u32 cubeCount, f64* out_averageCacheLines)
+{
+	f32 sum = 0;
+	u64 cacheLineCount = 0;
+	for (u32 i = 0; i < cubeCount; i++)
+	{
+		u32 x = cubes[i * 3];
+		u32 y = cubes[i * 3 + 1];
+		u32 z = cubes[i * 3 + 2];
+		f32* corners[8];
+		if (densityMap)
+		{
+			f32* first = densityMap + ((u64)x * resolution + y) * resolution + z;
+			u64 offsetsX[2] = { 0, (u64)resolution * resolution };
+			u64 offsetsY[2] = { 0, resolution };
+			for (u32 corner = 0; corner < 8; corner++)
+				corners[corner] = first + offsetsX[corner & 1] + offsetsY[corner >> 1 & 1] + (corner >> 2);
+		}
+		else
+		{
+			u64 offsetsX[2] = { BrickedDensityMapGetOffsetX(brickedDensityMap, x), BrickedDensityMapGetOffsetX(brickedDensityMap, x + 1) };
+			u64 offsetsY[2] = { BrickedDensityMapGetOffsetY(brickedDensityMap, y), BrickedDensityMapGetOffsetY(brickedDensityMap, y + 1) };
+			u64 offsetsZ[2] = { BrickedDensityMapGetOffsetZ(brickedDensityMap, z), BrickedDensityMapGetOffsetZ(brickedDensityMap, z + 1) };
+			for (u32 corner = 0; corner < 8; corner++)
+				corners[corner] = brickedDensityMap->values + offsetsX[corner & 1] + offsetsY[corner >> 1 & 1] + offsetsZ[corner >> 2];
+		}
+		for (u32 corner = 0; corner < 8; corner++)
+			sum += *corners[corner];
+
+		if (out_averageCacheLines)
+			cacheLineCount += CountCacheLines(corners, 8);
+	}
+
+	if (out_averageCacheLines)
+		*out_averageCacheLines = cacheLineCount / (f64)cubeCount;
+	return sum;
+}
+
+// Replaces every inner value with the sum of the 3x3x3 values around it, the flat map is visited in memory order and the bricked map one tile at a time
+static void SumNeighbourhoods(f32* densityMap, BrickedDensityMap* brickedDensityMap, u32 resolution, f32* out_flatSums, BrickedDensityMap* out_brickedSums)
+{
+	if (densityMap)
+	{
+		for (u32 x = 1; x < resolution - 1; x++)
+			for (u32 y = 1; y < resolution - 1; y++)
+				for (u32 z = 1; z < resolution - 1; z++)
+				{
+					f32 sum = 0;
+					for (u32 nx = x - 1; nx <= x + 1; nx++)
+						for (u32 ny = y - 1; ny <= y + 1; ny++)
+							for (u32 nz = z - 1; nz <= z + 1; nz++)
+								sum += densityMap[((u64)nx * resolution + ny) * resolution + nz];
+					out_flatSums[((u64)x * resolution + y) * resolution + z] = sum;
+				}
+		return;
+	}
+
+	for (u32 tileX = 0; tileX < brickedDensityMap->tileCountX; tileX++)
+		for (u32 tileY = 0; tileY < brickedDensityMap->tileCountY; tileY++)
+			for (u32 tileZ = 0; tileZ < brickedDensityMap->tileCountZ; tileZ++)
+				for (u32 x = tileX * DENSITY_TILE_SIZE; x < (tileX + 1) * DENSITY_TILE_SIZE; x++)
+					for (u32 y = tileY * DENSITY_TILE_SIZE; y < (tileY + 1) * DENSITY_TILE_SIZE; y++)
+						for (u32 z = tileZ * DENSITY_TILE_SIZE; z < (tileZ + 1) * DENSITY_TILE_SIZE; z++)
+						{
+							if (x == 0 || y == 0 || z == 0 || x >= resolution - 1 || y >= resolution - 1 || z >= resolution - 1)
+								continue;
+							u64 offsetsX[3] = { BrickedDensityMapGetOffsetX(brickedDensityMap, x - 1), BrickedDensityMapGetOffsetX(brickedDensityMap, x), BrickedDensityMapGetOffsetX(brickedDensityMap, x + 1) };
+							u64 offsetsY[3] = { BrickedDensityMapGetOffsetY(brickedDensityMap, y - 1), BrickedDensityMapGetOffsetY(brickedDensityMap, y), BrickedDensityMapGetOffsetY(brickedDensityMap, y + 1) };
+							u64 offsetsZ[3] = { BrickedDensityMapGetOffsetZ(brickedDensityMap, z - 1), BrickedDensityMapGetOffsetZ(brickedDensityMap, z), BrickedDensityMapGetOffsetZ(brickedDensityMap, z + 1) };
+							f32 sum = 0;
+							for (u32 nx = 0; nx < 3; nx++)
+								for (u32 ny = 0; ny < 3; ny++)
+									for (u32 nz = 0; nz < 3; nz++)
+										sum += brickedDensityMap->values[offsetsX[nx] + offsetsY[ny] + offsetsZ[nz]];
+							out_brickedSums->values[offsetsX[1] + offsetsY[1] + offsetsZ[1]] = sum;
+						}
+}
+
+// Compares the flat and the bricked density map layout at resolution 100 and 200: conversion, generation, blurring, chunk meshing,
+// random cube corner gathers (mostly cache misses at resolution 200) and 3x3x3 neighbourhood reads. Also checks that both layouts give the same results.
+static void BenchmarkDensityLayouts()
+{
+	u32 resolutions[] = { 100, 200 };
+	u32 resolutionCount = sizeof(resolutions) / sizeof(*resolutions);
+	u32 threadCount = JobSystemGetThreadCount();
+
+	_INFO("==================== Benchmark: flat vs bricked density layout (%ux%ux%u tiles, morton order within tiles) ====================", DENSITY_TILE_SIZE, DENSITY_TILE_SIZE, DENSITY_TILE_SIZE);
+
+	for (u32 resolutionIndex = 0; resolutionIndex < resolutionCount; resolutionIndex++)
+	{
+		u32 resolution = resolutions[resolutionIndex];
+		u32 valueCount = resolution * resolution * resolution;
+		Timer timer;
+
+		f32* densityMap = CreateBenchmarkDensityMap(resolution);
+		f32* flatMap = Alloc(GetGlobalAllocator(), sizeof(*flatMap) * valueCount);
+		f32* decodedMap = Alloc(GetGlobalAllocator(), sizeof(*decodedMap) * valueCount);
+		BrickedDensityMap brickedMap = BrickedDensityMapCreate(GetGlobalAllocator(), resolution, resolution, resolution);
+		BrickedDensityMap brickedSums = BrickedDensityMapCreate(GetGlobalAllocator(), resolution, resolution, resolution);
+
+		_INFO("Resolution %u: flat %.2f MiB, bricked %.2f MiB (tiles on the far sides stick out of the map)",
+			  resolution, sizeof(f32) * valueCount / (f64)MiB, sizeof(f32) * BrickedDensityMapGetValueCount(&brickedMap) / (f64)MiB);
+
+		// Conversion
+		f64 toBrickedTime = 1000000;
+		f64 toFlatTime = 1000000;
+		for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+		{
+			StartOrResetTimer(&timer);
+			BrickedDensityMapEncodeBox(&brickedMap, nullptr, densityMap);
+			f64 time = TimerSecondsSinceStart(timer);
+			toBrickedTime = time < toBrickedTime ? time : toBrickedTime;
+
+			StartOrResetTimer(&timer);
+			BrickedDensityMapDecodeBox(&brickedMap, nullptr, decodedMap);
+			time = TimerSecondsSinceStart(timer);
+			toFlatTime = time < toFlatTime ? time : toFlatTime;
+		}
+		bool identical = MemoryCompare(densityMap, decodedMap, sizeof(*densityMap) * valueCount);
+		_INFO("Conversion: flat to bricked %.3f ms, bricked to flat %.3f ms, round trip %s", toBrickedTime * 1000, toFlatTime * 1000, identical ? "identical" : "DIFFERENT");
+
+		// Generation
+		BezierDensityFuncSettings settings = GetBenchmarkTerrainSettings(resolution);
+		f64 flatGenerationTime = 1000000;
+		f64 brickedGenerationTime = 1000000;
+		for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+		{
+			u32 seed = BENCHMARK_SEED;
+			StartOrResetTimer(&timer);
+			DensityFuncBezierCurveHole(&seed, &settings, flatMap, resolution, nullptr);
+			f64 time = TimerSecondsSinceStart(timer);
+			flatGenerationTime = time < flatGenerationTime ? time : flatGenerationTime;
+
+			seed = BENCHMARK_SEED;
+			StartOrResetTimer(&timer);
+			DensityFuncBezierCurveHoleBricked(&seed, &settings, &brickedMap, nullptr);
+			time = TimerSecondsSinceStart(timer);
+			brickedGenerationTime = time < brickedGenerationTime ? time : brickedGenerationTime;
+		}
+		BrickedDensityMapDecodeBox(&brickedMap, nullptr, decodedMap);
+		identical = MemoryCompare(flatMap, decodedMap, sizeof(*flatMap) * valueCount);
+		_INFO("Bezier tunnel generation: flat %.3f ms, bricked %.3f ms, output %s", flatGenerationTime * 1000, brickedGenerationTime * 1000, identical ? "identical" : "DIFFERENT");
+
+		// Blurring
+		f64 flatBlurTime = 1000000;
+		f64 brickedBlurTime = 1000000;
+		for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+		{
+			MemoryCopy(flatMap, densityMap, sizeof(*flatMap) * valueCount);
+			StartOrResetTimer(&timer);
+			BlurDensityMapGaussian(LAYOUT_BENCHMARK_BLUR_ITERATIONS, LAYOUT_BENCHMARK_BLUR_KERNEL_SIZE, flatMap, resolution, resolution, resolution, false, DENSITY_MAP_FORMAT_F32, threadCount);
+			f64 time = TimerSecondsSinceStart(timer);
+			flatBlurTime = time < flatBlurTime ? time : flatBlurTime;
+
+			BrickedDensityMapEncodeBox(&brickedMap, nullptr, densityMap);
+			StartOrResetTimer(&timer);
+			BlurDensityMapGaussianBricked(LAYOUT_BENCHMARK_BLUR_ITERATIONS, LAYOUT_BENCHMARK_BLUR_KERNEL_SIZE, &brickedMap, threadCount);
+			time = TimerSecondsSinceStart(timer);
+			brickedBlurTime = time < brickedBlurTime ? time : brickedBlurTime;
+		}
+		BrickedDensityMapDecodeBox(&brickedMap, nullptr, decodedMap);
+		identical = MemoryCompare(flatMap, decodedMap, sizeof(*flatMap) * valueCount);
+		_INFO("Gaussian blur (%u iterations, kernel %u): flat %.3f ms, bricked (tile columns) %.3f ms, %.2fx speedup, output %s",
+			  LAYOUT_BENCHMARK_BLUR_ITERATIONS, LAYOUT_BENCHMARK_BLUR_KERNEL_SIZE, flatBlurTime * 1000, brickedBlurTime * 1000, flatBlurTime / brickedBlurTime, identical ? "identical" : "DIFFERENT");
+
+		// Chunk meshing of the blurred map, both layouts hold exactly the same values
+		DensityBrickMap brickMap = DensityBrickMapCreate(GetGlobalAllocator(), resolution, resolution, resolution);
+		DensityBrickMapUpdate(&brickMap, flatMap);
+
+		u32 cubeCount = resolution - 1;
+		u32 chunksPerAxis = (cubeCount + WORLD_CHUNK_SIZE - 1) / WORLD_CHUNK_SIZE;
+		u32 chunkCount = chunksPerAxis * chunksPerAxis * chunksPerAxis;
+		ReferenceMesh* referenceMeshes = Alloc(GetGlobalAllocator(), sizeof(*referenceMeshes) * chunkCount);
+		bool sameTriangles = true;
+		f32 maxPositionDifference = 0;
+		f64 averagePositionDifference;
+		f64 flatMeshTime = MeshBenchmarkChunks(flatMap, nullptr, nullptr, resolution, &brickMap, referenceMeshes, false, &sameTriangles, &maxPositionDifference, &averagePositionDifference);
+		f64 brickedMeshTime = MeshBenchmarkChunks(nullptr, nullptr, &brickedMap, resolution, &brickMap, referenceMeshes, true, &sameTriangles, &maxPositionDifference, &averagePositionDifference);
+		_INFO("Meshing %u chunks: flat %.3f ms, bricked %.3f ms, meshes %s", chunkCount, flatMeshTime * 1000, brickedMeshTime * 1000, sameTriangles && maxPositionDifference == 0 ? "identical" : "DIFFERENT");
+
+		for (u32 i = 0; i < chunkCount; i++)
+		{
+			if (referenceMeshes[i].vertexCount == 0)
+				continue;
+			Free(GetGlobalAllocator(), referenceMeshes[i].vertices);
+			Free(GetGlobalAllocator(), referenceMeshes[i].indices);
+		}
+		Free(GetGlobalAllocator(), referenceMeshes);
+		DensityBrickMapDestroy(GetGlobalAllocator(), &brickMap);
+
+		// Random cube corner gathers, like marching cubes or a ray march looking up cubes all over the map
+		u32* cubes = Alloc(GetGlobalAllocator(), sizeof(*cubes) * 3 * LAYOUT_BENCHMARK_GATHER_COUNT);
+		u32 seed = BENCHMARK_SEED;
+		for (u32 i = 0; i < LAYOUT_BENCHMARK_GATHER_COUNT * 3; i++)
+		{
+			seed = PCG_Hash(seed);
+			cubes[i] = seed % cubeCount;
+		}
+
+		f64 flatCacheLines;
+		f64 brickedCacheLines;
+		f32 flatSum = GatherCubeCorners(flatMap, nullptr, resolution, cubes, LAYOUT_BENCHMARK_GATHER_COUNT, &flatCacheLines);
+		f32 brickedSum = GatherCubeCorners(nullptr, &brickedMap, resolution, cubes, LAYOUT_BENCHMARK_GATHER_COUNT, &brickedCacheLines);
+		f64 flatGatherTime = 1000000;
+		f64 brickedGatherTime = 1000000;
+		for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+		{
+			StartOrResetTimer(&timer);
+			flatSum = GatherCubeCorners(flatMap, nullptr, resolution, cubes, LAYOUT_BENCHMARK_GATHER_COUNT, nullptr);
+			f64 time = TimerSecondsSinceStart(timer);
+			flatGatherTime = time < flatGatherTime ? time : flatGatherTime;
+
+			StartOrResetTimer(&timer);
+			brickedSum = GatherCubeCorners(nullptr, &brickedMap, resolution, cubes, LAYOUT_BENCHMARK_GATHER_COUNT, nullptr);
+			time = TimerSecondsSinceStart(timer);
+			brickedGatherTime = time < brickedGatherTime ? time : brickedGatherTime;
+		}
+		_INFO("Random cube corner gathers: flat %.2f ns (%.2f cache lines), bricked %.2f ns (%.2f cache lines) per cube, %.2fx speedup, sums %s",
+			  flatGatherTime * 1000000000 / LAYOUT_BENCHMARK_GATHER_COUNT, flatCacheLines, brickedGatherTime * 1000000000 / LAYOUT_BENCHMARK_GATHER_COUNT, brickedCacheLines,
+			  flatGatherTime / brickedGatherTime, flatSum == brickedSum ? "identical" : "DIFFERENT");
+		Free(GetGlobalAllocator(), cubes);
+
+		// 3x3x3 neighbourhood reads over the whole map
+		f64 flatNeighbourhoodTime = 1000000;
+		f64 brickedNeighbourhoodTime = 1000000;
+		for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+		{
+			StartOrResetTimer(&timer);
+			SumNeighbourhoods(flatMap, nullptr, resolution, decodedMap, nullptr);
+			f64 time = TimerSecondsSinceStart(timer);
+			flatNeighbourhoodTime = time < flatNeighbourhoodTime ? time : flatNeighbourhoodTime;
+
+			StartOrResetTimer(&timer);
+			SumNeighbourhoods(nullptr, &brickedMap, resolution, nullptr, &brickedSums);
+			time = TimerSecondsSinceStart(timer);
+			brickedNeighbourhoodTime = time < brickedNeighbourhoodTime ? time : brickedNeighbourhoodTime;
+		}
+		// Only the inner values are written
+		identical = true;
+		for (u32 x = 1; x < resolution - 1 && identical; x++)
+			for (u32 y = 1; y < resolution - 1 && identical; y++)
+				for (u32 z = 1; z < resolution - 1 && identical; z++)
+					identical = decodedMap[((u64)x * resolution + y) * resolution + z] == BrickedDensityMapGetValue(&brickedSums, x, y, z);
+		_INFO("3x3x3 neighbourhood sums: flat %.3f ms, bricked %.3f ms, %.2fx speedup, output %s",
+			  flatNeighbourhoodTime * 1000, brickedNeighbourhoodTime * 1000, flatNeighbourhoodTime / brickedNeighbourhoodTime, identical ? "identical" : "DIFFERENT");
+
+		BrickedDensityMapDestroy(GetGlobalAllocator(), &brickedSums);
+		BrickedDensityMapDestroy(GetGlobalAllocator(), &brickedMap);
+		Free(GetGlobalAllocator(), decodedMap);
+		Free(GetGlobalAllocator(), flatMap);
+		Free(GetGlobalAllocator(), densityMap);
+	}
+}
+
+static void BenchmarkSurfaceNets()
+{
+	u32 resolutions[] = { 50, 100, 200 };
+	u32 resolutionCount = sizeof(resolutions) / sizeof(*resolutions);
+
+	_INFO("==================== Benchmark: surface nets vs indexed marching cubes ====================");
+
+	for (u32 i = 0; i < resolutionCount; i++)
+	{
+		u32 resolution = resolutions[i];
+		f32* densityMap = CreateBenchmarkDensityMap(resolution);
+
+		f64 marchingCubesTime = 1000000;
+		u32 marchingCubesVertexCount = 0;
+		u32 marchingCubesIndexCount = 0;
+		for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+		{
+			Timer timer;
+			StartOrResetTimer(&timer);
+			MeshData mesh = MarchingCubesGenerateMeshIndexed(densityMap, resolution, resolution, resolution, nullptr);
+			f64 time = TimerSecondsSinceStart(timer);
+			if (time < marchingCubesTime)
+				marchingCubesTime = time;
+			marchingCubesVertexCount = mesh.vertexCount;
+			marchingCubesIndexCount = mesh.indexCount;
+			MarchingCubesFreeMeshData(mesh);
+		}
+
+		f64 surfaceNetsTime = 1000000;
+		u32 surfaceNetsVertexCount = 0;
+		u32 surfaceNetsIndexCount = 0;
+		for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+		{
+			Timer timer;
+			StartOrResetTimer(&timer);
+			MeshData mesh = MarchingCubesGenerateMeshSurfaceNets(densityMap, resolution, resolution, resolution, nullptr);
+			f64 time = TimerSecondsSinceStart(timer);
+			if (time < surfaceNetsTime)
+				surfaceNetsTime = time;
+			surfaceNetsVertexCount = mesh.vertexCount;
+			surfaceNetsIndexCount = mesh.indexCount;
+			MarchingCubesFreeMeshData(mesh);
+		}
+
+		// The unindexed marching cubes mesh has a vertex for every index of the indexed one
+		_INFO("Resolution %u, indexed marching cubes: %.3f ms, %u triangles, %u vertices (%u unindexed)",
+			  resolution, marchingCubesTime * 1000, marchingCubesIndexCount / 3, marchingCubesVertexCount, marchingCubesIndexCount);
+		_INFO("Resolution %u, surface nets: %.3f ms, %u triangles (%.2fx), %u vertices (%.2fx, %.2fx less than unindexed), %.2f MiB instead of %.2f MiB",
+			  resolution, surfaceNetsTime * 1000, surfaceNetsIndexCount / 3, surfaceNetsIndexCount / (f64)marchingCubesIndexCount,
+			  surfaceNetsVertexCount, surfaceNetsVertexCount / (f64)marchingCubesVertexCount, marchingCubesIndexCount / (f64)surfaceNetsVertexCount,
+			  (surfaceNetsVertexCount * sizeof(VertexT2) + surfaceNetsIndexCount * sizeof(u32)) / (1024.0 * 1024.0),
+			  (marchingCubesVertexCount * sizeof(VertexT2) + marchingCubesIndexCount * sizeof(u32)) / (1024.0 * 1024.0));
+
+		Free(GetGlobalAllocator(), densityMap);
+	}
+}
+
+static void BenchmarkSimplification()
+{
+	u32 resolutions[] = { 100, 200 };
+	u32 resolutionCount = sizeof(resolutions) / sizeof(*resolutions);
+	// Fractions of the triangles that are kept, and error bounds (in density map cubes) without a triangle target
+	f32 triangleFractions[] = { 0.5f, 0.25f, 0.1f };
+	u32 triangleFractionCount = sizeof(triangleFractions) / sizeof(*triangleFractions);
+	f32 errorBounds[] = { 0.05f, 0.25f };
+	u32 errorBoundCount = sizeof(errorBounds) / sizeof(*errorBounds);
+
+	_INFO("==================== Benchmark: quadric error mesh simplification ====================");
+
+	for (u32 i = 0; i < resolutionCount; i++)
+	{
+		u32 resolution = resolutions[i];
+		f32* densityMap = CreateBenchmarkDensityMap(resolution);
+		MeshData mesh = MarchingCubesGenerateMeshIndexed(densityMap, resolution, resolution, resolution, nullptr);
+		_INFO("Resolution %u, indexed marching cubes mesh: %u triangles, %u vertices", resolution, mesh.indexCount / 3, mesh.vertexCount);
+
+		for (u32 run = 0; run < triangleFractionCount + errorBoundCount; run++)
+		{
+			bool errorBoundRun = run >= triangleFractionCount;
+			u32 targetIndexCount = errorBoundRun ? 0 : (u32)(mesh.indexCount / 3 * triangleFractions[run]) * 3;
+			f32 targetError = errorBoundRun ? errorBounds[run - triangleFractionCount] : FLT_MAX;
+
+			f64 fastestTime = 1000000;
+			u32 simplifiedIndexCount = 0;
+			u32 simplifiedVertexCount = 0;
+			f32 error = 0;
+			for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+			{
+				Timer timer;
+				StartOrResetTimer(&timer);
+				MeshData simplified = MeshOptimizerSimplify(mesh, offsetof(VertexT2, position), offsetof(VertexT2, normal), targetIndexCount, targetError, &error);
+				f64 time = TimerSecondsSinceStart(timer);
+				if (time < fastestTime)
+					fastestTime = time;
+				simplifiedIndexCount = simplified.indexCount;
+				simplifiedVertexCount = simplified.vertexCount;
+				MeshOptimizerFreeMeshData(simplified);
+			}
+
+			if (errorBoundRun)
+				_INFO("Resolution %u, error bound %.2f: %.3f ms, %u triangles (%.1f%%), %u vertices, error %.3f",
+					  resolution, targetError, fastestTime * 1000, simplifiedIndexCount / 3, 100.0 * simplifiedIndexCount / mesh.indexCount, simplifiedVertexCount, error);
+			else
+				_INFO("Resolution %u, target %u triangles (%.0f%%): %.3f ms, %u triangles, %u vertices, error %.3f",
+					  resolution, targetIndexCount / 3, triangleFractions[run] * 100, fastestTime * 1000, simplifiedIndexCount / 3, simplifiedVertexCount, error);
+		}
+
+		MarchingCubesFreeMeshData(mesh);
+		Free(GetGlobalAllocator(), densityMap);
+	}
+}
+
+static void BenchmarkVertexCacheOptimization()
+{
+	u32 resolutions[] = { 50, 100, 200 };
+	u32 resolutionCount = sizeof(resolutions) / sizeof(*resolutions);
+
+	_INFO("==================== Benchmark: vertex cache, overdraw and vertex fetch optimization ====================");
+
+	for (u32 i = 0; i < resolutionCount; i++)
+	{
+		u32 resolution = resolutions[i];
+		f32* densityMap = CreateBenchmarkDensityMap(resolution);
+
+		for (u32 mesher = 0; mesher < 2; mesher++)
+		{
+			const char* mesherName = mesher == 0 ? "indexed marching cubes" : "surface nets";
+
+			f64 vertexCacheTime = 1000000;
+			f64 overdrawTime = 1000000;
+			f64 vertexFetchTime = 1000000;
+			VertexCacheStatistics before = {};
+			VertexCacheStatistics afterVertexCache = {};
+			VertexCacheStatistics after = {};
+			for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+			{
+				MeshData mesh = mesher == 0 ?
+					MarchingCubesGenerateMeshIndexed(densityMap, resolution, resolution, resolution, nullptr) :
+					MarchingCubesGenerateMeshSurfaceNets(densityMap, resolution, resolution, resolution, nullptr);
+				before = MeshOptimizerAnalyzeVertexCache(mesh);
+
+				Timer timer;
+				StartOrResetTimer(&timer);
+				MeshOptimizerOptimizeVertexCache(&mesh);
+				f64 time = TimerSecondsSinceStart(timer);
+				if (time < vertexCacheTime)
+					vertexCacheTime = time;
+				afterVertexCache = MeshOptimizerAnalyzeVertexCache(mesh);
+
+				StartOrResetTimer(&timer);
+				MeshOptimizerOptimizeOverdraw(&mesh, offsetof(VertexT2, position));
+				time = TimerSecondsSinceStart(timer);
+				if (time < overdrawTime)
+					overdrawTime = time;
+
+				StartOrResetTimer(&timer);
+				MeshOptimizerOptimizeVertexFetch(&mesh);
+				time = TimerSecondsSinceStart(timer);
+				if (time < vertexFetchTime)
+					vertexFetchTime = time;
+				after = MeshOptimizerAnalyzeVertexCache(mesh);
+
+				MarchingCubesFreeMeshData(mesh);
+			}
+
+			// The overdraw pass trades a little of the vertex cache efficiency for drawing the occluding clusters first
+			_INFO("Resolution %u, %s: ACMR %.3f -> %.3f (%.3f after overdraw), ATVR %.3f -> %.3f (%.3f after overdraw)",
+				  resolution, mesherName, before.acmr, afterVertexCache.acmr, after.acmr, before.atvr, afterVertexCache.atvr, after.atvr);
+			_INFO("Resolution %u, %s: vertex cache %.3f ms, overdraw %.3f ms, vertex fetch %.3f ms",
+				  resolution, mesherName, vertexCacheTime * 1000, overdrawTime * 1000, vertexFetchTime * 1000);
+		}
+
+		Free(GetGlobalAllocator(), densityMap);
+	}
+}
+
+static void BenchmarkVertexPacking()
+{
+	u32 resolutions[] = { 100, 200 };
+	u32 resolutionCount = sizeof(resolutions) / sizeof(*resolutions);
+
+	_INFO("==================== Benchmark: packed chunk vertices and narrow indices ====================");
+
+	for (u32 i = 0; i < resolutionCount; i++)
+	{
+		u32 resolution = resolutions[i];
+		f32* densityMap = CreateBenchmarkDensityMap(resolution);
+
+		// Packing the surface nets meshes of world sized chunks with the same bounds as the world, the vertices are unpacked again to measure the error
+		u32 cubeCount = resolution - 1;
+		u32 chunksPerAxis = (cubeCount + WORLD_CHUNK_SIZE - 1) / WORLD_CHUNK_SIZE;
+		u32 chunkCount = chunksPerAxis * chunksPerAxis * chunksPerAxis;
+		u32 totalVertexCount = 0;
+		u64 totalIndexCount = 0;
+		u64 narrowIndexBytes = 0;
+		f64 totalPackTime = 0;
+		f32 maxPositionError = 0;
+		f32 maxNormalErrorSine = 0;
+		for (u32 chunk = 0; chunk < chunkCount; chunk++)
+		{
+			u32 chunkCoords[3] = { chunk / (chunksPerAxis * chunksPerAxis), (chunk / chunksPerAxis) % chunksPerAxis, chunk % chunksPerAxis };
+			u32 regionStart[3];
+			u32 regionEnd[3];
+			for (u32 axis = 0; axis < 3; axis++)
+			{
+				regionStart[axis] = chunkCoords[axis] * WORLD_CHUNK_SIZE;
+				regionEnd[axis] = regionStart[axis] + WORLD_CHUNK_SIZE < cubeCount ? regionStart[axis] + WORLD_CHUNK_SIZE : cubeCount;
+			}
+			MarchingCubesRegion region = { regionStart[0], regionStart[1], regionStart[2], regionEnd[0], regionEnd[1], regionEnd[2] };
+			MeshData mesh = MarchingCubesGenerateMeshSurfaceNetsRegion(densityMap, resolution, resolution, resolution, nullptr, region);
+			if (mesh.vertexCount == 0)
+				continue;
+
+			vec3 packingOrigin = vec3_create(regionStart[0] - 1.0f, regionStart[1] - 1.0f, regionStart[2] - 1.0f);
+			f32 packingExtent = WORLD_CHUNK_SIZE + 1;
+			VertexPacked* packedVertices = Alloc(GetGlobalAllocator(), sizeof(*packedVertices) * mesh.vertexCount);
+			VertexT2* unpackedVertices = Alloc(GetGlobalAllocator(), sizeof(*unpackedVertices) * mesh.vertexCount);
+
+			Timer timer;
+			StartOrResetTimer(&timer);
+			MeshOptimizerPackVertices(mesh, offsetof(VertexT2, position), offsetof(VertexT2, normal), packingOrigin, packingExtent, packedVertices);
+			totalPackTime += TimerSecondsSinceStart(timer);
+
+			MeshOptimizerUnpackVertices(packedVertices, mesh.vertexCount, packingOrigin, packingExtent, unpackedVertices);
+			VertexT2* vertices = mesh.vertices;
+			for (u32 v = 0; v < mesh.vertexCount; v++)
+			{
+				vec3 difference = vec3_sub_vec3(vertices[v].position, unpackedVertices[v].position);
+				f32 positionError = fabsf(difference.x) > fabsf(difference.y) ? fabsf(difference.x) : fabsf(difference.y);
+				positionError = fabsf(difference.z) > positionError ? fabsf(difference.z) : positionError;
+				if (positionError > maxPositionError)
+					maxPositionError = positionError;
+				// The sine of the angle between the normals, acos of the dot product is too imprecise for tiny angles
+				f32 normalErrorSine = vec3_magnitude(vec3_cross_vec3(vec3_normalize(vertices[v].normal), unpackedVertices[v].normal));
+				if (normalErrorSine > maxNormalErrorSine)
+					maxNormalErrorSine = normalErrorSine;
+			}
+			totalVertexCount += mesh.vertexCount;
+			totalIndexCount += mesh.indexCount;
+			narrowIndexBytes += (u64)MeshOptimizerGetIndexSize(mesh) * mesh.indexCount;
+
+			Free(GetGlobalAllocator(), unpackedVertices);
+			Free(GetGlobalAllocator(), packedVertices);
+			MarchingCubesFreeMeshData(mesh);
+		}
+
+		f32 maxNormalErrorDegrees = asinf(maxNormalErrorSine > 1 ? 1 : maxNormalErrorSine) * 180 / PI;
+		_INFO("Resolution %u, %u chunks, %u vertices: %.2f MiB as VertexT2, %.2f MiB packed (%.2fx smaller), packing %.3f ms",
+			  resolution, chunkCount, totalVertexCount, totalVertexCount * sizeof(VertexT2) / (1024.0 * 1024.0), totalVertexCount * sizeof(VertexPacked) / (1024.0 * 1024.0),
+			  sizeof(VertexT2) / (f64)sizeof(VertexPacked), totalPackTime * 1000);
+		_INFO("Resolution %u, largest position error %f cubes, largest normal error %.4f degrees", resolution, maxPositionError, maxNormalErrorDegrees);
+		_INFO("Resolution %u, %llu indices: %.2f MiB as u32, %.2f MiB with the narrowest index size per chunk",
+			  resolution, (unsigned long long)totalIndexCount, totalIndexCount * sizeof(u32) / (1024.0 * 1024.0), narrowIndexBytes / (1024.0 * 1024.0));
+
+		Free(GetGlobalAllocator(), densityMap);
+	}
+}
+
+static void BenchmarkVertexWelding()
+{
+	// The unindexed mesh of a 200 resolution map and its welded mesh don't fit in the large object allocator at the same time
+	u32 resolutions[] = { 50, 100, 150 };
+	u32 resolutionCount = sizeof(resolutions) / sizeof(*resolutions);
+	// Grid cell sizes of the welds that also merge vertices that are close together (in density map cubes), 0 is an exact weld
+	f32 weldGridSizes[] = { 0, 0.05f, 0.25f };
+	u32 weldGridSizeCount = sizeof(weldGridSizes) / sizeof(*weldGridSizes);
+
+	_INFO("==================== Benchmark: vertex welding (merge normals) of unshared marching cubes meshes ====================");
+
+	for (u32 i = 0; i < resolutionCount; i++)
+	{
+		u32 resolution = resolutions[i];
+		f32* densityMap = CreateBenchmarkDensityMap(resolution);
+		MeshData mesh = MarchingCubesGenerateMesh(densityMap, resolution, resolution, resolution, nullptr);
+
+		for (u32 j = 0; j < weldGridSizeCount; j++)
+		{
+			f64 fastestTime = 1000000;
+			u32 weldedVertexCount = 0;
+			u32 weldedIndexCount = 0;
+			for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+			{
+				Timer timer;
+				StartOrResetTimer(&timer);
+				MeshData weldedMesh = MeshOptimizerWeldVertices(mesh, offsetof(VertexT2, position), offsetof(VertexT2, normal), weldGridSizes[j]);
+				f64 time = TimerSecondsSinceStart(timer);
+				if (time < fastestTime)
+					fastestTime = time;
+				weldedVertexCount = weldedMesh.vertexCount;
+				weldedIndexCount = weldedMesh.indexCount;
+				MeshOptimizerFreeMeshData(weldedMesh);
+			}
+
+			_INFO("Resolution %u, weld grid size %.2f: %.3f ms (%.1f million vertices per second), %u vertices welded to %u, %u of %u triangles left",
+				  resolution, weldGridSizes[j], fastestTime * 1000, mesh.vertexCount / fastestTime / 1000000.0, mesh.vertexCount, weldedVertexCount, weldedIndexCount / 3, mesh.indexCount / 3);
+		}
+
+		MarchingCubesFreeMeshData(mesh);
+		Free(GetGlobalAllocator(), densityMap);
+	}
+}
+
+// Rays cast against the bvh, the brute force raycasts only use the first BVH_BENCHMARK_BRUTE_FORCE_RAY_COUNT of them
+#define BVH_BENCHMARK_RAY_COUNT 100000
+#define BVH_BENCHMARK_BRUTE_FORCE_RAY_COUNT 200
+// Hits of the two paths with distances further apart than this count as different (the same distance can be hit in two triangles that share an edge)
+#define BVH_BENCHMARK_DISTANCE_TOLERANCE 0.0001f
+
+static void BenchmarkMeshBvh()
+{
+	u32 resolutions[] = { 100, 200 };
+	u32 resolutionCount = sizeof(resolutions) / sizeof(*resolutions);
+
+	_INFO("==================== Benchmark: bvh vs brute force raycasts against whole indexed marching cubes meshes ====================");
+
+	vec3* origins = Alloc(GetGlobalAllocator(), sizeof(*origins) * BVH_BENCHMARK_RAY_COUNT);
+	vec3* directions = Alloc(GetGlobalAllocator(), sizeof(*directions) * BVH_BENCHMARK_RAY_COUNT);
+
+	for (u32 i = 0; i < resolutionCount; i++)
+	{
+		u32 resolution = resolutions[i];
+		f32* densityMap = CreateBenchmarkDensityMap(resolution);
+		MeshData mesh = MarchingCubesGenerateMeshIndexed(densityMap, resolution, resolution, resolution, nullptr);
+
+		f64 buildTime = 1000000;
+		MeshBvh bvh = {};
+		for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+		{
+			MeshBvhDestroy(&bvh, GetGlobalAllocator());
+			Timer timer;
+			StartOrResetTimer(&timer);
+			bvh = MeshBvhCreate(mesh, offsetof(VertexT2, position), GetGlobalAllocator());
+			f64 time = TimerSecondsSinceStart(timer);
+			if (time < buildTime)
+				buildTime = time;
+		}
+
+		u32 leafCount = 0;
+		for (u32 node = 0; node < bvh.nodeCount; node++)
+			leafCount += bvh.nodes[node].triangleCount > 0;
+		_INFO("Resolution %u, %u triangles, bvh build: %.3f ms, %u nodes (%u leaves, %.2f triangles per leaf), %.2f MiB",
+			  resolution, mesh.indexCount / 3, buildTime * 1000, bvh.nodeCount, leafCount, bvh.triangleCount / (f64)leafCount,
+			  (bvh.nodeCount * sizeof(*bvh.nodes) + bvh.triangleGroupCount * (sizeof(*bvh.triangleGroups) + BVH_TRIANGLE_GROUP_SIZE * sizeof(*bvh.triangles))) / (1024.0 * 1024.0));
+
+		// Rays from outside of the map towards random points in the map, like the brick skipping benchmark
+		vec3 mapCenter = vec3_from_float(resolution * 0.5f);
+		u32 seed = BENCHMARK_SEED;
+		for (u32 ray = 0; ray < BVH_BENCHMARK_RAY_COUNT; ray++)
+		{
+			origins[ray] = vec3_add_vec3(vec3_mul_f32(RandomPointOnUnitSphere(&seed), resolution), mapCenter);
+			vec3 target = vec3_add_vec3(vec3_mul_f32(RandomPointInUnitSphere(&seed), resolution * 0.6f), mapCenter);
+			directions[ray] = vec3_normalize(vec3_sub_vec3(target, origins[ray]));
+		}
+
+		Timer timer;
+		StartOrResetTimer(&timer);
+		u32 hitCount = 0;
+		for (u32 ray = 0; ray < BVH_BENCHMARK_RAY_COUNT; ray++)
+			hitCount += RaycastMeshBvh(origins[ray], directions[ray], bvh, FLT_MAX).hit;
+		f64 bvhTime = TimerSecondsSinceStart(timer);
+
+		f64 bruteForceTime = 0;
+		u32 differentHitCount = 0;
+		for (u32 ray = 0; ray < BVH_BENCHMARK_BRUTE_FORCE_RAY_COUNT; ray++)
+		{
+			StartOrResetTimer(&timer);
+			RaycastHit bruteForceHit = RaycastMesh(origins[ray], directions[ray], mesh, mat4_identity(), offsetof(VertexT2, position), offsetof(VertexT2, normal));
+			bruteForceTime += TimerSecondsSinceStart(timer);
+
+			RaycastHit bvhHit = RaycastMeshBvh(origins[ray], directions[ray], bvh, FLT_MAX);
+			if (bvhHit.hit != bruteForceHit.hit || (bvhHit.hit && fabsf(bvhHit.hitDistance - bruteForceHit.hitDistance) > BVH_BENCHMARK_DISTANCE_TOLERANCE))
+				differentHitCount++;
+		}
+
+		f64 bvhRaysPerSecond = BVH_BENCHMARK_RAY_COUNT / bvhTime;
+		f64 bruteForceRaysPerSecond = BVH_BENCHMARK_BRUTE_FORCE_RAY_COUNT / bruteForceTime;
+		_INFO("Resolution %u, brute force: %.0f rays per second, bvh: %.0f rays per second (%.0fx), %u of %u rays hit, %u of %u brute force hits different",
+			  resolution, bruteForceRaysPerSecond, bvhRaysPerSecond, bvhRaysPerSecond / bruteForceRaysPerSecond, hitCount, BVH_BENCHMARK_RAY_COUNT,
+			  differentHitCount, BVH_BENCHMARK_BRUTE_FORCE_RAY_COUNT);
+
+		MeshBvhDestroy(&bvh, GetGlobalAllocator());
+		MarchingCubesFreeMeshData(mesh);
+		Free(GetGlobalAllocator(), densityMap);
+	}
+
+	Free(GetGlobalAllocator(), origins);
+	Free(GetGlobalAllocator(), directions);
+}
+
+// Size of the picking image in pixels, packets are tiles of 4 by 2 pixels
+#define RAY_PACKET_BENCHMARK_WIDTH 512
+#define RAY_PACKET_BENCHMARK_HEIGHT 256
+#define RAY_PACKET_BENCHMARK_RESOLUTION 200
+
+// Picking rays for every pixel of a RAY_PACKET_BENCHMARK_WIDTH by RAY_PACKET_BENCHMARK_HEIGHT image of a camera outside of the map looking at its center (60 degree vertical
+// field of view). Consecutive groups of RAY_PACKET_SIZE rays are tiles of 4 by 2 pixels.
+static void CreateBenchmarkPickingRays(u32 resolution, vec3* out_origins, vec3* out_directions)
+{
+	vec3 mapCenter = vec3_from_float(resolution * 0.5f);
+	vec3 cameraPosition = vec3_add_vec3(mapCenter, vec3_create(0.3f * resolution, 0.4f * resolution, -1.2f * resolution));
+	vec3 forward = vec3_normalize(vec3_sub_vec3(mapCenter, cameraPosition));
+	vec3 right = vec3_normalize(vec3_cross_vec3(vec3_create(0, 1, 0), forward));
+	vec3 up = vec3_cross_vec3(forward, right);
+	f32 halfHeight = tanf(PI / 6);
+	f32 halfWidth = halfHeight * RAY_PACKET_BENCHMARK_WIDTH / RAY_PACKET_BENCHMARK_HEIGHT;
+	u32 ray = 0;
+	for (u32 tileY = 0; tileY < RAY_PACKET_BENCHMARK_HEIGHT; tileY += 2)
+	{
+		for (u32 tileX = 0; tileX < RAY_PACKET_BENCHMARK_WIDTH; tileX += 4)
+		{
+			for (u32 pixel = 0; pixel < RAY_PACKET_SIZE; pixel++)
+			{
+				f32 screenX = ((tileX + pixel % 4 + 0.5f) / RAY_PACKET_BENCHMARK_WIDTH * 2 - 1) * halfWidth;
+				f32 screenY = ((tileY + pixel / 4 + 0.5f) / RAY_PACKET_BENCHMARK_HEIGHT * 2 - 1) * halfHeight;
+				out_origins[ray] = cameraPosition;
+				out_directions[ray] = vec3_normalize(vec3_add_vec3(forward, vec3_add_vec3(vec3_mul_f32(right, screenX), vec3_mul_f32(up, screenY))));
+				ray++;
+			}
+		}
+	}
+}
+
+// Incoherent rays from random points around the map towards random points in the map
+static void CreateBenchmarkRandomRays(u32 resolution, u32 rayCount, vec3* out_origins, vec3* out_directions)
+{
+	vec3 mapCenter = vec3_from_float(resolution * 0.5f);
+	u32 seed = BENCHMARK_SEED;
+	for (u32 i = 0; i < rayCount; i++)
+	{
+		out_origins[i] = vec3_add_vec3(vec3_mul_f32(RandomPointOnUnitSphere(&seed), resolution), mapCenter);
+		vec3 target = vec3_add_vec3(vec3_mul_f32(RandomPointInUnitSphere(&seed), resolution * 0.6f), mapCenter);
+		out_directions[i] = vec3_normalize(vec3_sub_vec3(target, out_origins[i]));
+	}
+}
+
+// Casts the rays one at a time and in packets of consecutive rays, returns the fastest time of both and counts the rays whose packet hit differs from their single hit
+static void TimeSingleRaysAndPackets(vec3* origins, vec3* directions, u32 rayCount, MeshBvh bvh, f64* out_singleTime, f64* out_packetTime, u32* out_differentHitCount)
+{
+	RaycastHit* singleHits = Alloc(GetGlobalAllocator(), sizeof(*singleHits) * rayCount);
+	RaycastHit* packetHits = Alloc(GetGlobalAllocator(), sizeof(*packetHits) * rayCount);
+	*out_singleTime = 1000000;
+	*out_packetTime = 1000000;
+	for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+	{
+		Timer timer;
+		StartOrResetTimer(&timer);
+		for (u32 ray = 0; ray < rayCount; ray++)
+			singleHits[ray] = RaycastMeshBvh(origins[ray], directions[ray], bvh, FLT_MAX);
+		f64 time = TimerSecondsSinceStart(timer);
+		if (time < *out_singleTime)
+			*out_singleTime = time;
+
+		StartOrResetTimer(&timer);
+		for (u32 ray = 0; ray < rayCount; ray += RAY_PACKET_SIZE)
+		{
+			u32 packetRayCount = rayCount - ray < RAY_PACKET_SIZE ? rayCount - ray : RAY_PACKET_SIZE;
+			RaycastMeshBvhPacket(origins + ray, directions + ray, packetRayCount, bvh, FLT_MAX, packetHits + ray);
+		}
+		time = TimerSecondsSinceStart(timer);
+		if (time < *out_packetTime)
+			*out_packetTime = time;
+	}
+
+	*out_differentHitCount = 0;
+	for (u32 ray = 0; ray < rayCount; ray++)
+	{
+		if (singleHits[ray].hit != packetHits[ray].hit || (singleHits[ray].hit && fabsf(singleHits[ray].hitDistance - packetHits[ray].hitDistance) > BVH_BENCHMARK_DISTANCE_TOLERANCE))
+			(*out_differentHitCount)++;
+	}
+
+	Free(GetGlobalAllocator(), singleHits);
+	Free(GetGlobalAllocator(), packetHits);
+}
+
+static void BenchmarkRayPackets()
+{
+	u32 resolution = RAY_PACKET_BENCHMARK_RESOLUTION;
+	u32 rayCount = RAY_PACKET_BENCHMARK_WIDTH * RAY_PACKET_BENCHMARK_HEIGHT;
+
+	_INFO("==================== Benchmark: single rays vs %u ray packets through a mesh bvh (%s kernels) ====================", RAY_PACKET_SIZE,
+#if defined(__AVX2__)
+		  "8 and 4 wide"
+#elif defined(__SSE2__)
+		  "4 wide"
+#else
+		  "scalar"
+#endif
+		  );
+
+	f32* densityMap = CreateBenchmarkDensityMap(resolution);
+	MeshData mesh = MarchingCubesGenerateMeshIndexed(densityMap, resolution, resolution, resolution, nullptr);
+	MeshBvh bvh = MeshBvhCreate(mesh, offsetof(VertexT2, position), GetGlobalAllocator());
+
+	vec3* origins = Alloc(GetGlobalAllocator(), sizeof(*origins) * rayCount);
+	vec3* directions = Alloc(GetGlobalAllocator(), sizeof(*directions) * rayCount);
+
+	CreateBenchmarkPickingRays(resolution, origins, directions);
+
+	f64 singleTime, packetTime;
+	u32 differentHitCount;
+	TimeSingleRaysAndPackets(origins, directions, rayCount, bvh, &singleTime, &packetTime, &differentHitCount);
+	_INFO("Resolution %u, %ux%u picking rays: single rays %.3f ms (%.0f rays per second), packets %.3f ms (%.0f rays per second, %.2fx), %u packet hits different",
+		  resolution, RAY_PACKET_BENCHMARK_WIDTH, RAY_PACKET_BENCHMARK_HEIGHT, singleTime * 1000, rayCount / singleTime, packetTime * 1000, rayCount / packetTime, singleTime / packetTime, differentHitCount);
+
+	// Packets of rays that go in different directions visit many more nodes
+	CreateBenchmarkRandomRays(resolution, rayCount, origins, directions);
+
+	TimeSingleRaysAndPackets(origins, directions, rayCount, bvh, &singleTime, &packetTime, &differentHitCount);
+	_INFO("Resolution %u, %u random rays: single rays %.3f ms (%.0f rays per second), packets %.3f ms (%.0f rays per second, %.2fx), %u packet hits different",
+		  resolution, rayCount, singleTime * 1000, rayCount / singleTime, packetTime * 1000, rayCount / packetTime, singleTime / packetTime, differentHitCount);
+
+	Free(GetGlobalAllocator(), origins);
+	Free(GetGlobalAllocator(), directions);
+	MeshBvhDestroy(&bvh, GetGlobalAllocator());
+	MarchingCubesFreeMeshData(mesh);
+	Free(GetGlobalAllocator(), densityMap);
+}
+
+static void BenchmarkRaycastBatches()
+{
+	u32 resolution = RAY_PACKET_BENCHMARK_RESOLUTION;
+	u32 rayCount = RAY_PACKET_BENCHMARK_WIDTH * RAY_PACKET_BENCHMARK_HEIGHT;
+	u32 maxThreadCount = JobSystemGetThreadCount();
+
+	_INFO("==================== Benchmark: raycast batch thread scaling ====================");
+
+	f32* densityMap = CreateBenchmarkDensityMap(resolution);
+	MeshData mesh = MarchingCubesGenerateMeshIndexed(densityMap, resolution, resolution, resolution, nullptr);
+	MeshBvh bvh = MeshBvhCreate(mesh, offsetof(VertexT2, position), GetGlobalAllocator());
+
+	vec3* origins = Alloc(GetGlobalAllocator(), sizeof(*origins) * rayCount);
+	vec3* directions = Alloc(GetGlobalAllocator(), sizeof(*directions) * rayCount);
+	RaycastHit* referenceHits = Alloc(GetGlobalAllocator(), sizeof(*referenceHits) * rayCount);
+	RaycastHit* batchHits = Alloc(GetGlobalAllocator(), sizeof(*batchHits) * rayCount);
+
+	for (u32 coherentRays = 0; coherentRays < 2; coherentRays++)
+	{
+		if (coherentRays)
+			CreateBenchmarkPickingRays(resolution, origins, directions);
+		else
+			CreateBenchmarkRandomRays(resolution, rayCount, origins, directions);
+
+		// Casting the rays one at a time on this thread is the baseline
+		f64 serialTime = 1000000;
+		for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+		{
+			Timer timer;
+			StartOrResetTimer(&timer);
+			for (u32 ray = 0; ray < rayCount; ray++)
+				referenceHits[ray] = RaycastMeshBvh(origins[ray], directions[ray], bvh, FLT_MAX);
+			f64 time = TimerSecondsSinceStart(timer);
+			if (time < serialTime)
+				serialTime = time;
+		}
+
+		const char* rayKind = coherentRays ? "picking rays (packets)" : "random rays";
+		_INFO("Resolution %u, %u %s, serial single rays: %.3f ms (%.0f rays per second)", resolution, rayCount, rayKind, serialTime * 1000, rayCount / serialTime);
+
+		// Doubling the thread count every step and always ending with the maximum amount of threads
+		u32 threadCount = 1;
+		while (true)
+		{
+			f64 bestTime = 1000000;
+			u32 differentHitCount = 0;
+			for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+			{
+				Timer timer;
+				StartOrResetTimer(&timer);
+				RaycastMeshBvhBatch(origins, directions, rayCount, bvh, FLT_MAX, coherentRays, batchHits, threadCount);
+				f64 time = TimerSecondsSinceStart(timer);
+				if (time < bestTime)
+					bestTime = time;
+			}
+			for (u32 ray = 0; ray < rayCount; ray++)
+			{
+				if (batchHits[ray].hit != referenceHits[ray].hit || (batchHits[ray].hit && fabsf(batchHits[ray].hitDistance - referenceHits[ray].hitDistance) > BVH_BENCHMARK_DISTANCE_TOLERANCE))
+					differentHitCount++;
+			}
+
+			_INFO("Resolution %u, %s, %2u threads: %.3f ms (%.0f rays per second), %.2fx speedup, %u hits different",
+				  resolution, rayKind, threadCount, bestTime * 1000, rayCount / bestTime, serialTime / bestTime, differentHitCount);
+
+			if (threadCount == maxThreadCount)
+				break;
+			threadCount *= 2;
+			if (threadCount > maxThreadCount)
+				threadCount = maxThreadCount;
+		}
+	}
+
+	Free(GetGlobalAllocator(), origins);
+	Free(GetGlobalAllocator(), directions);
+	Free(GetGlobalAllocator(), referenceHits);
+	Free(GetGlobalAllocator(), batchHits);
+	MeshBvhDestroy(&bvh, GetGlobalAllocator());
+	MarchingCubesFreeMeshData(mesh);
+	Free(GetGlobalAllocator(), densityMap);
+}
+
+// Hits of the density map raycast are on the trilinear surface, marching cubes interpolates linearly along the edges of the cubes, so the distances differ slightly
+#define DENSITY_RAYCAST_BENCHMARK_DISTANCE_TOLERANCE 0.5f
+
+// Casts the rays against the f32 density map (or the quantized map if densityMap is nullptr), returns the fastest time and compares the hits with the mesh hits
+static f64 TimeDensityRaycasts(f32* densityMap, QuantizedDensityMap* quantizedMap, u32 resolution, DensityBrickMap* brickMap, vec3* origins, vec3* directions, u32 rayCount,
+							   RaycastHit* meshHits, RaycastHit* hits, u32* out_differentHitCount, f64* out_averageDistanceDifference)
+{
+	f64 bestTime = 1000000;
+	for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+	{
+		Timer timer;
+		StartOrResetTimer(&timer);
+		if (densityMap)
+		{
+			for (u32 ray = 0; ray < rayCount; ray++)
+				hits[ray] = DensityMapRaycast(densityMap, resolution, resolution, resolution, brickMap, origins[ray], directions[ray], FLT_MAX);
+		}
+		else
+		{
+			for (u32 ray = 0; ray < rayCount; ray++)
+				hits[ray] = DensityMapRaycastQuantized(quantizedMap, brickMap, origins[ray], directions[ray], FLT_MAX);
+		}
+		f64 time = TimerSecondsSinceStart(timer);
+		if (time < bestTime)
+			bestTime = time;
+	}
+
+	*out_differentHitCount = 0;
+	f64 distanceDifferenceSum = 0;
+	u32 bothHitCount = 0;
+	for (u32 ray = 0; ray < rayCount; ray++)
+	{
+		if (hits[ray].hit && meshHits[ray].hit)
+		{
+			distanceDifferenceSum += fabsf(hits[ray].hitDistance - meshHits[ray].hitDistance);
+			bothHitCount++;
+		}
+		if (hits[ray].hit != meshHits[ray].hit || (hits[ray].hit && fabsf(hits[ray].hitDistance - meshHits[ray].hitDistance) > DENSITY_RAYCAST_BENCHMARK_DISTANCE_TOLERANCE))
+			(*out_differentHitCount)++;
+	}
+	*out_averageDistanceDifference = bothHitCount ? distanceDifferenceSum / bothHitCount : 0;
+
+	return bestTime;
+}
+
+static void BenchmarkDensityRaycasts()
+{
+	u32 resolutions[] = { 100, 200 };
+	u32 resolutionCount = sizeof(resolutions) / sizeof(*resolutions);
+	u32 rayCount = RAY_PACKET_BENCHMARK_WIDTH * RAY_PACKET_BENCHMARK_HEIGHT;
+
+	_INFO("==================== Benchmark: density map raycasts vs mesh bvh raycasts ====================");
+
+	vec3* origins = Alloc(GetGlobalAllocator(), sizeof(*origins) * rayCount);
+	vec3* directions = Alloc(GetGlobalAllocator(), sizeof(*directions) * rayCount);
+	RaycastHit* meshHits = Alloc(GetGlobalAllocator(), sizeof(*meshHits) * rayCount);
+	RaycastHit* densityHits = Alloc(GetGlobalAllocator(), sizeof(*densityHits) * rayCount);
+
+	for (u32 i = 0; i < resolutionCount; i++)
+	{
+		u32 resolution = resolutions[i];
+		u64 valueCount = (u64)resolution * resolution * resolution;
+		f32* densityMap = CreateBenchmarkDensityMap(resolution);
+		MeshData mesh = MarchingCubesGenerateMeshIndexed(densityMap, resolution, resolution, resolution, nullptr);
+		MeshBvh bvh = MeshBvhCreate(mesh, offsetof(VertexT2, position), GetGlobalAllocator());
+
+		DensityBrickMap brickMap = DensityBrickMapCreate(GetGlobalAllocator(), resolution, resolution, resolution);
+		DensityBrickMapUpdate(&brickMap, densityMap);
+
+		// Quantized like the world does it, the brick map of the f32 values stays valid
+		f32 minValue;
+		f32 maxValue;
+		DensityMapGetRange(densityMap, valueCount, &minValue, &maxValue);
+		minValue = minValue > -1 ? -1 : minValue;
+		maxValue = maxValue < 1 ? 1 : maxValue;
+		maxValue = maxValue > QUANTIZED_TERRAIN_MAX_DENSITY ? QUANTIZED_TERRAIN_MAX_DENSITY : maxValue;
+		QuantizedDensityMap quantizedMap = QuantizedDensityMapCreate(GetGlobalAllocator(), DENSITY_MAP_FORMAT_16BIT, resolution, resolution, resolution, minValue, maxValue);
+		QuantizedDensityMapEncodeBox(&quantizedMap, nullptr, densityMap);
+
+		for (u32 coherentRays = 0; coherentRays < 2; coherentRays++)
+		{
+			if (coherentRays)
+				CreateBenchmarkPickingRays(resolution, origins, directions);
+			else
+				CreateBenchmarkRandomRays(resolution, rayCount, origins, directions);
+			const char* rayKind = coherentRays ? "picking rays" : "random rays";
+
+			f64 bvhTime = 1000000;
+			for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+			{
+				Timer timer;
+				StartOrResetTimer(&timer);
+				for (u32 ray = 0; ray < rayCount; ray++)
+					meshHits[ray] = RaycastMeshBvh(origins[ray], directions[ray], bvh, FLT_MAX);
+				f64 time = TimerSecondsSinceStart(timer);
+				if (time < bvhTime)
+					bvhTime = time;
+			}
+			u32 hitCount = 0;
+			for (u32 ray = 0; ray < rayCount; ray++)
+				hitCount += meshHits[ray].hit;
+			_INFO("Resolution %u, %u triangles, %u %s (%u hit the mesh), mesh bvh: %.0f rays per second", resolution, mesh.indexCount / 3, rayCount, rayKind, hitCount, rayCount / bvhTime);
+
+			u32 differentHitCount;
+			f64 averageDistanceDifference;
+			f64 time = TimeDensityRaycasts(densityMap, nullptr, resolution, nullptr, origins, directions, rayCount, meshHits, densityHits, &differentHitCount, &averageDistanceDifference);
+			_INFO("Resolution %u, %s, f32 density map without brick skipping: %.0f rays per second (%.2fx bvh), %u hits different, average distance difference %f",
+				  resolution, rayKind, rayCount / time, bvhTime / time, differentHitCount, averageDistanceDifference);
+
+			time = TimeDensityRaycasts(densityMap, nullptr, resolution, &brickMap, origins, directions, rayCount, meshHits, densityHits, &differentHitCount, &averageDistanceDifference);
+			_INFO("Resolution %u, %s, f32 density map with brick skipping: %.0f rays per second (%.2fx bvh), %u hits different, average distance difference %f",
+				  resolution, rayKind, rayCount / time, bvhTime / time, differentHitCount, averageDistanceDifference);
+
+			time = TimeDensityRaycasts(nullptr, &quantizedMap, resolution, &brickMap, origins, directions, rayCount, meshHits, densityHits, &differentHitCount, &averageDistanceDifference);
+			_INFO("Resolution %u, %s, 16 bit density map with brick skipping: %.0f rays per second (%.2fx bvh), %u hits different, average distance difference %f",
+				  resolution, rayKind, rayCount / time, bvhTime / time, differentHitCount, averageDistanceDifference);
+		}
+
+		QuantizedDensityMapDestroy(GetGlobalAllocator(), &quantizedMap);
+		DensityBrickMapDestroy(GetGlobalAllocator(), &brickMap);
+		MeshBvhDestroy(&bvh, GetGlobalAllocator());
+		MarchingCubesFreeMeshData(mesh);
+		Free(GetGlobalAllocator(), densityMap);
+	}
+
+	Free(GetGlobalAllocator(), origins);
+	Free(GetGlobalAllocator(), directions);
+	Free(GetGlobalAllocator(), meshHits);
+	Free(GetGlobalAllocator(), densityHits);
+}
+
+#define SWEEP_BENCHMARK_COUNT 100000
+#define SWEEP_BENCHMARK_RESOLUTION 200
+// Sizes in cubes of the density map, the capsule is upright with a segment of the given length
+#define SWEEP_BENCHMARK_RADIUS 1.5f
+#define SWEEP_BENCHMARK_CAPSULE_LENGTH 3.f
+// Sweeps with this radius are compared with raycasts. At a grazing angle the sphere touches the surface up to radius / cos(angle) before the ray does,
+// hits further apart than that plus the tolerance count as different.
+#define SWEEP_BENCHMARK_RAY_RADIUS 0.0001f
+#define SWEEP_BENCHMARK_RAY_TOLERANCE 0.001f
+
+static void BenchmarkSweeps()
+{
+	u32 resolution = SWEEP_BENCHMARK_RESOLUTION;
+	// Short sweeps are a substep of a moving agent, long sweeps go through a large part of the map
+	f32 distances[] = { 2, 50 };
+	u32 distanceCount = sizeof(distances) / sizeof(*distances);
+
+	_INFO("==================== Benchmark: sphere and capsule sweeps through a mesh bvh ====================");
+
+	f32* densityMap = CreateBenchmarkDensityMap(resolution);
+	MeshData mesh = MarchingCubesGenerateMeshIndexed(densityMap, resolution, resolution, resolution, nullptr);
+	MeshBvh bvh = MeshBvhCreate(mesh, offsetof(VertexT2, position), GetGlobalAllocator());
+
+	// Random start points in the part of the map with terrain, moving in random directions
+	vec3* origins = Alloc(GetGlobalAllocator(), sizeof(*origins) * SWEEP_BENCHMARK_COUNT);
+	vec3* directions = Alloc(GetGlobalAllocator(), sizeof(*directions) * SWEEP_BENCHMARK_COUNT);
+	vec3 mapCenter = vec3_from_float(resolution * 0.5f);
+	u32 seed = BENCHMARK_SEED;
+	for (u32 i = 0; i < SWEEP_BENCHMARK_COUNT; i++)
+	{
+		origins[i] = vec3_add_vec3(vec3_mul_f32(RandomPointInUnitSphere(&seed), resolution * 0.45f), mapCenter);
+		directions[i] = RandomPointOnUnitSphere(&seed);
+	}
+	vec3 capsuleSegment = vec3_create(0, SWEEP_BENCHMARK_CAPSULE_LENGTH, 0);
+
+	for (u32 i = 0; i < distanceCount; i++)
+	{
+		f64 sphereTime = 1000000;
+		f64 capsuleTime = 1000000;
+		u32 sphereHitCount = 0;
+		u32 capsuleHitCount = 0;
+		for (u32 repeat = 0; repeat < BENCHMARK_REPEAT_COUNT; repeat++)
+		{
+			sphereHitCount = 0;
+			Timer timer;
+			StartOrResetTimer(&timer);
+			for (u32 sweep = 0; sweep < SWEEP_BENCHMARK_COUNT; sweep++)
+				sphereHitCount += SweepSphereMeshBvh(origins[sweep], SWEEP_BENCHMARK_RADIUS, directions[sweep], distances[i], bvh).hit;
+			f64 time = TimerSecondsSinceStart(timer);
+			if (time < sphereTime)
+				sphereTime = time;
+
+			capsuleHitCount = 0;
+			StartOrResetTimer(&timer);
+			for (u32 sweep = 0; sweep < SWEEP_BENCHMARK_COUNT; sweep++)
+				capsuleHitCount += SweepCapsuleMeshBvh(origins[sweep], vec3_add_vec3(origins[sweep], capsuleSegment), SWEEP_BENCHMARK_RADIUS, directions[sweep], distances[i], bvh).hit;
+			time = TimerSecondsSinceStart(timer);
+			if (time < capsuleTime)
+				capsuleTime = time;
+		}
+
+		_INFO("Resolution %u, %u triangles, sweeps of length %.0f: spheres %.0f per second (%u of %u hit), capsules %.0f per second (%u of %u hit)",
+			  resolution, mesh.indexCount / 3, distances[i], SWEEP_BENCHMARK_COUNT / sphereTime, sphereHitCount, SWEEP_BENCHMARK_COUNT,
+			  SWEEP_BENCHMARK_COUNT / capsuleTime, capsuleHitCount, SWEEP_BENCHMARK_COUNT);
+	}
+
+	// A sphere with a tiny radius should hit where a ray does
+	u32 differentHitCount = 0;
+	for (u32 i = 0; i < SWEEP_BENCHMARK_COUNT; i++)
+	{
+		RaycastHit rayHit = RaycastMeshBvh(origins[i], directions[i], bvh, distances[distanceCount - 1]);
+		SweepHit sweepHit = SweepSphereMeshBvh(origins[i], SWEEP_BENCHMARK_RAY_RADIUS, directions[i], distances[distanceCount - 1], bvh);
+		if (rayHit.hit != sweepHit.hit)
+			differentHitCount++;
+		else if (rayHit.hit)
+		{
+			f32 grazingOffset = SWEEP_BENCHMARK_RAY_RADIUS / fabsf(vec3_dot(directions[i], sweepHit.contactNormal));
+			differentHitCount += fabsf(rayHit.hitDistance - sweepHit.hitDistance) > grazingOffset + SWEEP_BENCHMARK_RAY_TOLERANCE;
+		}
+	}
+	_INFO("Sweeps with radius %f compared to raycasts: %u of %u hits different", SWEEP_BENCHMARK_RAY_RADIUS, differentHitCount, SWEEP_BENCHMARK_COUNT);
+
+	Free(GetGlobalAllocator(), origins);
+	Free(GetGlobalAllocator(), directions);
+	MeshBvhDestroy(&bvh, GetGlobalAllocator());
+	MarchingCubesFreeMeshData(mesh);
+	Free(GetGlobalAllocator(), densityMap);
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include "defines.h"
+
+// Benchmarks for the world generation and collision code, they can be started from the benchmarks debug menu and log their results.
+void BenchmarksInit();
+void BenchmarksUpdate();
+void BenchmarksShutdown();
@@ -1,8 +1,92 @@
 #include "collision.h"
 
+#include "core/engine.h"
+#include "core/profiler.h"
+#include "core/job_system.h"
+#include <float.h>
 
+// Amount of bins per axis that the split candidates of a node are evaluated at
+#define BVH_BIN_COUNT 16
+// Nodes with more triangles than this are always split, smaller nodes only if the surface area heuristic says the split is cheaper
+#define BVH_MAX_LEAF_TRIANGLES 8
+// Cost of testing a node relative to the cost of testing a triangle group
+#define BVH_TRAVERSAL_COST 1.0f
+// Nodes at this depth become leaves, so the build and traversal stacks have a fixed size
+#define BVH_MAX_DEPTH 64
+// Amount of jobs per thread of a raycast batch, more jobs than threads balance rays that take longer than others
+#define RAYCAST_BATCH_JOBS_PER_THREAD 8
+// Batches aren't split into jobs with fewer rays than this, a multiple of the packet size so packets never cross jobs
+#define RAYCAST_BATCH_MIN_JOB_SIZE 64
+// Triangles whose plane is closer to parallel to the ray than this (determinant of the ray triangle test) are never hit
+#define RAY_TRIANGLE_MIN_DETERMINANT 0.00001f
+// Direction components closer to 0 than this are replaced by it, so the slab tests never multiply 0 by infinity
+#define BVH_MIN_DIRECTION_COMPONENT 0.0000000001f
+// Squared lengths (triangle normals, offsets, cross products of nearly parallel directions) below this are treated as 0 by the sweeps, which then rely on other features
+#define SWEEP_MIN_SQUARED_LENGTH 0.000000000001f
 
+typedef struct BvhBin
+{
+	f32 min[3];
+	f32 max[3];
+	u32 count;
+} BvhBin;
+
+typedef struct BvhBuildTask
+{
+	u32 node;
+	u32 first;
+	u32 count;
+	u32 depth;
+	f32 centroidMin[3];
+	f32 centroidMax[3];
+} BvhBuildTask;
+
+typedef struct BvhBuildTriangle
+{
+	f32 min[3];
+	f32 max[3];
+	f32 centroid[3];
+	u32 triangle;
+} BvhBuildTriangle;
+
+typedef struct BvhTraversalEntry
+{
+	u32 node;
+	f32 enterDistance;
+} BvhTraversalEntry;
+
+
+// Moller Trumbore ray triangle intersection with the edges from v0 to the other two vertices, returns false if the ray is parallel to the triangle or misses it,
+// hits behind the origin are returned with a negative distance. The simd kernels below do the same per lane.
+// https://www.scratchapixel.com/lessons/3d-basic-rendering/ray-tracing-rendering-a-triangle/moller-trumbore-ray-triangle-intersection.html
+static inline bool RayIntersectsTriangle(vec3 origin, vec3 direction, vec3 v0, vec3 v0v1, vec3 v0v2, f32* out_distance)
+{
+	vec3 P = vec3_cross_vec3(direction, v0v2);
+	f32 determinant = vec3_dot(v0v1, P);
+
+	if (fabsf(determinant) < RAY_TRIANGLE_MIN_DETERMINANT)
+		return false;
+
+	f32 inverseDeterminant = 1.f / determinant;
 
+	vec3 T = vec3_sub_vec3(origin, v0);
+	f32 u = vec3_dot(T, P) * inverseDeterminant;
+	if (u < 0 || u > 1)
+		return false;
+
+	vec3 Q = vec3_cross_vec3(T, v0v1);
+	f32 v = vec3_dot(direction, Q) * inverseDeterminant;
+	if (v < 0 || u + v > 1)
+		return false;
+
+	*out_distance = vec3_dot(v0v2, Q) * inverseDeterminant;
+	return true;
+}
+
+static inline vec3 GetTriangleVertexPosition(MeshData mesh, u32 triangle, u32 corner, u32 positionOffset)
+{
+	return *(vec3*)((u8*)mesh.vertices + mesh.indices[triangle * 3 + corner] * mesh.vertexStride + positionOffset);
+}
 
 RaycastHit RaycastMesh(vec3 origin, vec3 direction, MeshData mesh, mat4 modelMatrix, u32 positionOffset, u32 normalOffset)
 {
@@ -21,34 +105,14 @@ RaycastHit RaycastMesh(vec3 origin, vec3 direction, MeshData mesh, mat4 modelMat
 
 	for (u32 i = 0; i < mesh.indexCount / 3; i++)
 	{
-		vec3 v0 = *(vec3*)((u8*)mesh.vertices + mesh.indices[i * 3 + 0] * mesh.vertexStride + positionOffset);
-		vec3 v1 = *(vec3*)((u8*)mesh.vertices + mesh.indices[i * 3 + 1] * mesh.vertexStride + positionOffset);
-		vec3 v2 = *(vec3*)((u8*)mesh.vertices + mesh.indices[i * 3 + 2] * mesh.vertexStride + positionOffset);
+		vec3 v0 = GetTriangleVertexPosition(mesh, i, 0, positionOffset);
+		vec3 v1 = GetTriangleVertexPosition(mesh, i, 1, positionOffset);
+		vec3 v2 = GetTriangleVertexPosition(mesh, i, 2, positionOffset);
 
-		// Moller Trumbore ray triangle intersection
-		// https://www.scratchapixel.com/lessons/3d-basic-rendering/ray-tracing-rendering-a-triangle/moller-trumbore-ray-triangle-intersection.html
-		vec3 v0v1 = vec3_sub_vec3(v1, v0);
-		vec3 v0v2 = vec3_sub_vec3(v2, v0);
-		vec3 P = vec3_cross_vec3(objectSpaceDirection, v0v2);
-		f32 determinant = vec3_dot(v0v1, P);
-
-		if (fabsf(determinant) < 0.00001f)
-			continue;
-		
-		f32 inverseDeterminant = 1.f / determinant;
-
-		vec3 T = vec3_sub_vec3(objectSpaceOrigin, v0);
-		f32 u = vec3_dot(T, P) * inverseDeterminant;
-		if (u < 0 || u > 1)
+		f32 t;
+		if (!RayIntersectsTriangle(objectSpaceOrigin, objectSpaceDirection, v0, vec3_sub_vec3(v1, v0), vec3_sub_vec3(v2, v0), &t))
 			continue;
 
-		vec3 Q = vec3_cross_vec3(T, v0v1);
-		f32 v = vec3_dot(objectSpaceDirection, Q) * inverseDeterminant;
-		if (v < 0 || u + v > 1)
-			continue;
-		
-		f32 t = vec3_dot(v0v2, Q) * inverseDeterminant;
-
 		if (t < closestHitDistance)
 		{
 			closestHitDistance = t;
@@ -66,4 +130,1284 @@ RaycastHit RaycastMesh(vec3 origin, vec3 direction, MeshData mesh, mat4 modelMat
 	return hit;
 }
 
+// Half of the surface area of the box, the surface area heuristic only compares areas so the factor doesn't matter
+static inline f32 GetBoundsHalfArea(f32* min, f32* max)
+{
+	f32 x = max[0] - min[0];
+	f32 y = max[1] - min[1];
+	f32 z = max[2] - min[2];
+	return x * y + y * z + z * x;
+}
+
+static inline void GrowBounds(f32* min, f32* max, f32* otherMin, f32* otherMax)
+{
+	for (u32 axis = 0; axis < 3; axis++)
+	{
+		min[axis] = otherMin[axis] < min[axis] ? otherMin[axis] : min[axis];
+		max[axis] = otherMax[axis] > max[axis] ? otherMax[axis] : max[axis];
+	}
+}
+
+// Leaves are tested a group at a time, so the surface area heuristic counts groups instead of triangles
+static inline u32 GetTriangleGroupCount(u32 triangleCount)
+{
+	return (triangleCount + BVH_TRIANGLE_GROUP_SIZE - 1) / BVH_TRIANGLE_GROUP_SIZE;
+}
+
+static inline u32 GetBinIndex(f32 centroid, f32 centroidMin, f32 binScale)
+{
+	i32 bin = (i32)((centroid - centroidMin) * binScale);
+	return bin < 0 ? 0 : (bin >= BVH_BIN_COUNT ? BVH_BIN_COUNT - 1 : bin);
+}
+
+MeshBvh MeshBvhCreate(MeshData mesh, u32 positionOffset, Allocator* allocator)
+{
+	MeshBvh bvh = {};
+	bvh.triangleCount = mesh.indexCount / 3;
+	if (bvh.triangleCount == 0)
+		return bvh;
+
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	// The bounds and centroids are partitioned together with the triangles, so every pass over a node reads its triangles in order
+	BvhBuildTriangle* buildTriangles = ArenaAlloc(global->frameArena, sizeof(*buildTriangles) * bvh.triangleCount);
+	f32 rootCentroidMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	f32 rootCentroidMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	// A binary tree with at least one triangle per leaf has at most 2n - 1 nodes, the array is shrunk to the nodes that were used at the end
+	bvh.nodes = Alloc(allocator, sizeof(*bvh.nodes) * (2 * bvh.triangleCount - 1));
+	bvh.nodeCount = 1;
+	BvhNode* root = &bvh.nodes[0];
+	for (u32 axis = 0; axis < 3; axis++)
+	{
+		root->min[axis] = FLT_MAX;
+		root->max[axis] = -FLT_MAX;
+	}
+
+	for (u32 i = 0; i < bvh.triangleCount; i++)
+	{
+		vec3 v0 = GetTriangleVertexPosition(mesh, i, 0, positionOffset);
+		vec3 v1 = GetTriangleVertexPosition(mesh, i, 1, positionOffset);
+		vec3 v2 = GetTriangleVertexPosition(mesh, i, 2, positionOffset);
+		BvhBuildTriangle* buildTriangle = &buildTriangles[i];
+		buildTriangle->min[0] = fminf(v0.x, fminf(v1.x, v2.x));
+		buildTriangle->min[1] = fminf(v0.y, fminf(v1.y, v2.y));
+		buildTriangle->min[2] = fminf(v0.z, fminf(v1.z, v2.z));
+		buildTriangle->max[0] = fmaxf(v0.x, fmaxf(v1.x, v2.x));
+		buildTriangle->max[1] = fmaxf(v0.y, fmaxf(v1.y, v2.y));
+		buildTriangle->max[2] = fmaxf(v0.z, fmaxf(v1.z, v2.z));
+		for (u32 axis = 0; axis < 3; axis++)
+			buildTriangle->centroid[axis] = (buildTriangle->min[axis] + buildTriangle->max[axis]) * 0.5f;
+		buildTriangle->triangle = i;
+		GrowBounds(root->min, root->max, buildTriangle->min, buildTriangle->max);
+		GrowBounds(rootCentroidMin, rootCentroidMax, buildTriangle->centroid, buildTriangle->centroid);
+	}
+
+	// Depth first, the second child is pushed first so the nodes of a subtree are close together in the array.
+	// The bounds of a node are set by its parent, the task has the bounds of the centroids.
+	BvhBuildTask taskStack[BVH_MAX_DEPTH + 1];
+	u32 taskCount = 1;
+	taskStack[0] = (BvhBuildTask){ 0, 0, bvh.triangleCount, 0 };
+	for (u32 axis = 0; axis < 3; axis++)
+	{
+		taskStack[0].centroidMin[axis] = rootCentroidMin[axis];
+		taskStack[0].centroidMax[axis] = rootCentroidMax[axis];
+	}
+
+	while (taskCount > 0)
+	{
+		BvhBuildTask task = taskStack[--taskCount];
+		BvhNode* node = &bvh.nodes[task.node];
+		BvhBuildTriangle* nodeTriangles = buildTriangles + task.first;
+
+		// Binning the centroids along all three axes at once
+		BvhBin bins[3][BVH_BIN_COUNT];
+		f32 binScales[3];
+		for (u32 axis = 0; axis < 3; axis++)
+		{
+			f32 extent = task.centroidMax[axis] - task.centroidMin[axis];
+			binScales[axis] = extent > 0 ? BVH_BIN_COUNT / extent : 0;
+			for (u32 bin = 0; bin < BVH_BIN_COUNT; bin++)
+				bins[axis][bin] = (BvhBin){ { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX }, 0 };
+		}
+		if (task.count > 1)
+		{
+			for (u32 i = 0; i < task.count; i++)
+			{
+				for (u32 axis = 0; axis < 3; axis++)
+				{
+					BvhBin* bin = &bins[axis][GetBinIndex(nodeTriangles[i].centroid[axis], task.centroidMin[axis], binScales[axis])];
+					GrowBounds(bin->min, bin->max, nodeTriangles[i].min, nodeTriangles[i].max);
+					bin->count++;
+				}
+			}
+		}
+
+		// Cost of every split between two bins is the traversal cost plus the triangles of both sides weighted by the chance that a ray through the node hits the side.
+		// The costs are kept multiplied by the area of the node, so nodes without area (all triangles on a line) don't divide by 0.
+		f32 bestCost = FLT_MAX;
+		u32 bestAxis = 0;
+		u32 bestSplit = 0;
+		f32 nodeArea = GetBoundsHalfArea(node->min, node->max);
+		for (u32 axis = 0; axis < 3 && task.count > 1; axis++)
+		{
+			if (binScales[axis] == 0)
+				continue;
+
+			// Area times triangle count of the bins left of every split
+			f32 leftCosts[BVH_BIN_COUNT];
+			f32 leftMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+			f32 leftMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			u32 leftCount = 0;
+			for (u32 split = 1; split < BVH_BIN_COUNT; split++)
+			{
+				BvhBin* bin = &bins[axis][split - 1];
+				GrowBounds(leftMin, leftMax, bin->min, bin->max);
+				leftCount += bin->count;
+				leftCosts[split] = leftCount > 0 ? GetBoundsHalfArea(leftMin, leftMax) * GetTriangleGroupCount(leftCount) : 0;
+			}
+
+			f32 rightMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+			f32 rightMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			u32 rightCount = 0;
+			for (u32 split = BVH_BIN_COUNT - 1; split > 0; split--)
+			{
+				BvhBin* bin = &bins[axis][split];
+				GrowBounds(rightMin, rightMax, bin->min, bin->max);
+				rightCount += bin->count;
+				if (rightCount == 0 || rightCount == task.count)
+					continue;
+
+				f32 cost = BVH_TRAVERSAL_COST * nodeArea + leftCosts[split] + GetBoundsHalfArea(rightMin, rightMax) * GetTriangleGroupCount(rightCount);
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = split;
+				}
+			}
+		}
+
+		// There is no split if the node has a single triangle or all centroids are in the same place
+		bool noSplit = bestSplit == 0;
+		bool splitIsWorse = task.count <= BVH_MAX_LEAF_TRIANGLES && bestCost >= GetTriangleGroupCount(task.count) * nodeArea;
+		if (noSplit || splitIsWorse || task.depth + 1 >= BVH_MAX_DEPTH)
+		{
+			node->first = task.first;
+			node->triangleCount = task.count;
+			continue;
+		}
+
+		node->first = bvh.nodeCount;
+		node->triangleCount = 0;
+		bvh.nodeCount += 2;
+		BvhNode* children = &bvh.nodes[node->first];
+		BvhBuildTask childTasks[2];
+		for (u32 child = 0; child < 2; child++)
+		{
+			childTasks[child] = (BvhBuildTask){ node->first + child, 0, 0, task.depth + 1 };
+			for (u32 axis = 0; axis < 3; axis++)
+			{
+				children[child].min[axis] = FLT_MAX;
+				children[child].max[axis] = -FLT_MAX;
+				childTasks[child].centroidMin[axis] = FLT_MAX;
+				childTasks[child].centroidMax[axis] = -FLT_MAX;
+			}
+		}
+		for (u32 bin = 0; bin < BVH_BIN_COUNT; bin++)
+		{
+			BvhNode* child = &children[bin < bestSplit ? 0 : 1];
+			GrowBounds(child->min, child->max, bins[bestAxis][bin].min, bins[bestAxis][bin].max);
+		}
+
+		// Partitioning the triangles of the node into the two sides of the split
+		u32 left = 0;
+		u32 right = task.count;
+		while (left < right)
+		{
+			BvhBuildTriangle* buildTriangle = &nodeTriangles[left];
+			if (GetBinIndex(buildTriangle->centroid[bestAxis], task.centroidMin[bestAxis], binScales[bestAxis]) < bestSplit)
+			{
+				GrowBounds(childTasks[0].centroidMin, childTasks[0].centroidMax, buildTriangle->centroid, buildTriangle->centroid);
+				left++;
+			}
+			else
+			{
+				right--;
+				BvhBuildTriangle swap = nodeTriangles[left];
+				nodeTriangles[left] = nodeTriangles[right];
+				nodeTriangles[right] = swap;
+				GrowBounds(childTasks[1].centroidMin, childTasks[1].centroidMax, swap.centroid, swap.centroid);
+			}
+		}
+
+		childTasks[0].first = task.first;
+		childTasks[0].count = left;
+		childTasks[1].first = task.first + left;
+		childTasks[1].count = task.count - left;
+		taskStack[taskCount++] = childTasks[1];
+		taskStack[taskCount++] = childTasks[0];
+	}
+
+	bvh.nodes = Realloc(allocator, bvh.nodes, sizeof(*bvh.nodes) * bvh.nodeCount);
+
+	// Copying the triangles of every leaf into groups, the unused lanes stay zero (a degenerate triangle)
+	bvh.triangleGroupCount = 0;
+	for (u32 i = 0; i < bvh.nodeCount; i++)
+		bvh.triangleGroupCount += GetTriangleGroupCount(bvh.nodes[i].triangleCount);
+	bvh.triangleGroups = Alloc(allocator, sizeof(*bvh.triangleGroups) * bvh.triangleGroupCount);
+	bvh.triangles = Alloc(allocator, sizeof(*bvh.triangles) * bvh.triangleGroupCount * BVH_TRIANGLE_GROUP_SIZE);
+	MemoryZero(bvh.triangleGroups, sizeof(*bvh.triangleGroups) * bvh.triangleGroupCount);
+	MemorySet(bvh.triangles, 0xFF, sizeof(*bvh.triangles) * bvh.triangleGroupCount * BVH_TRIANGLE_GROUP_SIZE);
+
+	u32 groupStart = 0;
+	for (u32 i = 0; i < bvh.nodeCount; i++)
+	{
+		BvhNode* node = &bvh.nodes[i];
+		if (node->triangleCount == 0)
+			continue;
+
+		for (u32 j = 0; j < node->triangleCount; j++)
+		{
+			u32 triangle = buildTriangles[node->first + j].triangle;
+			vec3 v0 = GetTriangleVertexPosition(mesh, triangle, 0, positionOffset);
+			vec3 v0v1 = vec3_sub_vec3(GetTriangleVertexPosition(mesh, triangle, 1, positionOffset), v0);
+			vec3 v0v2 = vec3_sub_vec3(GetTriangleVertexPosition(mesh, triangle, 2, positionOffset), v0);
+
+			u32 slot = groupStart * BVH_TRIANGLE_GROUP_SIZE + j;
+			BvhTriangleGroup* group = &bvh.triangleGroups[slot / BVH_TRIANGLE_GROUP_SIZE];
+			u32 lane = slot % BVH_TRIANGLE_GROUP_SIZE;
+			for (u32 axis = 0; axis < 3; axis++)
+			{
+				group->v0[axis][lane] = ((f32*)&v0)[axis];
+				group->edge1[axis][lane] = ((f32*)&v0v1)[axis];
+				group->edge2[axis][lane] = ((f32*)&v0v2)[axis];
+			}
+			bvh.triangles[slot] = triangle;
+		}
+
+		node->first = groupStart * BVH_TRIANGLE_GROUP_SIZE;
+		groupStart += GetTriangleGroupCount(node->triangleCount);
+	}
+
+	ArenaFreeMarker(global->frameArena, marker);
+	return bvh;
+}
+
+void MeshBvhDestroy(MeshBvh* bvh, Allocator* allocator)
+{
+	if (bvh->triangleCount == 0)
+		return;
+
+	Free(allocator, bvh->nodes);
+	Free(allocator, bvh->triangleGroups);
+	Free(allocator, bvh->triangles);
+	*bvh = (MeshBvh){};
+}
+
+// Ray prepared for the bvh traversal
+typedef struct BvhRay
+{
+	f32 origin[3];
+	f32 direction[3];
+	f32 inverseDirection[3];
+} BvhRay;
+
+static inline f32 GetSafeInverseDirection(f32 component)
+{
+	if (fabsf(component) < BVH_MIN_DIRECTION_COMPONENT)
+		component = component < 0 ? -BVH_MIN_DIRECTION_COMPONENT : BVH_MIN_DIRECTION_COMPONENT;
+	return 1.f / component;
+}
+
+static inline BvhRay CreateBvhRay(vec3 origin, vec3 direction)
+{
+	direction = vec3_normalize(direction);
+	BvhRay ray = {};
+	for (u32 axis = 0; axis < 3; axis++)
+	{
+		ray.origin[axis] = ((f32*)&origin)[axis];
+		ray.direction[axis] = ((f32*)&direction)[axis];
+		ray.inverseDirection[axis] = GetSafeInverseDirection(ray.direction[axis]);
+	}
+	return ray;
+}
+
+// Slab test, returns the distance at which the ray enters the node or FLT_MAX if it misses the node or enters it after maxDistance
+static inline f32 GetRayNodeEnterDistance(BvhNode* node, BvhRay* ray, f32 maxDistance)
+{
+	f32 enter = 0;
+	f32 exit = maxDistance;
+	for (u32 axis = 0; axis < 3; axis++)
+	{
+		f32 t0 = (node->min[axis] - ray->origin[axis]) * ray->inverseDirection[axis];
+		f32 t1 = (node->max[axis] - ray->origin[axis]) * ray->inverseDirection[axis];
+		enter = t0 < t1 ? (t0 > enter ? t0 : enter) : (t1 > enter ? t1 : enter);
+		exit = t0 < t1 ? (t1 < exit ? t1 : exit) : (t0 < exit ? t0 : exit);
+	}
+	return enter <= exit ? enter : FLT_MAX;
+}
+
+// ================================== Ray triangle kernels ==================================
+// One ray against the triangles of one group (4 wide) or two consecutive groups (8 wide). They return the lane of the closest hit in front of the origin that is closer
+// than *closestDistance and set *closestDistance to its distance, or -1 if there is no such hit. Ties go to the lowest lane, like in the scalar loop.
+#if defined(__SSE2__)
+static inline i32 IntersectTriangleGroup4(BvhRay* ray, BvhTriangleGroup* group, f32* closestDistance)
+{
+	__m128 dx = _mm_set1_ps(ray->direction[0]);
+	__m128 dy = _mm_set1_ps(ray->direction[1]);
+	__m128 dz = _mm_set1_ps(ray->direction[2]);
+	__m128 e1x = _mm_loadu_ps(group->edge1[0]);
+	__m128 e1y = _mm_loadu_ps(group->edge1[1]);
+	__m128 e1z = _mm_loadu_ps(group->edge1[2]);
+	__m128 e2x = _mm_loadu_ps(group->edge2[0]);
+	__m128 e2y = _mm_loadu_ps(group->edge2[1]);
+	__m128 e2z = _mm_loadu_ps(group->edge2[2]);
+
+	// P = direction x edge2
+	__m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+	__m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+	__m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+	__m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+	__m128 absoluteDeterminant = _mm_andnot_ps(_mm_set1_ps(-0.f), determinant);
+	__m128 valid = _mm_cmpge_ps(absoluteDeterminant, _mm_set1_ps(RAY_TRIANGLE_MIN_DETERMINANT));
+	__m128 inverseDeterminant = _mm_div_ps(_mm_set1_ps(1.f), determinant);
+
+	// T = origin - v0
+	__m128 tx = _mm_sub_ps(_mm_set1_ps(ray->origin[0]), _mm_loadu_ps(group->v0[0]));
+	__m128 ty = _mm_sub_ps(_mm_set1_ps(ray->origin[1]), _mm_loadu_ps(group->v0[1]));
+	__m128 tz = _mm_sub_ps(_mm_set1_ps(ray->origin[2]), _mm_loadu_ps(group->v0[2]));
+	__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), inverseDeterminant);
+	valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(u, _mm_setzero_ps()), _mm_cmple_ps(u, _mm_set1_ps(1.f))));
+
+	// Q = T x edge1
+	__m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+	__m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+	__m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+	__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inverseDeterminant);
+	valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(v, _mm_setzero_ps()), _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.f))));
+
+	__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverseDeterminant);
+	valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(t, _mm_setzero_ps()), _mm_cmplt_ps(t, _mm_set1_ps(*closestDistance))));
+	u32 validMask = _mm_movemask_ps(valid);
+	if (validMask == 0)
+		return -1;
+
+	// Smallest valid distance in every lane, then the first lane that has it
+	t = _mm_or_ps(_mm_and_ps(valid, t), _mm_andnot_ps(valid, _mm_set1_ps(FLT_MAX)));
+	__m128 minimum = _mm_min_ps(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(2, 3, 0, 1)));
+	minimum = _mm_min_ps(minimum, _mm_shuffle_ps(minimum, minimum, _MM_SHUFFLE(1, 0, 3, 2)));
+	*closestDistance = _mm_cvtss_f32(minimum);
+	return __builtin_ctz(_mm_movemask_ps(_mm_cmpeq_ps(t, minimum)) & validMask);
+}
+#else
+static inline i32 IntersectTriangleGroup4(BvhRay* ray, BvhTriangleGroup* group, f32* closestDistance)
+{
+	vec3 origin = vec3_create(ray->origin[0], ray->origin[1], ray->origin[2]);
+	vec3 direction = vec3_create(ray->direction[0], ray->direction[1], ray->direction[2]);
+	i32 closestLane = -1;
+	for (u32 lane = 0; lane < BVH_TRIANGLE_GROUP_SIZE; lane++)
+	{
+		vec3 v0 = vec3_create(group->v0[0][lane], group->v0[1][lane], group->v0[2][lane]);
+		vec3 v0v1 = vec3_create(group->edge1[0][lane], group->edge1[1][lane], group->edge1[2][lane]);
+		vec3 v0v2 = vec3_create(group->edge2[0][lane], group->edge2[1][lane], group->edge2[2][lane]);
+		f32 t;
+		if (RayIntersectsTriangle(origin, direction, v0, v0v1, v0v2, &t) && t >= 0 && t < *closestDistance)
+		{
+			*closestDistance = t;
+			closestLane = lane;
+		}
+	}
+	return closestLane;
+}
+#endif
+
+#if defined(__AVX2__)
+// The lanes of the two groups are put next to each other in one 8 wide register
+static inline __m256 LoadGroupPair(f32* firstGroupValues, f32* secondGroupValues)
+{
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(firstGroupValues)), _mm_loadu_ps(secondGroupValues), 1);
+}
+
+static inline i32 IntersectTriangleGroups8(BvhRay* ray, BvhTriangleGroup* groups, f32* closestDistance)
+{
+	__m256 dx = _mm256_set1_ps(ray->direction[0]);
+	__m256 dy = _mm256_set1_ps(ray->direction[1]);
+	__m256 dz = _mm256_set1_ps(ray->direction[2]);
+	__m256 e1x = LoadGroupPair(groups[0].edge1[0], groups[1].edge1[0]);
+	__m256 e1y = LoadGroupPair(groups[0].edge1[1], groups[1].edge1[1]);
+	__m256 e1z = LoadGroupPair(groups[0].edge1[2], groups[1].edge1[2]);
+	__m256 e2x = LoadGroupPair(groups[0].edge2[0], groups[1].edge2[0]);
+	__m256 e2y = LoadGroupPair(groups[0].edge2[1], groups[1].edge2[1]);
+	__m256 e2z = LoadGroupPair(groups[0].edge2[2], groups[1].edge2[2]);
+
+	// P = direction x edge2
+	__m256 px = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+	__m256 py = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+	__m256 pz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+	__m256 determinant = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, px), _mm256_mul_ps(e1y, py)), _mm256_mul_ps(e1z, pz));
+	__m256 absoluteDeterminant = _mm256_andnot_ps(_mm256_set1_ps(-0.f), determinant);
+	__m256 valid = _mm256_cmp_ps(absoluteDeterminant, _mm256_set1_ps(RAY_TRIANGLE_MIN_DETERMINANT), _CMP_GE_OQ);
+	__m256 inverseDeterminant = _mm256_div_ps(_mm256_set1_ps(1.f), determinant);
+
+	// T = origin - v0
+	__m256 tx = _mm256_sub_ps(_mm256_set1_ps(ray->origin[0]), LoadGroupPair(groups[0].v0[0], groups[1].v0[0]));
+	__m256 ty = _mm256_sub_ps(_mm256_set1_ps(ray->origin[1]), LoadGroupPair(groups[0].v0[1], groups[1].v0[1]));
+	__m256 tz = _mm256_sub_ps(_mm256_set1_ps(ray->origin[2]), LoadGroupPair(groups[0].v0[2], groups[1].v0[2]));
+	__m256 u = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tx, px), _mm256_mul_ps(ty, py)), _mm256_mul_ps(tz, pz)), inverseDeterminant);
+	valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(u, _mm256_setzero_ps(), _CMP_GE_OQ), _mm256_cmp_ps(u, _mm256_set1_ps(1.f), _CMP_LE_OQ)));
+
+	// Q = T x edge1
+	__m256 qx = _mm256_sub_ps(_mm256_mul_ps(ty, e1z), _mm256_mul_ps(tz, e1y));
+	__m256 qy = _mm256_sub_ps(_mm256_mul_ps(tz, e1x), _mm256_mul_ps(tx, e1z));
+	__m256 qz = _mm256_sub_ps(_mm256_mul_ps(tx, e1y), _mm256_mul_ps(ty, e1x));
+	__m256 v = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)), inverseDeterminant);
+	valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_GE_OQ), _mm256_cmp_ps(_mm256_add_ps(u, v), _mm256_set1_ps(1.f), _CMP_LE_OQ)));
+
+	__m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)), inverseDeterminant);
+	valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(t, _mm256_setzero_ps(), _CMP_GE_OQ), _mm256_cmp_ps(t, _mm256_set1_ps(*closestDistance), _CMP_LT_OQ)));
+	u32 validMask = _mm256_movemask_ps(valid);
+	if (validMask == 0)
+		return -1;
+
+	t = _mm256_blendv_ps(_mm256_set1_ps(FLT_MAX), t, valid);
+	__m256 minimum = _mm256_min_ps(t, _mm256_permute_ps(t, _MM_SHUFFLE(2, 3, 0, 1)));
+	minimum = _mm256_min_ps(minimum, _mm256_permute_ps(minimum, _MM_SHUFFLE(1, 0, 3, 2)));
+	minimum = _mm256_min_ps(minimum, _mm256_permute2f128_ps(minimum, minimum, 1));
+	*closestDistance = _mm256_cvtss_f32(minimum);
+	return __builtin_ctz(_mm256_movemask_ps(_mm256_cmp_ps(t, minimum, _CMP_EQ_OQ)) & validMask);
+}
+#endif
+
+// Tests the ray against all groups of a leaf, 8 wide while there are two groups left
+static inline void IntersectLeaf(BvhRay* ray, MeshBvh* bvh, BvhNode* leaf, f32* closestDistance, u32* closestTriangle)
+{
+	u32 group = leaf->first / BVH_TRIANGLE_GROUP_SIZE;
+	u32 groupEnd = group + GetTriangleGroupCount(leaf->triangleCount);
+	while (group < groupEnd)
+	{
+#if defined(__AVX2__)
+		if (group + 2 <= groupEnd)
+		{
+			i32 lane = IntersectTriangleGroups8(ray, &bvh->triangleGroups[group], closestDistance);
+			if (lane >= 0)
+				*closestTriangle = bvh->triangles[group * BVH_TRIANGLE_GROUP_SIZE + lane];
+			group += 2;
+			continue;
+		}
+#endif
+		i32 lane = IntersectTriangleGroup4(ray, &bvh->triangleGroups[group], closestDistance);
+		if (lane >= 0)
+			*closestTriangle = bvh->triangles[group * BVH_TRIANGLE_GROUP_SIZE + lane];
+		group++;
+	}
+}
+
+RaycastHit RaycastMeshBvh(vec3 origin, vec3 direction, MeshBvh bvh, f32 maxDistance)
+{
+	RaycastHit hit = {};
+	hit.hit = false;
+	hit.hitDistance = -1;
+	hit.triangleFirstIndex = UINT32_MAX;
+
+	if (bvh.nodeCount == 0)
+		return hit;
+
+	BvhRay ray = CreateBvhRay(origin, direction);
+	u32 closestTriangle = UINT32_MAX;
+	f32 closestHitDistance = maxDistance;
+
+	// Nodes that were skipped for their closer sibling, with the distance at which the ray enters them so they can be dropped once there is a closer hit
+	BvhTraversalEntry stack[BVH_MAX_DEPTH + 1];
+	u32 stackSize = 0;
+	if (GetRayNodeEnterDistance(&bvh.nodes[0], &ray, closestHitDistance) != FLT_MAX)
+		stack[stackSize++] = (BvhTraversalEntry){ 0, 0 };
+
+	while (stackSize > 0)
+	{
+		BvhTraversalEntry entry = stack[--stackSize];
+		if (entry.enterDistance > closestHitDistance)
+			continue;
+
+		BvhNode* node = &bvh.nodes[entry.node];
+		while (node->triangleCount == 0)
+		{
+			BvhNode* firstChild = &bvh.nodes[node->first];
+			BvhNode* secondChild = firstChild + 1;
+			f32 firstDistance = GetRayNodeEnterDistance(firstChild, &ray, closestHitDistance);
+			f32 secondDistance = GetRayNodeEnterDistance(secondChild, &ray, closestHitDistance);
+			if (firstDistance == FLT_MAX && secondDistance == FLT_MAX)
+			{
+				node = nullptr;
+				break;
+			}
+
+			// Going into the closer child first, the other one is visited later if it can still have a closer hit
+			if (firstDistance <= secondDistance)
+			{
+				if (secondDistance != FLT_MAX)
+					stack[stackSize++] = (BvhTraversalEntry){ node->first + 1, secondDistance };
+				node = firstChild;
+			}
+			else
+			{
+				if (firstDistance != FLT_MAX)
+					stack[stackSize++] = (BvhTraversalEntry){ node->first, firstDistance };
+				node = secondChild;
+			}
+		}
+		if (node)
+			IntersectLeaf(&ray, &bvh, node, &closestHitDistance, &closestTriangle);
+	}
+
+	if (closestTriangle != UINT32_MAX)
+	{
+		hit.hit = true;
+		hit.triangleFirstIndex = closestTriangle * 3;
+		hit.hitDistance = closestHitDistance;
+	}
+
+	return hit;
+}
+
+// ================================== Ray packets ==================================
+#if defined(__AVX2__)
+// Rays of a packet in structure of arrays layout, so every lane of the 8 wide kernels is a ray. Unused rays have a closest distance below 0, they never enter a node.
+typedef struct BvhRayPacket
+{
+	_Alignas(32) f32 origin[3][RAY_PACKET_SIZE];
+	_Alignas(32) f32 direction[3][RAY_PACKET_SIZE];
+	_Alignas(32) f32 inverseDirection[3][RAY_PACKET_SIZE];
+	_Alignas(32) f32 closestDistance[RAY_PACKET_SIZE];
+	_Alignas(32) u32 closestTriangle[RAY_PACKET_SIZE];
+} BvhRayPacket;
+
+// Returns a bit for every ray of the packet that enters the node before its closest hit
+static inline u32 GetPacketNodeHitMask(BvhNode* node, BvhRayPacket* packet)
+{
+	__m256 enter = _mm256_setzero_ps();
+	__m256 exit = _mm256_load_ps(packet->closestDistance);
+	for (u32 axis = 0; axis < 3; axis++)
+	{
+		__m256 origin = _mm256_load_ps(packet->origin[axis]);
+		__m256 inverseDirection = _mm256_load_ps(packet->inverseDirection[axis]);
+		__m256 t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node->min[axis]), origin), inverseDirection);
+		__m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node->max[axis]), origin), inverseDirection);
+		enter = _mm256_max_ps(enter, _mm256_min_ps(t0, t1));
+		exit = _mm256_min_ps(exit, _mm256_max_ps(t0, t1));
+	}
+	return _mm256_movemask_ps(_mm256_cmp_ps(enter, exit, _CMP_LE_OQ));
+}
+
+// All rays of the packet against one triangle of a group, every ray keeps its own closest hit
+static inline void IntersectPacketTriangle(BvhRayPacket* packet, BvhTriangleGroup* group, u32 lane, u32 triangle)
+{
+	__m256 dx = _mm256_load_ps(packet->direction[0]);
+	__m256 dy = _mm256_load_ps(packet->direction[1]);
+	__m256 dz = _mm256_load_ps(packet->direction[2]);
+	__m256 e1x = _mm256_set1_ps(group->edge1[0][lane]);
+	__m256 e1y = _mm256_set1_ps(group->edge1[1][lane]);
+	__m256 e1z = _mm256_set1_ps(group->edge1[2][lane]);
+	__m256 e2x = _mm256_set1_ps(group->edge2[0][lane]);
+	__m256 e2y = _mm256_set1_ps(group->edge2[1][lane]);
+	__m256 e2z = _mm256_set1_ps(group->edge2[2][lane]);
+
+	// P = direction x edge2
+	__m256 px = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+	__m256 py = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+	__m256 pz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+	__m256 determinant = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, px), _mm256_mul_ps(e1y, py)), _mm256_mul_ps(e1z, pz));
+	__m256 absoluteDeterminant = _mm256_andnot_ps(_mm256_set1_ps(-0.f), determinant);
+	__m256 valid = _mm256_cmp_ps(absoluteDeterminant, _mm256_set1_ps(RAY_TRIANGLE_MIN_DETERMINANT), _CMP_GE_OQ);
+	__m256 inverseDeterminant = _mm256_div_ps(_mm256_set1_ps(1.f), determinant);
+
+	// T = origin - v0
+	__m256 tx = _mm256_sub_ps(_mm256_load_ps(packet->origin[0]), _mm256_set1_ps(group->v0[0][lane]));
+	__m256 ty = _mm256_sub_ps(_mm256_load_ps(packet->origin[1]), _mm256_set1_ps(group->v0[1][lane]));
+	__m256 tz = _mm256_sub_ps(_mm256_load_ps(packet->origin[2]), _mm256_set1_ps(group->v0[2][lane]));
+	__m256 u = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tx, px), _mm256_mul_ps(ty, py)), _mm256_mul_ps(tz, pz)), inverseDeterminant);
+	valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(u, _mm256_setzero_ps(), _CMP_GE_OQ), _mm256_cmp_ps(u, _mm256_set1_ps(1.f), _CMP_LE_OQ)));
+
+	// Q = T x edge1
+	__m256 qx = _mm256_sub_ps(_mm256_mul_ps(ty, e1z), _mm256_mul_ps(tz, e1y));
+	__m256 qy = _mm256_sub_ps(_mm256_mul_ps(tz, e1x), _mm256_mul_ps(tx, e1z));
+	__m256 qz = _mm256_sub_ps(_mm256_mul_ps(tx, e1y), _mm256_mul_ps(ty, e1x));
+	__m256 v = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)), inverseDeterminant);
+	valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_GE_OQ), _mm256_cmp_ps(_mm256_add_ps(u, v), _mm256_set1_ps(1.f), _CMP_LE_OQ)));
+
+	__m256 closestDistance = _mm256_load_ps(packet->closestDistance);
+	__m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)), inverseDeterminant);
+	valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(t, _mm256_setzero_ps(), _CMP_GE_OQ), _mm256_cmp_ps(t, closestDistance, _CMP_LT_OQ)));
+	if (_mm256_movemask_ps(valid) == 0)
+		return;
+
+	_mm256_store_ps(packet->closestDistance, _mm256_blendv_ps(closestDistance, t, valid));
+	__m256 closestTriangle = _mm256_load_ps((f32*)packet->closestTriangle);
+	_mm256_store_ps((f32*)packet->closestTriangle, _mm256_blendv_ps(closestTriangle, _mm256_castsi256_ps(_mm256_set1_epi32(triangle)), valid));
+}
+
+void RaycastMeshBvhPacket(vec3* origins, vec3* directions, u32 rayCount, MeshBvh bvh, f32 maxDistance, RaycastHit* out_hits)
+{
+	GRASSERT_DEBUG(rayCount <= RAY_PACKET_SIZE);
+
+	BvhRayPacket packet = {};
+	for (u32 i = 0; i < RAY_PACKET_SIZE; i++)
+	{
+		BvhRay ray = i < rayCount ? CreateBvhRay(origins[i], directions[i]) : CreateBvhRay(vec3_create(0, 0, 0), vec3_create(1, 0, 0));
+		for (u32 axis = 0; axis < 3; axis++)
+		{
+			packet.origin[axis][i] = ray.origin[axis];
+			packet.direction[axis][i] = ray.direction[axis];
+			packet.inverseDirection[axis][i] = ray.inverseDirection[axis];
+		}
+		packet.closestDistance[i] = i < rayCount ? maxDistance : -1;
+		packet.closestTriangle[i] = UINT32_MAX;
+	}
+
+	// Nodes are tested again when they are taken off the stack, the rays may have found closer hits in the meantime
+	u32 stack[BVH_MAX_DEPTH + 1];
+	u32 stackSize = 0;
+	if (bvh.nodeCount > 0)
+		stack[stackSize++] = 0;
 
+	while (stackSize > 0)
+	{
+		BvhNode* node = &bvh.nodes[stack[--stackSize]];
+		u32 hitMask = GetPacketNodeHitMask(node, &packet);
+		if (hitMask == 0)
+			continue;
+
+		if (node->triangleCount > 0)
+		{
+			u32 slotEnd = node->first + GetTriangleGroupCount(node->triangleCount) * BVH_TRIANGLE_GROUP_SIZE;
+			for (u32 slot = node->first; slot < slotEnd; slot++)
+			{
+				if (bvh.triangles[slot] != UINT32_MAX)
+					IntersectPacketTriangle(&packet, &bvh.triangleGroups[slot / BVH_TRIANGLE_GROUP_SIZE], slot % BVH_TRIANGLE_GROUP_SIZE, bvh.triangles[slot]);
+			}
+			continue;
+		}
+
+		// The child that is closer along the direction of the first ray that entered the node is visited first
+		u32 firstRay = __builtin_ctz(hitMask);
+		BvhNode* firstChild = &bvh.nodes[node->first];
+		f32 centerDifference = 0;
+		for (u32 axis = 0; axis < 3; axis++)
+			centerDifference += (firstChild[1].min[axis] + firstChild[1].max[axis] - firstChild[0].min[axis] - firstChild[0].max[axis]) * packet.direction[axis][firstRay];
+		bool firstChildCloser = centerDifference >= 0;
+		stack[stackSize++] = firstChildCloser ? node->first + 1 : node->first;
+		stack[stackSize++] = firstChildCloser ? node->first : node->first + 1;
+	}
+
+	for (u32 i = 0; i < rayCount; i++)
+	{
+		out_hits[i].hit = packet.closestTriangle[i] != UINT32_MAX;
+		out_hits[i].hitDistance = out_hits[i].hit ? packet.closestDistance[i] : -1;
+		out_hits[i].triangleFirstIndex = out_hits[i].hit ? packet.closestTriangle[i] * 3 : UINT32_MAX;
+	}
+}
+#else
+// Packets need a lane per ray, without 8 wide registers the rays are cast one at a time
+void RaycastMeshBvhPacket(vec3* origins, vec3* directions, u32 rayCount, MeshBvh bvh, f32 maxDistance, RaycastHit* out_hits)
+{
+	GRASSERT_DEBUG(rayCount <= RAY_PACKET_SIZE);
+
+	for (u32 i = 0; i < rayCount; i++)
+		out_hits[i] = RaycastMeshBvh(origins[i], directions[i], bvh, maxDistance);
+}
+#endif
+
+// ================================== Raycast batches ==================================
+typedef struct RaycastBatchJobData
+{
+	vec3* origins;
+	vec3* directions;
+	RaycastHit* hits;
+	MeshBvh bvh;
+	f32 maxDistance;
+	u32 rayCount;
+	u32 raysPerJob;
+	bool coherentRays;
+} RaycastBatchJobData;
+
+static void RaycastBatchJob(void* data, u32 jobIndex)
+{
+	RaycastBatchJobData* jobData = data;
+	u32 start = jobIndex * jobData->raysPerJob;
+	u32 end = start + jobData->raysPerJob < jobData->rayCount ? start + jobData->raysPerJob : jobData->rayCount;
+
+	if (jobData->coherentRays)
+	{
+		for (u32 ray = start; ray < end; ray += RAY_PACKET_SIZE)
+		{
+			u32 packetRayCount = end - ray < RAY_PACKET_SIZE ? end - ray : RAY_PACKET_SIZE;
+			RaycastMeshBvhPacket(jobData->origins + ray, jobData->directions + ray, packetRayCount, jobData->bvh, jobData->maxDistance, jobData->hits + ray);
+		}
+	}
+	else
+	{
+		for (u32 ray = start; ray < end; ray++)
+			jobData->hits[ray] = RaycastMeshBvh(jobData->origins[ray], jobData->directions[ray], jobData->bvh, jobData->maxDistance);
+	}
+}
+
+void RaycastMeshBvhBatch(vec3* origins, vec3* directions, u32 rayCount, MeshBvh bvh, f32 maxDistance, bool coherentRays, RaycastHit* out_hits, u32 maxThreadCount)
+{
+	if (rayCount == 0)
+		return;
+
+	START_SCOPE("Raycast batch");
+
+	RaycastBatchJobData jobData = {};
+	jobData.origins = origins;
+	jobData.directions = directions;
+	jobData.hits = out_hits;
+	jobData.bvh = bvh;
+	jobData.maxDistance = maxDistance;
+	jobData.rayCount = rayCount;
+	jobData.coherentRays = coherentRays;
+
+	u32 jobCount = maxThreadCount * RAYCAST_BATCH_JOBS_PER_THREAD;
+	u32 maxJobCount = (rayCount + RAYCAST_BATCH_MIN_JOB_SIZE - 1) / RAYCAST_BATCH_MIN_JOB_SIZE;
+	jobCount = jobCount < maxJobCount ? jobCount : maxJobCount;
+	jobCount = jobCount > 0 ? jobCount : 1;
+	// Rounding the rays per job up to whole packets
+	jobData.raysPerJob = (rayCount + jobCount - 1) / jobCount;
+	jobData.raysPerJob = (jobData.raysPerJob + RAY_PACKET_SIZE - 1) / RAY_PACKET_SIZE * RAY_PACKET_SIZE;
+	jobCount = (rayCount + jobData.raysPerJob - 1) / jobData.raysPerJob;
+
+	JobSystemParallelFor(RaycastBatchJob, &jobData, jobCount, maxThreadCount);
+
+	END_SCOPE_THROUGHPUT(rayCount, "rays");
+}
+
+// ================================== Sphere and capsule sweeps ==================================
+// Sphere or capsule moving along a normalized direction, a sphere is a capsule whose segment is a single point
+typedef struct SweepShape
+{
+	vec3 segmentStart;
+	vec3 segmentEnd;
+	vec3 direction;
+	f32 radius;
+	bool capsule;
+} SweepShape;
+
+// Closest point on the triangle abc to p (Ericson, real-time collision detection 5.1.5)
+static vec3 ClosestPointOnTriangle(vec3 p, vec3 a, vec3 b, vec3 c)
+{
+	vec3 ab = vec3_sub_vec3(b, a);
+	vec3 ac = vec3_sub_vec3(c, a);
+	vec3 ap = vec3_sub_vec3(p, a);
+	f32 d1 = vec3_dot(ab, ap);
+	f32 d2 = vec3_dot(ac, ap);
+	if (d1 <= 0 && d2 <= 0)
+		return a;
+
+	vec3 bp = vec3_sub_vec3(p, b);
+	f32 d3 = vec3_dot(ab, bp);
+	f32 d4 = vec3_dot(ac, bp);
+	if (d3 >= 0 && d4 <= d3)
+		return b;
+
+	f32 vc = d1 * d4 - d3 * d2;
+	if (vc <= 0 && d1 >= 0 && d3 <= 0)
+		return vec3_add_vec3(a, vec3_mul_f32(ab, d1 / (d1 - d3)));
+
+	vec3 cp = vec3_sub_vec3(p, c);
+	f32 d5 = vec3_dot(ab, cp);
+	f32 d6 = vec3_dot(ac, cp);
+	if (d6 >= 0 && d5 <= d6)
+		return c;
+
+	f32 vb = d5 * d2 - d1 * d6;
+	if (vb <= 0 && d2 >= 0 && d6 <= 0)
+		return vec3_add_vec3(a, vec3_mul_f32(ac, d2 / (d2 - d6)));
+
+	f32 va = d3 * d6 - d5 * d4;
+	if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0)
+		return vec3_add_vec3(b, vec3_mul_f32(vec3_sub_vec3(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+
+	f32 inverseDenominator = 1.f / (va + vb + vc);
+	return vec3_add_vec3(a, vec3_add_vec3(vec3_mul_f32(ab, vb * inverseDenominator), vec3_mul_f32(ac, vc * inverseDenominator)));
+}
+
+// Closest points of the segments p1q1 and p2q2 (Ericson, real-time collision detection 5.1.9), returns their squared distance
+static f32 ClosestPointsOnSegments(vec3 p1, vec3 q1, vec3 p2, vec3 q2, vec3* out_closest1, vec3* out_closest2)
+{
+	vec3 d1 = vec3_sub_vec3(q1, p1);
+	vec3 d2 = vec3_sub_vec3(q2, p2);
+	vec3 r = vec3_sub_vec3(p1, p2);
+	f32 a = vec3_dot(d1, d1);
+	f32 e = vec3_dot(d2, d2);
+	f32 f = vec3_dot(d2, r);
+	f32 s = 0;
+	f32 t = 0;
+
+	if (a <= SWEEP_MIN_SQUARED_LENGTH && e <= SWEEP_MIN_SQUARED_LENGTH)
+	{
+		s = 0;
+		t = 0;
+	}
+	else if (a <= SWEEP_MIN_SQUARED_LENGTH)
+	{
+		t = f / e;
+		t = t < 0 ? 0 : (t > 1 ? 1 : t);
+	}
+	else
+	{
+		f32 c = vec3_dot(d1, r);
+		if (e <= SWEEP_MIN_SQUARED_LENGTH)
+		{
+			s = -c / a;
+			s = s < 0 ? 0 : (s > 1 ? 1 : s);
+		}
+		else
+		{
+			f32 b = vec3_dot(d1, d2);
+			f32 denominator = a * e - b * b;
+			// Parallel segments use any s, the clamping of t picks a matching point
+			s = denominator != 0 ? (b * f - c * e) / denominator : 0;
+			s = s < 0 ? 0 : (s > 1 ? 1 : s);
+			t = (b * s + f) / e;
+			if (t < 0)
+			{
+				t = 0;
+				s = -c / a;
+				s = s < 0 ? 0 : (s > 1 ? 1 : s);
+			}
+			else if (t > 1)
+			{
+				t = 1;
+				s = (b - c) / a;
+				s = s < 0 ? 0 : (s > 1 ? 1 : s);
+			}
+		}
+	}
+
+	*out_closest1 = vec3_add_vec3(p1, vec3_mul_f32(d1, s));
+	*out_closest2 = vec3_add_vec3(p2, vec3_mul_f32(d2, t));
+	return vec3_distance_squared(*out_closest1, *out_closest2);
+}
+
+// Distance along the normalized direction at which the ray enters the sphere, false if it misses it, starts inside of it or enters it at or after maxDistance
+static inline bool RayEntersSphere(vec3 origin, vec3 direction, vec3 center, f32 radius, f32 maxDistance, f32* out_distance)
+{
+	vec3 m = vec3_sub_vec3(origin, center);
+	f32 b = vec3_dot(m, direction);
+	if (vec3_dot(m, m) <= radius * radius || b >= 0)
+		return false;
+
+	// The discriminant from the offset of the line to the center, b * b - c cancels out for origins far away compared to the radius
+	vec3 perpendicularOffset = vec3_sub_vec3(m, vec3_mul_f32(direction, b));
+	f32 discriminant = radius * radius - vec3_dot(perpendicularOffset, perpendicularOffset);
+	if (discriminant < 0)
+		return false;
+
+	f32 distance = -b - sqrtf(discriminant);
+	if (distance >= maxDistance)
+		return false;
+	*out_distance = distance;
+	return true;
+}
+
+// Distance along the normalized direction at which the ray enters the side of the cylinder around the segment ab (without caps), false if it misses it,
+// starts inside of the infinite cylinder, is parallel to it or enters it at or after maxDistance
+static inline bool RayEntersCylinder(vec3 origin, vec3 direction, vec3 a, vec3 b, f32 radius, f32 maxDistance, f32* out_distance)
+{
+	vec3 axis = vec3_sub_vec3(b, a);
+	f32 axisLengthSquared = vec3_dot(axis, axis);
+	if (axisLengthSquared <= SWEEP_MIN_SQUARED_LENGTH)
+		return false;
+
+	// Solving in the plane perpendicular to the axis, where the cylinder is a circle
+	vec3 m = vec3_sub_vec3(origin, a);
+	vec3 perpendicularDirection = vec3_sub_vec3(direction, vec3_mul_f32(axis, vec3_dot(direction, axis) / axisLengthSquared));
+	vec3 perpendicularOffset = vec3_sub_vec3(m, vec3_mul_f32(axis, vec3_dot(m, axis) / axisLengthSquared));
+	f32 qa = vec3_dot(perpendicularDirection, perpendicularDirection);
+	f32 qb = vec3_dot(perpendicularOffset, perpendicularDirection);
+	if (qa <= SWEEP_MIN_SQUARED_LENGTH || vec3_dot(perpendicularOffset, perpendicularOffset) <= radius * radius || qb >= 0)
+		return false;
+
+	// Same stable discriminant as for spheres, from the closest point of the projected line to the axis
+	vec3 closestOffset = vec3_sub_vec3(perpendicularOffset, vec3_mul_f32(perpendicularDirection, qb / qa));
+	f32 discriminant = qa * (radius * radius - vec3_dot(closestOffset, closestOffset));
+	if (discriminant < 0)
+		return false;
+
+	f32 distance = (-qb - sqrtf(discriminant)) / qa;
+	if (distance >= maxDistance)
+		return false;
+
+	// The ray has to enter the side between the end points, the caps are spheres that are tested separately
+	f32 axisPosition = vec3_dot(vec3_add_vec3(m, vec3_mul_f32(direction, distance)), axis);
+	if (axisPosition < 0 || axisPosition > axisLengthSquared)
+		return false;
+
+	*out_distance = distance;
+	return true;
+}
+
+// Sweeps a sphere against the triangle abc, returns true and updates the hit if the sphere touches it closer than *closestDistance.
+// The contact is the first of: the sphere touching the inside of the face, the side of an edge (a cylinder around it) or a vertex (a sphere around it).
+static bool SweepSphereTriangle(vec3 center, f32 radius, vec3 direction, vec3 a, vec3 b, vec3 c, vec3 faceNormal, f32* closestDistance, vec3* out_contactPoint, vec3* out_contactNormal)
+{
+	// The face is reached first if the contact is inside of the triangle, and no part of the triangle can be touched before the plane is
+	f32 planeDistance = vec3_dot(vec3_sub_vec3(center, a), faceNormal);
+	vec3 towardsSphere = planeDistance < 0 ? vec3_invert_sign(faceNormal) : faceNormal;
+	planeDistance = fabsf(planeDistance);
+	f32 approachSpeed = -vec3_dot(direction, towardsSphere);
+	if (planeDistance > radius)
+	{
+		if (approachSpeed <= 0)
+			return false;
+
+		f32 distance = (planeDistance - radius) / approachSpeed;
+		if (distance >= *closestDistance)
+			return false;
+
+		vec3 contact = vec3_sub_vec3(vec3_add_vec3(center, vec3_mul_f32(direction, distance)), vec3_mul_f32(towardsSphere, radius));
+		bool insideTriangle = vec3_dot(vec3_cross_vec3(vec3_sub_vec3(b, a), vec3_sub_vec3(contact, a)), faceNormal) >= 0 &&
+			vec3_dot(vec3_cross_vec3(vec3_sub_vec3(c, b), vec3_sub_vec3(contact, b)), faceNormal) >= 0 &&
+			vec3_dot(vec3_cross_vec3(vec3_sub_vec3(a, c), vec3_sub_vec3(contact, c)), faceNormal) >= 0;
+		if (insideTriangle)
+		{
+			*closestDistance = distance;
+			*out_contactPoint = contact;
+			*out_contactNormal = towardsSphere;
+			return true;
+		}
+	}
+
+	vec3 vertices[3] = { a, b, c };
+	bool hit = false;
+	vec3 contact;
+	f32 distance;
+	for (u32 i = 0; i < 3; i++)
+	{
+		vec3 edgeStart = vertices[i];
+		vec3 edgeEnd = vertices[i == 2 ? 0 : i + 1];
+		if (RayEntersCylinder(center, direction, edgeStart, edgeEnd, radius, *closestDistance, &distance))
+		{
+			vec3 edge = vec3_sub_vec3(edgeEnd, edgeStart);
+			vec3 movedCenter = vec3_add_vec3(center, vec3_mul_f32(direction, distance));
+			*closestDistance = distance;
+			contact = vec3_add_vec3(edgeStart, vec3_mul_f32(edge, vec3_dot(vec3_sub_vec3(movedCenter, edgeStart), edge) / vec3_dot(edge, edge)));
+			hit = true;
+		}
+		if (RayEntersSphere(center, direction, vertices[i], radius, *closestDistance, &distance))
+		{
+			*closestDistance = distance;
+			contact = vertices[i];
+			hit = true;
+		}
+	}
+
+	if (hit)
+	{
+		*out_contactPoint = contact;
+		*out_contactNormal = vec3_normalize(vec3_sub_vec3(vec3_add_vec3(center, vec3_mul_f32(direction, *closestDistance)), contact));
+	}
+	return hit;
+}
+
+// Sweeps a capsule against the triangle abc, returns true and updates the hit if the capsule touches it closer than *closestDistance.
+// The first contact is between the closest features of the two: an end cap and the triangle (a sphere sweep), a vertex and the side of the capsule, or an edge and the segment.
+static bool SweepCapsuleTriangle(SweepShape* shape, vec3 a, vec3 b, vec3 c, vec3 faceNormal, f32* closestDistance, vec3* out_contactPoint, vec3* out_contactNormal)
+{
+	bool hit = SweepSphereTriangle(shape->segmentStart, shape->radius, shape->direction, a, b, c, faceNormal, closestDistance, out_contactPoint, out_contactNormal);
+	hit |= SweepSphereTriangle(shape->segmentEnd, shape->radius, shape->direction, a, b, c, faceNormal, closestDistance, out_contactPoint, out_contactNormal);
+
+	vec3 segment = vec3_sub_vec3(shape->segmentEnd, shape->segmentStart);
+	vec3 vertices[3] = { a, b, c };
+	for (u32 i = 0; i < 3; i++)
+	{
+		// The vertex moving against the direction hits the side of the capsule where the capsule moving along it would
+		f32 distance;
+		if (RayEntersCylinder(vertices[i], vec3_invert_sign(shape->direction), shape->segmentStart, shape->segmentEnd, shape->radius, *closestDistance, &distance))
+		{
+			vec3 movedStart = vec3_add_vec3(shape->segmentStart, vec3_mul_f32(shape->direction, distance));
+			vec3 axisPoint = vec3_add_vec3(movedStart, vec3_mul_f32(segment, vec3_dot(vec3_sub_vec3(vertices[i], movedStart), segment) / vec3_dot(segment, segment)));
+			*closestDistance = distance;
+			*out_contactPoint = vertices[i];
+			*out_contactNormal = vec3_normalize(vec3_sub_vec3(axisPoint, vertices[i]));
+			hit = true;
+		}
+
+		// The distance between the lines through the edge and the segment changes linearly with the distance moved, the contact counts if it's between the end points of both
+		vec3 edgeStart = vertices[i];
+		vec3 edge = vec3_sub_vec3(vertices[i == 2 ? 0 : i + 1], edgeStart);
+		vec3 lineNormal = vec3_cross_vec3(segment, edge);
+		f32 lineNormalLengthSquared = vec3_dot(lineNormal, lineNormal);
+		if (lineNormalLengthSquared <= SWEEP_MIN_SQUARED_LENGTH * vec3_dot(segment, segment) * vec3_dot(edge, edge))
+			continue;
+
+		lineNormal = vec3_div_float(lineNormal, sqrtf(lineNormalLengthSquared));
+		f32 lineDistance = vec3_dot(vec3_sub_vec3(shape->segmentStart, edgeStart), lineNormal);
+		if (lineDistance < 0)
+		{
+			lineNormal = vec3_invert_sign(lineNormal);
+			lineDistance = -lineDistance;
+		}
+		f32 approachSpeed = -vec3_dot(shape->direction, lineNormal);
+		if (lineDistance <= shape->radius || approachSpeed <= 0)
+			continue;
+
+		distance = (lineDistance - shape->radius) / approachSpeed;
+		if (distance >= *closestDistance)
+			continue;
+
+		vec3 offset = vec3_sub_vec3(vec3_add_vec3(shape->segmentStart, vec3_mul_f32(shape->direction, distance)), edgeStart);
+		f32 segmentDotSegment = vec3_dot(segment, segment);
+		f32 edgeDotEdge = vec3_dot(edge, edge);
+		f32 segmentDotEdge = vec3_dot(segment, edge);
+		f32 denominator = segmentDotSegment * edgeDotEdge - segmentDotEdge * segmentDotEdge;
+		f32 segmentPosition = (segmentDotEdge * vec3_dot(edge, offset) - vec3_dot(segment, offset) * edgeDotEdge) / denominator;
+		f32 edgePosition = (segmentDotSegment * vec3_dot(edge, offset) - segmentDotEdge * vec3_dot(segment, offset)) / denominator;
+		if (segmentPosition < 0 || segmentPosition > 1 || edgePosition < 0 || edgePosition > 1)
+			continue;
+
+		*closestDistance = distance;
+		*out_contactPoint = vec3_add_vec3(edgeStart, vec3_mul_f32(edge, edgePosition));
+		*out_contactNormal = lineNormal;
+		hit = true;
+	}
+
+	return hit;
+}
+
+// Returns true if the shape already overlaps the triangle, with the closest points of the two in out_shapePoint (on the segment) and out_trianglePoint
+static bool ShapeOverlapsTriangle(SweepShape* shape, vec3 a, vec3 b, vec3 c, vec3 faceNormal, vec3* out_shapePoint, vec3* out_trianglePoint)
+{
+	f32 radiusSquared = shape->radius * shape->radius;
+	*out_shapePoint = shape->segmentStart;
+	*out_trianglePoint = ClosestPointOnTriangle(shape->segmentStart, a, b, c);
+	f32 closestDistanceSquared = vec3_distance_squared(*out_shapePoint, *out_trianglePoint);
+	if (!shape->capsule)
+		return closestDistanceSquared <= radiusSquared;
+
+	vec3 trianglePoint = ClosestPointOnTriangle(shape->segmentEnd, a, b, c);
+	f32 distanceSquared = vec3_distance_squared(shape->segmentEnd, trianglePoint);
+	if (distanceSquared < closestDistanceSquared)
+	{
+		closestDistanceSquared = distanceSquared;
+		*out_shapePoint = shape->segmentEnd;
+		*out_trianglePoint = trianglePoint;
+	}
+
+	vec3 vertices[3] = { a, b, c };
+	for (u32 i = 0; i < 3; i++)
+	{
+		vec3 segmentPoint;
+		vec3 edgePoint;
+		distanceSquared = ClosestPointsOnSegments(shape->segmentStart, shape->segmentEnd, vertices[i], vertices[i == 2 ? 0 : i + 1], &segmentPoint, &edgePoint);
+		if (distanceSquared < closestDistanceSquared)
+		{
+			closestDistanceSquared = distanceSquared;
+			*out_shapePoint = segmentPoint;
+			*out_trianglePoint = edgePoint;
+		}
+	}
+
+	// A segment that goes through the inside of the triangle isn't close to any of the above
+	f32 startDistance = vec3_dot(vec3_sub_vec3(shape->segmentStart, a), faceNormal);
+	f32 endDistance = vec3_dot(vec3_sub_vec3(shape->segmentEnd, a), faceNormal);
+	if ((startDistance < 0) != (endDistance < 0))
+	{
+		vec3 crossing = vec3_lerp(shape->segmentStart, shape->segmentEnd, startDistance / (startDistance - endDistance));
+		if (vec3_distance_squared(crossing, ClosestPointOnTriangle(crossing, a, b, c)) <= SWEEP_MIN_SQUARED_LENGTH)
+		{
+			*out_shapePoint = crossing;
+			*out_trianglePoint = crossing;
+			return true;
+		}
+	}
+
+	return closestDistanceSquared <= radiusSquared;
+}
+
+// Slab test of the ray through the center of the shape against the node grown by the half extent of the shape, returns the distance at which the shape
+// might start touching the node or FLT_MAX if it can't touch the node before maxDistance
+static inline f32 GetSweepNodeEnterDistance(BvhNode* node, BvhRay* ray, f32* halfExtent, f32 maxDistance)
+{
+	f32 enter = 0;
+	f32 exit = maxDistance;
+	for (u32 axis = 0; axis < 3; axis++)
+	{
+		f32 t0 = (node->min[axis] - halfExtent[axis] - ray->origin[axis]) * ray->inverseDirection[axis];
+		f32 t1 = (node->max[axis] + halfExtent[axis] - ray->origin[axis]) * ray->inverseDirection[axis];
+		enter = t0 < t1 ? (t0 > enter ? t0 : enter) : (t1 > enter ? t1 : enter);
+		exit = t0 < t1 ? (t1 < exit ? t1 : exit) : (t0 < exit ? t0 : exit);
+	}
+	return enter <= exit ? enter : FLT_MAX;
+}
+
+static void SweepLeaf(SweepShape* shape, MeshBvh* bvh, BvhNode* leaf, f32* closestDistance, SweepHit* hit)
+{
+	for (u32 slot = leaf->first; slot < leaf->first + leaf->triangleCount; slot++)
+	{
+		BvhTriangleGroup* group = &bvh->triangleGroups[slot / BVH_TRIANGLE_GROUP_SIZE];
+		u32 lane = slot % BVH_TRIANGLE_GROUP_SIZE;
+
+		// Most triangles of a leaf are outside of the bounds of the sweep up to the closest hit so far, the exact tests below are much more expensive
+		bool outsideBounds = false;
+		for (u32 axis = 0; axis < 3 && !outsideBounds; axis++)
+		{
+			f32 start = ((f32*)&shape->segmentStart)[axis];
+			f32 end = ((f32*)&shape->segmentEnd)[axis];
+			f32 movement = ((f32*)&shape->direction)[axis] * *closestDistance;
+			f32 sweepMin = (start < end ? start : end) + (movement < 0 ? movement : 0) - shape->radius;
+			f32 sweepMax = (start > end ? start : end) + (movement > 0 ? movement : 0) + shape->radius;
+
+			f32 v0 = group->v0[axis][lane];
+			f32 v1 = v0 + group->edge1[axis][lane];
+			f32 v2 = v0 + group->edge2[axis][lane];
+			f32 triangleMin = v0 < v1 ? (v0 < v2 ? v0 : v2) : (v1 < v2 ? v1 : v2);
+			f32 triangleMax = v0 > v1 ? (v0 > v2 ? v0 : v2) : (v1 > v2 ? v1 : v2);
+			outsideBounds = triangleMin > sweepMax || triangleMax < sweepMin;
+		}
+		if (outsideBounds)
+			continue;
+
+		vec3 a = vec3_create(group->v0[0][lane], group->v0[1][lane], group->v0[2][lane]);
+		vec3 edge1 = vec3_create(group->edge1[0][lane], group->edge1[1][lane], group->edge1[2][lane]);
+		vec3 edge2 = vec3_create(group->edge2[0][lane], group->edge2[1][lane], group->edge2[2][lane]);
+
+		// Degenerate triangles are skipped, the triangles around them cover the surface
+		vec3 faceNormal = vec3_cross_vec3(edge1, edge2);
+		f32 faceNormalLengthSquared = vec3_dot(faceNormal, faceNormal);
+		if (faceNormalLengthSquared <= SWEEP_MIN_SQUARED_LENGTH)
+			continue;
+		faceNormal = vec3_div_float(faceNormal, sqrtf(faceNormalLengthSquared));
+
+		// A shape that stays further than its radius from the plane of the triangle on one side during the whole sweep can't touch it
+		f32 startDistance = vec3_dot(vec3_sub_vec3(shape->segmentStart, a), faceNormal);
+		f32 endDistance = vec3_dot(vec3_sub_vec3(shape->segmentEnd, a), faceNormal);
+		f32 movement = vec3_dot(shape->direction, faceNormal) * *closestDistance;
+		f32 minDistance = (startDistance < endDistance ? startDistance : endDistance) + (movement < 0 ? movement : 0);
+		f32 maxDistance = (startDistance > endDistance ? startDistance : endDistance) + (movement > 0 ? movement : 0);
+		if (minDistance > shape->radius || maxDistance < -shape->radius)
+			continue;
+
+		vec3 b = vec3_add_vec3(a, edge1);
+		vec3 c = vec3_add_vec3(a, edge2);
+
+		// Shapes that already touch the triangle only collide with it if they move further into it, so they are free to move out of it again
+		vec3 shapePoint;
+		vec3 trianglePoint;
+		if (ShapeOverlapsTriangle(shape, a, b, c, faceNormal, &shapePoint, &trianglePoint))
+		{
+			vec3 normal = vec3_sub_vec3(shapePoint, trianglePoint);
+			f32 normalLengthSquared = vec3_dot(normal, normal);
+			if (normalLengthSquared > SWEEP_MIN_SQUARED_LENGTH)
+				normal = vec3_div_float(normal, sqrtf(normalLengthSquared));
+			else
+				normal = vec3_dot(faceNormal, shape->direction) > 0 ? vec3_invert_sign(faceNormal) : faceNormal;
+
+			if (vec3_dot(normal, shape->direction) < 0 && *closestDistance > 0)
+			{
+				*closestDistance = 0;
+				hit->contactPoint = trianglePoint;
+				hit->contactNormal = normal;
+				hit->triangleFirstIndex = bvh->triangles[slot] * 3;
+			}
+			continue;
+		}
+
+		bool triangleHit = shape->capsule ?
+			SweepCapsuleTriangle(shape, a, b, c, faceNormal, closestDistance, &hit->contactPoint, &hit->contactNormal) :
+			SweepSphereTriangle(shape->segmentStart, shape->radius, shape->direction, a, b, c, faceNormal, closestDistance, &hit->contactPoint, &hit->contactNormal);
+		if (triangleHit)
+			hit->triangleFirstIndex = bvh->triangles[slot] * 3;
+	}
+}
+
+// Same traversal as RaycastMeshBvh with the ray through the center of the shape and nodes grown by the extent of the shape
+static SweepHit SweepMeshBvh(SweepShape* shape, MeshBvh* bvh, f32 maxDistance)
+{
+	SweepHit hit = {};
+	hit.hit = false;
+	hit.hitDistance = -1;
+	hit.triangleFirstIndex = UINT32_MAX;
+
+	if (bvh->nodeCount == 0)
+		return hit;
+
+	shape->direction = vec3_normalize(shape->direction);
+	vec3 center = vec3_lerp(shape->segmentStart, shape->segmentEnd, 0.5f);
+	BvhRay ray = CreateBvhRay(center, shape->direction);
+	f32 halfExtent[3];
+	for (u32 axis = 0; axis < 3; axis++)
+		halfExtent[axis] = fabsf(((f32*)&shape->segmentEnd)[axis] - ((f32*)&shape->segmentStart)[axis]) * 0.5f + shape->radius;
+
+	f32 closestDistance = maxDistance;
+	BvhTraversalEntry stack[BVH_MAX_DEPTH + 1];
+	u32 stackSize = 0;
+	if (GetSweepNodeEnterDistance(&bvh->nodes[0], &ray, halfExtent, closestDistance) != FLT_MAX)
+		stack[stackSize++] = (BvhTraversalEntry){ 0, 0 };
+
+	while (stackSize > 0)
+	{
+		BvhTraversalEntry entry = stack[--stackSize];
+		if (entry.enterDistance > closestDistance)
+			continue;
+
+		BvhNode* node = &bvh->nodes[entry.node];
+		while (node->triangleCount == 0)
+		{
+			BvhNode* firstChild = &bvh->nodes[node->first];
+			BvhNode* secondChild = firstChild + 1;
+			f32 firstDistance = GetSweepNodeEnterDistance(firstChild, &ray, halfExtent, closestDistance);
+			f32 secondDistance = GetSweepNodeEnterDistance(secondChild, &ray, halfExtent, closestDistance);
+			if (firstDistance == FLT_MAX && secondDistance == FLT_MAX)
+			{
+				node = nullptr;
+				break;
+			}
+
+			if (firstDistance <= secondDistance)
+			{
+				if (secondDistance != FLT_MAX)
+					stack[stackSize++] = (BvhTraversalEntry){ node->first + 1, secondDistance };
+				node = firstChild;
+			}
+			else
+			{
+				if (firstDistance != FLT_MAX)
+					stack[stackSize++] = (BvhTraversalEntry){ node->first, firstDistance };
+				node = secondChild;
+			}
+		}
+		if (node)
+			SweepLeaf(shape, bvh, node, &closestDistance, &hit);
+	}
+
+	if (hit.triangleFirstIndex != UINT32_MAX)
+	{
+		hit.hit = true;
+		hit.hitDistance = closestDistance;
+	}
+
+	return hit;
+}
+
+SweepHit SweepSphereMeshBvh(vec3 center, f32 radius, vec3 direction, f32 maxDistance, MeshBvh bvh)
+{
+	SweepShape shape = {};
+	shape.segmentStart = center;
+	shape.segmentEnd = center;
+	shape.direction = direction;
+	shape.radius = radius;
+	shape.capsule = false;
+	return SweepMeshBvh(&shape, &bvh, maxDistance);
+}
+
+SweepHit SweepCapsuleMeshBvh(vec3 segmentStart, vec3 segmentEnd, f32 radius, vec3 direction, f32 maxDistance, MeshBvh bvh)
+{
+	SweepShape shape = {};
+	shape.segmentStart = segmentStart;
+	shape.segmentEnd = segmentEnd;
+	shape.direction = direction;
+	shape.radius = radius;
+	shape.capsule = vec3_distance_squared(segmentStart, segmentEnd) > SWEEP_MIN_SQUARED_LENGTH;
+	return SweepMeshBvh(&shape, &bvh, maxDistance);
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "defines.h"
 
+#include "core/meminc.h"
 #include "renderer/renderer.h"
 #include "math/lin_alg.h"
 
@@ -11,7 +12,73 @@ typedef struct RaycastHit
 	bool hit;
 } RaycastHit;
 
+// Result of a sphere or capsule sweep, the shape touches the surface after moving hitDistance along the normalized direction.
+// A hit distance of 0 means the shape already overlapped the surface at the start and moves further into it.
+typedef struct SweepHit
+{
+	vec3 contactPoint;
+	vec3 contactNormal;			// Unit vector from the contact point towards the shape, movement along the surface is perpendicular to it
+	f32 hitDistance;
+	u32 triangleFirstIndex;
+	bool hit;
+} SweepHit;
+
+// Amount of triangles in a triangle group of a mesh bvh, the width of the 4 wide intersection kernel (the 8 wide kernel tests two groups)
+#define BVH_TRIANGLE_GROUP_SIZE 4
+// Amount of rays in a ray packet
+#define RAY_PACKET_SIZE 8
+
+// Node of a mesh bvh, 32 bytes so two nodes share a cache line
+typedef struct BvhNode
+{
+	f32 min[3];
+	u32 first;					// Inner nodes: index of the first child node (the second child directly follows it), leaves: first entry of the leaf in MeshBvh.triangles (a multiple of the group size)
+	f32 max[3];
+	u32 triangleCount;			// 0 for inner nodes
+} BvhNode;
+
+// Triangles of a bvh leaf in structure of arrays layout, as the first vertex and the edges from it to the other two vertices (that is what the ray triangle test uses).
+// Lanes that aren't used by the leaf have a degenerate triangle that is never hit.
+typedef struct BvhTriangleGroup
+{
+	f32 v0[3][BVH_TRIANGLE_GROUP_SIZE];
+	f32 edge1[3][BVH_TRIANGLE_GROUP_SIZE];
+	f32 edge2[3][BVH_TRIANGLE_GROUP_SIZE];
+} BvhTriangleGroup;
+
+// Bounding volume hierarchy over the triangles of a mesh, in the space of the mesh positions. The nodes are a flat array with the root at index 0.
+// The bvh has its own copy of the triangles, so raycasts don't read the mesh. It has to be rebuilt if the positions or the triangle order of the mesh change.
+typedef struct MeshBvh
+{
+	BvhNode* nodes;
+	BvhTriangleGroup* triangleGroups;
+	u32* triangles;				// Triangle (first index / 3) of every lane of the triangle groups, UINT32_MAX in unused lanes
+	u32 nodeCount;
+	u32 triangleGroupCount;
+	u32 triangleCount;			// Triangles of the mesh, without the unused lanes
+} MeshBvh;
 
 
+// Tests every triangle of the mesh, meshes that are raycast more than once should use a bvh
 RaycastHit RaycastMesh(vec3 origin, vec3 direction, MeshData mesh, mat4 modelMatrix, u32 positionOffset, u32 normalOffset);
 
+// Builds the bvh with binned surface area heuristic splits, the nodes and triangles are allocated with allocator and the frame arena is used for scratch memory
+MeshBvh MeshBvhCreate(MeshData mesh, u32 positionOffset, Allocator* allocator);
+void MeshBvhDestroy(MeshBvh* bvh, Allocator* allocator);
+// Finds the closest hit in front of the origin closer than maxDistance, the ray is in the space of the mesh positions so there's no model matrix to invert.
+// Like RaycastMesh the direction is normalized and the hit distance is along the normalized direction. Doesn't use globals, so it can run in jobs.
+RaycastHit RaycastMeshBvh(vec3 origin, vec3 direction, MeshBvh bvh, f32 maxDistance);
+// Casts up to RAY_PACKET_SIZE rays through the bvh together and writes a hit for every ray to out_hits, same results as RaycastMeshBvh for every ray.
+// The packet visits every node one of its rays enters, so it's faster than single rays for coherent rays (e.g. neighbouring pixels) and slower for rays in different directions.
+// Needs avx2, otherwise the rays are cast one at a time.
+void RaycastMeshBvhPacket(vec3* origins, vec3* directions, u32 rayCount, MeshBvh bvh, f32 maxDistance, RaycastHit* out_hits);
+// Casts rayCount rays through the bvh, spread over at most maxThreadCount threads of the job system, and writes a hit for every ray to out_hits (same results as RaycastMeshBvh).
+// If coherentRays is true, groups of RAY_PACKET_SIZE consecutive rays are cast as packets. The throughput of the batch is reported through the profiler.
+void RaycastMeshBvhBatch(vec3* origins, vec3* directions, u32 rayCount, MeshBvh bvh, f32 maxDistance, bool coherentRays, RaycastHit* out_hits, u32 maxThreadCount);
+
+// Moves a sphere along the direction (normalized, must not be 0) and returns the first contact with the triangles of the bvh closer than maxDistance, in the space of the mesh positions.
+// The bvh nodes are grown by the radius, so only the leaves along the path are tested. Triangles are two sided. Shapes that already overlap a triangle only
+// hit it (at distance 0) if they move further into it, so a shape that was pushed into the surface can always move out. Doesn't use globals, so it can run in jobs.
+SweepHit SweepSphereMeshBvh(vec3 center, f32 radius, vec3 direction, f32 maxDistance, MeshBvh bvh);
+// Same as SweepSphereMeshBvh for a capsule, the points within radius of the segment from segmentStart to segmentEnd
+SweepHit SweepCapsuleMeshBvh(vec3 segmentStart, vec3 segmentEnd, f32 radius, vec3 direction, f32 maxDistance, MeshBvh bvh);
@@ -9,6 +9,7 @@
 #include "math/lin_alg.h"
 #include "player_controller.h"
 #include "raycast_demo.h"
+#include "benchmarks.h"
 
 int main()
 {
@@ -24,6 +25,7 @@ int main()
     GameRenderingInit();
 	RaycastDemoInit();
     PlayerControllerInit();
+	BenchmarksInit();
 
     // ================================================================= Game loop
     while (EngineUpdate())
@@ -32,10 +34,12 @@ int main()
 		WorldGenerationUpdate();
         PlayerControllerUpdate();
 		RaycastDemoUpdate();
+		BenchmarksUpdate();
         GameRenderingRender();
     }
 
     // ================================================================== Shutdown
+	BenchmarksShutdown();
     PlayerControllerShutdown();
 	RaycastDemoShutdown();
     GameRenderingShutdown();
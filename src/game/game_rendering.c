@@ -123,8 +123,8 @@ void GameRenderingInit()
             shaderCreateInfo.renderTargetDepth = true;
             shaderCreateInfo.renderTargetStencil = false;
             shaderCreateInfo.vertexBufferLayout.perVertexAttributeCount = 2;
-            shaderCreateInfo.vertexBufferLayout.perVertexAttributes[0] = VERTEX_ATTRIBUTE_TYPE_VEC3;
-            shaderCreateInfo.vertexBufferLayout.perVertexAttributes[1] = VERTEX_ATTRIBUTE_TYPE_VEC3;
+            shaderCreateInfo.vertexBufferLayout.perVertexAttributes[0] = VERTEX_ATTRIBUTE_TYPE_UNORM16_VEC4; // VertexPacked position
+            shaderCreateInfo.vertexBufferLayout.perVertexAttributes[1] = VERTEX_ATTRIBUTE_TYPE_SNORM16_VEC2; // VertexPacked normal
             shaderCreateInfo.vertexBufferLayout.perInstanceAttributeCount = 0;
 			shaderCreateInfo.rasterizerMode = RASTERIZER_MODE_TRIANGLES_FILLED;
 
@@ -139,8 +139,8 @@ void GameRenderingInit()
             shaderCreateInfo.renderTargetDepth = true;
             shaderCreateInfo.renderTargetStencil = false;
             shaderCreateInfo.vertexBufferLayout.perVertexAttributeCount = 2;
-            shaderCreateInfo.vertexBufferLayout.perVertexAttributes[0] = VERTEX_ATTRIBUTE_TYPE_VEC3;
-            shaderCreateInfo.vertexBufferLayout.perVertexAttributes[1] = VERTEX_ATTRIBUTE_TYPE_VEC3;
+            shaderCreateInfo.vertexBufferLayout.perVertexAttributes[0] = VERTEX_ATTRIBUTE_TYPE_UNORM16_VEC4; // VertexPacked position
+            shaderCreateInfo.vertexBufferLayout.perVertexAttributes[1] = VERTEX_ATTRIBUTE_TYPE_SNORM16_VEC2; // VertexPacked normal
             shaderCreateInfo.vertexBufferLayout.perInstanceAttributeCount = 0;
 			shaderCreateInfo.rasterizerMode = RASTERIZER_MODE_TRIANGLES_FILLED;
 
@@ -0,0 +1,124 @@
+#include "bricked_density_map.h"
+
+#include "core/asserts.h"
+
+
+static BrickedDensityMap InitBrickedDensityMap(u32 mapWidth, u32 mapHeight, u32 mapDepth)
+{
+	BrickedDensityMap densityMap = {};
+	densityMap.mapWidth = mapWidth;
+	densityMap.mapHeight = mapHeight;
+	densityMap.mapDepth = mapDepth;
+	densityMap.tileCountX = (mapWidth + DENSITY_TILE_SIZE - 1) / DENSITY_TILE_SIZE;
+	densityMap.tileCountY = (mapHeight + DENSITY_TILE_SIZE - 1) / DENSITY_TILE_SIZE;
+	densityMap.tileCountZ = (mapDepth + DENSITY_TILE_SIZE - 1) / DENSITY_TILE_SIZE;
+	return densityMap;
+}
+
+BrickedDensityMap BrickedDensityMapCreate(Allocator* allocator, u32 mapWidth, u32 mapHeight, u32 mapDepth)
+{
+	BrickedDensityMap densityMap = InitBrickedDensityMap(mapWidth, mapHeight, mapDepth);
+	densityMap.values = AlignedAlloc(allocator, sizeof(*densityMap.values) * BrickedDensityMapGetValueCount(&densityMap), CACHE_ALIGN);
+	return densityMap;
+}
+
+BrickedDensityMap BrickedDensityMapCreateInArena(Arena* arena, u32 mapWidth, u32 mapHeight, u32 mapDepth)
+{
+	BrickedDensityMap densityMap = InitBrickedDensityMap(mapWidth, mapHeight, mapDepth);
+	densityMap.values = ArenaAlignedAlloc(arena, sizeof(*densityMap.values) * BrickedDensityMapGetValueCount(&densityMap), CACHE_ALIGN);
+	return densityMap;
+}
+
+void BrickedDensityMapDestroy(Allocator* allocator, BrickedDensityMap* densityMap)
+{
+	Free(allocator, densityMap->values);
+	densityMap->values = nullptr;
+}
+
+void BrickedDensityMapDecodeRow(BrickedDensityMap* densityMap, u32 x, u32 y, u32 zStart, u32 count, f32* out_values)
+{
+	u32 zEnd = zStart + count;
+	u32 z = zStart;
+
+	// The values of a row within one tile share the x and y part of their index, only the z part changes
+	f32* firstTileRow = densityMap->values + BrickedDensityMapGetOffsetX(densityMap, x) + BrickedDensityMapGetOffsetY(densityMap, y);
+	while (z < zEnd)
+	{
+		u32 tileStart = z & ~(DENSITY_TILE_SIZE - 1);
+		f32* tileRow = firstTileRow + (u64)(z >> DENSITY_TILE_SHIFT) * DENSITY_TILE_VALUE_COUNT;
+		f32* out = out_values + tileStart - zStart;
+
+		// Whole rows of a tile with constant offsets, which unrolls into plain loads and stores
+		if (z == tileStart && z + DENSITY_TILE_SIZE <= zEnd)
+		{
+			for (u32 i = 0; i < DENSITY_TILE_SIZE; i++)
+				out[i] = tileRow[densityTileMortonSpread[i]];
+			z += DENSITY_TILE_SIZE;
+			continue;
+		}
+
+		u32 tileEnd = tileStart + DENSITY_TILE_SIZE < zEnd ? tileStart + DENSITY_TILE_SIZE : zEnd;
+		for (; z < tileEnd; z++)
+			out[z - tileStart] = tileRow[densityTileMortonSpread[z - tileStart]];
+	}
+}
+
+void BrickedDensityMapEncodeRow(BrickedDensityMap* densityMap, u32 x, u32 y, u32 zStart, u32 count, f32* values)
+{
+	u32 zEnd = zStart + count;
+	u32 z = zStart;
+
+	f32* firstTileRow = densityMap->values + BrickedDensityMapGetOffsetX(densityMap, x) + BrickedDensityMapGetOffsetY(densityMap, y);
+	while (z < zEnd)
+	{
+		u32 tileStart = z & ~(DENSITY_TILE_SIZE - 1);
+		f32* tileRow = firstTileRow + (u64)(z >> DENSITY_TILE_SHIFT) * DENSITY_TILE_VALUE_COUNT;
+		f32* in = values + tileStart - zStart;
+
+		if (z == tileStart && z + DENSITY_TILE_SIZE <= zEnd)
+		{
+			for (u32 i = 0; i < DENSITY_TILE_SIZE; i++)
+				tileRow[densityTileMortonSpread[i]] = in[i];
+			z += DENSITY_TILE_SIZE;
+			continue;
+		}
+
+		u32 tileEnd = tileStart + DENSITY_TILE_SIZE < zEnd ? tileStart + DENSITY_TILE_SIZE : zEnd;
+		for (; z < tileEnd; z++)
+			tileRow[densityTileMortonSpread[z - tileStart]] = in[z - tileStart];
+	}
+}
+
+void BrickedDensityMapEncodeBox(BrickedDensityMap* densityMap, DensityMapBox* box, f32* values)
+{
+	DensityMapBox wholeMap = { 0, 0, 0, densityMap->mapWidth, densityMap->mapHeight, densityMap->mapDepth };
+	box = box ? box : &wholeMap;
+	GRASSERT_DEBUG(box->endX <= densityMap->mapWidth && box->endY <= densityMap->mapHeight && box->endZ <= densityMap->mapDepth);
+
+	u32 boxDepth = box->endZ - box->startZ;
+	for (u32 x = box->startX; x < box->endX; x++)
+	{
+		for (u32 y = box->startY; y < box->endY; y++)
+		{
+			f32* row = values + ((u64)(x - box->startX) * (box->endY - box->startY) + y - box->startY) * boxDepth;
+			BrickedDensityMapEncodeRow(densityMap, x, y, box->startZ, boxDepth, row);
+		}
+	}
+}
+
+void BrickedDensityMapDecodeBox(BrickedDensityMap* densityMap, DensityMapBox* box, f32* out_values)
+{
+	DensityMapBox wholeMap = { 0, 0, 0, densityMap->mapWidth, densityMap->mapHeight, densityMap->mapDepth };
+	box = box ? box : &wholeMap;
+	GRASSERT_DEBUG(box->endX <= densityMap->mapWidth && box->endY <= densityMap->mapHeight && box->endZ <= densityMap->mapDepth);
+
+	u32 boxDepth = box->endZ - box->startZ;
+	for (u32 x = box->startX; x < box->endX; x++)
+	{
+		for (u32 y = box->startY; y < box->endY; y++)
+		{
+			f32* row = out_values + ((u64)(x - box->startX) * (box->endY - box->startY) + y - box->startY) * boxDepth;
+			BrickedDensityMapDecodeRow(densityMap, x, y, box->startZ, boxDepth, row);
+		}
+	}
+}
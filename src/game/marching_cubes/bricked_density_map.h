@@ -0,0 +1,82 @@
+#pragma once
+#include "defines.h"
+#include "core/meminc.h"
+#include "density_evaluation.h"
+
+// Amount of density values along every side of a tile, tiles are the unit of the bricked layout
+#define DENSITY_TILE_SIZE 8
+#define DENSITY_TILE_SHIFT 3
+#define DENSITY_TILE_VALUE_COUNT (DENSITY_TILE_SIZE * DENSITY_TILE_SIZE * DENSITY_TILE_SIZE)
+
+// Coordinate within a tile (3 bits) with two zero bits inserted between its bits, or-ing the spread x, y and z coordinates gives the morton code
+static const u16 densityTileMortonSpread[DENSITY_TILE_SIZE] = { 0x000, 0x001, 0x008, 0x009, 0x040, 0x041, 0x048, 0x049 };
+
+// Density map stored as tiles of DENSITY_TILE_SIZE^3 values instead of the flat x * H * D + y * D + z layout.
+// Tiles are stored in x, y, z order like the values of the flat layout, the values within a tile are stored in morton order (z in the lowest bit).
+// Every 2x2x2 block of values that starts at even coordinates is 32 contiguous bytes, so a neighbourhood of values touches a few cache lines of one or two tiles
+// instead of a cache line in every row and slice it covers. Tiles on the far sides of the map can stick out of it, the values outside of the map are unused.
+typedef struct BrickedDensityMap
+{
+	f32* values;
+	u32 tileCountX;
+	u32 tileCountY;
+	u32 tileCountZ;
+	u32 mapWidth;
+	u32 mapHeight;
+	u32 mapDepth;
+} BrickedDensityMap;
+
+// The values of the map are undefined until they are written
+BrickedDensityMap BrickedDensityMapCreate(Allocator* allocator, u32 mapWidth, u32 mapHeight, u32 mapDepth);
+// Same as BrickedDensityMapCreate but the values are allocated in the arena, free them with an arena marker instead of calling BrickedDensityMapDestroy
+BrickedDensityMap BrickedDensityMapCreateInArena(Arena* arena, u32 mapWidth, u32 mapHeight, u32 mapDepth);
+void BrickedDensityMapDestroy(Allocator* allocator, BrickedDensityMap* densityMap);
+
+// Amount of values stored including the parts of the tiles that stick out of the map
+static inline u64 BrickedDensityMapGetValueCount(BrickedDensityMap* densityMap)
+{
+	return (u64)densityMap->tileCountX * densityMap->tileCountY * densityMap->tileCountZ * DENSITY_TILE_VALUE_COUNT;
+}
+
+// The index of a value is the sum of an offset for each of its coordinates, neighbouring values can be indexed by combining the offsets of their coordinates
+static inline u64 BrickedDensityMapGetOffsetX(BrickedDensityMap* densityMap, u32 x)
+{
+	return (u64)(x >> DENSITY_TILE_SHIFT) * densityMap->tileCountY * densityMap->tileCountZ * DENSITY_TILE_VALUE_COUNT + (densityTileMortonSpread[x & (DENSITY_TILE_SIZE - 1)] << 2);
+}
+
+static inline u64 BrickedDensityMapGetOffsetY(BrickedDensityMap* densityMap, u32 y)
+{
+	return (u64)(y >> DENSITY_TILE_SHIFT) * densityMap->tileCountZ * DENSITY_TILE_VALUE_COUNT + (densityTileMortonSpread[y & (DENSITY_TILE_SIZE - 1)] << 1);
+}
+
+static inline u64 BrickedDensityMapGetOffsetZ(BrickedDensityMap* densityMap, u32 z)
+{
+	return (u64)(z >> DENSITY_TILE_SHIFT) * DENSITY_TILE_VALUE_COUNT + densityTileMortonSpread[z & (DENSITY_TILE_SIZE - 1)];
+}
+
+static inline u64 BrickedDensityMapGetIndex(BrickedDensityMap* densityMap, u32 x, u32 y, u32 z)
+{
+	return BrickedDensityMapGetOffsetX(densityMap, x) + BrickedDensityMapGetOffsetY(densityMap, y) + BrickedDensityMapGetOffsetZ(densityMap, z);
+}
+
+static inline f32 BrickedDensityMapGetValue(BrickedDensityMap* densityMap, u32 x, u32 y, u32 z)
+{
+	return densityMap->values[BrickedDensityMapGetIndex(densityMap, x, y, z)];
+}
+
+static inline void BrickedDensityMapSetValue(BrickedDensityMap* densityMap, u32 x, u32 y, u32 z, f32 value)
+{
+	densityMap->values[BrickedDensityMapGetIndex(densityMap, x, y, z)] = value;
+}
+
+// Copies the values of the box (the whole map if box is nullptr) from values, which holds them densely packed in the flat density map layout.
+// With a nullptr box this converts a flat density map to the bricked layout.
+void BrickedDensityMapEncodeBox(BrickedDensityMap* densityMap, DensityMapBox* box, f32* values);
+// Copies the values of the box (the whole map if box is nullptr) into out_values, densely packed in the flat density map layout.
+// With a nullptr box this converts the bricked density map to a flat density map.
+void BrickedDensityMapDecodeBox(BrickedDensityMap* densityMap, DensityMapBox* box, f32* out_values);
+
+// Copies count values starting at the given value (along z) into out_values
+void BrickedDensityMapDecodeRow(BrickedDensityMap* densityMap, u32 x, u32 y, u32 zStart, u32 count, f32* out_values);
+// Copies count values into the map starting at the given value (along z)
+void BrickedDensityMapEncodeRow(BrickedDensityMap* densityMap, u32 x, u32 y, u32 zStart, u32 count, f32* values);
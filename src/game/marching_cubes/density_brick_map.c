@@ -0,0 +1,319 @@
+#include "density_brick_map.h"
+
+#include "core/asserts.h"
+#include "core/engine.h"
+#include "quantized_density_map.h"
+
+
+DensityBrickMap DensityBrickMapCreate(Allocator* allocator, u32 mapWidth, u32 mapHeight, u32 mapDepth)
+{
+	GRASSERT_DEBUG(mapWidth > 1 && mapHeight > 1 && mapDepth > 1);
+
+	DensityBrickMap brickMap = {};
+	brickMap.mapWidth = mapWidth;
+	brickMap.mapHeight = mapHeight;
+	brickMap.mapDepth = mapDepth;
+
+	// A density map of size n has n - 1 cubes along that axis
+	brickMap.brickCountX = (mapWidth - 1 + DENSITY_BRICK_SIZE - 1) / DENSITY_BRICK_SIZE;
+	brickMap.brickCountY = (mapHeight - 1 + DENSITY_BRICK_SIZE - 1) / DENSITY_BRICK_SIZE;
+	brickMap.brickCountZ = (mapDepth - 1 + DENSITY_BRICK_SIZE - 1) / DENSITY_BRICK_SIZE;
+
+	u32 brickCount = brickMap.brickCountX * brickMap.brickCountY * brickMap.brickCountZ;
+	brickMap.minValues = Alloc(allocator, sizeof(*brickMap.minValues) * brickCount);
+	brickMap.maxValues = Alloc(allocator, sizeof(*brickMap.maxValues) * brickCount);
+
+	return brickMap;
+}
+
+void DensityBrickMapDestroy(Allocator* allocator, DensityBrickMap* brickMap)
+{
+	Free(allocator, brickMap->minValues);
+	Free(allocator, brickMap->maxValues);
+	brickMap->minValues = nullptr;
+	brickMap->maxValues = nullptr;
+}
+
+void DensityBrickMapUpdate(DensityBrickMap* brickMap, f32* densityMap)
+{
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	u32 mapHeightTimesDepth = brickMap->mapHeight * brickMap->mapDepth;
+	u32 brickCount = brickMap->brickCountX * brickMap->brickCountY * brickMap->brickCountZ;
+
+	for (u32 i = 0; i < brickCount; i++)
+	{
+		brickMap->minValues[i] = 1000000000000000;
+		brickMap->maxValues[i] = -1000000000000000;
+	}
+
+	// Min/max of the bricks along one row of density values
+	f32* rowMinValues = ArenaAlloc(global->frameArena, sizeof(*rowMinValues) * brickMap->brickCountZ);
+	f32* rowMaxValues = ArenaAlloc(global->frameArena, sizeof(*rowMaxValues) * brickMap->brickCountZ);
+
+	// Every density value is read once per row, the min/max of the row is then added to every brick that contains the row.
+	// Values on the side of a brick also belong to the previous brick, so a row is part of up to four bricks.
+	for (u32 x = 0; x < brickMap->mapWidth; x++)
+	{
+		for (u32 y = 0; y < brickMap->mapHeight; y++)
+		{
+			f32* row = densityMap + x * mapHeightTimesDepth + y * brickMap->mapDepth;
+
+			for (u32 brickZ = 0; brickZ < brickMap->brickCountZ; brickZ++)
+			{
+				u32 zStart = brickZ * DENSITY_BRICK_SIZE;
+				u32 zEnd = zStart + DENSITY_BRICK_SIZE + 1;
+				if (zEnd > brickMap->mapDepth)
+					zEnd = brickMap->mapDepth;
+
+				f32 minValue = row[zStart];
+				f32 maxValue = row[zStart];
+				for (u32 z = zStart + 1; z < zEnd; z++)
+				{
+					minValue = row[z] < minValue ? row[z] : minValue;
+					maxValue = row[z] > maxValue ? row[z] : maxValue;
+				}
+				rowMinValues[brickZ] = minValue;
+				rowMaxValues[brickZ] = maxValue;
+			}
+
+			for (u32 brickX = (x > 0 && x % DENSITY_BRICK_SIZE == 0) ? x / DENSITY_BRICK_SIZE - 1 : x / DENSITY_BRICK_SIZE; brickX <= x / DENSITY_BRICK_SIZE && brickX < brickMap->brickCountX; brickX++)
+			{
+				for (u32 brickY = (y > 0 && y % DENSITY_BRICK_SIZE == 0) ? y / DENSITY_BRICK_SIZE - 1 : y / DENSITY_BRICK_SIZE; brickY <= y / DENSITY_BRICK_SIZE && brickY < brickMap->brickCountY; brickY++)
+				{
+					u32 firstBrickIndex = DensityBrickMapGetBrickIndex(brickMap, brickX, brickY, 0);
+					f32* brickMinValues = brickMap->minValues + firstBrickIndex;
+					f32* brickMaxValues = brickMap->maxValues + firstBrickIndex;
+					for (u32 brickZ = 0; brickZ < brickMap->brickCountZ; brickZ++)
+					{
+						brickMinValues[brickZ] = rowMinValues[brickZ] < brickMinValues[brickZ] ? rowMinValues[brickZ] : brickMinValues[brickZ];
+						brickMaxValues[brickZ] = rowMaxValues[brickZ] > brickMaxValues[brickZ] ? rowMaxValues[brickZ] : brickMaxValues[brickZ];
+					}
+				}
+			}
+		}
+	}
+
+	ArenaFreeMarker(global->frameArena, marker);
+}
+
+// Range of bricks that contain any of the density values from start up to and including end
+static inline void GetBrickRangeOfValues(DensityBrickMap* brickMap, u32* start, u32* end, u32* out_firstBrick, u32* out_lastBrick)
+{
+	GRASSERT_DEBUG(start[0] <= end[0] && start[1] <= end[1] && start[2] <= end[2]);
+	GRASSERT_DEBUG(end[0] < brickMap->mapWidth && end[1] < brickMap->mapHeight && end[2] < brickMap->mapDepth);
+
+	u32 brickCounts[3] = { brickMap->brickCountX, brickMap->brickCountY, brickMap->brickCountZ };
+	for (u32 axis = 0; axis < 3; axis++)
+	{
+		// Values on the side of a brick also belong to the previous brick, so the first brick is the one that ends on the start value
+		out_firstBrick[axis] = start[axis] > 0 ? (start[axis] - 1) / DENSITY_BRICK_SIZE : 0;
+		out_lastBrick[axis] = end[axis] / DENSITY_BRICK_SIZE;
+		if (out_lastBrick[axis] >= brickCounts[axis])
+			out_lastBrick[axis] = brickCounts[axis] - 1;
+	}
+}
+
+// Recalculates the min/max values of the bricks firstBrick up to and including lastBrick. The density map can be a box of the map the brick map was made for,
+// origin is the position of the first value of the box in that map and the box needs to contain all values of the bricks.
+static void UpdateBrickRange(DensityBrickMap* brickMap, f32* densityMap, u32 densityMapHeight, u32 densityMapDepth, u32* origin, u32* firstBrick, u32* lastBrick)
+{
+	u32 mapHeightTimesDepth = densityMapHeight * densityMapDepth;
+
+	for (u32 brickX = firstBrick[0]; brickX <= lastBrick[0]; brickX++)
+	{
+		for (u32 brickY = firstBrick[1]; brickY <= lastBrick[1]; brickY++)
+		{
+			for (u32 brickZ = firstBrick[2]; brickZ <= lastBrick[2]; brickZ++)
+			{
+				// Range of density values of the brick, including the values on its far sides
+				u32 xEnd = brickX * DENSITY_BRICK_SIZE + DENSITY_BRICK_SIZE + 1;
+				u32 yEnd = brickY * DENSITY_BRICK_SIZE + DENSITY_BRICK_SIZE + 1;
+				u32 zEnd = brickZ * DENSITY_BRICK_SIZE + DENSITY_BRICK_SIZE + 1;
+				xEnd = xEnd > brickMap->mapWidth ? brickMap->mapWidth : xEnd;
+				yEnd = yEnd > brickMap->mapHeight ? brickMap->mapHeight : yEnd;
+				zEnd = zEnd > brickMap->mapDepth ? brickMap->mapDepth : zEnd;
+
+				f32 minValue = 1000000000000000;
+				f32 maxValue = -1000000000000000;
+				for (u32 x = brickX * DENSITY_BRICK_SIZE; x < xEnd; x++)
+				{
+					for (u32 y = brickY * DENSITY_BRICK_SIZE; y < yEnd; y++)
+					{
+						f32* row = densityMap + (x - origin[0]) * mapHeightTimesDepth + (y - origin[1]) * densityMapDepth;
+						for (u32 z = brickZ * DENSITY_BRICK_SIZE - origin[2]; z < zEnd - origin[2]; z++)
+						{
+							minValue = row[z] < minValue ? row[z] : minValue;
+							maxValue = row[z] > maxValue ? row[z] : maxValue;
+						}
+					}
+				}
+
+				u32 brickIndex = DensityBrickMapGetBrickIndex(brickMap, brickX, brickY, brickZ);
+				brickMap->minValues[brickIndex] = minValue;
+				brickMap->maxValues[brickIndex] = maxValue;
+			}
+		}
+	}
+}
+
+void DensityBrickMapUpdateRegion(DensityBrickMap* brickMap, f32* densityMap, u32 startX, u32 startY, u32 startZ, u32 endX, u32 endY, u32 endZ)
+{
+	u32 start[3] = { startX, startY, startZ };
+	u32 end[3] = { endX, endY, endZ };
+	u32 origin[3] = { 0, 0, 0 };
+	u32 firstBrick[3];
+	u32 lastBrick[3];
+	GetBrickRangeOfValues(brickMap, start, end, firstBrick, lastBrick);
+
+	UpdateBrickRange(brickMap, densityMap, brickMap->mapHeight, brickMap->mapDepth, origin, firstBrick, lastBrick);
+}
+
+void DensityBrickMapUpdateRegionQuantized(DensityBrickMap* brickMap, QuantizedDensityMap* densityMap, u32 startX, u32 startY, u32 startZ, u32 endX, u32 endY, u32 endZ)
+{
+	u32 start[3] = { startX, startY, startZ };
+	u32 end[3] = { endX, endY, endZ };
+	u32 firstBrick[3];
+	u32 lastBrick[3];
+	GetBrickRangeOfValues(brickMap, start, end, firstBrick, lastBrick);
+
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	// Dequantizing every value of the bricks, including the values on the far sides of the last bricks
+	DensityMapBox box = {};
+	box.startX = firstBrick[0] * DENSITY_BRICK_SIZE;
+	box.startY = firstBrick[1] * DENSITY_BRICK_SIZE;
+	box.startZ = firstBrick[2] * DENSITY_BRICK_SIZE;
+	box.endX = (lastBrick[0] + 1) * DENSITY_BRICK_SIZE + 1;
+	box.endY = (lastBrick[1] + 1) * DENSITY_BRICK_SIZE + 1;
+	box.endZ = (lastBrick[2] + 1) * DENSITY_BRICK_SIZE + 1;
+	box.endX = box.endX > brickMap->mapWidth ? brickMap->mapWidth : box.endX;
+	box.endY = box.endY > brickMap->mapHeight ? brickMap->mapHeight : box.endY;
+	box.endZ = box.endZ > brickMap->mapDepth ? brickMap->mapDepth : box.endZ;
+	f32* boxValues = ArenaAlloc(global->frameArena, sizeof(*boxValues) * (box.endX - box.startX) * (box.endY - box.startY) * (box.endZ - box.startZ));
+	QuantizedDensityMapDecodeBox(densityMap, &box, boxValues);
+
+	u32 origin[3] = { box.startX, box.startY, box.startZ };
+	UpdateBrickRange(brickMap, boxValues, box.endY - box.startY, box.endZ - box.startZ, origin, firstBrick, lastBrick);
+
+	ArenaFreeMarker(global->frameArena, marker);
+}
+
+void DensityBrickMapGetUniformNeighbourhoods(DensityBrickMap* brickMap, bool* out_uniformBricks)
+{
+	for (i32 brickX = 0; brickX < brickMap->brickCountX; brickX++)
+	{
+		for (i32 brickY = 0; brickY < brickMap->brickCountY; brickY++)
+		{
+			for (i32 brickZ = 0; brickZ < brickMap->brickCountZ; brickZ++)
+			{
+				u32 brickIndex = DensityBrickMapGetBrickIndex(brickMap, brickX, brickY, brickZ);
+				f32 uniformValue = brickMap->minValues[brickIndex];
+				bool uniform = brickMap->maxValues[brickIndex] == uniformValue;
+
+				// Checking the neighbouring bricks that exist
+				for (i32 neighbourX = brickX - 1; uniform && neighbourX <= brickX + 1; neighbourX++)
+				{
+					for (i32 neighbourY = brickY - 1; uniform && neighbourY <= brickY + 1; neighbourY++)
+					{
+						for (i32 neighbourZ = brickZ - 1; uniform && neighbourZ <= brickZ + 1; neighbourZ++)
+						{
+							if (neighbourX < 0 || neighbourY < 0 || neighbourZ < 0 || neighbourX >= brickMap->brickCountX || neighbourY >= brickMap->brickCountY || neighbourZ >= brickMap->brickCountZ)
+								continue;
+
+							u32 neighbourIndex = DensityBrickMapGetBrickIndex(brickMap, neighbourX, neighbourY, neighbourZ);
+							uniform = brickMap->minValues[neighbourIndex] == uniformValue && brickMap->maxValues[neighbourIndex] == uniformValue;
+						}
+					}
+				}
+
+				out_uniformBricks[brickIndex] = uniform;
+			}
+		}
+	}
+}
+
+bool DensityBrickMapRayMayHitSurface(DensityBrickMap* brickMap, vec3 origin, vec3 direction)
+{
+	f32 rayOrigin[3] = { origin.x, origin.y, origin.z };
+	f32 rayDirection[3] = { direction.x, direction.y, direction.z };
+	f32 mapBounds[3] = { brickMap->mapWidth - 1, brickMap->mapHeight - 1, brickMap->mapDepth - 1 };
+	i32 brickCounts[3] = { brickMap->brickCountX, brickMap->brickCountY, brickMap->brickCountZ };
+
+	// Clipping the ray to the bounds of the density map
+	f32 tEnter = 0;
+	f32 tExit = 1000000000000000;
+	for (u32 axis = 0; axis < 3; axis++)
+	{
+		if (fabsf(rayDirection[axis]) < 0.0000001f)
+		{
+			if (rayOrigin[axis] < 0 || rayOrigin[axis] > mapBounds[axis])
+				return false;
+			continue;
+		}
+
+		f32 t0 = (0 - rayOrigin[axis]) / rayDirection[axis];
+		f32 t1 = (mapBounds[axis] - rayOrigin[axis]) / rayDirection[axis];
+		if (t0 > t1)
+		{
+			f32 temp = t0;
+			t0 = t1;
+			t1 = temp;
+		}
+		tEnter = t0 > tEnter ? t0 : tEnter;
+		tExit = t1 < tExit ? t1 : tExit;
+	}
+
+	if (tEnter > tExit)
+		return false;
+
+	// Walking through the bricks that the ray passes with a 3D DDA (Amanatides & Woo)
+	i32 brick[3];
+	i32 step[3];
+	f32 tMax[3];
+	f32 tDelta[3];
+	for (u32 axis = 0; axis < 3; axis++)
+	{
+		f32 entryPosition = rayOrigin[axis] + rayDirection[axis] * tEnter;
+		brick[axis] = (i32)(entryPosition / DENSITY_BRICK_SIZE);
+		if (brick[axis] < 0)
+			brick[axis] = 0;
+		if (brick[axis] >= brickCounts[axis])
+			brick[axis] = brickCounts[axis] - 1;
+
+		if (rayDirection[axis] > 0.0000001f)
+		{
+			step[axis] = 1;
+			tMax[axis] = ((brick[axis] + 1) * DENSITY_BRICK_SIZE - rayOrigin[axis]) / rayDirection[axis];
+			tDelta[axis] = DENSITY_BRICK_SIZE / rayDirection[axis];
+		}
+		else if (rayDirection[axis] < -0.0000001f)
+		{
+			step[axis] = -1;
+			tMax[axis] = (brick[axis] * DENSITY_BRICK_SIZE - rayOrigin[axis]) / rayDirection[axis];
+			tDelta[axis] = -DENSITY_BRICK_SIZE / rayDirection[axis];
+		}
+		else
+		{
+			step[axis] = 0;
+			tMax[axis] = 1000000000000000;
+			tDelta[axis] = 1000000000000000;
+		}
+	}
+
+	while (true)
+	{
+		if (DensityBrickMapBrickHasSurface(brickMap, DensityBrickMapGetBrickIndex(brickMap, brick[0], brick[1], brick[2])))
+			return true;
+
+		// Stepping to the next brick along the axis with the closest brick boundary
+		u32 axis = tMax[0] < tMax[1] ? (tMax[0] < tMax[2] ? 0 : 2) : (tMax[1] < tMax[2] ? 1 : 2);
+		if (tMax[axis] > tExit)
+			return false;
+
+		brick[axis] += step[axis];
+		if (brick[axis] < 0 || brick[axis] >= brickCounts[axis])
+			return false;
+		tMax[axis] += tDelta[axis];
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "defines.h"
+#include "core/meminc.h"
+#include "math/lin_alg.h"
+
+typedef struct QuantizedDensityMap QuantizedDensityMap;
+
+// Amount of cubes along every side of a brick
+#define DENSITY_BRICK_SIZE 8
+
+// Min/max values of bricks of DENSITY_BRICK_SIZE^3 cubes of a density map.
+// A brick includes the density values on its far sides (which it shares with the next brick), so the range of a brick covers all corners of its cubes.
+// If the range of a brick doesn't contain the 0 isosurface, none of its cubes produce triangles.
+typedef struct DensityBrickMap
+{
+	f32* minValues;
+	f32* maxValues;
+	u32 brickCountX;
+	u32 brickCountY;
+	u32 brickCountZ;
+	u32 mapWidth;
+	u32 mapHeight;
+	u32 mapDepth;
+} DensityBrickMap;
+
+// The min/max values of the brick map are undefined until DensityBrickMapUpdate is called
+DensityBrickMap DensityBrickMapCreate(Allocator* allocator, u32 mapWidth, u32 mapHeight, u32 mapDepth);
+void DensityBrickMapDestroy(Allocator* allocator, DensityBrickMap* brickMap);
+
+// Recalculates the min/max values of all bricks from the density map, the density map needs to be the size the brick map was created with
+void DensityBrickMapUpdate(DensityBrickMap* brickMap, f32* densityMap);
+
+// Only recalculates the min/max values of the bricks that contain any of the density values from start up to and including end, used after editing part of the density map
+void DensityBrickMapUpdateRegion(DensityBrickMap* brickMap, f32* densityMap, u32 startX, u32 startY, u32 startZ, u32 endX, u32 endY, u32 endZ);
+// Same as DensityBrickMapUpdateRegion for a quantized density map, the values of the bricks are dequantized into the frame arena first
+void DensityBrickMapUpdateRegionQuantized(DensityBrickMap* brickMap, QuantizedDensityMap* densityMap, u32 startX, u32 startY, u32 startZ, u32 endX, u32 endY, u32 endZ);
+
+// Sets out_uniformBricks[brickIndex] to true if the brick and all of its neighbouring bricks only contain one and the same value.
+// Filters with a radius of up to DENSITY_BRICK_SIZE leave the values in those bricks unchanged. out_uniformBricks needs room for every brick.
+void DensityBrickMapGetUniformNeighbourhoods(DensityBrickMap* brickMap, bool* out_uniformBricks);
+
+// Returns true if the ray (in density map space) goes through a brick that contains the isosurface, false means the ray can't hit the surface
+bool DensityBrickMapRayMayHitSurface(DensityBrickMap* brickMap, vec3 origin, vec3 direction);
+
+static inline u32 DensityBrickMapGetBrickIndex(DensityBrickMap* brickMap, u32 brickX, u32 brickY, u32 brickZ)
+{
+	return brickX * brickMap->brickCountY * brickMap->brickCountZ + brickY * brickMap->brickCountZ + brickZ;
+}
+
+// Returns true if the range of the brick contains the 0 isosurface, meaning some of its cubes might produce triangles.
+// Cube corners with a value below 0 are inside of the contour, so a cube is only active if it has a corner below 0 and a corner at or above 0.
+static inline bool DensityBrickMapBrickHasSurface(DensityBrickMap* brickMap, u32 brickIndex)
+{
+	return brickMap->minValues[brickIndex] < 0 && brickMap->maxValues[brickIndex] >= 0;
+}
@@ -0,0 +1,179 @@
+#include "density_evaluation.h"
+
+#include "core/asserts.h"
+#include "core/engine.h"
+#include "core/job_system.h"
+#include "bricked_density_map.h"
+
+// Slabs per thread, more slabs than threads evens out the work when some slabs contain more of the (expensive) inside of the terrain than others
+#define SLABS_PER_THREAD 4
+
+typedef struct DensityEvaluationJobData
+{
+	f32* densityMap;				// nullptr if the values are written to the bricked density map
+	BrickedDensityMap* brickedDensityMap;
+	u32 mapHeight;
+	u32 mapDepth;
+	DensityMapBox box;
+	u32 slabWidth;					// Amount of x slices in every slab (the last slab can be smaller)
+	PFN_DensityFunction densityFunction;
+	void* userData;
+	DensityBrickMap* brickMap;
+	bool* bandBricks;				// nullptr if every value is evaluated
+} DensityEvaluationJobData;
+
+// Evaluates the values zStart up to zEnd of a row in batches, row is nullptr if the values go to the bricked density map
+static inline void EvaluateRowRange(DensityEvaluationJobData* jobData, f32* row, u32 x, u32 y, u32 zStart, u32 zEnd)
+{
+	DensityBatch batch;
+	_Alignas(32) f32 values[DENSITY_BATCH_SIZE];
+
+	for (u32 lane = 0; lane < DENSITY_BATCH_SIZE; lane++)
+	{
+		batch.x[lane] = x;
+		batch.y[lane] = y;
+	}
+
+	for (u32 z = zStart; z < zEnd; z += DENSITY_BATCH_SIZE)
+	{
+		batch.count = zEnd - z < DENSITY_BATCH_SIZE ? zEnd - z : DENSITY_BATCH_SIZE;
+		for (u32 lane = 0; lane < DENSITY_BATCH_SIZE; lane++)
+			batch.z[lane] = lane < batch.count ? z + lane : z + batch.count - 1;
+
+		jobData->densityFunction(jobData->userData, &batch, values);
+
+		if (row == nullptr)
+		{
+			BrickedDensityMapEncodeRow(jobData->brickedDensityMap, x, y, z, batch.count, values);
+			continue;
+		}
+		for (u32 lane = 0; lane < batch.count; lane++)
+			row[z + lane] = values[lane];
+	}
+}
+
+static void DensityEvaluationSlabJob(void* data, u32 slabIndex)
+{
+	DensityEvaluationJobData* jobData = data;
+	u32 mapHeightTimesDepth = jobData->mapHeight * jobData->mapDepth;
+
+	u32 xStart = jobData->box.startX + slabIndex * jobData->slabWidth;
+	u32 xEnd = xStart + jobData->slabWidth;
+	if (xEnd > jobData->box.endX)
+		xEnd = jobData->box.endX;
+
+	for (u32 x = xStart; x < xEnd; x++)
+	{
+		for (u32 y = jobData->box.startY; y < jobData->box.endY; y++)
+		{
+			f32* row = jobData->densityMap ? jobData->densityMap + x * mapHeightTimesDepth + y * jobData->mapDepth : nullptr;
+
+			if (jobData->bandBricks == nullptr)
+			{
+				EvaluateRowRange(jobData, row, x, y, jobData->box.startZ, jobData->box.endZ);
+				continue;
+			}
+
+			// Only evaluating the runs of values in bricks of the narrow band, values on the far side of the last brick along an axis belong to that brick
+			DensityBrickMap* brickMap = jobData->brickMap;
+			u32 brickX = x / DENSITY_BRICK_SIZE < brickMap->brickCountX ? x / DENSITY_BRICK_SIZE : brickMap->brickCountX - 1;
+			u32 brickY = y / DENSITY_BRICK_SIZE < brickMap->brickCountY ? y / DENSITY_BRICK_SIZE : brickMap->brickCountY - 1;
+			u32 firstBrickIndex = DensityBrickMapGetBrickIndex(brickMap, brickX, brickY, 0);
+
+			u32 z = jobData->box.startZ;
+			while (z < jobData->box.endZ)
+			{
+				u32 brickZ = z / DENSITY_BRICK_SIZE < brickMap->brickCountZ ? z / DENSITY_BRICK_SIZE : brickMap->brickCountZ - 1;
+				bool inBand = jobData->bandBricks[firstBrickIndex + brickZ];
+
+				// End of the run of values in the same brick
+				u32 runEnd = brickZ + 1 == brickMap->brickCountZ ? jobData->box.endZ : (brickZ + 1) * DENSITY_BRICK_SIZE;
+				runEnd = runEnd > jobData->box.endZ ? jobData->box.endZ : runEnd;
+
+				if (inBand)
+					EvaluateRowRange(jobData, row, x, y, z, runEnd);
+				z = runEnd;
+			}
+		}
+	}
+}
+
+// Writes to the flat density map if it isn't nullptr, otherwise to the bricked density map
+static void EvaluateDensityMap(f32* densityMap, BrickedDensityMap* brickedDensityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth, DensityMapBox* box, PFN_DensityFunction densityFunction, void* userData, DensityBrickMap* narrowBandBrickMap, u32 maxThreadCount)
+{
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	DensityEvaluationJobData jobData = {};
+	jobData.densityMap = densityMap;
+	jobData.brickedDensityMap = brickedDensityMap;
+	jobData.mapHeight = mapHeight;
+	jobData.mapDepth = mapDepth;
+	jobData.densityFunction = densityFunction;
+	jobData.userData = userData;
+	if (box)
+		jobData.box = *box;
+	else
+		jobData.box = (DensityMapBox){ 0, 0, 0, mapWidth, mapHeight, mapDepth };
+
+	GRASSERT_DEBUG(jobData.box.endX <= mapWidth && jobData.box.endY <= mapHeight && jobData.box.endZ <= mapDepth);
+	if (jobData.box.startX >= jobData.box.endX || jobData.box.startY >= jobData.box.endY || jobData.box.startZ >= jobData.box.endZ)
+		return;
+
+	// The narrow band is every brick that contains the surface plus its neighbouring bricks
+	if (narrowBandBrickMap)
+	{
+		GRASSERT_DEBUG(narrowBandBrickMap->mapWidth == mapWidth && narrowBandBrickMap->mapHeight == mapHeight && narrowBandBrickMap->mapDepth == mapDepth);
+		jobData.brickMap = narrowBandBrickMap;
+		u32 brickCount = narrowBandBrickMap->brickCountX * narrowBandBrickMap->brickCountY * narrowBandBrickMap->brickCountZ;
+		jobData.bandBricks = ArenaAlloc(global->frameArena, sizeof(*jobData.bandBricks) * brickCount);
+		MemoryZero(jobData.bandBricks, sizeof(*jobData.bandBricks) * brickCount);
+
+		for (i32 brickX = 0; brickX < narrowBandBrickMap->brickCountX; brickX++)
+		{
+			for (i32 brickY = 0; brickY < narrowBandBrickMap->brickCountY; brickY++)
+			{
+				for (i32 brickZ = 0; brickZ < narrowBandBrickMap->brickCountZ; brickZ++)
+				{
+					if (!DensityBrickMapBrickHasSurface(narrowBandBrickMap, DensityBrickMapGetBrickIndex(narrowBandBrickMap, brickX, brickY, brickZ)))
+						continue;
+
+					for (i32 neighbourX = brickX - 1; neighbourX <= brickX + 1; neighbourX++)
+						for (i32 neighbourY = brickY - 1; neighbourY <= brickY + 1; neighbourY++)
+							for (i32 neighbourZ = brickZ - 1; neighbourZ <= brickZ + 1; neighbourZ++)
+							{
+								if (neighbourX < 0 || neighbourY < 0 || neighbourZ < 0 || neighbourX >= narrowBandBrickMap->brickCountX || neighbourY >= narrowBandBrickMap->brickCountY || neighbourZ >= narrowBandBrickMap->brickCountZ)
+									continue;
+								jobData.bandBricks[DensityBrickMapGetBrickIndex(narrowBandBrickMap, neighbourX, neighbourY, neighbourZ)] = true;
+							}
+				}
+			}
+		}
+	}
+
+	u32 boxWidth = jobData.box.endX - jobData.box.startX;
+	u32 slabCount = maxThreadCount * SLABS_PER_THREAD;
+	if (slabCount > boxWidth)
+		slabCount = boxWidth;
+	if (slabCount == 0)
+		slabCount = 1;
+	jobData.slabWidth = (boxWidth + slabCount - 1) / slabCount;
+	// Rounding the slabs up to whole layers of tiles, so threads don't share the cache lines of a tile
+	if (brickedDensityMap)
+		jobData.slabWidth = (jobData.slabWidth + DENSITY_TILE_SIZE - 1) & ~(DENSITY_TILE_SIZE - 1);
+	slabCount = (boxWidth + jobData.slabWidth - 1) / jobData.slabWidth;
+
+	JobSystemParallelFor(DensityEvaluationSlabJob, &jobData, slabCount, maxThreadCount);
+
+	// "Freeing" the narrow band
+	ArenaFreeMarker(global->frameArena, marker);
+}
+
+void DensityMapEvaluate(f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth, DensityMapBox* box, PFN_DensityFunction densityFunction, void* userData, DensityBrickMap* narrowBandBrickMap, u32 maxThreadCount)
+{
+	EvaluateDensityMap(densityMap, nullptr, mapWidth, mapHeight, mapDepth, box, densityFunction, userData, narrowBandBrickMap, maxThreadCount);
+}
+
+void DensityMapEvaluateBricked(BrickedDensityMap* densityMap, DensityMapBox* box, PFN_DensityFunction densityFunction, void* userData, DensityBrickMap* narrowBandBrickMap, u32 maxThreadCount)
+{
+	EvaluateDensityMap(nullptr, densityMap, densityMap->mapWidth, densityMap->mapHeight, densityMap->mapDepth, box, densityFunction, userData, narrowBandBrickMap, maxThreadCount);
+}
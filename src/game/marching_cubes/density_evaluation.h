@@ -0,0 +1,41 @@
+#pragma once
+#include "defines.h"
+#include "density_brick_map.h"
+
+typedef struct BrickedDensityMap BrickedDensityMap;
+
+// Amount of density values that a density function evaluates at once
+#define DENSITY_BATCH_SIZE 8
+
+// Coordinates of up to DENSITY_BATCH_SIZE density values in SoA layout, all values of a batch are in the same row (same x and y, consecutive z).
+// Lanes from count up to DENSITY_BATCH_SIZE repeat the last coordinate, so density functions can always process the full batch.
+typedef struct DensityBatch
+{
+	_Alignas(32) f32 x[DENSITY_BATCH_SIZE];
+	_Alignas(32) f32 y[DENSITY_BATCH_SIZE];
+	_Alignas(32) f32 z[DENSITY_BATCH_SIZE];
+	u32 count;
+} DensityBatch;
+
+// Writes the density of every lane of the batch to out_values (DENSITY_BATCH_SIZE values, 32 byte aligned).
+// Gets called from the worker threads of the job system, so it can't allocate or change state that other batches use.
+typedef void (*PFN_DensityFunction)(void* userData, DensityBatch* batch, f32* out_values);
+
+// Range [start, end) of density values along every axis of a density map
+typedef struct DensityMapBox
+{
+	u32 startX;
+	u32 startY;
+	u32 startZ;
+	u32 endX;
+	u32 endY;
+	u32 endZ;
+} DensityMapBox;
+
+// Evaluates densityFunction for every density value in the box (the whole map if box is nullptr) and writes the results to the density map.
+// The box is split into slabs along x that are evaluated on at most maxThreadCount threads.
+// If narrowBandBrickMap is given (it needs to be up to date with the density map), only the values in bricks that contain the surface and in their neighbouring bricks
+// are evaluated, the other values keep their previous value. This is only correct if the new density function doesn't move the surface by more than a brick.
+void DensityMapEvaluate(f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth, DensityMapBox* box, PFN_DensityFunction densityFunction, void* userData, DensityBrickMap* narrowBandBrickMap, u32 maxThreadCount);
+// Same as DensityMapEvaluate for a density map in the bricked layout (see bricked_density_map.h), the result is exactly the same
+void DensityMapEvaluateBricked(BrickedDensityMap* densityMap, DensityMapBox* box, PFN_DensityFunction densityFunction, void* userData, DensityBrickMap* narrowBandBrickMap, u32 maxThreadCount);
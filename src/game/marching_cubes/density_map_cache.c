@@ -0,0 +1,136 @@
+#include "density_map_cache.h"
+
+#include "core/engine.h"
+#include <stdio.h>
+#include <string.h>
+
+// More files than this in the cache directory are left alone by the eviction
+#define DENSITY_MAP_CACHE_MAX_LISTED_FILES 256
+
+
+static void GetCacheFilePath(const char* directory, u32 resolution, u32 seed, u64 settingsHash, char* out_path, u32 pathSize)
+{
+	// Mixing the seed and resolution into the settings hash (splitmix64 finalizer) so the name covers everything in the header
+	u64 nameHash = settingsHash ^ (((u64)seed << 32) | resolution);
+	nameHash = (nameHash ^ (nameHash >> 30)) * 0xbf58476d1ce4e5b9ull;
+	nameHash = (nameHash ^ (nameHash >> 27)) * 0x94d049bb133111ebull;
+	nameHash = nameHash ^ (nameHash >> 31);
+	snprintf(out_path, pathSize, "%s/%016llx%s", directory, (unsigned long long)nameHash, DENSITY_MAP_CACHE_FILE_EXTENSION);
+}
+
+static inline u64 GetDensityMapSize(u32 resolution)
+{
+	return sizeof(f32) * (u64)resolution * resolution * resolution;
+}
+
+bool DensityMapCacheLoad(const char* directory, u32 resolution, u32 seed, u64 settingsHash, DensityMapCacheFile* out_file)
+{
+	char path[PLATFORM_MAX_FILE_NAME_LENGTH];
+	GetCacheFilePath(directory, resolution, seed, settingsHash, path, sizeof(path));
+
+	PlatformMappedFile mappedFile;
+	if (!PlatformMapFile(path, &mappedFile))
+		return false;
+
+	// Files with a different header (hash collision, old version) or that were cut short while writing are ignored, storing the density map again overwrites them
+	DensityMapCacheHeader* header = mappedFile.data;
+	bool valid = mappedFile.size == sizeof(*header) + GetDensityMapSize(resolution) &&
+		header->magic == DENSITY_MAP_CACHE_MAGIC &&
+		header->version == DENSITY_MAP_CACHE_VERSION &&
+		header->resolution == resolution &&
+		header->seed == seed &&
+		header->settingsHash == settingsHash &&
+		header->layout == DENSITY_MAP_CACHE_LAYOUT_FLAT_F32 &&
+		header->valueSize == sizeof(f32);
+	if (!valid)
+	{
+		PlatformUnmapFile(&mappedFile);
+		return false;
+	}
+
+	// Marking the file as recently used for the eviction
+	PlatformTouchFile(path);
+
+	out_file->mappedFile = mappedFile;
+	out_file->densityMap = (f32*)(header + 1);
+	return true;
+}
+
+void DensityMapCacheUnload(DensityMapCacheFile* file)
+{
+	PlatformUnmapFile(&file->mappedFile);
+	file->densityMap = nullptr;
+}
+
+// Deletes the least recently used files other than keepFileName until the files in the directory fit in the size budget
+static void EvictDensityMapCacheFiles(const char* directory, const char* keepFileName, u64 sizeBudget)
+{
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	PlatformFileInfo* files = ArenaAlloc(global->frameArena, sizeof(*files) * DENSITY_MAP_CACHE_MAX_LISTED_FILES);
+	u32 fileCount = PlatformListFiles(directory, DENSITY_MAP_CACHE_FILE_EXTENSION, files, DENSITY_MAP_CACHE_MAX_LISTED_FILES);
+	fileCount = fileCount < DENSITY_MAP_CACHE_MAX_LISTED_FILES ? fileCount : DENSITY_MAP_CACHE_MAX_LISTED_FILES;
+
+	u64 totalSize = 0;
+	for (u32 i = 0; i < fileCount; i++)
+		totalSize += files[i].size;
+
+	while (totalSize > sizeBudget)
+	{
+		u32 oldestFile = UINT32_MAX;
+		for (u32 i = 0; i < fileCount; i++)
+		{
+			if (strcmp(files[i].name, keepFileName) == 0)
+				continue;
+			if (oldestFile == UINT32_MAX || files[i].lastWriteTime < files[oldestFile].lastWriteTime)
+				oldestFile = i;
+		}
+		if (oldestFile == UINT32_MAX)
+			break;
+
+		// Files that can't be deleted (e.g. because they are mapped) are skipped
+		char path[PLATFORM_MAX_FILE_NAME_LENGTH];
+		snprintf(path, sizeof(path), "%s/%s", directory, files[oldestFile].name);
+		if (PlatformDeleteFile(path))
+			totalSize -= files[oldestFile].size;
+		files[oldestFile] = files[fileCount - 1];
+		fileCount--;
+	}
+
+	ArenaFreeMarker(global->frameArena, marker);
+}
+
+bool DensityMapCacheStore(const char* directory, u32 resolution, u32 seed, u64 settingsHash, f32* densityMap, u64 sizeBudget)
+{
+	if (!PlatformCreateDirectory(directory))
+		return false;
+
+	char path[PLATFORM_MAX_FILE_NAME_LENGTH];
+	GetCacheFilePath(directory, resolution, seed, settingsHash, path, sizeof(path));
+
+	FILE* file = fopen(path, "wb");
+	if (file == NULL)
+		return false;
+
+	DensityMapCacheHeader header = {};
+	header.magic = DENSITY_MAP_CACHE_MAGIC;
+	header.version = DENSITY_MAP_CACHE_VERSION;
+	header.resolution = resolution;
+	header.seed = seed;
+	header.settingsHash = settingsHash;
+	header.layout = DENSITY_MAP_CACHE_LAYOUT_FLAT_F32;
+	header.valueSize = sizeof(f32);
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(densityMap, GetDensityMapSize(resolution), 1, file) == 1;
+	written = fclose(file) == 0 && written;
+
+	// A partially written file fails the size check when loading, but it would still count towards the budget
+	if (!written)
+	{
+		PlatformDeleteFile(path);
+		return false;
+	}
+
+	EvictDensityMapCacheFiles(directory, path + strlen(directory) + 1, sizeBudget);
+	return true;
+}
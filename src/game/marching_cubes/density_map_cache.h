@@ -0,0 +1,44 @@
+#pragma once
+#include "defines.h"
+#include "core/platform.h"
+
+#define DENSITY_MAP_CACHE_MAGIC 0x434d4447	// "GDMC" in a little endian file
+#define DENSITY_MAP_CACHE_VERSION 1
+#define DENSITY_MAP_CACHE_FILE_EXTENSION ".dmc"
+
+typedef enum DensityMapCacheLayout
+{
+	DENSITY_MAP_CACHE_LAYOUT_FLAT_F32,			// f32 values in the x * H * D + y * D + z layout
+} DensityMapCacheLayout;
+
+// Start of a density map cache file, the values of the density map directly follow it.
+// The header is padded to a cache line so the values of a mapped file are cache line aligned.
+typedef struct DensityMapCacheHeader
+{
+	u32 magic;
+	u32 version;
+	u32 resolution;								// Cubic density maps only
+	u32 seed;
+	u64 settingsHash;							// Hash of everything else that went into the density map
+	u32 layout;									// DensityMapCacheLayout
+	u32 valueSize;
+	u8 padding[32];
+} DensityMapCacheHeader;
+
+// A cache file that is mapped into memory, densityMap points into the mapping and is read only
+typedef struct DensityMapCacheFile
+{
+	PlatformMappedFile mappedFile;
+	f32* densityMap;
+} DensityMapCacheFile;
+
+// Cache files are named after a hash of the seed, settings hash and resolution, so every density map has one file in the directory.
+// Loading a file marks it as used, when storing a file makes the directory larger than its size budget the least recently used files are deleted.
+// None of the functions log or use an allocator other than the frame arena, so they can be used on threads with their own globals.
+
+// Maps the cache file for the density map into memory, returns false if there is no file or its header doesn't match
+bool DensityMapCacheLoad(const char* directory, u32 resolution, u32 seed, u64 settingsHash, DensityMapCacheFile* out_file);
+void DensityMapCacheUnload(DensityMapCacheFile* file);
+// Writes the density map to the cache and deletes the least recently used files until the directory fits in sizeBudget bytes again
+// (never the file that was just written). Returns false if the file couldn't be written.
+bool DensityMapCacheStore(const char* directory, u32 resolution, u32 seed, u64 settingsHash, f32* densityMap, u64 sizeBudget);
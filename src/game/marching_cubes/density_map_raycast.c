@@ -0,0 +1,407 @@
+#include "density_map_raycast.h"
+
+#include "density_brick_map.h"
+#include "quantized_density_map.h"
+#include <float.h>
+#include <math.h>
+
+// Direction components smaller than this are treated as 0, the ray never crosses a cube boundary along that axis
+#define DENSITY_RAYCAST_MIN_DIRECTION_COMPONENT 0.0000001f
+// Regula falsi iterations that refine a zero crossing after it has been bracketed, the cubic is monotonic between the brackets so this converges quickly
+#define DENSITY_RAYCAST_REFINE_ITERATIONS 4
+
+// Reads the values of a f32 or quantized density map, only one of values and quantizedMap is set
+typedef struct DensityMapSampler
+{
+	f32* values;
+	QuantizedDensityMap* quantizedMap;
+	u32 mapWidth;
+	u32 mapHeight;
+	u32 mapDepth;
+} DensityMapSampler;
+
+typedef struct DensityRay
+{
+	f32 origin[3];
+	f32 direction[3];
+	i32 step[3];
+	i32 previousSide;			// Side of the surface where the ray left the last cube it passed (-1 inside, 1 outside), 0 before the first cube
+} DensityRay;
+
+// Writes the 8 corners of the cube with its origin at x, y, z to out_corners, corner index is x * 4 + y * 2 + z (relative to the cube origin)
+static inline void GetCubeCorners(DensityMapSampler* sampler, u32 x, u32 y, u32 z, f32* out_corners)
+{
+	if (sampler->values)
+	{
+		u64 sliceSize = (u64)sampler->mapHeight * sampler->mapDepth;
+		f32* base = sampler->values + x * sliceSize + (u64)y * sampler->mapDepth + z;
+		out_corners[0] = base[0];
+		out_corners[1] = base[1];
+		out_corners[2] = base[sampler->mapDepth];
+		out_corners[3] = base[sampler->mapDepth + 1];
+		out_corners[4] = base[sliceSize];
+		out_corners[5] = base[sliceSize + 1];
+		out_corners[6] = base[sliceSize + sampler->mapDepth];
+		out_corners[7] = base[sliceSize + sampler->mapDepth + 1];
+	}
+	else
+	{
+		for (u32 corner = 0; corner < 8; corner++)
+			out_corners[corner] = QuantizedDensityMapGetValue(sampler->quantizedMap, x + (corner >> 2), y + ((corner >> 1) & 1), z + (corner & 1));
+	}
+}
+
+static inline f32 EvaluateCubic(f32 a, f32 b, f32 c, f32 d, f32 s)
+{
+	return ((a * s + b) * s + c) * s + d;
+}
+
+static inline i32 GetSurfaceSide(f32 value)
+{
+	return value < 0 ? -1 : 1;
+}
+
+// The interpolation is continuous across the faces of cubes, but rounding can put a crossing that lies on a face outside of both cubes.
+// Returns true (the ray crosses the surface where it enters) if the ray enters on the other side than it left the previous cube, and remembers the side it leaves on.
+static inline bool RayChangedSide(DensityRay* ray, i32 enterSide, i32 exitSide)
+{
+	bool changedSide = ray->previousSide != 0 && enterSide != ray->previousSide;
+	ray->previousSide = exitSide;
+	return changedSide;
+}
+
+// Finds the first zero crossing of the trilinear interpolation of the cube corners along the ray between tStart and tEnd (Marmitt et al., fast and accurate ray voxel intersection).
+// Along the ray the interpolation is a cubic, splitting it at its extrema leaves monotonic pieces that can only cross 0 once, the first piece whose ends have a different sign has the hit.
+static bool IntersectCube(f32* corners, DensityRay* ray, i32* cube, f32 tStart, f32 tEnd, f32* out_t)
+{
+	// The interpolation written as k0 + k1 x + k2 y + k3 z + k4 xy + k5 xz + k6 yz + k7 xyz with x, y, z relative to the cube origin
+	f32 k0 = corners[0];
+	f32 k1 = corners[4] - corners[0];
+	f32 k2 = corners[2] - corners[0];
+	f32 k3 = corners[1] - corners[0];
+	f32 k4 = corners[6] - corners[2] - corners[4] + corners[0];
+	f32 k5 = corners[5] - corners[1] - corners[4] + corners[0];
+	f32 k6 = corners[3] - corners[1] - corners[2] + corners[0];
+	f32 k7 = corners[7] - corners[3] - corners[5] - corners[6] + corners[4] + corners[1] + corners[2] - corners[0];
+
+	// Parameterizing from the point where the ray enters the cube keeps the numbers small for rays that start far away
+	f32 ox = ray->origin[0] + ray->direction[0] * tStart - cube[0];
+	f32 oy = ray->origin[1] + ray->direction[1] * tStart - cube[1];
+	f32 oz = ray->origin[2] + ray->direction[2] * tStart - cube[2];
+	f32 dx = ray->direction[0];
+	f32 dy = ray->direction[1];
+	f32 dz = ray->direction[2];
+
+	f32 a = k7 * dx * dy * dz;
+	f32 b = k4 * dx * dy + k5 * dx * dz + k6 * dy * dz + k7 * (ox * dy * dz + dx * oy * dz + dx * dy * oz);
+	f32 c = k1 * dx + k2 * dy + k3 * dz + k4 * (ox * dy + dx * oy) + k5 * (ox * dz + dx * oz) + k6 * (oy * dz + dy * oz) + k7 * (ox * oy * dz + ox * dy * oz + dx * oy * oz);
+	f32 d = k0 + k1 * ox + k2 * oy + k3 * oz + k4 * ox * oy + k5 * ox * oz + k6 * oy * oz + k7 * ox * oy * oz;
+
+	// Extrema are the roots of the derivative 3a s^2 + 2b s + c, only the ones inside of the segment split it
+	f32 length = tEnd - tStart;
+	f32 splits[3];
+	u32 splitCount = 0;
+	f32 quadraticA = 3 * a;
+	f32 quadraticB = 2 * b;
+	if (quadraticA == 0)
+	{
+		if (quadraticB != 0)
+			splits[splitCount++] = -c / quadraticB;
+	}
+	else
+	{
+		f32 discriminant = quadraticB * quadraticB - 4 * quadraticA * c;
+		if (discriminant >= 0)
+		{
+			// Numerically stable form of the quadratic formula
+			f32 q = -0.5f * (quadraticB + (quadraticB < 0 ? -sqrtf(discriminant) : sqrtf(discriminant)));
+			splits[splitCount++] = q / quadraticA;
+			if (q != 0)
+				splits[splitCount++] = c / q;
+		}
+	}
+
+	u32 insideCount = 0;
+	for (u32 i = 0; i < splitCount; i++)
+	{
+		if (splits[i] > 0 && splits[i] < length)
+			splits[insideCount++] = splits[i];
+	}
+	if (insideCount == 2 && splits[0] > splits[1])
+	{
+		f32 temp = splits[0];
+		splits[0] = splits[1];
+		splits[1] = temp;
+	}
+	splits[insideCount++] = length;
+
+	f32 s0 = 0;
+	f32 f0 = d;
+	if (RayChangedSide(ray, GetSurfaceSide(d), GetSurfaceSide(EvaluateCubic(a, b, c, d, length))))
+	{
+		*out_t = tStart;
+		return true;
+	}
+
+	for (u32 i = 0; i < insideCount; i++)
+	{
+		f32 s1 = splits[i];
+		f32 f1 = EvaluateCubic(a, b, c, d, s1);
+
+		// Values below 0 are inside, so the ray hits the surface where it goes from one side to the other
+		if ((f0 < 0) != (f1 < 0))
+		{
+			for (u32 iteration = 0; iteration < DENSITY_RAYCAST_REFINE_ITERATIONS; iteration++)
+			{
+				f32 s = s0 - f0 * (s1 - s0) / (f1 - f0);
+				f32 f = EvaluateCubic(a, b, c, d, s);
+				if ((f < 0) == (f0 < 0))
+				{
+					s0 = s;
+					f0 = f;
+				}
+				else
+				{
+					s1 = s;
+					f1 = f;
+				}
+			}
+			*out_t = tStart + s0 - f0 * (s1 - s0) / (f1 - f0);
+			return true;
+		}
+
+		s0 = s1;
+		f0 = f1;
+	}
+
+	return false;
+}
+
+// Walks the cubes from cubeMin up to and including cubeMax that the ray passes between tStart and tEnd with a 3D DDA (Amanatides & Woo), stops at the first hit
+static bool RaycastCubes(DensityMapSampler* sampler, DensityRay* ray, f32 tStart, f32 tEnd, i32* cubeMin, i32* cubeMax, f32* out_t)
+{
+	i32 cube[3];
+	f32 tMax[3];
+	f32 tDelta[3];
+	for (u32 axis = 0; axis < 3; axis++)
+	{
+		cube[axis] = (i32)floorf(ray->origin[axis] + ray->direction[axis] * tStart);
+		if (cube[axis] < cubeMin[axis])
+			cube[axis] = cubeMin[axis];
+		if (cube[axis] > cubeMax[axis])
+			cube[axis] = cubeMax[axis];
+
+		if (ray->step[axis] > 0)
+		{
+			tMax[axis] = (cube[axis] + 1 - ray->origin[axis]) / ray->direction[axis];
+			tDelta[axis] = 1 / ray->direction[axis];
+		}
+		else if (ray->step[axis] < 0)
+		{
+			tMax[axis] = (cube[axis] - ray->origin[axis]) / ray->direction[axis];
+			tDelta[axis] = -1 / ray->direction[axis];
+		}
+		else
+		{
+			tMax[axis] = FLT_MAX;
+			tDelta[axis] = FLT_MAX;
+		}
+	}
+
+	f32 tCubeStart = tStart;
+	while (true)
+	{
+		u32 axis = tMax[0] < tMax[1] ? (tMax[0] < tMax[2] ? 0 : 2) : (tMax[1] < tMax[2] ? 1 : 2);
+		f32 tCubeEnd = tMax[axis] < tEnd ? tMax[axis] : tEnd;
+
+		// The clamped start cube can end before tStart due to rounding, that cube is skipped
+		if (tCubeEnd > tCubeStart)
+		{
+			f32 corners[8];
+			GetCubeCorners(sampler, cube[0], cube[1], cube[2], corners);
+
+			f32 minValue = corners[0];
+			f32 maxValue = corners[0];
+			for (u32 corner = 1; corner < 8; corner++)
+			{
+				minValue = corners[corner] < minValue ? corners[corner] : minValue;
+				maxValue = corners[corner] > maxValue ? corners[corner] : maxValue;
+			}
+
+			// Same condition as for bricks, the interpolation of a cube without a corner on each side never crosses 0
+			if (minValue < 0 && maxValue >= 0)
+			{
+				if (IntersectCube(corners, ray, cube, tCubeStart, tCubeEnd, out_t))
+					return true;
+			}
+			else if (RayChangedSide(ray, GetSurfaceSide(maxValue), GetSurfaceSide(maxValue)))
+			{
+				*out_t = tCubeStart;
+				return true;
+			}
+		}
+
+		if (tMax[axis] >= tEnd)
+			return false;
+
+		cube[axis] += ray->step[axis];
+		if (cube[axis] < cubeMin[axis] || cube[axis] > cubeMax[axis])
+			return false;
+
+		tCubeStart = tMax[axis];
+		tMax[axis] += tDelta[axis];
+	}
+}
+
+static RaycastHit RaycastDensityMapSampler(DensityMapSampler* sampler, DensityBrickMap* brickMap, vec3 origin, vec3 direction, f32 maxDistance)
+{
+	RaycastHit hit = {};
+	hit.hit = false;
+	hit.hitDistance = -1;
+	hit.triangleFirstIndex = UINT32_MAX;
+
+	// Maps without cubes (e.g. a world that hasn't been generated) can't be hit
+	if (sampler->mapWidth < 2 || sampler->mapHeight < 2 || sampler->mapDepth < 2)
+		return hit;
+
+	direction = vec3_normalize(direction);
+	DensityRay ray = {};
+	f32 mapBounds[3] = { sampler->mapWidth - 1, sampler->mapHeight - 1, sampler->mapDepth - 1 };
+
+	// Clipping the ray to the bounds of the density map
+	f32 tEnter = 0;
+	f32 tExit = maxDistance;
+	for (u32 axis = 0; axis < 3; axis++)
+	{
+		ray.origin[axis] = ((f32*)&origin)[axis];
+		ray.direction[axis] = ((f32*)&direction)[axis];
+
+		if (fabsf(ray.direction[axis]) < DENSITY_RAYCAST_MIN_DIRECTION_COMPONENT)
+		{
+			ray.step[axis] = 0;
+			if (ray.origin[axis] < 0 || ray.origin[axis] > mapBounds[axis])
+				return hit;
+			continue;
+		}
+
+		ray.step[axis] = ray.direction[axis] > 0 ? 1 : -1;
+		f32 t0 = (0 - ray.origin[axis]) / ray.direction[axis];
+		f32 t1 = (mapBounds[axis] - ray.origin[axis]) / ray.direction[axis];
+		if (t0 > t1)
+		{
+			f32 temp = t0;
+			t0 = t1;
+			t1 = temp;
+		}
+		tEnter = t0 > tEnter ? t0 : tEnter;
+		tExit = t1 < tExit ? t1 : tExit;
+	}
+
+	if (tEnter > tExit)
+		return hit;
+
+	i32 lastCube[3] = { sampler->mapWidth - 2, sampler->mapHeight - 2, sampler->mapDepth - 2 };
+	f32 t;
+
+	if (!brickMap)
+	{
+		i32 firstCube[3] = { 0, 0, 0 };
+		if (RaycastCubes(sampler, &ray, tEnter, tExit, firstCube, lastCube, &t))
+		{
+			hit.hit = true;
+			hit.hitDistance = t;
+		}
+		return hit;
+	}
+
+	// Walking through the bricks that the ray passes like DensityBrickMapRayMayHitSurface, only the cubes of bricks with surface are visited
+	i32 brickCounts[3] = { brickMap->brickCountX, brickMap->brickCountY, brickMap->brickCountZ };
+	i32 brick[3];
+	f32 tMax[3];
+	f32 tDelta[3];
+	for (u32 axis = 0; axis < 3; axis++)
+	{
+		brick[axis] = (i32)((ray.origin[axis] + ray.direction[axis] * tEnter) / DENSITY_BRICK_SIZE);
+		if (brick[axis] < 0)
+			brick[axis] = 0;
+		if (brick[axis] >= brickCounts[axis])
+			brick[axis] = brickCounts[axis] - 1;
+
+		if (ray.step[axis] > 0)
+		{
+			tMax[axis] = ((brick[axis] + 1) * DENSITY_BRICK_SIZE - ray.origin[axis]) / ray.direction[axis];
+			tDelta[axis] = DENSITY_BRICK_SIZE / ray.direction[axis];
+		}
+		else if (ray.step[axis] < 0)
+		{
+			tMax[axis] = (brick[axis] * DENSITY_BRICK_SIZE - ray.origin[axis]) / ray.direction[axis];
+			tDelta[axis] = -DENSITY_BRICK_SIZE / ray.direction[axis];
+		}
+		else
+		{
+			tMax[axis] = FLT_MAX;
+			tDelta[axis] = FLT_MAX;
+		}
+	}
+
+	f32 tBrickStart = tEnter;
+	while (true)
+	{
+		u32 axis = tMax[0] < tMax[1] ? (tMax[0] < tMax[2] ? 0 : 2) : (tMax[1] < tMax[2] ? 1 : 2);
+		f32 tBrickEnd = tMax[axis] < tExit ? tMax[axis] : tExit;
+
+		u32 brickIndex = DensityBrickMapGetBrickIndex(brickMap, brick[0], brick[1], brick[2]);
+		if (DensityBrickMapBrickHasSurface(brickMap, brickIndex))
+		{
+			i32 firstCube[3];
+			i32 brickLastCube[3];
+			for (u32 i = 0; i < 3; i++)
+			{
+				firstCube[i] = brick[i] * DENSITY_BRICK_SIZE;
+				brickLastCube[i] = firstCube[i] + DENSITY_BRICK_SIZE - 1 < lastCube[i] ? firstCube[i] + DENSITY_BRICK_SIZE - 1 : lastCube[i];
+			}
+			if (RaycastCubes(sampler, &ray, tBrickStart, tBrickEnd, firstCube, brickLastCube, &t))
+			{
+				hit.hit = true;
+				hit.hitDistance = t;
+				return hit;
+			}
+		}
+		else if (tBrickEnd > tBrickStart && RayChangedSide(&ray, GetSurfaceSide(brickMap->maxValues[brickIndex]), GetSurfaceSide(brickMap->maxValues[brickIndex])))
+		{
+			hit.hit = true;
+			hit.hitDistance = tBrickStart;
+			return hit;
+		}
+
+		if (tMax[axis] >= tExit)
+			return hit;
+
+		brick[axis] += ray.step[axis];
+		if (brick[axis] < 0 || brick[axis] >= brickCounts[axis])
+			return hit;
+
+		tBrickStart = tMax[axis];
+		tMax[axis] += tDelta[axis];
+	}
+}
+
+RaycastHit DensityMapRaycast(f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth, DensityBrickMap* brickMap, vec3 origin, vec3 direction, f32 maxDistance)
+{
+	DensityMapSampler sampler = {};
+	sampler.values = densityMap;
+	sampler.mapWidth = mapWidth;
+	sampler.mapHeight = mapHeight;
+	sampler.mapDepth = mapDepth;
+	return RaycastDensityMapSampler(&sampler, brickMap, origin, direction, maxDistance);
+}
+
+RaycastHit DensityMapRaycastQuantized(QuantizedDensityMap* densityMap, DensityBrickMap* brickMap, vec3 origin, vec3 direction, f32 maxDistance)
+{
+	DensityMapSampler sampler = {};
+	sampler.quantizedMap = densityMap;
+	sampler.mapWidth = densityMap->mapWidth;
+	sampler.mapHeight = densityMap->mapHeight;
+	sampler.mapDepth = densityMap->mapDepth;
+	return RaycastDensityMapSampler(&sampler, brickMap, origin, direction, maxDistance);
+}
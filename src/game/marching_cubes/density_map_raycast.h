@@ -0,0 +1,17 @@
+#pragma once
+#include "defines.h"
+#include "math/lin_alg.h"
+#include "game/collision.h"
+
+typedef struct DensityBrickMap DensityBrickMap;
+typedef struct QuantizedDensityMap QuantizedDensityMap;
+
+// Raycasts the 0 isosurface of a density map directly, without a mesh. The ray is in density map space (value x, y, z is at position x, y, z).
+// The ray walks the cubes of the map with a 3D DDA and finds the first zero crossing of the trilinear interpolation of the corners of every cube it passes that has surface.
+// If brickMap is not nullptr, bricks without surface are skipped as a whole. The cost scales with the distance the ray travels through the map instead of the triangle count,
+// and the result only depends on the density values, so it stays valid while the mesh is rebuilt.
+// hitDistance is the distance along the normalized direction like RaycastMeshBvh, crossings further than maxDistance are ignored. triangleFirstIndex is always UINT32_MAX.
+// The trilinear surface is the one marching cubes approximates, hits are within a fraction of a cube of the marching cubes mesh.
+RaycastHit DensityMapRaycast(f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth, DensityBrickMap* brickMap, vec3 origin, vec3 direction, f32 maxDistance);
+// Same as DensityMapRaycast for a quantized density map, the corners of the cubes are dequantized as the ray passes them
+RaycastHit DensityMapRaycastQuantized(QuantizedDensityMap* densityMap, DensityBrickMap* brickMap, vec3 origin, vec3 direction, f32 maxDistance);
@@ -6,9 +6,22 @@
 #include "math/lin_alg.h"
 #include "renderer/renderer.h"
 #include "core/engine.h"
+#include "core/job_system.h"
+#include "core/platform.h"
+#include "density_brick_map.h"
+#include "quantized_density_map.h"
+#include "bricked_density_map.h"
 
 #define INITIAL_VERT_RESERVATION 1000
+// Maximum amount of vertices a single cube can produce (5 triangles)
+#define MAX_VERTS_PER_CUBE 15
+// Amount of vertices in a block of the vertex block pool used by the slab workers
+#define SLAB_VERTEX_BLOCK_CAPACITY 4096
+// Amount of slabs created per thread, more slabs than threads evens out the work because some slabs are much more expensive than others
+#define SLABS_PER_THREAD 4
 
+// Brick origin for meshing a whole density map rather than a box of it
+static u32 zeroOrigin[3] = { 0, 0, 0 };
 
 // Indexes into a densityMap
 static inline f32* GetDensityValueRef(f32* densityMap, u32 mapHeightTimesDepth, u32 mapDepth, u32 x, u32 y, u32 z)
@@ -27,134 +40,1008 @@ static inline f32 GetDensityValueRaw(f32* densityMap, u32 mapHeightTimesDepth, u
 }
 
 
-MeshData MarchingCubesGenerateMesh(f32* densityMap, u32 densityMapWidth, u32 densityMapHeight, u32 densityMapDepth)
+// Gathers the density values of the corners of the cube with its origin at x, y, z into out_cubeValues
+static inline void GetCubeValues(f32* densityMap, u32 densityMapHeightTimesDepth, u32 densityMapDepth, u32 x, u32 y, u32 z, f32* out_cubeValues)
+{
+	// Putting the values of the current cube in a small array because in the big array they are not contiguous in memory
+	out_cubeValues[0] = GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y, z);
+	out_cubeValues[1] = GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, x + 1, y, z);
+	out_cubeValues[2] = GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, x + 1, y, z + 1);
+	out_cubeValues[3] = GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y, z + 1);
+	out_cubeValues[4] = GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y + 1, z);
+	out_cubeValues[5] = GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, x + 1, y + 1, z);
+	out_cubeValues[6] = GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, x + 1, y + 1, z + 1);
+	out_cubeValues[7] = GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y + 1, z + 1);
+}
+
+// ================================== Cell classification ==================================
+// Before marching, every row of cubes (all cubes with the same x and y) is classified at once. The cube index of a cube has a bit set for every corner
+// that is inside of the contour of the density function, cubes with index 0 or 255 are fully outside or inside and don't need triangles.
+// The four rows of density values that make up the corners of a row of cubes are contiguous in memory, so the classification can be vectorized along z.
+// Only the active cubes are written to a compact list, which is what the meshers loop over.
+
+typedef struct ActiveCell
+{
+	u32 z;
+	u32 cubeIndex;
+} ActiveCell;
+
+// Classifies the cubes zStart up to zEnd of a row of cubes, the rows are the density values at (x, y), (x + 1, y), (x, y + 1) and (x + 1, y + 1).
+// Writes the active cubes to out_activeCells and returns the amount of active cubes.
+static inline u32 ClassifyCellRowScalar(f32* row00, f32* row10, f32* row01, f32* row11, u32 zStart, u32 zEnd, ActiveCell* out_activeCells)
+{
+	u32 activeCellCount = 0;
+
+	for (u32 z = zStart; z < zEnd; z++)
+	{
+		// Bit i is set if corner i is inside of the contour, the corner order matches the lookup tables
+		u32 cubeIndex = (row00[z] < 0) | (row10[z] < 0) << 1 | (row10[z + 1] < 0) << 2 | (row00[z + 1] < 0) << 3 |
+						(row01[z] < 0) << 4 | (row11[z] < 0) << 5 | (row11[z + 1] < 0) << 6 | (row01[z + 1] < 0) << 7;
+
+		if (cubeIndex != 0 && cubeIndex != 255)
+		{
+			out_activeCells[activeCellCount].z = z;
+			out_activeCells[activeCellCount].cubeIndex = cubeIndex;
+			activeCellCount++;
+		}
+	}
+
+	return activeCellCount;
+}
+
+#if defined(__AVX2__)
+#define CLASSIFICATION_LANE_COUNT 8
+
+// Returns the given bit in every lane where the density value is inside of the contour, and 0 in the other lanes
+static inline __m256i CornerInsideBits(f32* values, u32 bit)
+{
+	__m256 inside = _mm256_cmp_ps(_mm256_loadu_ps(values), _mm256_setzero_ps(), _CMP_LT_OQ);
+	return _mm256_and_si256(_mm256_castps_si256(inside), _mm256_set1_epi32(1 << bit));
+}
+#elif defined(__SSE2__)
+#define CLASSIFICATION_LANE_COUNT 4
+
+// Returns the given bit in every lane where the density value is inside of the contour, and 0 in the other lanes
+static inline __m128i CornerInsideBits(f32* values, u32 bit)
+{
+	__m128 inside = _mm_cmplt_ps(_mm_loadu_ps(values), _mm_setzero_ps());
+	return _mm_and_si128(_mm_castps_si128(inside), _mm_set1_epi32(1 << bit));
+}
+#endif
+
+// Classifies the cubes zStart up to zEnd of the row of cubes at x, y, writes the active cubes to out_activeCells in order of increasing z and returns the amount of active cubes.
+static inline u32 ClassifyCellRowRange(f32* densityMap, u32 densityMapHeightTimesDepth, u32 densityMapDepth, u32 x, u32 y, u32 zStart, u32 zEnd, ActiveCell* out_activeCells)
+{
+	f32* row00 = GetDensityValueRef(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y, 0);
+	f32* row10 = GetDensityValueRef(densityMap, densityMapHeightTimesDepth, densityMapDepth, x + 1, y, 0);
+	f32* row01 = GetDensityValueRef(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y + 1, 0);
+	f32* row11 = GetDensityValueRef(densityMap, densityMapHeightTimesDepth, densityMapDepth, x + 1, y + 1, 0);
+
+	u32 activeCellCount = 0;
+	u32 z = zStart;
+
+#ifdef CLASSIFICATION_LANE_COUNT
+	// Classifying a group of cubes at a time, the z + 1 corners of the last cube of a group are one value further so groups have to end before the last density value
+	_Alignas(32) u32 cubeIndices[CLASSIFICATION_LANE_COUNT];
+	for (; z + CLASSIFICATION_LANE_COUNT <= zEnd; z += CLASSIFICATION_LANE_COUNT)
+	{
+#if defined(__AVX2__)
+		__m256i cubeIndex = _mm256_or_si256(
+			_mm256_or_si256(_mm256_or_si256(CornerInsideBits(row00 + z, 0), CornerInsideBits(row10 + z, 1)), _mm256_or_si256(CornerInsideBits(row10 + z + 1, 2), CornerInsideBits(row00 + z + 1, 3))),
+			_mm256_or_si256(_mm256_or_si256(CornerInsideBits(row01 + z, 4), CornerInsideBits(row11 + z, 5)), _mm256_or_si256(CornerInsideBits(row11 + z + 1, 6), CornerInsideBits(row01 + z + 1, 7))));
+		__m256i inactive = _mm256_or_si256(_mm256_cmpeq_epi32(cubeIndex, _mm256_setzero_si256()), _mm256_cmpeq_epi32(cubeIndex, _mm256_set1_epi32(255)));
+		u32 activeMask = ~_mm256_movemask_ps(_mm256_castsi256_ps(inactive)) & 0xFF;
+		if (activeMask == 0)
+			continue;
+		_mm256_store_si256((__m256i*)cubeIndices, cubeIndex);
+#else
+		__m128i cubeIndex = _mm_or_si128(
+			_mm_or_si128(_mm_or_si128(CornerInsideBits(row00 + z, 0), CornerInsideBits(row10 + z, 1)), _mm_or_si128(CornerInsideBits(row10 + z + 1, 2), CornerInsideBits(row00 + z + 1, 3))),
+			_mm_or_si128(_mm_or_si128(CornerInsideBits(row01 + z, 4), CornerInsideBits(row11 + z, 5)), _mm_or_si128(CornerInsideBits(row11 + z + 1, 6), CornerInsideBits(row01 + z + 1, 7))));
+		__m128i inactive = _mm_or_si128(_mm_cmpeq_epi32(cubeIndex, _mm_setzero_si128()), _mm_cmpeq_epi32(cubeIndex, _mm_set1_epi32(255)));
+		u32 activeMask = ~_mm_movemask_ps(_mm_castsi128_ps(inactive)) & 0xF;
+		if (activeMask == 0)
+			continue;
+		_mm_store_si128((__m128i*)cubeIndices, cubeIndex);
+#endif
+
+		// Most groups are fully inside or outside, only groups with active cubes get here
+		for (u32 lane = 0; lane < CLASSIFICATION_LANE_COUNT; lane++)
+		{
+			if (activeMask & (1 << lane))
+			{
+				out_activeCells[activeCellCount].z = z + lane;
+				out_activeCells[activeCellCount].cubeIndex = cubeIndices[lane];
+				activeCellCount++;
+			}
+		}
+	}
+#endif
+
+	// Classifying the cubes that didn't fill a whole group
+	activeCellCount += ClassifyCellRowScalar(row00, row10, row01, row11, z, zEnd, out_activeCells + activeCellCount);
+
+	return activeCellCount;
+}
+
+// Classifies the cubes zStart up to (not including) zEnd of the row of cubes at x, y, writes the active cubes to out_activeCells in order of increasing z and returns the amount of active cubes.
+// If a brick map is given, runs of cubes in bricks that don't contain the surface are skipped. out_activeCells needs room for zEnd - zStart cubes.
+// The density map can be a box of a larger map that the brick map was made for, brickOrigin is the position of the first value of the box in the larger map.
+static inline u32 ClassifyCellRow(f32* densityMap, u32 densityMapHeightTimesDepth, u32 densityMapDepth, u32 x, u32 y, u32 zStart, u32 zEnd, DensityBrickMap* brickMap, u32* brickOrigin, ActiveCell* out_activeCells)
+{
+	if (brickMap == nullptr)
+		return ClassifyCellRowRange(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y, zStart, zEnd, out_activeCells);
+
+	u32 activeCellCount = 0;
+	u32 firstBrickIndex = DensityBrickMapGetBrickIndex(brickMap, (x + brickOrigin[0]) / DENSITY_BRICK_SIZE, (y + brickOrigin[1]) / DENSITY_BRICK_SIZE, 0);
+	u32 lastBrickZ = (zEnd - 1 + brickOrigin[2]) / DENSITY_BRICK_SIZE;
+
+	// Classifying every run of consecutive bricks that contain the surface at once
+	u32 brickZ = (zStart + brickOrigin[2]) / DENSITY_BRICK_SIZE;
+	while (brickZ <= lastBrickZ)
+	{
+		if (!DensityBrickMapBrickHasSurface(brickMap, firstBrickIndex + brickZ))
+		{
+			brickZ++;
+			continue;
+		}
+
+		u32 runStart = brickZ;
+		while (brickZ <= lastBrickZ && DensityBrickMapBrickHasSurface(brickMap, firstBrickIndex + brickZ))
+			brickZ++;
+
+		u32 runZStart = runStart * DENSITY_BRICK_SIZE;
+		u32 runZEnd = brickZ * DENSITY_BRICK_SIZE - brickOrigin[2];
+		runZStart = runZStart < zStart + brickOrigin[2] ? zStart : runZStart - brickOrigin[2];
+		if (runZEnd > zEnd)
+			runZEnd = zEnd;
+		activeCellCount += ClassifyCellRowRange(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y, runZStart, runZEnd, out_activeCells + activeCellCount);
+	}
+
+	return activeCellCount;
+}
+
+// ================================== Marching ==================================
+// Calculates the position of the vertex on the given edge of the cube with its origin at x, y, z
+static inline vec3 InterpolateEdgeVertex(f32* cubeValues, i32 edgeIndex, u32 x, u32 y, u32 z)
+{
+	// Using a lookup table to get the position of the center of the edge relative to the origin of the cube (which is in one of the corners not the center).
+	vec3 position = edgeIndexToPositionTable[edgeIndex];
+
+	// Interpolating the vertex position based on the two density points connected to the edge that this vertex is on
+	f32 value1 = cubeValues[edgeToCornerTable[edgeIndex][0]];
+	f32 value2 = cubeValues[edgeToCornerTable[edgeIndex][1]] - value1;
+	f32 surfaceLevel = -value1;
+	surfaceLevel /= value2;
+
+	// The vertex only gets interpolated along one direction so we need to check which dimension of the vert position needs to be changed to the interpolated value
+	if (position.x == 0.5f)
+		position.x = surfaceLevel;
+	if (position.y == 0.5f)
+		position.y = surfaceLevel;
+	if (position.z == 0.5f)
+		position.z = surfaceLevel;
+
+	// Calculating the vertex position relative to the mesh origin rather than the cube origin
+	position.x += x;
+	position.y += y;
+	position.z += z;
+
+	return position;
+}
+
+// Central difference gradient of the density map at the grid point x, y, z, the differences are one sided on the borders of the map
+static inline vec3 GetGridPointGradient(f32* densityMap, u32 densityMapWidth, u32 densityMapHeight, u32 densityMapDepth, u32 x, u32 y, u32 z)
+{
+	u32 densityMapHeightTimesDepth = densityMapHeight * densityMapDepth;
+	u32 lowX = x > 0 ? x - 1 : x;
+	u32 highX = x + 1 < densityMapWidth ? x + 1 : x;
+	u32 lowY = y > 0 ? y - 1 : y;
+	u32 highY = y + 1 < densityMapHeight ? y + 1 : y;
+	u32 lowZ = z > 0 ? z - 1 : z;
+	u32 highZ = z + 1 < densityMapDepth ? z + 1 : z;
+
+	vec3 gradient;
+	gradient.x = (GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, highX, y, z) - GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, lowX, y, z)) / (f32)(highX - lowX);
+	gradient.y = (GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, highY, z) - GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, lowY, z)) / (f32)(highY - lowY);
+	gradient.z = (GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y, highZ) - GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y, lowZ)) / (f32)(highZ - lowZ);
+	return gradient;
+}
+
+// Calculates the normal of the vertex on the given edge of the cube with its origin at x, y, z, the density gradient interpolated between the two grid points of the edge.
+// It only depends on the density values around the edge, so every mesh that creates the vertex (like the meshes of two neighbouring regions) gives it the same normal.
+static inline vec3 InterpolateEdgeNormal(f32* densityMap, u32 densityMapWidth, u32 densityMapHeight, u32 densityMapDepth, f32* cubeValues, i32 edgeIndex, u32 x, u32 y, u32 z)
+{
+	u32* gridEdge = edgeToGridEdgeTable[edgeIndex];
+	u32 lowX = x + gridEdge[0];
+	u32 lowY = y + gridEdge[1];
+	u32 lowZ = z + gridEdge[2];
+	vec3 lowGradient = GetGridPointGradient(densityMap, densityMapWidth, densityMapHeight, densityMapDepth, lowX, lowY, lowZ);
+	vec3 highGradient = GetGridPointGradient(densityMap, densityMapWidth, densityMapHeight, densityMapDepth, lowX + (gridEdge[3] == 0), lowY + (gridEdge[3] == 1), lowZ + (gridEdge[3] == 2));
+
+	// Same interpolation factor as the vertex position, the first corner of an edge is always its lowest corner
+	f32 value1 = cubeValues[edgeToCornerTable[edgeIndex][0]];
+	f32 surfaceLevel = -value1 / (cubeValues[edgeToCornerTable[edgeIndex][1]] - value1);
+	vec3 gradient = vec3_add_vec3(vec3_mul_f32(lowGradient, 1 - surfaceLevel), vec3_mul_f32(highGradient, surfaceLevel));
+
+	return vec3_dot(gradient, gradient) > 0 ? vec3_normalize(vec3_mul_f32(gradient, -1)) : vec3_create(0, 1, 0);
+}
+
+// Applies the marching cubes algorithm to the active cube with its origin at x, y, z and writes the resulting vertices to out_vertices.
+// out_vertices needs room for at least MAX_VERTS_PER_CUBE vertices, returns the amount of vertices written.
+static inline u32 MarchCube(f32* densityMap, u32 densityMapHeightTimesDepth, u32 densityMapDepth, u32 x, u32 y, u32 z, u32 cubeIndex, VertexT2* out_vertices)
+{
+	f32 cubeValues[8];
+	GetCubeValues(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y, z, cubeValues);
+
+	u32 numberOfVertices = 0;
+
+	// Looping through all the vertices for all the triangles that are required for this cube based on which corners are inside or outside of the contour.
+	// We use a lookup table with a row for every possible configuration of corners that are inside/outside of the contour (apart from the configurations where every corner is inside or every corner is outside).
+	// Each row tells you which triangles are needed by giving three edges that need to be connected and in what order (for normals to be correct).
+	for (i32 i = 0; triTable[cubeIndex][i] != -1; i++)
+	{
+		// Adding the vertex on the edge that the current vertex needs to be on
+		out_vertices[numberOfVertices].position = InterpolateEdgeVertex(cubeValues, triTable[cubeIndex][i], x, y, z);
+		numberOfVertices++;
+
+		// If a triangle was completed this loop calculate and set the normal for all verts of that triangle
+		if (i % 3 == 2)
+		{
+			// Taking the cross product of two of the edges of the triangle to calculate the normal
+			// (because the cross product calculates a vector that is orthogonal to the two vectors that are suplied this vector wil always be the normal of a triangle,
+			// it points to the ouside of the triangle as long as we supply the correct edges)
+			vec3 edgeA = vec3_sub_vec3(out_vertices[numberOfVertices - 2].position, out_vertices[numberOfVertices - 1].position);
+			vec3 edgeB = vec3_sub_vec3(out_vertices[numberOfVertices - 3].position, out_vertices[numberOfVertices - 1].position);
+			vec3 normal = vec3_cross_vec3(edgeA, edgeB);
+			normal = vec3_normalize(normal);
+
+			// Setting the normal for the three most recently added verts
+			out_vertices[numberOfVertices - 1].normal = normal;
+			out_vertices[numberOfVertices - 2].normal = normal;
+			out_vertices[numberOfVertices - 3].normal = normal;
+		}
+	}
+
+	return numberOfVertices;
+}
+
+// Creates the final mesh data, with the vertices copied to a permanent allocation and an index buffer where every vertex is only used once
+static MeshData CreateUnsharedVertexMeshData(u32 numberOfVertices)
+{
+	GRASSERT_MSG(numberOfVertices > 0, "Marching cubes density function produced no vertices");
+
+	// Creating the index buffer
+	u32* indices = AlignedAlloc(global->largeObjectAllocator, sizeof(*indices) * numberOfVertices, CACHE_ALIGN);
+
+	for (int i = 0; i < numberOfVertices; i++)
+	{
+		indices[i] = i;
+	}
+
+	MeshData meshData = {};
+	meshData.vertices = AlignedAlloc(global->largeObjectAllocator, sizeof(VertexT2) * numberOfVertices, CACHE_ALIGN);
+	meshData.vertexCount = numberOfVertices;
+	meshData.vertexStride = sizeof(VertexT2);
+	meshData.indices = indices;
+	meshData.indexCount = numberOfVertices;
+
+	return meshData;
+}
+
+MeshData MarchingCubesGenerateMesh(f32* densityMap, u32 densityMapWidth, u32 densityMapHeight, u32 densityMapDepth, DensityBrickMap* brickMap)
 {
 	ArenaMarker marker = ArenaGetMarker(global->frameArena);
 
+	ActiveCell* activeCells = ArenaAlloc(global->frameArena, sizeof(*activeCells) * (densityMapDepth - 1));
+
 	u32 reserved = INITIAL_VERT_RESERVATION;
 	VertexT2* vertArray = ArenaAlloc(global->frameArena, sizeof(*vertArray) * INITIAL_VERT_RESERVATION);
-    u32 numberOfVertices = 0;
+	u32 numberOfVertices = 0;
 
 	u32 densityMapHeightTimesDepth = densityMapHeight * densityMapDepth;
 
-    // Looping over every cube in the density map
-    for (u32 x = 0; x < densityMapWidth - 1; x++)
-    {
-        for (u32 y = 0; y < densityMapHeight - 1; y++)
-        {
-            for (u32 z = 0; z < densityMapDepth - 1; z++)
-            {
-                // Applying the marching cubes algorithm to this cube to determine what triangles are needed (if any).
-
-                // Putting the values of the current cube in a small array because in the big array they are not contiguous in memory
-                f32 cubeValues[8];
-
-                cubeValues[0] = GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y, z);
-                cubeValues[1] = GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, x + 1, y, z);
-                cubeValues[2] = GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, x + 1, y, z + 1);
-                cubeValues[3] = GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y, z + 1);
-                cubeValues[4] = GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y + 1, z);
-                cubeValues[5] = GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, x + 1, y + 1, z);
-                cubeValues[6] = GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, x + 1, y + 1, z + 1);
-                cubeValues[7] = GetDensityValueRaw(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y + 1, z + 1);
-
-                u32 cubeIndex = 0;
-
-                // Determining which corners are in the contour of the density function and which are outside of it
-                // and storing the booleans in the first 8 bits of an int (cubeIndex)
-                for (int i = 0; i < 8; i++)
-                {
-                    if (cubeValues[i] < 0)
-                        cubeIndex += 1 << i;
-                }
-
-                // If the cube is fully inside or fully outside of the contour, we skip this if block
-                if (!(cubeIndex == 0 || cubeIndex == 255))
-                {
-                    // Looping through all the vertices for all the triangles that are required for this cube based on which corners are inside or outside of the contour.
-                    // We use a lookup table with a row for every possible configuration of corners that are inside/outside of the contour (apart from the configurations where every corner is inside or every corner is outside).
-                    // Each row tells you which triangles are needed by giving three edges that need to be connected and in what order (for normals to be correct).
-                    for (i32 i = 0; triTable[cubeIndex][i] != -1; i++)
-                    {
-                        // Getting the edge that the current vertex needs to be on by first getting its index and then using a lookup table
-                        // to get the corresponding position of the center of the edge relative to the origin of the cube (which is in one of the corners not the center).
-                        i32 edgeIndex = triTable[cubeIndex][i];
-                        vertArray[numberOfVertices].position = edgeIndexToPositionTable[edgeIndex];
-
-                        // Interpolating the vertex position based on the two density points connected to the edge that this vertex is on
-                        f32 value1 = cubeValues[edgeToCornerTable[edgeIndex][0]];
-                        f32 value2 = cubeValues[edgeToCornerTable[edgeIndex][1]] - value1;
-                        f32 surfaceLevel = -value1;
-                        surfaceLevel /= value2;
-
-                        // The vertex only gets interpolated along one direction so we need to check which dimension of the vert position needs to be changed to the interpolated value
-                        if (vertArray[numberOfVertices].position.x == 0.5f)
-							vertArray[numberOfVertices].position.x = surfaceLevel;
-                        if (vertArray[numberOfVertices].position.y == 0.5f)
-							vertArray[numberOfVertices].position.y = surfaceLevel;
-                        if (vertArray[numberOfVertices].position.z == 0.5f)
-							vertArray[numberOfVertices].position.z = surfaceLevel;
-
-                        // Calculating the vertex position relative to the mesh origin rather than the cube origin
-                        vertArray[numberOfVertices].position.x += x;
-                        vertArray[numberOfVertices].position.y += y;
-                        vertArray[numberOfVertices].position.z += z;
-
-                        // Adding the vertex
-                        numberOfVertices++;
-						if (numberOfVertices >= reserved)
-						{
-							reserved += INITIAL_VERT_RESERVATION;
-							ArenaAlloc(global->frameArena, sizeof(*vertArray) * INITIAL_VERT_RESERVATION);
-						}
-
-                        // If a triangle was completed this loop calculate and set the normal for all verts of that triangle
-                        if (i % 3 == 2)
-                        {
-                            // Taking the cross product of two of the edges of the triangle to calculate the normal
-                            // (because the cross product calculates a vector that is orthogonal to the two vectors that are suplied this vector wil always be the normal of a triangle,
-                            // it points to the ouside of the triangle as long as we supply the correct edges)
-                            vec3 edgeA = vec3_sub_vec3(vertArray[numberOfVertices - 2].position, vertArray[numberOfVertices - 1].position);
-                            vec3 edgeB = vec3_sub_vec3(vertArray[numberOfVertices - 3].position, vertArray[numberOfVertices - 1].position);
-                            vec3 normal = vec3_cross_vec3(edgeA, edgeB);
-							normal = vec3_normalize(normal);
-
-                            // Setting the normal for the three most recently added verts
-                            vertArray[numberOfVertices - 1].normal = normal;
-                            vertArray[numberOfVertices - 2].normal = normal;
-                            vertArray[numberOfVertices - 3].normal = normal;
-                        }
-                    }
-                }
-            }
-        }
-    }
+	// Looping over every row of cubes in the density map and only marching the cubes that the contour passes through
+	for (u32 x = 0; x < densityMapWidth - 1; x++)
+	{
+		for (u32 y = 0; y < densityMapHeight - 1; y++)
+		{
+			u32 activeCellCount = ClassifyCellRow(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y, 0, densityMapDepth - 1, brickMap, zeroOrigin, activeCells);
 
-	GRASSERT_MSG(numberOfVertices > 0, "Marching cubes density function produced no vertices");
-	
-	// Creating the index buffer
-    u32* indices = AlignedAlloc(global->largeObjectAllocator, sizeof(*indices) * numberOfVertices, CACHE_ALIGN);
+			for (u32 i = 0; i < activeCellCount; i++)
+			{
+				// Making sure there is room for the maximum amount of vertices a cube can add
+				if (numberOfVertices + MAX_VERTS_PER_CUBE >= reserved)
+				{
+					reserved += INITIAL_VERT_RESERVATION;
+					ArenaAlloc(global->frameArena, sizeof(*vertArray) * INITIAL_VERT_RESERVATION);
+				}
 
-    for (int i = 0; i < numberOfVertices; i++)
-    {
-        indices[i] = i;
-    }
+				numberOfVertices += MarchCube(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y, activeCells[i].z, activeCells[i].cubeIndex, vertArray + numberOfVertices);
+			}
+		}
+	}
 
 	// Copying the vertex buffer to a permanent allocation
-	VertexT2* vertices = AlignedAlloc(global->largeObjectAllocator, sizeof(*vertices) * numberOfVertices, CACHE_ALIGN);
-	MemoryCopy(vertices, vertArray, sizeof(*vertices) * numberOfVertices);
+	MeshData meshData = CreateUnsharedVertexMeshData(numberOfVertices);
+	MemoryCopy(meshData.vertices, vertArray, sizeof(*vertArray) * numberOfVertices);
+
+	// "Freeing" the memory from the temporary vert array, because they could be quite large and this function might be run multiple times per frame
+	ArenaFreeMarker(global->frameArena, marker);
+
+	return meshData;
+}
+
+// ================================== Slab parallel marching cubes ==================================
+// The x range of the density map is split into slabs, every slab is meshed by a job that writes its vertices into a chain of blocks.
+// Blocks are handed out from a pool in the frame arena using an atomic counter, so the jobs never touch the (non thread safe) allocators.
+// After all jobs are done the blocks are copied into the final vertex buffer in slab order, which gives the exact same mesh as the serial version.
+
+typedef struct SlabVertexBlock
+{
+	struct SlabVertexBlock* next;
+	u32 vertexCount;
+	VertexT2 vertices[SLAB_VERTEX_BLOCK_CAPACITY];
+} SlabVertexBlock;
+
+typedef struct SlabJobData
+{
+	f32* densityMap;
+	DensityBrickMap* brickMap;
+	u32 densityMapWidth;
+	u32 densityMapHeight;
+	u32 densityMapDepth;
+	u32 slabWidth;					// Amount of cube layers along x in every slab (the last slab can be smaller)
+	SlabVertexBlock* blockPool;
+	u32 blockPoolCapacity;
+	volatile i32 blockPoolUsed;
+	SlabVertexBlock** slabFirstBlocks;	// First block of every slab, nullptr if the slab has no vertices
+	u32* slabVertexCounts;
+	ActiveCell* slabActiveCells;		// Active cell list of one row of cubes for every slab
+	volatile i32 outOfBlocks;
+} SlabJobData;
+
+static SlabVertexBlock* SlabGetNewBlock(SlabJobData* jobData)
+{
+	i32 blockIndex = PlatformAtomicAdd(&jobData->blockPoolUsed, 1) - 1;
+	if (blockIndex >= (i32)jobData->blockPoolCapacity)
+	{
+		jobData->outOfBlocks = true;
+		return nullptr;
+	}
+
+	SlabVertexBlock* block = &jobData->blockPool[blockIndex];
+	block->next = nullptr;
+	block->vertexCount = 0;
+	return block;
+}
+
+static void MarchingCubesSlabJob(void* data, u32 slabIndex)
+{
+	SlabJobData* jobData = data;
+
+	u32 densityMapHeightTimesDepth = jobData->densityMapHeight * jobData->densityMapDepth;
+	u32 xStart = slabIndex * jobData->slabWidth;
+	u32 xEnd = xStart + jobData->slabWidth;
+	if (xEnd > jobData->densityMapWidth - 1)
+		xEnd = jobData->densityMapWidth - 1;
+
+	ActiveCell* activeCells = jobData->slabActiveCells + slabIndex * (jobData->densityMapDepth - 1);
+
+	SlabVertexBlock* firstBlock = nullptr;
+	SlabVertexBlock* currentBlock = nullptr;
+	u32 slabVertexCount = 0;
+
+	for (u32 x = xStart; x < xEnd; x++)
+	{
+		for (u32 y = 0; y < jobData->densityMapHeight - 1; y++)
+		{
+			u32 activeCellCount = ClassifyCellRow(jobData->densityMap, densityMapHeightTimesDepth, jobData->densityMapDepth, x, y, 0, jobData->densityMapDepth - 1, jobData->brickMap, zeroOrigin, activeCells);
+
+			for (u32 i = 0; i < activeCellCount; i++)
+			{
+				// Getting a new block if the current block can't hold the maximum amount of vertices a cube can add
+				if (currentBlock == nullptr || currentBlock->vertexCount + MAX_VERTS_PER_CUBE > SLAB_VERTEX_BLOCK_CAPACITY)
+				{
+					SlabVertexBlock* newBlock = SlabGetNewBlock(jobData);
+					if (newBlock == nullptr)
+						return;
+					if (currentBlock)
+						currentBlock->next = newBlock;
+					else
+						firstBlock = newBlock;
+					currentBlock = newBlock;
+				}
+
+				u32 cubeVertexCount = MarchCube(jobData->densityMap, densityMapHeightTimesDepth, jobData->densityMapDepth, x, y, activeCells[i].z, activeCells[i].cubeIndex, currentBlock->vertices + currentBlock->vertexCount);
+				currentBlock->vertexCount += cubeVertexCount;
+				slabVertexCount += cubeVertexCount;
+			}
+		}
+	}
+
+	jobData->slabFirstBlocks[slabIndex] = firstBlock;
+	jobData->slabVertexCounts[slabIndex] = slabVertexCount;
+}
+
+MeshData MarchingCubesGenerateMeshMultithreaded(f32* densityMap, u32 densityMapWidth, u32 densityMapHeight, u32 densityMapDepth, DensityBrickMap* brickMap, u32 maxThreadCount)
+{
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	u32 cubeLayerCount = densityMapWidth - 1;
+	u32 slabCount = maxThreadCount * SLABS_PER_THREAD;
+	if (slabCount > cubeLayerCount)
+		slabCount = cubeLayerCount;
+	if (slabCount == 0)
+		slabCount = 1;
+
+	SlabJobData jobData = {};
+	jobData.densityMap = densityMap;
+	jobData.brickMap = brickMap;
+	jobData.densityMapWidth = densityMapWidth;
+	jobData.densityMapHeight = densityMapHeight;
+	jobData.densityMapDepth = densityMapDepth;
+	jobData.slabWidth = (cubeLayerCount + slabCount - 1) / slabCount;
+	slabCount = (cubeLayerCount + jobData.slabWidth - 1) / jobData.slabWidth;
+	jobData.slabFirstBlocks = ArenaAlloc(global->frameArena, sizeof(*jobData.slabFirstBlocks) * slabCount);
+	jobData.slabVertexCounts = ArenaAlloc(global->frameArena, sizeof(*jobData.slabVertexCounts) * slabCount);
+	MemoryZero(jobData.slabFirstBlocks, sizeof(*jobData.slabFirstBlocks) * slabCount);
+	MemoryZero(jobData.slabVertexCounts, sizeof(*jobData.slabVertexCounts) * slabCount);
+	jobData.slabActiveCells = ArenaAlloc(global->frameArena, sizeof(*jobData.slabActiveCells) * slabCount * (densityMapDepth - 1));
+
+	// Using the rest of the frame arena as the block pool
+	jobData.blockPoolCapacity = (ArenaGetRemainingCapacity(global->frameArena) - CACHE_ALIGN) / sizeof(SlabVertexBlock);
+	jobData.blockPool = ArenaAlignedAlloc(global->frameArena, sizeof(SlabVertexBlock) * jobData.blockPoolCapacity, CACHE_ALIGN);
+	jobData.blockPoolUsed = 0;
+	jobData.outOfBlocks = false;
+
+	JobSystemParallelFor(MarchingCubesSlabJob, &jobData, slabCount, maxThreadCount);
+
+	GRASSERT_MSG(!jobData.outOfBlocks, "Frame arena ran out of memory during multithreaded marching cubes");
+
+	// Joining the slabs in order
+	u32 numberOfVertices = 0;
+	for (u32 i = 0; i < slabCount; i++)
+		numberOfVertices += jobData.slabVertexCounts[i];
+
+	MeshData meshData = CreateUnsharedVertexMeshData(numberOfVertices);
+	VertexT2* vertices = meshData.vertices;
+
+	u32 copiedVertexCount = 0;
+	for (u32 i = 0; i < slabCount; i++)
+	{
+		for (SlabVertexBlock* block = jobData.slabFirstBlocks[i]; block != nullptr; block = block->next)
+		{
+			MemoryCopy(vertices + copiedVertexCount, block->vertices, sizeof(*vertices) * block->vertexCount);
+			copiedVertexCount += block->vertexCount;
+		}
+	}
+
+	// "Freeing" the block pool
+	ArenaFreeMarker(global->frameArena, marker);
+
+	return meshData;
+}
+
+// ================================== Indexed marching cubes ==================================
+// Meshes the region of the density map, which can be a box of a larger map. origin is the position of the first value of the box in the larger map,
+// it's used for the brick map lookups and added to the vertex positions so they are the same as when meshing the larger map directly.
+static MeshData GenerateMeshIndexedRegion(f32* densityMap, u32 densityMapWidth, u32 densityMapHeight, u32 densityMapDepth, u32* origin, DensityBrickMap* brickMap, MarchingCubesRegion region)
+{
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	u32 densityMapHeightTimesDepth = densityMapHeight * densityMapDepth;
+
+	// Amount of grid points along y and z in the region, the cubes of the region are in between them
+	u32 regionPointsY = region.endY - region.startY + 1;
+	u32 regionPointsZ = region.endZ - region.startZ + 1;
+
+	// Rolling cache with the vertex index of every grid edge in two x slices of the region, UINT32_MAX means the edge has no vertex (yet).
+	// Every grid point is the lowest corner of three edges (one along every axis), the edges of grid plane x are stored in edgeVertexCache[x & 1].
+	// Edges along x are stored in the slice of the plane they start in, so they are only shared between cubes in the same x layer.
+	u32 sliceEdgeCount = regionPointsY * regionPointsZ * 3;
+	u32* edgeVertexCache[2];
+	edgeVertexCache[0] = ArenaAlloc(global->frameArena, sizeof(*edgeVertexCache[0]) * sliceEdgeCount);
+	edgeVertexCache[1] = ArenaAlloc(global->frameArena, sizeof(*edgeVertexCache[1]) * sliceEdgeCount);
+	MemorySet(edgeVertexCache[0], 0xFF, sizeof(*edgeVertexCache[0]) * sliceEdgeCount);
+	MemorySet(edgeVertexCache[1], 0xFF, sizeof(*edgeVertexCache[1]) * sliceEdgeCount);
+
+	ActiveCell* activeCells = ArenaAlloc(global->frameArena, sizeof(*activeCells) * (regionPointsZ - 1));
+
+	// The index array grows in the frame arena (it's the last allocation so it can just be extended),
+	// the vertex array is much smaller and grows in the large object allocator
+	u32 reservedIndices = INITIAL_VERT_RESERVATION;
+	u32* indexArray = ArenaAlloc(global->frameArena, sizeof(*indexArray) * INITIAL_VERT_RESERVATION);
+	u32 numberOfIndices = 0;
+
+	u32 reservedVertices = INITIAL_VERT_RESERVATION;
+	VertexT2* vertices = AlignedAlloc(global->largeObjectAllocator, sizeof(*vertices) * reservedVertices, CACHE_ALIGN);
+	u32 numberOfVertices = 0;
+
+	// Looping over every row of cubes in the region and only marching the cubes that the contour passes through
+	for (u32 x = region.startX; x < region.endX; x++)
+	{
+		// The slice for plane x + 1 still holds the edges of plane x - 1, so it is cleared before it gets filled with the edges of plane x + 1
+		if (x > region.startX)
+			MemorySet(edgeVertexCache[(x + 1) & 1], 0xFF, sizeof(*edgeVertexCache[0]) * sliceEdgeCount);
+
+		for (u32 y = region.startY; y < region.endY; y++)
+		{
+			u32 activeCellCount = ClassifyCellRow(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y, region.startZ, region.endZ, brickMap, origin, activeCells);
+
+			for (u32 cell = 0; cell < activeCellCount; cell++)
+			{
+				u32 z = activeCells[cell].z;
+				u32 cubeIndex = activeCells[cell].cubeIndex;
+				f32 cubeValues[8];
+				GetCubeValues(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y, z, cubeValues);
+
+				// Making sure there is room for the maximum amount of indices and vertices a cube can add
+				if (numberOfIndices + MAX_VERTS_PER_CUBE >= reservedIndices)
+				{
+					reservedIndices += INITIAL_VERT_RESERVATION;
+					ArenaAlloc(global->frameArena, sizeof(*indexArray) * INITIAL_VERT_RESERVATION);
+				}
+				if (numberOfVertices + MAX_VERTS_PER_CUBE >= reservedVertices)
+				{
+					reservedVertices *= 2;
+					vertices = Realloc(global->largeObjectAllocator, vertices, sizeof(*vertices) * reservedVertices);
+				}
+
+				for (i32 i = 0; triTable[cubeIndex][i] != -1; i++)
+				{
+					// Looking up the grid edge that the vertex is on, and only creating a new vertex if no neighbouring cube has created it already
+					i32 edgeIndex = triTable[cubeIndex][i];
+					u32* gridEdge = edgeToGridEdgeTable[edgeIndex];
+					u32* cachedVertexIndex = &edgeVertexCache[(x + gridEdge[0]) & 1][((y - region.startY + gridEdge[1]) * regionPointsZ + z - region.startZ + gridEdge[2]) * 3 + gridEdge[3]];
+
+					if (*cachedVertexIndex == UINT32_MAX)
+					{
+						vertices[numberOfVertices].position = InterpolateEdgeVertex(cubeValues, edgeIndex, x + origin[0], y + origin[1], z + origin[2]);
+						vertices[numberOfVertices].normal = InterpolateEdgeNormal(densityMap, densityMapWidth, densityMapHeight, densityMapDepth, cubeValues, edgeIndex, x, y, z);
+						*cachedVertexIndex = numberOfVertices;
+						numberOfVertices++;
+					}
+
+					indexArray[numberOfIndices] = *cachedVertexIndex;
+					numberOfIndices++;
+				}
+			}
+		}
+	}
 
 	MeshData meshData = {};
+
+	// Regions without surface result in an empty mesh without allocations
+	if (numberOfVertices == 0)
+	{
+		Free(global->largeObjectAllocator, vertices);
+		ArenaFreeMarker(global->frameArena, marker);
+		return meshData;
+	}
+
+	if (numberOfVertices != reservedVertices)
+		vertices = Realloc(global->largeObjectAllocator, vertices, sizeof(*vertices) * numberOfVertices);
 	meshData.vertices = vertices;
 	meshData.vertexCount = numberOfVertices;
 	meshData.vertexStride = sizeof(*vertices);
-	meshData.indices = indices;
-	meshData.indexCount = numberOfVertices;
 
-	// "Freeing" the memory from the temporary vert array, because they could be quite large and this function might be run multiple times per frame
+	// Copying the index buffer to a permanent allocation
+	meshData.indices = AlignedAlloc(global->largeObjectAllocator, sizeof(*meshData.indices) * numberOfIndices, CACHE_ALIGN);
+	meshData.indexCount = numberOfIndices;
+	MemoryCopy(meshData.indices, indexArray, sizeof(*indexArray) * numberOfIndices);
+
+	// "Freeing" the edge cache, the active cell list and the temporary index array
+	ArenaFreeMarker(global->frameArena, marker);
+
+	return meshData;
+}
+
+MeshData MarchingCubesGenerateMeshIndexedRegion(f32* densityMap, u32 densityMapWidth, u32 densityMapHeight, u32 densityMapDepth, DensityBrickMap* brickMap, MarchingCubesRegion region)
+{
+	GRASSERT_DEBUG(region.startX < region.endX && region.startY < region.endY && region.startZ < region.endZ);
+	GRASSERT_DEBUG(region.endX < densityMapWidth && region.endY < densityMapHeight && region.endZ < densityMapDepth);
+
+	return GenerateMeshIndexedRegion(densityMap, densityMapWidth, densityMapHeight, densityMapDepth, zeroOrigin, brickMap, region);
+}
+
+// Box of density values the region variants for other map layouts decode, the values of the cubes of the region plus one more value on every side that the map has
+static inline DensityMapBox GetIndexedRegionBox(u32 densityMapWidth, u32 densityMapHeight, u32 densityMapDepth, MarchingCubesRegion region)
+{
+	DensityMapBox box;
+	box.startX = region.startX > 0 ? region.startX - 1 : 0;
+	box.startY = region.startY > 0 ? region.startY - 1 : 0;
+	box.startZ = region.startZ > 0 ? region.startZ - 1 : 0;
+	box.endX = region.endX + 2 < densityMapWidth ? region.endX + 2 : densityMapWidth;
+	box.endY = region.endY + 2 < densityMapHeight ? region.endY + 2 : densityMapHeight;
+	box.endZ = region.endZ + 2 < densityMapDepth ? region.endZ + 2 : densityMapDepth;
+	return box;
+}
+
+MeshData MarchingCubesGenerateMeshIndexedRegionQuantized(QuantizedDensityMap* densityMap, DensityBrickMap* brickMap, MarchingCubesRegion region)
+{
+	GRASSERT_DEBUG(region.startX < region.endX && region.startY < region.endY && region.startZ < region.endZ);
+	GRASSERT_DEBUG(region.endX < densityMap->mapWidth && region.endY < densityMap->mapHeight && region.endZ < densityMap->mapDepth);
+
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	// Dequantizing the values of the cubes of the region (one more value than cubes along every axis) and meshing them as a small f32 density map.
+	// The box also has the values one past the region on every side (where the map has them) for the normals of the vertices on the border of the region
+	DensityMapBox box = GetIndexedRegionBox(densityMap->mapWidth, densityMap->mapHeight, densityMap->mapDepth, region);
+	u32 boxWidth = box.endX - box.startX;
+	u32 boxHeight = box.endY - box.startY;
+	u32 boxDepth = box.endZ - box.startZ;
+	f32* boxValues = ArenaAlloc(global->frameArena, sizeof(*boxValues) * boxWidth * boxHeight * boxDepth);
+	QuantizedDensityMapDecodeBox(densityMap, &box, boxValues);
+
+	u32 origin[3] = { box.startX, box.startY, box.startZ };
+	MarchingCubesRegion localRegion = { region.startX - box.startX, region.startY - box.startY, region.startZ - box.startZ, region.endX - box.startX, region.endY - box.startY, region.endZ - box.startZ };
+	MeshData meshData = GenerateMeshIndexedRegion(boxValues, boxWidth, boxHeight, boxDepth, origin, brickMap, localRegion);
+
+	// "Freeing" the dequantized values, the mesh data itself isn't allocated in the frame arena
+	ArenaFreeMarker(global->frameArena, marker);
+
+	return meshData;
+}
+
+MeshData MarchingCubesGenerateMeshIndexedRegionBricked(BrickedDensityMap* densityMap, DensityBrickMap* brickMap, MarchingCubesRegion region)
+{
+	GRASSERT_DEBUG(region.startX < region.endX && region.startY < region.endY && region.startZ < region.endZ);
+	GRASSERT_DEBUG(region.endX < densityMap->mapWidth && region.endY < densityMap->mapHeight && region.endZ < densityMap->mapDepth);
+
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	// Copying the values of the cubes of the region into a small flat density map, the classification needs the rows of values to be contiguous.
+	// The box also has the values one past the region on every side (where the map has them) for the normals of the vertices on the border of the region
+	DensityMapBox box = GetIndexedRegionBox(densityMap->mapWidth, densityMap->mapHeight, densityMap->mapDepth, region);
+	u32 boxWidth = box.endX - box.startX;
+	u32 boxHeight = box.endY - box.startY;
+	u32 boxDepth = box.endZ - box.startZ;
+	f32* boxValues = ArenaAlloc(global->frameArena, sizeof(*boxValues) * boxWidth * boxHeight * boxDepth);
+	BrickedDensityMapDecodeBox(densityMap, &box, boxValues);
+
+	u32 origin[3] = { box.startX, box.startY, box.startZ };
+	MarchingCubesRegion localRegion = { region.startX - box.startX, region.startY - box.startY, region.startZ - box.startZ, region.endX - box.startX, region.endY - box.startY, region.endZ - box.startZ };
+	MeshData meshData = GenerateMeshIndexedRegion(boxValues, boxWidth, boxHeight, boxDepth, origin, brickMap, localRegion);
+
+	// "Freeing" the copied values, the mesh data itself isn't allocated in the frame arena
+	ArenaFreeMarker(global->frameArena, marker);
+
+	return meshData;
+}
+
+MeshData MarchingCubesGenerateMeshIndexed(f32* densityMap, u32 densityMapWidth, u32 densityMapHeight, u32 densityMapDepth, DensityBrickMap* brickMap)
+{
+	MarchingCubesRegion region = { 0, 0, 0, densityMapWidth - 1, densityMapHeight - 1, densityMapDepth - 1 };
+	MeshData meshData = MarchingCubesGenerateMeshIndexedRegion(densityMap, densityMapWidth, densityMapHeight, densityMapDepth, brickMap, region);
+
+	GRASSERT_MSG(meshData.vertexCount > 0, "Marching cubes density function produced no vertices");
+
+	return meshData;
+}
+
+// ================================== Surface nets ==================================
+// Naive surface nets: every active cube gets one vertex at the average of the points where the contour crosses its edges,
+// and every grid edge that crosses the contour gets a quad connecting the vertices of the four cubes around it.
+// The mesh has about half the triangles of marching cubes and every vertex is shared by about six triangles instead of one per crossed grid edge.
+
+// Maximum amount of indices a single cube can add, a quad (two triangles) for each of the three grid edges that start at its origin
+#define MAX_SURFACE_NETS_INDICES_PER_CUBE 18
+
+// Calculates the vertex of the active cube with its origin at x, y, z (in the density map the cube values were read from), origin is added to the position.
+// The normal is the gradient of the trilinear interpolation of the cube values at the vertex, it only depends on the cube itself
+// so the vertices that neighbouring regions both create for the cubes on their shared border are exactly the same.
+static inline VertexT2 SurfaceNetsCubeVertex(f32* cubeValues, u32 cubeIndex, u32 x, u32 y, u32 z, u32* origin)
+{
+	// Averaging the edge crossings relative to the cube origin
+	vec3 average = vec3_create(0, 0, 0);
+	u32 crossingCount = 0;
+	i32 crossedEdges = edgeTable[cubeIndex];
+	for (i32 edgeIndex = 0; edgeIndex < 12; edgeIndex++)
+	{
+		if (crossedEdges & (1 << edgeIndex))
+		{
+			average = vec3_add_vec3(average, InterpolateEdgeVertex(cubeValues, edgeIndex, 0, 0, 0));
+			crossingCount++;
+		}
+	}
+	vec3 local = vec3_div_float(average, crossingCount);
+
+	// Differences along every axis between the corners of the cube (corner order matches the lookup tables), interpolated over the other two axes
+	f32 fx = local.x, fy = local.y, fz = local.z;
+	f32* c = cubeValues;
+	vec3 gradient;
+	gradient.x = (1 - fy) * (1 - fz) * (c[1] - c[0]) + (1 - fy) * fz * (c[2] - c[3]) + fy * (1 - fz) * (c[5] - c[4]) + fy * fz * (c[6] - c[7]);
+	gradient.y = (1 - fx) * (1 - fz) * (c[4] - c[0]) + fx * (1 - fz) * (c[5] - c[1]) + fx * fz * (c[6] - c[2]) + (1 - fx) * fz * (c[7] - c[3]);
+	gradient.z = (1 - fx) * (1 - fy) * (c[3] - c[0]) + fx * (1 - fy) * (c[2] - c[1]) + (1 - fx) * fy * (c[7] - c[4]) + fx * fy * (c[6] - c[5]);
+
+	// The gradient can only vanish in symmetric saddle configurations, the average gradient over the cube (at its center) is used then
+	if (vec3_dot(gradient, gradient) < 0.0000001f)
+	{
+		gradient.x = (c[1] - c[0]) + (c[2] - c[3]) + (c[5] - c[4]) + (c[6] - c[7]);
+		gradient.y = (c[4] - c[0]) + (c[5] - c[1]) + (c[6] - c[2]) + (c[7] - c[3]);
+		gradient.z = (c[3] - c[0]) + (c[2] - c[1]) + (c[7] - c[4]) + (c[6] - c[5]);
+	}
+
+	VertexT2 vertex;
+	vertex.position = vec3_create(local.x + x + origin[0], local.y + y + origin[1], local.z + z + origin[2]);
+	// Density increases towards the outside of the contour, the normals point to the inside like the marching cubes normals
+	vertex.normal = vec3_dot(gradient, gradient) > 0 ? vec3_normalize(vec3_mul_f32(gradient, -1)) : vec3_create(0, 1, 0);
+	return vertex;
+}
+
+// Meshes the region of the density map with surface nets, the density map can be a box of a larger map like with GenerateMeshIndexedRegion.
+// The quad of a grid edge connects the cubes that have the lowest corner of the edge as their highest corner, a region creates the quads of the grid edges
+// that start in its cubes, so the cubes one below the region need vertices as well and their values need to be in the density map.
+// Grid edges on the low sides of the whole map don't have four cubes around them and don't get a quad.
+static MeshData GenerateMeshSurfaceNetsRegion(f32* densityMap, u32 densityMapHeight, u32 densityMapDepth, u32* origin, DensityBrickMap* brickMap, MarchingCubesRegion region)
+{
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	u32 densityMapHeightTimesDepth = densityMapHeight * densityMapDepth;
+
+	// Cubes that get a vertex, the region plus one layer of cubes below it unless the region is on the low side of the map
+	u32 cubeStartX = region.startX > 0 ? region.startX - 1 : 0;
+	u32 cubeStartY = region.startY > 0 ? region.startY - 1 : 0;
+	u32 cubeStartZ = region.startZ > 0 ? region.startZ - 1 : 0;
+	u32 cubesY = region.endY - cubeStartY;
+	u32 cubesZ = region.endZ - cubeStartZ;
+
+	// Rolling cache with the vertex index of every cube in two x slices, the quads of a cube only use vertices of its own slice and the one before it.
+	// UINT32_MAX means the cube isn't active.
+	u32 sliceCubeCount = cubesY * cubesZ;
+	u32* cubeVertexCache[2];
+	cubeVertexCache[0] = ArenaAlloc(global->frameArena, sizeof(*cubeVertexCache[0]) * sliceCubeCount);
+	cubeVertexCache[1] = ArenaAlloc(global->frameArena, sizeof(*cubeVertexCache[1]) * sliceCubeCount);
+
+	ActiveCell* activeCells = ArenaAlloc(global->frameArena, sizeof(*activeCells) * cubesZ);
+
+	// The index array grows in the frame arena (it's the last allocation so it can just be extended),
+	// the vertex array is much smaller and grows in the large object allocator
+	u32 reservedIndices = INITIAL_VERT_RESERVATION;
+	u32* indexArray = ArenaAlloc(global->frameArena, sizeof(*indexArray) * INITIAL_VERT_RESERVATION);
+	u32 numberOfIndices = 0;
+
+	u32 reservedVertices = INITIAL_VERT_RESERVATION;
+	VertexT2* vertices = AlignedAlloc(global->largeObjectAllocator, sizeof(*vertices) * reservedVertices, CACHE_ALIGN);
+	u32 numberOfVertices = 0;
+
+	for (u32 x = cubeStartX; x < region.endX; x++)
+	{
+		u32* slice = cubeVertexCache[x & 1];
+		u32* previousSlice = cubeVertexCache[(x + 1) & 1];
+		MemorySet(slice, 0xFF, sizeof(*slice) * sliceCubeCount);
+
+		for (u32 y = cubeStartY; y < region.endY; y++)
+		{
+			u32 activeCellCount = ClassifyCellRow(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y, cubeStartZ, region.endZ, brickMap, origin, activeCells);
+
+			for (u32 cell = 0; cell < activeCellCount; cell++)
+			{
+				u32 z = activeCells[cell].z;
+				u32 cubeIndex = activeCells[cell].cubeIndex;
+				f32 cubeValues[8];
+				GetCubeValues(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y, z, cubeValues);
+
+				// Making sure there is room for the maximum amount of indices and vertices a cube can add
+				if (numberOfIndices + MAX_SURFACE_NETS_INDICES_PER_CUBE >= reservedIndices)
+				{
+					reservedIndices += INITIAL_VERT_RESERVATION;
+					ArenaAlloc(global->frameArena, sizeof(*indexArray) * INITIAL_VERT_RESERVATION);
+				}
+				if (numberOfVertices + 1 >= reservedVertices)
+				{
+					reservedVertices *= 2;
+					vertices = Realloc(global->largeObjectAllocator, vertices, sizeof(*vertices) * reservedVertices);
+				}
+
+				u32 cacheIndex = (y - cubeStartY) * cubesZ + z - cubeStartZ;
+				vertices[numberOfVertices] = SurfaceNetsCubeVertex(cubeValues, cubeIndex, x, y, z, origin);
+				slice[cacheIndex] = numberOfVertices;
+				numberOfVertices++;
+
+				// Cubes below the region only provide vertices for the quads of the region
+				if (x < region.startX || y < region.startY || z < region.startZ)
+					continue;
+
+				// The three grid edges that start at the cube origin (corner 0) run to corner 1 (x), corner 4 (y) and corner 3 (z).
+				// The four cubes around a grid edge along axis a are listed counterclockwise seen from the positive side of a: the cube at the edge start
+				// minus both other axes, minus the third axis, the cube itself and minus the second axis (axes in x, y, z, x, y order).
+				// The cubes before the current one have all been visited, so their vertices are in the cache already.
+				bool originInside = cubeIndex & 1;
+				u32 quadVertices[3][4] = {};
+				bool quadCrossed[3];
+				quadCrossed[0] = y > 0 && z > 0 && originInside != (bool)(cubeIndex & (1 << 1));
+				quadCrossed[1] = z > 0 && x > 0 && originInside != (bool)(cubeIndex & (1 << 4));
+				quadCrossed[2] = x > 0 && y > 0 && originInside != (bool)(cubeIndex & (1 << 3));
+				if (quadCrossed[0])
+				{
+					quadVertices[0][0] = slice[cacheIndex - cubesZ - 1];
+					quadVertices[0][1] = slice[cacheIndex - 1];
+					quadVertices[0][2] = slice[cacheIndex];
+					quadVertices[0][3] = slice[cacheIndex - cubesZ];
+				}
+				if (quadCrossed[1])
+				{
+					quadVertices[1][0] = previousSlice[cacheIndex - 1];
+					quadVertices[1][1] = previousSlice[cacheIndex];
+					quadVertices[1][2] = slice[cacheIndex];
+					quadVertices[1][3] = slice[cacheIndex - 1];
+				}
+				if (quadCrossed[2])
+				{
+					quadVertices[2][0] = previousSlice[cacheIndex - cubesZ];
+					quadVertices[2][1] = slice[cacheIndex - cubesZ];
+					quadVertices[2][2] = slice[cacheIndex];
+					quadVertices[2][3] = previousSlice[cacheIndex];
+				}
+
+				for (u32 axis = 0; axis < 3; axis++)
+				{
+					if (!quadCrossed[axis])
+						continue;
+
+					u32* quad = quadVertices[axis];
+					GRASSERT_DEBUG(quad[0] != UINT32_MAX && quad[1] != UINT32_MAX && quad[2] != UINT32_MAX && quad[3] != UINT32_MAX);
+
+					// Like the marching cubes triangles the quad is counterclockwise seen from the outside of the contour,
+					// which is on the positive side of the edge if its start is inside, otherwise the quad is flipped
+					if (!originInside)
+					{
+						u32 swap = quad[1];
+						quad[1] = quad[3];
+						quad[3] = swap;
+					}
+
+					// Splitting the quad along its shorter diagonal, which gives better shaped triangles on curved parts of the surface
+					vec3 diagonal02 = vec3_sub_vec3(vertices[quad[2]].position, vertices[quad[0]].position);
+					vec3 diagonal13 = vec3_sub_vec3(vertices[quad[3]].position, vertices[quad[1]].position);
+					if (vec3_dot(diagonal02, diagonal02) <= vec3_dot(diagonal13, diagonal13))
+					{
+						u32 triangles[6] = { quad[0], quad[1], quad[2], quad[0], quad[2], quad[3] };
+						MemoryCopy(indexArray + numberOfIndices, triangles, sizeof(triangles));
+					}
+					else
+					{
+						u32 triangles[6] = { quad[0], quad[1], quad[3], quad[1], quad[2], quad[3] };
+						MemoryCopy(indexArray + numberOfIndices, triangles, sizeof(triangles));
+					}
+					numberOfIndices += 6;
+				}
+			}
+		}
+	}
+
+	MeshData meshData = {};
+
+	// Regions without surface result in an empty mesh without allocations. Cubes below the region can have vertices without the region having any quads.
+	if (numberOfIndices == 0)
+	{
+		Free(global->largeObjectAllocator, vertices);
+		ArenaFreeMarker(global->frameArena, marker);
+		return meshData;
+	}
+
+	// Vertices of cubes below the region that no quad uses are kept, they are at most one layer of cubes on three sides of the region
+	if (numberOfVertices != reservedVertices)
+		vertices = Realloc(global->largeObjectAllocator, vertices, sizeof(*vertices) * numberOfVertices);
+	meshData.vertices = vertices;
+	meshData.vertexCount = numberOfVertices;
+	meshData.vertexStride = sizeof(*vertices);
+
+	// Copying the index buffer to a permanent allocation
+	meshData.indices = AlignedAlloc(global->largeObjectAllocator, sizeof(*meshData.indices) * numberOfIndices, CACHE_ALIGN);
+	meshData.indexCount = numberOfIndices;
+	MemoryCopy(meshData.indices, indexArray, sizeof(*indexArray) * numberOfIndices);
+
+	// "Freeing" the vertex cache, the active cell list and the temporary index array
 	ArenaFreeMarker(global->frameArena, marker);
 
 	return meshData;
 }
 
+MeshData MarchingCubesGenerateMeshSurfaceNetsRegion(f32* densityMap, u32 densityMapWidth, u32 densityMapHeight, u32 densityMapDepth, DensityBrickMap* brickMap, MarchingCubesRegion region)
+{
+	GRASSERT_DEBUG(region.startX < region.endX && region.startY < region.endY && region.startZ < region.endZ);
+	GRASSERT_DEBUG(region.endX < densityMapWidth && region.endY < densityMapHeight && region.endZ < densityMapDepth);
+
+	return GenerateMeshSurfaceNetsRegion(densityMap, densityMapHeight, densityMapDepth, zeroOrigin, brickMap, region);
+}
+
+// Box of density values that the surface nets of the region read, the region's cubes and the layer of cubes below it.
+// Fills in the origin of the box and the region relative to the box.
+static inline DensityMapBox GetSurfaceNetsRegionBox(MarchingCubesRegion region, u32* out_origin, MarchingCubesRegion* out_localRegion)
+{
+	DensityMapBox box = { region.startX > 0 ? region.startX - 1 : 0, region.startY > 0 ? region.startY - 1 : 0, region.startZ > 0 ? region.startZ - 1 : 0, region.endX + 1, region.endY + 1, region.endZ + 1 };
+	out_origin[0] = box.startX;
+	out_origin[1] = box.startY;
+	out_origin[2] = box.startZ;
+	*out_localRegion = (MarchingCubesRegion){ region.startX - box.startX, region.startY - box.startY, region.startZ - box.startZ, region.endX - box.startX, region.endY - box.startY, region.endZ - box.startZ };
+	return box;
+}
+
+MeshData MarchingCubesGenerateMeshSurfaceNetsRegionQuantized(QuantizedDensityMap* densityMap, DensityBrickMap* brickMap, MarchingCubesRegion region)
+{
+	GRASSERT_DEBUG(region.startX < region.endX && region.startY < region.endY && region.startZ < region.endZ);
+	GRASSERT_DEBUG(region.endX < densityMap->mapWidth && region.endY < densityMap->mapHeight && region.endZ < densityMap->mapDepth);
+
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	u32 origin[3];
+	MarchingCubesRegion localRegion;
+	DensityMapBox box = GetSurfaceNetsRegionBox(region, origin, &localRegion);
+	u32 boxHeight = box.endY - box.startY;
+	u32 boxDepth = box.endZ - box.startZ;
+	f32* boxValues = ArenaAlloc(global->frameArena, sizeof(*boxValues) * (box.endX - box.startX) * boxHeight * boxDepth);
+	QuantizedDensityMapDecodeBox(densityMap, &box, boxValues);
 
+	MeshData meshData = GenerateMeshSurfaceNetsRegion(boxValues, boxHeight, boxDepth, origin, brickMap, localRegion);
+
+	// "Freeing" the dequantized values, the mesh data itself isn't allocated in the frame arena
+	ArenaFreeMarker(global->frameArena, marker);
+
+	return meshData;
+}
+
+MeshData MarchingCubesGenerateMeshSurfaceNetsRegionBricked(BrickedDensityMap* densityMap, DensityBrickMap* brickMap, MarchingCubesRegion region)
+{
+	GRASSERT_DEBUG(region.startX < region.endX && region.startY < region.endY && region.startZ < region.endZ);
+	GRASSERT_DEBUG(region.endX < densityMap->mapWidth && region.endY < densityMap->mapHeight && region.endZ < densityMap->mapDepth);
+
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	u32 origin[3];
+	MarchingCubesRegion localRegion;
+	DensityMapBox box = GetSurfaceNetsRegionBox(region, origin, &localRegion);
+	u32 boxHeight = box.endY - box.startY;
+	u32 boxDepth = box.endZ - box.startZ;
+	f32* boxValues = ArenaAlloc(global->frameArena, sizeof(*boxValues) * (box.endX - box.startX) * boxHeight * boxDepth);
+	BrickedDensityMapDecodeBox(densityMap, &box, boxValues);
+
+	MeshData meshData = GenerateMeshSurfaceNetsRegion(boxValues, boxHeight, boxDepth, origin, brickMap, localRegion);
+
+	// "Freeing" the copied values, the mesh data itself isn't allocated in the frame arena
+	ArenaFreeMarker(global->frameArena, marker);
+
+	return meshData;
+}
+
+MeshData MarchingCubesGenerateMeshSurfaceNets(f32* densityMap, u32 densityMapWidth, u32 densityMapHeight, u32 densityMapDepth, DensityBrickMap* brickMap)
+{
+	MarchingCubesRegion region = { 0, 0, 0, densityMapWidth - 1, densityMapHeight - 1, densityMapDepth - 1 };
+	MeshData meshData = MarchingCubesGenerateMeshSurfaceNetsRegion(densityMap, densityMapWidth, densityMapHeight, densityMapDepth, brickMap, region);
+
+	GRASSERT_MSG(meshData.vertexCount > 0, "Surface nets density function produced no vertices");
+
+	return meshData;
+}
+
+u64 MarchingCubesCountActiveCells(f32* densityMap, u32 densityMapWidth, u32 densityMapHeight, u32 densityMapDepth, DensityBrickMap* brickMap, bool scalarClassification)
+{
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	ActiveCell* activeCells = ArenaAlloc(global->frameArena, sizeof(*activeCells) * (densityMapDepth - 1));
+	u32 densityMapHeightTimesDepth = densityMapHeight * densityMapDepth;
+	u64 activeCellCount = 0;
+
+	for (u32 x = 0; x < densityMapWidth - 1; x++)
+	{
+		for (u32 y = 0; y < densityMapHeight - 1; y++)
+		{
+			if (scalarClassification)
+			{
+				f32* row00 = GetDensityValueRef(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y, 0);
+				f32* row10 = GetDensityValueRef(densityMap, densityMapHeightTimesDepth, densityMapDepth, x + 1, y, 0);
+				f32* row01 = GetDensityValueRef(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y + 1, 0);
+				f32* row11 = GetDensityValueRef(densityMap, densityMapHeightTimesDepth, densityMapDepth, x + 1, y + 1, 0);
+				activeCellCount += ClassifyCellRowScalar(row00, row10, row01, row11, 0, densityMapDepth - 1, activeCells);
+			}
+			else
+				activeCellCount += ClassifyCellRow(densityMap, densityMapHeightTimesDepth, densityMapDepth, x, y, 0, densityMapDepth - 1, brickMap, zeroOrigin, activeCells);
+		}
+	}
+
+	ArenaFreeMarker(global->frameArena, marker);
+
+	return activeCellCount;
+}
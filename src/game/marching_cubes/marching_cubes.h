@@ -1,10 +1,60 @@
 #pragma once
 #include "renderer/material.h"
 #include "core/engine.h"
+#include "density_brick_map.h"
+#include "quantized_density_map.h"
+#include "bricked_density_map.h"
 
 
-// Vertices in the mesh data generated have a position and a normal, vertices are not shared and normals are just the face normals
-MeshData MarchingCubesGenerateMesh(f32* densityMap, u32 densityMapWidth, u32 densityMapHeight, u32 densityMapDepth);
+// Vertices in the mesh data generated have a position and a normal, vertices are not shared and normals are just the face normals.
+// brickMap is optional (can be nullptr), if given the cubes in bricks that don't contain the surface are skipped, it needs to be up to date with the density map.
+MeshData MarchingCubesGenerateMesh(f32* densityMap, u32 densityMapWidth, u32 densityMapHeight, u32 densityMapDepth, DensityBrickMap* brickMap);
+
+// Same as MarchingCubesGenerateMesh but the x range of the density map is split into slabs that are meshed by the job system on at most maxThreadCount threads.
+// The slabs are joined in order so the resulting mesh is exactly the same as the one generated by MarchingCubesGenerateMesh.
+MeshData MarchingCubesGenerateMeshMultithreaded(f32* densityMap, u32 densityMapWidth, u32 densityMapHeight, u32 densityMapDepth, DensityBrickMap* brickMap, u32 maxThreadCount);
+
+// Vertices in the mesh data generated have a position and a normal and are shared between triangles, every edge of the density grid that crosses the contour produces exactly one vertex.
+// Normals are smooth, they are the density gradient (central differences) interpolated along the edge of the vertex. The mesh can be used as a collider without merging vertices first.
+MeshData MarchingCubesGenerateMeshIndexed(f32* densityMap, u32 densityMapWidth, u32 densityMapHeight, u32 densityMapDepth, DensityBrickMap* brickMap);
+
+// Cube range [start, end) along every axis of a density map, a density map of size n has n - 1 cubes along that axis
+typedef struct MarchingCubesRegion
+{
+	u32 startX;
+	u32 startY;
+	u32 startZ;
+	u32 endX;
+	u32 endY;
+	u32 endZ;
+} MarchingCubesRegion;
+
+// Same as MarchingCubesGenerateMeshIndexed but only meshes the cubes in the given region, vertex positions are still relative to the origin of the density map.
+// Vertices are only shared within the region, the normals only depend on the density values around the vertex so neighbouring regions give their shared border vertices the same normals.
+// If the region doesn't contain any surface an empty mesh data (no allocations, zero counts) is returned, don't free it.
+MeshData MarchingCubesGenerateMeshIndexedRegion(f32* densityMap, u32 densityMapWidth, u32 densityMapHeight, u32 densityMapDepth, DensityBrickMap* brickMap, MarchingCubesRegion region);
+
+// Same as MarchingCubesGenerateMeshIndexedRegion for a quantized density map, the values of the region are dequantized into the frame arena before meshing.
+// The triangles are exactly the same as for the f32 map the quantized map was made from, only the vertex positions can move slightly.
+MeshData MarchingCubesGenerateMeshIndexedRegionQuantized(QuantizedDensityMap* densityMap, DensityBrickMap* brickMap, MarchingCubesRegion region);
+
+// Same as MarchingCubesGenerateMeshIndexedRegion for a density map in the bricked layout, the values of the region are copied to a flat box in the frame arena before meshing.
+// The mesh is exactly the same as for the flat density map. Chunk sized regions only cover a few tiles along every axis, so the copy reads whole tiles at a time.
+MeshData MarchingCubesGenerateMeshIndexedRegionBricked(BrickedDensityMap* densityMap, DensityBrickMap* brickMap, MarchingCubesRegion region);
+
+// Alternative to the marching cubes meshers using naive surface nets: every active cube gets one vertex at the average of the contour crossings on its edges,
+// and every grid edge crossing the contour gets a quad (two triangles) connecting the vertices of the four cubes around it.
+// Gives about half the triangles of marching cubes and far fewer vertices. Normals are the density gradient at the vertex.
+// The region variants take the same inputs as their MarchingCubesGenerateMeshIndexedRegion counterparts. A region also creates vertices for the layer of cubes
+// below it (so it reads one more layer of density values on its low sides), the meshes of neighbouring regions meet without gaps and their border vertices match exactly.
+MeshData MarchingCubesGenerateMeshSurfaceNets(f32* densityMap, u32 densityMapWidth, u32 densityMapHeight, u32 densityMapDepth, DensityBrickMap* brickMap);
+MeshData MarchingCubesGenerateMeshSurfaceNetsRegion(f32* densityMap, u32 densityMapWidth, u32 densityMapHeight, u32 densityMapDepth, DensityBrickMap* brickMap, MarchingCubesRegion region);
+MeshData MarchingCubesGenerateMeshSurfaceNetsRegionQuantized(QuantizedDensityMap* densityMap, DensityBrickMap* brickMap, MarchingCubesRegion region);
+MeshData MarchingCubesGenerateMeshSurfaceNetsRegionBricked(BrickedDensityMap* densityMap, DensityBrickMap* brickMap, MarchingCubesRegion region);
+
+// Only runs the cell classification pass of the meshers over the whole density map and returns the amount of active cells (cells that the contour passes through).
+// If scalarClassification is true the SIMD classification and the brick map are skipped. Used for benchmarking.
+u64 MarchingCubesCountActiveCells(f32* densityMap, u32 densityMapWidth, u32 densityMapHeight, u32 densityMapDepth, DensityBrickMap* brickMap, bool scalarClassification);
 
 inline static void MarchingCubesFreeMeshData(MeshData meshData)
 {
@@ -32,6 +32,23 @@ i32 edgeToCornerTable[12][2] = {
     {3, 7},
 };
 
+// Every edge of a cube lies on an edge of the density grid, this table gives that grid edge as an offset from the cube origin to the lowest corner of the edge
+// and the axis the edge runs along (0 = x, 1 = y, 2 = z). Used to share vertices between neighbouring cubes.
+u32 edgeToGridEdgeTable[12][4] = {
+    {0, 0, 0, 0}, // 0
+    {1, 0, 0, 2}, // 1
+    {0, 0, 1, 0}, // 2
+    {0, 0, 0, 2}, // 3
+    {0, 1, 0, 0}, // 4
+    {1, 1, 0, 2}, // 5
+    {0, 1, 1, 0}, // 6
+    {0, 1, 0, 2}, // 7
+    {0, 0, 0, 1}, // 8
+    {1, 0, 0, 1}, // 9
+    {1, 0, 1, 1}, // 10
+    {0, 0, 1, 1}, // 11
+};
+
 i32 edgeTable[] = {
     0x0, 0x109, 0x203, 0x30a, 0x406, 0x50f, 0x605, 0x70c,
     0x80c, 0x905, 0xa0f, 0xb06, 0xc0a, 0xd03, 0xe09, 0xf00,
@@ -0,0 +1,219 @@
+#include "quantized_density_map.h"
+
+#include "core/asserts.h"
+#include "core/engine.h"
+#include "math/lin_alg.h"
+#include <math.h>
+
+
+u64 QuantizedDensityMapGetSize(QuantizedDensityMap* densityMap)
+{
+	u64 bytesPerValue = densityMap->format == DENSITY_MAP_FORMAT_16BIT ? sizeof(u16) : sizeof(u8);
+	return bytesPerValue * densityMap->mapWidth * densityMap->mapHeight * densityMap->mapDepth;
+}
+
+// Picks the scale and bias for the range, doesn't allocate the values
+static QuantizedDensityMap InitQuantizedDensityMap(DensityMapFormat format, u32 mapWidth, u32 mapHeight, u32 mapDepth, f32 minValue, f32 maxValue)
+{
+	GRASSERT_DEBUG(format == DENSITY_MAP_FORMAT_16BIT || format == DENSITY_MAP_FORMAT_8BIT);
+	GRASSERT_DEBUG(minValue <= 0 && maxValue >= 0);
+
+	QuantizedDensityMap densityMap = {};
+	densityMap.mapWidth = mapWidth;
+	densityMap.mapHeight = mapHeight;
+	densityMap.mapDepth = mapDepth;
+	densityMap.format = format;
+
+	// The scale is the smallest power of two that fits the range in the levels, with one spare level for rounding up at the top
+	// and one for rounding down at the bottom (level zeroLevel - 1 always exists so negative values can stay below 0)
+	u32 maxLevel = format == DENSITY_MAP_FORMAT_16BIT ? UINT16_MAX : UINT8_MAX;
+	f32 targetScale = (maxValue - minValue) / (maxLevel - 2);
+	densityMap.scale = 1;
+	if (targetScale > 0)
+	{
+		i32 exponent;
+		f32 mantissa = frexpf(targetScale, &exponent);
+		densityMap.scale = ldexpf(1, mantissa == 0.5f ? exponent - 1 : exponent);
+	}
+
+	u32 zeroLevel = (u32)ceilf(-minValue / densityMap.scale);
+	zeroLevel = zeroLevel < 1 ? 1 : zeroLevel;
+	densityMap.bias = -(f32)zeroLevel * densityMap.scale;
+
+	return densityMap;
+}
+
+QuantizedDensityMap QuantizedDensityMapCreate(Allocator* allocator, DensityMapFormat format, u32 mapWidth, u32 mapHeight, u32 mapDepth, f32 minValue, f32 maxValue)
+{
+	QuantizedDensityMap densityMap = InitQuantizedDensityMap(format, mapWidth, mapHeight, mapDepth, minValue, maxValue);
+	densityMap.values = Alloc(allocator, QuantizedDensityMapGetSize(&densityMap));
+	return densityMap;
+}
+
+QuantizedDensityMap QuantizedDensityMapCreateInArena(Arena* arena, DensityMapFormat format, u32 mapWidth, u32 mapHeight, u32 mapDepth, f32 minValue, f32 maxValue)
+{
+	QuantizedDensityMap densityMap = InitQuantizedDensityMap(format, mapWidth, mapHeight, mapDepth, minValue, maxValue);
+	densityMap.values = ArenaAlloc(arena, QuantizedDensityMapGetSize(&densityMap));
+	return densityMap;
+}
+
+void QuantizedDensityMapDestroy(Allocator* allocator, QuantizedDensityMap* densityMap)
+{
+	Free(allocator, densityMap->values);
+	densityMap->values = nullptr;
+}
+
+void QuantizedDensityMapDecodeRow(QuantizedDensityMap* densityMap, u32 x, u32 y, u32 zStart, u32 count, f32* out_values)
+{
+	u64 firstIndex = ((u64)x * densityMap->mapHeight + y) * densityMap->mapDepth + zStart;
+	f32 scale = densityMap->scale;
+	f32 bias = densityMap->bias;
+	u32 i = 0;
+
+	if (densityMap->format == DENSITY_MAP_FORMAT_16BIT)
+	{
+		u16* row = (u16*)densityMap->values + firstIndex;
+#if defined(__AVX2__)
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 levels = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i*)(row + i))));
+			_mm256_storeu_ps(out_values + i, _mm256_add_ps(_mm256_mul_ps(levels, _mm256_set1_ps(scale)), _mm256_set1_ps(bias)));
+		}
+#elif defined(__SSE2__)
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i levels = _mm_loadu_si128((__m128i*)(row + i));
+			__m128 low = _mm_cvtepi32_ps(_mm_unpacklo_epi16(levels, _mm_setzero_si128()));
+			__m128 high = _mm_cvtepi32_ps(_mm_unpackhi_epi16(levels, _mm_setzero_si128()));
+			_mm_storeu_ps(out_values + i, _mm_add_ps(_mm_mul_ps(low, _mm_set1_ps(scale)), _mm_set1_ps(bias)));
+			_mm_storeu_ps(out_values + i + 4, _mm_add_ps(_mm_mul_ps(high, _mm_set1_ps(scale)), _mm_set1_ps(bias)));
+		}
+#endif
+		for (; i < count; i++)
+			out_values[i] = row[i] * scale + bias;
+	}
+	else
+	{
+		u8* row = (u8*)densityMap->values + firstIndex;
+#if defined(__AVX2__)
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 levels = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i*)(row + i))));
+			_mm256_storeu_ps(out_values + i, _mm256_add_ps(_mm256_mul_ps(levels, _mm256_set1_ps(scale)), _mm256_set1_ps(bias)));
+		}
+#elif defined(__SSE2__)
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i levels = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(row + i)), _mm_setzero_si128());
+			__m128 low = _mm_cvtepi32_ps(_mm_unpacklo_epi16(levels, _mm_setzero_si128()));
+			__m128 high = _mm_cvtepi32_ps(_mm_unpackhi_epi16(levels, _mm_setzero_si128()));
+			_mm_storeu_ps(out_values + i, _mm_add_ps(_mm_mul_ps(low, _mm_set1_ps(scale)), _mm_set1_ps(bias)));
+			_mm_storeu_ps(out_values + i + 4, _mm_add_ps(_mm_mul_ps(high, _mm_set1_ps(scale)), _mm_set1_ps(bias)));
+		}
+#endif
+		for (; i < count; i++)
+			out_values[i] = row[i] * scale + bias;
+	}
+}
+
+// Rounds the value to the closest level (ties to even like the SIMD conversion), negative values that would round to the zero level use the level below it
+// so they stay inside of the contour
+static inline i32 QuantizeValue(f32 value, f32 inverseScale, i32 zeroLevel, i32 maxLevel)
+{
+	i32 level = zeroLevel + (i32)lrintf(value * inverseScale);
+	level = value < 0 && level >= zeroLevel ? zeroLevel - 1 : level;
+	level = level < 0 ? 0 : level;
+	return level > maxLevel ? maxLevel : level;
+}
+
+void QuantizedDensityMapEncodeRow(QuantizedDensityMap* densityMap, u32 x, u32 y, u32 zStart, u32 count, f32* values)
+{
+	u64 firstIndex = ((u64)x * densityMap->mapHeight + y) * densityMap->mapDepth + zStart;
+	f32 inverseScale = 1.f / densityMap->scale;
+	i32 zeroLevel = (i32)(-densityMap->bias * inverseScale);
+
+	i32 maxLevel = densityMap->format == DENSITY_MAP_FORMAT_16BIT ? UINT16_MAX : UINT8_MAX;
+	u32 i = 0;
+
+#if defined(__AVX2__)
+	// Same steps as QuantizeValue for 8 values at a time, the 32 bit levels are packed down to 16 or 8 bits with unsigned saturation
+	__m256 inverseScaleVector = _mm256_set1_ps(inverseScale);
+	__m256i zeroLevelVector = _mm256_set1_epi32(zeroLevel);
+	__m256i belowZeroLevelVector = _mm256_set1_epi32(zeroLevel - 1);
+	__m256i maxLevelVector = _mm256_set1_epi32(maxLevel);
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 value = _mm256_loadu_ps(values + i);
+		__m256i level = _mm256_add_epi32(zeroLevelVector, _mm256_cvtps_epi32(_mm256_mul_ps(value, inverseScaleVector)));
+		__m256i roundedToOutside = _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(value, _mm256_setzero_ps(), _CMP_LT_OQ)), _mm256_cmpgt_epi32(level, belowZeroLevelVector));
+		level = _mm256_blendv_epi8(level, belowZeroLevelVector, roundedToOutside);
+		level = _mm256_min_epi32(_mm256_max_epi32(level, _mm256_setzero_si256()), maxLevelVector);
+
+		__m128i levels16 = _mm_packus_epi32(_mm256_castsi256_si128(level), _mm256_extracti128_si256(level, 1));
+		if (densityMap->format == DENSITY_MAP_FORMAT_16BIT)
+			_mm_storeu_si128((__m128i*)((u16*)densityMap->values + firstIndex + i), levels16);
+		else
+			_mm_storel_epi64((__m128i*)((u8*)densityMap->values + firstIndex + i), _mm_packus_epi16(levels16, levels16));
+	}
+#endif
+
+	if (densityMap->format == DENSITY_MAP_FORMAT_16BIT)
+	{
+		u16* row = (u16*)densityMap->values + firstIndex;
+		for (; i < count; i++)
+			row[i] = (u16)QuantizeValue(values[i], inverseScale, zeroLevel, maxLevel);
+	}
+	else
+	{
+		u8* row = (u8*)densityMap->values + firstIndex;
+		for (; i < count; i++)
+			row[i] = (u8)QuantizeValue(values[i], inverseScale, zeroLevel, maxLevel);
+	}
+}
+
+void QuantizedDensityMapEncodeBox(QuantizedDensityMap* densityMap, DensityMapBox* box, f32* values)
+{
+	DensityMapBox wholeMap = { 0, 0, 0, densityMap->mapWidth, densityMap->mapHeight, densityMap->mapDepth };
+	box = box ? box : &wholeMap;
+	GRASSERT_DEBUG(box->endX <= densityMap->mapWidth && box->endY <= densityMap->mapHeight && box->endZ <= densityMap->mapDepth);
+
+	u32 boxDepth = box->endZ - box->startZ;
+	for (u32 x = box->startX; x < box->endX; x++)
+	{
+		for (u32 y = box->startY; y < box->endY; y++)
+		{
+			f32* row = values + ((u64)(x - box->startX) * (box->endY - box->startY) + y - box->startY) * boxDepth;
+			QuantizedDensityMapEncodeRow(densityMap, x, y, box->startZ, boxDepth, row);
+		}
+	}
+}
+
+void QuantizedDensityMapDecodeBox(QuantizedDensityMap* densityMap, DensityMapBox* box, f32* out_values)
+{
+	DensityMapBox wholeMap = { 0, 0, 0, densityMap->mapWidth, densityMap->mapHeight, densityMap->mapDepth };
+	box = box ? box : &wholeMap;
+	GRASSERT_DEBUG(box->endX <= densityMap->mapWidth && box->endY <= densityMap->mapHeight && box->endZ <= densityMap->mapDepth);
+
+	u32 boxDepth = box->endZ - box->startZ;
+	for (u32 x = box->startX; x < box->endX; x++)
+	{
+		for (u32 y = box->startY; y < box->endY; y++)
+		{
+			f32* row = out_values + ((u64)(x - box->startX) * (box->endY - box->startY) + y - box->startY) * boxDepth;
+			QuantizedDensityMapDecodeRow(densityMap, x, y, box->startZ, boxDepth, row);
+		}
+	}
+}
+
+void DensityMapGetRange(f32* densityMap, u64 valueCount, f32* out_minValue, f32* out_maxValue)
+{
+	f32 minValue = densityMap[0];
+	f32 maxValue = densityMap[0];
+	for (u64 i = 1; i < valueCount; i++)
+	{
+		minValue = densityMap[i] < minValue ? densityMap[i] : minValue;
+		maxValue = densityMap[i] > maxValue ? densityMap[i] : maxValue;
+	}
+	*out_minValue = minValue;
+	*out_maxValue = maxValue;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "defines.h"
+#include "core/meminc.h"
+#include "density_evaluation.h"
+
+typedef enum DensityMapFormat
+{
+	DENSITY_MAP_FORMAT_F32,
+	DENSITY_MAP_FORMAT_16BIT,
+	DENSITY_MAP_FORMAT_8BIT,
+} DensityMapFormat;
+
+// Largest value that is kept when quantizing terrain, larger values are far outside of the surface. They only change the mesh on edges next to a steep jump in density,
+// which the blur smooths out, and leaving them out halves the size of the levels of an 8 bit map.
+#define QUANTIZED_TERRAIN_MAX_DENSITY 2
+
+// Density map that stores every value in 8 or 16 bits (same layout as f32 density maps), the value is quantizedValue * scale + bias.
+// The scale is a power of two and the bias a multiple of it, so dequantizing is exact (with or without fma) and 0 is exactly representable.
+// Values are rounded to the closest level, except that negative values never round up to 0, so the inside/outside of every value and with that
+// the marching cubes topology is exactly the same as for the f32 map. Vertex positions move by at most half a level divided by the gradient.
+typedef struct QuantizedDensityMap
+{
+	void* values;					// u16 or u8 depending on the format
+	f32 scale;
+	f32 bias;
+	u32 mapWidth;
+	u32 mapHeight;
+	u32 mapDepth;
+	DensityMapFormat format;
+} QuantizedDensityMap;
+
+// The levels cover at least [minValue, maxValue] (the range needs to contain 0), values outside of the levels are clamped when encoded
+QuantizedDensityMap QuantizedDensityMapCreate(Allocator* allocator, DensityMapFormat format, u32 mapWidth, u32 mapHeight, u32 mapDepth, f32 minValue, f32 maxValue);
+// Same as QuantizedDensityMapCreate but the values are allocated in the arena, free them with an arena marker instead of calling QuantizedDensityMapDestroy
+QuantizedDensityMap QuantizedDensityMapCreateInArena(Arena* arena, DensityMapFormat format, u32 mapWidth, u32 mapHeight, u32 mapDepth, f32 minValue, f32 maxValue);
+void QuantizedDensityMapDestroy(Allocator* allocator, QuantizedDensityMap* densityMap);
+
+// Bytes used by the values of the map
+u64 QuantizedDensityMapGetSize(QuantizedDensityMap* densityMap);
+
+// Quantizes the values of the box (the whole map if box is nullptr), values holds the values of the box densely packed in the usual density map layout.
+void QuantizedDensityMapEncodeBox(QuantizedDensityMap* densityMap, DensityMapBox* box, f32* values);
+// Dequantizes the values of the box (the whole map if box is nullptr) into out_values, densely packed in the usual density map layout.
+void QuantizedDensityMapDecodeBox(QuantizedDensityMap* densityMap, DensityMapBox* box, f32* out_values);
+
+// Dequantizes count values starting at the given value (along z) into out_values, SIMD if available
+void QuantizedDensityMapDecodeRow(QuantizedDensityMap* densityMap, u32 x, u32 y, u32 zStart, u32 count, f32* out_values);
+// Quantizes count values into the map starting at the given value (along z)
+void QuantizedDensityMapEncodeRow(QuantizedDensityMap* densityMap, u32 x, u32 y, u32 zStart, u32 count, f32* values);
+
+static inline f32 QuantizedDensityMapGetValue(QuantizedDensityMap* densityMap, u32 x, u32 y, u32 z)
+{
+	u64 index = ((u64)x * densityMap->mapHeight + y) * densityMap->mapDepth + z;
+	f32 quantizedValue = densityMap->format == DENSITY_MAP_FORMAT_16BIT ? ((u16*)densityMap->values)[index] : ((u8*)densityMap->values)[index];
+	return quantizedValue * densityMap->scale + densityMap->bias;
+}
+
+// Writes the smallest and largest value of the f32 density map to out_minValue and out_maxValue
+void DensityMapGetRange(f32* densityMap, u64 valueCount, f32* out_minValue, f32* out_maxValue);
@@ -1,6 +1,11 @@
 #include "terrain_density_functions.h"
 
 #include "core/engine.h"
+#include "density_brick_map.h"
+#include "core/job_system.h"
+#include "density_evaluation.h"
+#include "quantized_density_map.h"
+#include "bricked_density_map.h"
 
 // Indexes into a densityMap
 static inline f32* GetDensityValueRef(f32* densityMap, u32 mapHeightTimesDepth, u32 mapDepth, u32 x, u32 y, u32 z)
@@ -19,49 +24,59 @@ static inline f32 GetDensityValueRaw(f32* densityMap, u32 mapHeightTimesDepth, u
 }
 
 
-void DensityFuncSphereHole(f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth)
+typedef struct SphereHoleDensityData
 {
-    u32 mapHeightTimesDepth = mapHeight * mapDepth;
+    vec3 sphere1Center;
+    f32 sphere1Radius;
+    vec3 sphere2Center;
+    f32 sphere2Radius;
+} SphereHoleDensityData;
 
-    // Spheres for calculating density
-    vec3 sphere1Center = vec3_from_float(mapWidth / 2);
-    f32 sphere1Radius = 20;
-    vec3 sphere2Center = vec3_from_float(mapWidth / 2);
-    sphere2Center.x -= 13;
-    f32 sphere2Radius = 8;
+static void SphereHoleDensity(void* userData, DensityBatch* batch, f32* out_values)
+{
+    SphereHoleDensityData* data = userData;
 
-    // Looping over every density point and calculating the density.
-    for (u32 x = 0; x < mapWidth; x++)
+    for (u32 lane = 0; lane < DENSITY_BATCH_SIZE; lane++)
     {
-        for (u32 y = 0; y < mapHeight; y++)
-        {
-            for (u32 z = 0; z < mapDepth; z++)
-            {
-                // Calculating whether the current point is in the sphere or in the hole sphere
-                f32 sphereValue = vec3_distance(vec3_create(x, y, z), sphere1Center) - sphere1Radius;
-                if (sphereValue <= -2)
-                    sphereValue = -2;
-                if (sphereValue >= 0)
-                    sphereValue = 0;
-                f32 sphereHoleValue = vec3_distance(vec3_create(x, y, z), sphere2Center) - sphere2Radius;
-                if (sphereHoleValue <= -2)
-                    sphereHoleValue = -2;
-                if (sphereHoleValue >= 0)
-                    sphereHoleValue = 0;
-
-                // Calculating the density value
-                *GetDensityValueRef(densityMap, mapHeightTimesDepth, mapDepth, x, y, z) = 1 + sphereValue - sphereHoleValue;
-            }
-        }
+        // Calculating whether the current point is in the sphere or in the hole sphere
+        f32 deltaX = batch->x[lane] - data->sphere1Center.x;
+        f32 deltaY = batch->y[lane] - data->sphere1Center.y;
+        f32 deltaZ = batch->z[lane] - data->sphere1Center.z;
+        f32 sphereValue = sqrtf(deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ) - data->sphere1Radius;
+        sphereValue = sphereValue <= -2 ? -2 : sphereValue;
+        sphereValue = sphereValue >= 0 ? 0 : sphereValue;
+
+        deltaX = batch->x[lane] - data->sphere2Center.x;
+        deltaY = batch->y[lane] - data->sphere2Center.y;
+        deltaZ = batch->z[lane] - data->sphere2Center.z;
+        f32 sphereHoleValue = sqrtf(deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ) - data->sphere2Radius;
+        sphereHoleValue = sphereHoleValue <= -2 ? -2 : sphereHoleValue;
+        sphereHoleValue = sphereHoleValue >= 0 ? 0 : sphereHoleValue;
+
+        // Calculating the density value
+        out_values[lane] = 1 + sphereValue - sphereHoleValue;
     }
 }
 
+void DensityFuncSphereHole(f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth)
+{
+    // Spheres for calculating density
+    SphereHoleDensityData data = {};
+    data.sphere1Center = vec3_from_float(mapWidth / 2);
+    data.sphere1Radius = 20;
+    data.sphere2Center = vec3_from_float(mapWidth / 2);
+    data.sphere2Center.x -= 13;
+    data.sphere2Radius = 8;
+
+    DensityMapEvaluate(densityMap, mapWidth, mapHeight, mapDepth, nullptr, SphereHoleDensity, &data, nullptr, JobSystemGetThreadCount());
+}
+
 #define SAMPLES_PER_BEZIER 20
 
-void DensityFuncBezierCurveHole(u32* seed, BezierDensityFuncSettings* generationSettings, f32* densityMap, u32 mapResolution)
+// Generates the random bezier curves and sphere holes of the bezier curve hole density function and samples the curves.
+// out_bezierSamples gets bezierTunnelCount * SAMPLES_PER_BEZIER samples, out_sphereHoleCenters gets sphereHoleCount centers, both are allocated in the frame arena.
+static void GenerateBezierTunnels(u32* seed, BezierDensityFuncSettings* generationSettings, u32 mapResolution, vec3** out_bezierSamples, vec3** out_sphereHoleCenters)
 {
-    u32 mapHeightTimesDepth = mapResolution * mapResolution;
-
     vec3 sphereCenter = vec3_from_float(mapResolution / 2);
 
 	// Generating random bezier curves
@@ -109,6 +124,244 @@ void DensityFuncBezierCurveHole(u32* seed, BezierDensityFuncSettings* generation
 		sphereHoleCenters[i] = vec3_add_vec3(vec3_mul_f32(RandomPointInUnitSphere(seed), generationSettings->baseSphereRadius), sphereCenter);
 	}
 
+	*out_bezierSamples = bezierSamples;
+	*out_sphereHoleCenters = sphereHoleCenters;
+}
+
+// Amount of density values along every side of a cell of the tunnel grid
+#define TUNNEL_GRID_CELL_SIZE 8
+
+// Uniform grid over the density map where every cell lists the primitives (bezier samples or sphere holes) whose radius overlaps the cell.
+// A density value only has to test the primitives of its own cell, primitives that aren't listed are further away than their radius.
+typedef struct TunnelGrid
+{
+	u32* cellStarts;		// Primitives of cell i are cellPrimitives[cellStarts[i]] up to cellPrimitives[cellStarts[i + 1]]
+	u32* cellPrimitives;
+	u32 cellsPerAxis;
+} TunnelGrid;
+
+// Gets the range of cells along every axis that the box around a primitive with the given radius overlaps, returns false if it doesn't overlap the grid
+static inline bool GetTunnelGridCellRange(TunnelGrid* grid, vec3 position, f32 radius, u32* out_firstCell, u32* out_lastCell)
+{
+	f32 positionValues[3] = { position.x, position.y, position.z };
+	for (u32 axis = 0; axis < 3; axis++)
+	{
+		f32 first = floorf((positionValues[axis] - radius) / TUNNEL_GRID_CELL_SIZE);
+		f32 last = floorf((positionValues[axis] + radius) / TUNNEL_GRID_CELL_SIZE);
+		if (last < 0 || first >= grid->cellsPerAxis)
+			return false;
+		out_firstCell[axis] = first < 0 ? 0 : (u32)first;
+		out_lastCell[axis] = last >= grid->cellsPerAxis ? grid->cellsPerAxis - 1 : (u32)last;
+	}
+	return true;
+}
+
+// Builds the grid in the frame arena with a counting pass and a filling pass, so the primitives of a cell are stored contiguously
+static TunnelGrid CreateTunnelGrid(vec3* primitives, u32 primitiveCount, f32 radius, u32 mapResolution)
+{
+	TunnelGrid grid = {};
+	grid.cellsPerAxis = (mapResolution + TUNNEL_GRID_CELL_SIZE - 1) / TUNNEL_GRID_CELL_SIZE;
+	u32 cellCount = grid.cellsPerAxis * grid.cellsPerAxis * grid.cellsPerAxis;
+
+	grid.cellStarts = ArenaAlloc(global->frameArena, sizeof(*grid.cellStarts) * (cellCount + 1));
+	MemoryZero(grid.cellStarts, sizeof(*grid.cellStarts) * (cellCount + 1));
+
+	// Counting the primitives of every cell (in cellStarts[cell + 1])
+	u32 firstCell[3];
+	u32 lastCell[3];
+	for (u32 i = 0; i < primitiveCount; i++)
+	{
+		if (!GetTunnelGridCellRange(&grid, primitives[i], radius, firstCell, lastCell))
+			continue;
+		for (u32 x = firstCell[0]; x <= lastCell[0]; x++)
+			for (u32 y = firstCell[1]; y <= lastCell[1]; y++)
+				for (u32 z = firstCell[2]; z <= lastCell[2]; z++)
+					grid.cellStarts[(x * grid.cellsPerAxis + y) * grid.cellsPerAxis + z + 1]++;
+	}
+
+	for (u32 cell = 0; cell < cellCount; cell++)
+		grid.cellStarts[cell + 1] += grid.cellStarts[cell];
+
+	// Filling the cells, cellStarts[cell] is used as the write position and ends up at the start of the next cell, so it gets restored afterwards
+	grid.cellPrimitives = ArenaAlloc(global->frameArena, sizeof(*grid.cellPrimitives) * (grid.cellStarts[cellCount] + 1));
+	for (u32 i = 0; i < primitiveCount; i++)
+	{
+		if (!GetTunnelGridCellRange(&grid, primitives[i], radius, firstCell, lastCell))
+			continue;
+		for (u32 x = firstCell[0]; x <= lastCell[0]; x++)
+			for (u32 y = firstCell[1]; y <= lastCell[1]; y++)
+				for (u32 z = firstCell[2]; z <= lastCell[2]; z++)
+					grid.cellPrimitives[grid.cellStarts[(x * grid.cellsPerAxis + y) * grid.cellsPerAxis + z]++] = i;
+	}
+
+	for (u32 cell = cellCount; cell > 0; cell--)
+		grid.cellStarts[cell] = grid.cellStarts[cell - 1];
+	grid.cellStarts[0] = 0;
+
+	return grid;
+}
+
+typedef struct BezierCurveHoleDensityData
+{
+	BezierDensityFuncSettings* settings;
+	vec3 sphereCenter;
+	vec3* bezierSamples;
+	vec3* sphereHoleCenters;
+	TunnelGrid sampleGrid;
+	TunnelGrid sphereHoleGrid;
+} BezierCurveHoleDensityData;
+
+// Writes the closest squared distance to the primitives listed in the cell for the lanes firstLane up to laneEnd, the lanes need to be in the cell.
+// Writes 100000000000 if the cell doesn't list any primitives.
+static inline void ClosestDistanceSquaredInCell(TunnelGrid* grid, vec3* primitives, u32 cell, DensityBatch* batch, u32 firstLane, u32 laneEnd, f32* out_closestDistancesSquared)
+{
+	for (u32 lane = firstLane; lane < laneEnd; lane++)
+		out_closestDistancesSquared[lane] = 100000000000;
+
+	for (u32 i = grid->cellStarts[cell]; i < grid->cellStarts[cell + 1]; i++)
+	{
+		vec3 primitive = primitives[grid->cellPrimitives[i]];
+		for (u32 lane = firstLane; lane < laneEnd; lane++)
+		{
+			f32 deltaX = batch->x[lane] - primitive.x;
+			f32 deltaY = batch->y[lane] - primitive.y;
+			f32 deltaZ = batch->z[lane] - primitive.z;
+			f32 distanceSquared = deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ;
+			out_closestDistancesSquared[lane] = distanceSquared < out_closestDistancesSquared[lane] ? distanceSquared : out_closestDistancesSquared[lane];
+		}
+	}
+}
+
+static void BezierCurveHoleDensity(void* userData, DensityBatch* batch, f32* out_values)
+{
+	BezierCurveHoleDensityData* data = userData;
+	BezierDensityFuncSettings* generationSettings = data->settings;
+
+	// Calculating whether the points are in the sphere, points outside of the sphere don't need the tunnels
+	_Alignas(32) f32 sphereValues[DENSITY_BATCH_SIZE];
+	bool anyInside = false;
+	for (u32 lane = 0; lane < DENSITY_BATCH_SIZE; lane++)
+	{
+		f32 deltaX = batch->x[lane] - data->sphereCenter.x;
+		f32 deltaY = batch->y[lane] - data->sphereCenter.y;
+		f32 deltaZ = batch->z[lane] - data->sphereCenter.z;
+		sphereValues[lane] = sqrtf(deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ) - generationSettings->baseSphereRadius;
+		anyInside = anyInside || sphereValues[lane] < 0;
+	}
+
+	if (!anyInside)
+	{
+		for (u32 lane = 0; lane < DENSITY_BATCH_SIZE; lane++)
+			out_values[lane] = 1;
+		return;
+	}
+
+	// Only primitives closer than their radius change the density (further away the distance gets clamped to 0), so a value only tests the primitives listed in its cell.
+	// If the closest primitive is within its radius it is listed in the cell, so the closest distance and the result are exactly the same as when testing every primitive.
+	_Alignas(32) f32 closestSphereDistancesSquared[DENSITY_BATCH_SIZE];
+	_Alignas(32) f32 closestBezierDistancesSquared[DENSITY_BATCH_SIZE];
+	u32 firstCellOfRow = (((u32)batch->x[0] / TUNNEL_GRID_CELL_SIZE) * data->sampleGrid.cellsPerAxis + (u32)batch->y[0] / TUNNEL_GRID_CELL_SIZE) * data->sampleGrid.cellsPerAxis;
+	u32 firstLaneCell = firstCellOfRow + (u32)batch->z[0] / TUNNEL_GRID_CELL_SIZE;
+	u32 lastLaneCell = firstCellOfRow + (u32)batch->z[DENSITY_BATCH_SIZE - 1] / TUNNEL_GRID_CELL_SIZE;
+	if (firstLaneCell == lastLaneCell)
+	{
+		// Every lane tests the same primitives, which happens for every batch that is aligned to the cells
+		ClosestDistanceSquaredInCell(&data->sphereHoleGrid, data->sphereHoleCenters, firstLaneCell, batch, 0, DENSITY_BATCH_SIZE, closestSphereDistancesSquared);
+		ClosestDistanceSquaredInCell(&data->sampleGrid, data->bezierSamples, firstLaneCell, batch, 0, DENSITY_BATCH_SIZE, closestBezierDistancesSquared);
+	}
+	else
+	{
+		for (u32 lane = 0; lane < DENSITY_BATCH_SIZE; lane++)
+		{
+			u32 cell = firstCellOfRow + (u32)batch->z[lane] / TUNNEL_GRID_CELL_SIZE;
+			ClosestDistanceSquaredInCell(&data->sphereHoleGrid, data->sphereHoleCenters, cell, batch, lane, lane + 1, closestSphereDistancesSquared);
+			ClosestDistanceSquaredInCell(&data->sampleGrid, data->bezierSamples, cell, batch, lane, lane + 1, closestBezierDistancesSquared);
+		}
+	}
+
+	for (u32 lane = 0; lane < DENSITY_BATCH_SIZE; lane++)
+	{
+		f32 sphereValue = sphereValues[lane];
+		if (sphereValue >= 0)
+		{
+			out_values[lane] = 1;
+			continue;
+		}
+		if (sphereValue <= -2)
+			sphereValue = -2;
+
+		f32 closestSphereDistance = sqrtf(closestSphereDistancesSquared[lane]);
+		closestSphereDistance -= generationSettings->sphereHoleRadius;
+		if (closestSphereDistance <= -2)
+		{
+			out_values[lane] = 1 + sphereValue - closestSphereDistance;
+			continue;
+		}
+
+		f32 closestBezierDistance = sqrt(closestBezierDistancesSquared[lane]) - generationSettings->bezierTunnelRadius;
+
+		if (closestBezierDistance <= -2)
+		{
+			out_values[lane] = 1 + sphereValue - closestBezierDistance;
+			continue;
+		}
+
+		if (closestBezierDistance >= 0)
+			closestBezierDistance = 0;
+
+		f32 closestAirDistance = fmin(closestSphereDistance, closestBezierDistance);
+
+		// Calculating the density value
+		out_values[lane] = 1 + sphereValue - closestAirDistance;
+	}
+}
+
+// Writes to the flat density map if it isn't nullptr, otherwise to the bricked density map
+static void GenerateBezierCurveHole(u32* seed, BezierDensityFuncSettings* generationSettings, f32* densityMap, BrickedDensityMap* brickedDensityMap, u32 mapResolution, DensityBrickMap* narrowBandBrickMap)
+{
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	BezierCurveHoleDensityData data = {};
+	data.settings = generationSettings;
+	data.sphereCenter = vec3_from_float(mapResolution / 2);
+	GenerateBezierTunnels(seed, generationSettings, mapResolution, &data.bezierSamples, &data.sphereHoleCenters);
+
+	data.sampleGrid = CreateTunnelGrid(data.bezierSamples, generationSettings->bezierTunnelCount * SAMPLES_PER_BEZIER, generationSettings->bezierTunnelRadius, mapResolution);
+	data.sphereHoleGrid = CreateTunnelGrid(data.sphereHoleCenters, generationSettings->sphereHoleCount, generationSettings->sphereHoleRadius, mapResolution);
+
+	if (densityMap)
+		DensityMapEvaluate(densityMap, mapResolution, mapResolution, mapResolution, nullptr, BezierCurveHoleDensity, &data, narrowBandBrickMap, JobSystemGetThreadCount());
+	else
+		DensityMapEvaluateBricked(brickedDensityMap, nullptr, BezierCurveHoleDensity, &data, narrowBandBrickMap, JobSystemGetThreadCount());
+
+	// "Freeing" the curves and the grids
+	ArenaFreeMarker(global->frameArena, marker);
+}
+
+void DensityFuncBezierCurveHole(u32* seed, BezierDensityFuncSettings* generationSettings, f32* densityMap, u32 mapResolution, DensityBrickMap* narrowBandBrickMap)
+{
+	GenerateBezierCurveHole(seed, generationSettings, densityMap, nullptr, mapResolution, narrowBandBrickMap);
+}
+
+void DensityFuncBezierCurveHoleBricked(u32* seed, BezierDensityFuncSettings* generationSettings, BrickedDensityMap* densityMap, DensityBrickMap* narrowBandBrickMap)
+{
+	GRASSERT_DEBUG(densityMap->mapWidth == densityMap->mapHeight && densityMap->mapWidth == densityMap->mapDepth);
+	GenerateBezierCurveHole(seed, generationSettings, nullptr, densityMap, densityMap->mapWidth, narrowBandBrickMap);
+}
+
+void DensityFuncBezierCurveHoleReference(u32* seed, BezierDensityFuncSettings* generationSettings, f32* densityMap, u32 mapResolution)
+{
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+    u32 mapHeightTimesDepth = mapResolution * mapResolution;
+
+    vec3 sphereCenter = vec3_from_float(mapResolution / 2);
+
+	vec3* bezierSamples;
+	vec3* sphereHoleCenters;
+	GenerateBezierTunnels(seed, generationSettings, mapResolution, &bezierSamples, &sphereHoleCenters);
+	u64 totalBezierSamples = generationSettings->bezierTunnelCount * SAMPLES_PER_BEZIER;
+
     // Looping over every density point and calculating the density.
     for (u32 x = 0; x < mapResolution; x++)
     {
@@ -172,59 +425,156 @@ void DensityFuncBezierCurveHole(u32* seed, BezierDensityFuncSettings* generation
             }
         }
     }
+
+	ArenaFreeMarker(global->frameArena, marker);
 }
 
 #define RANDOM_SPHERES_COUNT 1050
-void DensityFuncRandomSpheres(f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth)
+
+typedef struct RandomSpheresDensityData
 {
-    u32 mapHeightTimesDepth = mapHeight * mapDepth;
+    vec3 sphereCenters[RANDOM_SPHERES_COUNT];
+    f32 sphereRadius;
+} RandomSpheresDensityData;
+
+static void RandomSpheresDensity(void* userData, DensityBatch* batch, f32* out_values)
+{
+    RandomSpheresDensityData* data = userData;
+
+    // Find distance to closest sphere
+    _Alignas(32) f32 closestDistances[DENSITY_BATCH_SIZE] = {};
+    for (u32 i = 0; i < RANDOM_SPHERES_COUNT; i++)
+    {
+        vec3 sphereCenter = data->sphereCenters[i];
+        for (u32 lane = 0; lane < DENSITY_BATCH_SIZE; lane++)
+        {
+            f32 deltaX = batch->x[lane] - sphereCenter.x;
+            f32 deltaY = batch->y[lane] - sphereCenter.y;
+            f32 deltaZ = batch->z[lane] - sphereCenter.z;
+            f32 distance = sqrtf(deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ) - data->sphereRadius;
+            closestDistances[lane] = distance <= closestDistances[lane] ? distance : closestDistances[lane];
+        }
+    }
+
+    for (u32 lane = 0; lane < DENSITY_BATCH_SIZE; lane++)
+    {
+        f32 closestDistance = closestDistances[lane];
+        if (closestDistance <= -2)
+            closestDistance = -2;
+
+        // Calculating the density value
+        out_values[lane] = 1 + closestDistance;
+    }
+}
 
+void DensityFuncRandomSpheres(f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth)
+{
     // Spheres for calculating density
     vec3 spheresCenter = vec3_from_float(mapWidth / 2);
     f32 spheresRadius = mapWidth / 8;
-    f32 sphereRadius = 2;
 
     // Generating random positions in a sphere
-    vec3 sphereCenters[RANDOM_SPHERES_COUNT] = {};
+    RandomSpheresDensityData* data = ArenaAlloc(global->frameArena, sizeof(*data));
+    data->sphereRadius = 2;
     u32 seed = 10;
 
     for (u32 i = 0; i < RANDOM_SPHERES_COUNT; i++)
     {
         // vec2 pointOnDisc = RandomPointInUnitDisc(&seed);
         // sphereCenters[i] = vec3_add_vec3(vec3_mul_f32(vec3_create(pointOnDisc.x, 0, pointOnDisc.y), spheresRadius), spheresCenter);
-        sphereCenters[i] = vec3_add_vec3(vec3_mul_f32(RandomPointInUnitSphere(&seed), spheresRadius), spheresCenter);
-        _DEBUG("x: %f, y: %f, z: %f", sphereCenters[i].x, sphereCenters[i].y, sphereCenters[i].z);
+        data->sphereCenters[i] = vec3_add_vec3(vec3_mul_f32(RandomPointInUnitSphere(&seed), spheresRadius), spheresCenter);
+        _DEBUG("x: %f, y: %f, z: %f", data->sphereCenters[i].x, data->sphereCenters[i].y, data->sphereCenters[i].z);
     }
 
-    // Looping over every density point and calculating the density.
-    for (u32 x = 0; x < mapWidth; x++)
+    DensityMapEvaluate(densityMap, mapWidth, mapHeight, mapDepth, nullptr, RandomSpheresDensity, data, nullptr, JobSystemGetThreadCount());
+}
+
+// Range of density values (inclusive) that a sphere edit can change, returns false if the edit doesn't touch the density map
+static inline bool GetSphereEditRange(u32 mapWidth, u32 mapHeight, u32 mapDepth, vec3 center, f32 radius, u32* out_editStart, u32* out_editEnd)
+{
+    f32 centerValues[3] = { center.x, center.y, center.z };
+    u32 mapSizes[3] = { mapWidth, mapHeight, mapDepth };
+
+    // Values further than radius + 1 from the center are clamped to the [-1, 1] range of the map anyway, so they can't change
+    for (u32 axis = 0; axis < 3; axis++)
     {
-        for (u32 y = 0; y < mapHeight; y++)
+        f32 start = floorf(centerValues[axis] - radius - 1);
+        f32 end = ceilf(centerValues[axis] + radius + 1);
+        if (end < 1 || start > mapSizes[axis] - 2)
+            return false;
+        out_editStart[axis] = start < 1 ? 1 : (u32)start;
+        out_editEnd[axis] = end > mapSizes[axis] - 2 ? mapSizes[axis] - 2 : (u32)end;
+    }
+
+    return true;
+}
+
+// Applies a sphere edit to the values editStart up to and including editEnd. The density map can be a box of a larger map,
+// origin is the position of the first value of the box in the larger map (the edit range and the center are in the larger map).
+static void EditSphereValues(f32* densityMap, u32 mapHeight, u32 mapDepth, u32* origin, u32* editStart, u32* editEnd, vec3 center, f32 radius, bool fill)
+{
+    u32 mapHeightTimesDepth = mapHeight * mapDepth;
+
+    for (u32 x = editStart[0]; x <= editEnd[0]; x++)
+    {
+        for (u32 y = editStart[1]; y <= editEnd[1]; y++)
         {
-            for (u32 z = 0; z < mapDepth; z++)
+            for (u32 z = editStart[2]; z <= editEnd[2]; z++)
             {
-                // Find distance to closest sphere
-                f32 closestDistance = 0;
-                for (u32 i = 0; i < RANDOM_SPHERES_COUNT; i++)
+                f32* value = GetDensityValueRef(densityMap, mapHeightTimesDepth, mapDepth, x - origin[0], y - origin[1], z - origin[2]);
+                f32 distance = vec3_distance(vec3_create(x, y, z), center);
+
+                // Inside the sphere the edit value is positive when digging (outside the contour) and negative when filling (inside the contour)
+                if (fill)
                 {
-                    f32 distance = vec3_distance(vec3_create(x, y, z), sphereCenters[i]) - sphereRadius;
-                    if (distance <= closestDistance)
-                    {
-                        closestDistance = distance;
-                    }
+                    f32 editValue = distance - radius;
+                    editValue = editValue < -1 ? -1 : editValue;
+                    *value = editValue < *value ? editValue : *value;
+                }
+                else
+                {
+                    f32 editValue = radius - distance;
+                    editValue = editValue > 1 ? 1 : editValue;
+                    *value = editValue > *value ? editValue : *value;
                 }
-
-                if (closestDistance <= -2)
-                    closestDistance = -2;
-
-                // Calculating the density value
-                *GetDensityValueRef(densityMap, mapHeightTimesDepth, mapDepth, x, y, z) = 1 + closestDistance;
             }
         }
     }
 }
 
-void BlurDensityMapGaussian(u32 iterations, u32 kernelSize, f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth)
+bool DensityMapEditSphere(f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth, vec3 center, f32 radius, bool fill, u32* out_editStart, u32* out_editEnd)
+{
+    if (!GetSphereEditRange(mapWidth, mapHeight, mapDepth, center, radius, out_editStart, out_editEnd))
+        return false;
+
+    u32 origin[3] = { 0, 0, 0 };
+    EditSphereValues(densityMap, mapHeight, mapDepth, origin, out_editStart, out_editEnd, center, radius, fill);
+
+    return true;
+}
+
+bool DensityMapEditSphereQuantized(QuantizedDensityMap* densityMap, vec3 center, f32 radius, bool fill, u32* out_editStart, u32* out_editEnd)
+{
+    if (!GetSphereEditRange(densityMap->mapWidth, densityMap->mapHeight, densityMap->mapDepth, center, radius, out_editStart, out_editEnd))
+        return false;
+
+    ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+    // Dequantizing the edited values, editing them and quantizing them again
+    DensityMapBox box = { out_editStart[0], out_editStart[1], out_editStart[2], out_editEnd[0] + 1, out_editEnd[1] + 1, out_editEnd[2] + 1 };
+    f32* boxValues = ArenaAlloc(global->frameArena, sizeof(*boxValues) * (box.endX - box.startX) * (box.endY - box.startY) * (box.endZ - box.startZ));
+    QuantizedDensityMapDecodeBox(densityMap, &box, boxValues);
+
+    EditSphereValues(boxValues, box.endY - box.startY, box.endZ - box.startZ, out_editStart, out_editStart, out_editEnd, center, radius, fill);
+
+    QuantizedDensityMapEncodeBox(densityMap, &box, boxValues);
+
+    ArenaFreeMarker(global->frameArena, marker);
+
+    return true;
+}
+
+void BlurDensityMapGaussianReference(u32 iterations, u32 kernelSize, f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth, bool skipUniformBricks)
 {
 	ArenaMarker marker = ArenaGetMarker(global->frameArena);
 
@@ -275,15 +625,37 @@ void BlurDensityMapGaussian(u32 iterations, u32 kernelSize, f32* densityMap, u32
     densityMap = ArenaAlloc(global->frameArena, densityMapValueCount * sizeof(*densityMap));
 	MemoryCopy(densityMap, nonBlurredDensityMap, densityMapValueCount * sizeof(*densityMap));
 
+	// Bricks in uniform areas of the density map don't change when blurred, so they can be skipped
+	DensityBrickMap brickMap = {};
+	bool* uniformBricks = nullptr;
+	if (skipUniformBricks)
+	{
+		GRASSERT_DEBUG(padding <= DENSITY_BRICK_SIZE);
+		brickMap = DensityBrickMapCreate(global->gameAllocator, mapWidth, mapHeight, mapDepth);
+		uniformBricks = ArenaAlloc(global->frameArena, sizeof(*uniformBricks) * brickMap.brickCountX * brickMap.brickCountY * brickMap.brickCountZ);
+	}
+
     // Looping over every kernel sized area in the density map
     for (u32 i = 0; i < iterations; i++)
     {
+		if (skipUniformBricks)
+		{
+			DensityBrickMapUpdate(&brickMap, nonBlurredDensityMap);
+			DensityBrickMapGetUniformNeighbourhoods(&brickMap, uniformBricks);
+		}
+
         for (u32 x = padding; x < mapWidth - padding; x++)
         {
             for (u32 y = padding; y < mapHeight - padding; y++)
             {
                 for (u32 z = padding; z < mapDepth - padding; z++)
                 {
+					if (skipUniformBricks && uniformBricks[DensityBrickMapGetBrickIndex(&brickMap, x / DENSITY_BRICK_SIZE, y / DENSITY_BRICK_SIZE, z / DENSITY_BRICK_SIZE)])
+					{
+						*GetDensityValueRef(densityMap, densityMapHeightTimesDepth, mapDepth, x, y, z) = GetDensityValueRaw(nonBlurredDensityMap, densityMapHeightTimesDepth, mapDepth, x, y, z);
+						continue;
+					}
+
                     f32 sum = 0;
 
                     // Looping over the kernel and multiplying each element of the kernel with its respective element of the kernel sized area in the density map
@@ -321,11 +693,411 @@ void BlurDensityMapGaussian(u32 iterations, u32 kernelSize, f32* densityMap, u32
 		MemoryCopy(originalDensityMap, densityMap, densityMapValueCount * sizeof(*densityMap));
 	}
 
+	if (skipUniformBricks)
+		DensityBrickMapDestroy(global->gameAllocator, &brickMap);
+
 	// "Freeing" the kernel and temp density map because these allocations can be quite large
 	ArenaFreeMarker(global->frameArena, marker);
 }
 
-void BlurDensityMapBokeh(u32 iterations, u32 kernelSize, f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth)
+// ================================== Separable gaussian blur ==================================
+// Writes out[i] = sum of weights[k] * sourceRows[k][i] over the kernel for every i from start up to end.
+// The source rows are offset by the caller so that sourceRows[k][i] is the k'th value under the kernel centered on i.
+static inline void BlurRow(f32** sourceRows, f32* weights, u32 kernelSize, u32 start, u32 end, f32* out)
+{
+	u32 i = start;
+
+	// Multiplying and adding separately (no fma) so the vectorized part gives exactly the same result as the scalar tail
+#if defined(__AVX2__)
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256 sum = _mm256_setzero_ps();
+		for (u32 k = 0; k < kernelSize; k++)
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(sourceRows[k] + i)));
+		_mm256_storeu_ps(out + i, sum);
+	}
+#elif defined(__SSE2__)
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 sum = _mm_setzero_ps();
+		for (u32 k = 0; k < kernelSize; k++)
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(sourceRows[k] + i)));
+		_mm_storeu_ps(out + i, sum);
+	}
+#endif
+
+	for (; i < end; i++)
+	{
+		f32 sum = 0;
+		for (u32 k = 0; k < kernelSize; k++)
+			sum += weights[k] * sourceRows[k][i];
+		out[i] = sum;
+	}
+}
+
+// The reference kernel (one plus the maximum squared distance from the center minus the squared distance from the center) isn't separable.
+// The 1D weights are the marginal of the reference kernel along one axis, so the blur has the same variance along every axis as the reference blur.
+static void GetSeparableBlurWeights(u32 kernelSize, f32* out_weights)
+{
+	f32 kernelCenter = (kernelSize - 1) / 2;
+	f32 maximumEuclideanDistanceSquaredPlusOne = 1 + 3 * kernelCenter * kernelCenter;
+	f32 kernelTotal = 0;
+	for (u32 x = 0; x < kernelSize; x++)
+	{
+		out_weights[x] = 0;
+		for (u32 y = 0; y < kernelSize; y++)
+		{
+			for (u32 z = 0; z < kernelSize; z++)
+				out_weights[x] += maximumEuclideanDistanceSquaredPlusOne - vec3_distance_squared(vec3_from_float(kernelCenter), vec3_create(x, y, z));
+		}
+		kernelTotal += out_weights[x];
+	}
+	for (u32 x = 0; x < kernelSize; x++)
+		out_weights[x] /= kernelTotal;
+}
+
+typedef struct SeparableBlurJobData
+{
+	f32* densityMap;
+	f32* tempDensityMap;			// Holds the result of the x pass, nullptr if the result is quantized
+	QuantizedDensityMap quantizedTempDensityMap;	// Holds the result of the x pass if the intermediate format isn't f32
+	f32* xPassRowScratch;			// One row for every x pass job, holds the blurred row before it gets quantized
+	f32* slabSliceScratch;			// One slice (mapHeight * mapDepth values) for every slab, holds the result of the y pass of the slice that is being blurred
+	f32* slabDecodedSliceScratch;	// One slice for every slab, holds the dequantized x pass result of the slice that is being blurred
+	f32* weights;
+	DensityBrickMap* brickMap;
+	bool* uniformBricks;			// nullptr if uniform bricks aren't skipped
+	u32 kernelSize;
+	u32 padding;
+	u32 mapWidth;
+	u32 mapHeight;
+	u32 mapDepth;
+	u32 slabWidth;					// Amount of slices in every slab of the y and z pass (the last slab can be smaller)
+} SeparableBlurJobData;
+
+// Blurs slice x = padding + jobIndex of the density map along x into the temp density map, every row of the slice is blurred because the y pass needs them
+static void SeparableBlurXPassJob(void* data, u32 jobIndex)
+{
+	SeparableBlurJobData* jobData = data;
+	u32 mapHeightTimesDepth = jobData->mapHeight * jobData->mapDepth;
+	u32 x = jobData->padding + jobIndex;
+
+	f32* sourceRows[MAX_BLUR_KERNEL_SIZE];
+	for (u32 y = 0; y < jobData->mapHeight; y++)
+	{
+		for (u32 k = 0; k < jobData->kernelSize; k++)
+			sourceRows[k] = jobData->densityMap + (x + k - jobData->padding) * mapHeightTimesDepth + y * jobData->mapDepth;
+
+		if (jobData->tempDensityMap)
+		{
+			BlurRow(sourceRows, jobData->weights, jobData->kernelSize, 0, jobData->mapDepth, jobData->tempDensityMap + x * mapHeightTimesDepth + y * jobData->mapDepth);
+			continue;
+		}
+
+		f32* row = jobData->xPassRowScratch + jobIndex * jobData->mapDepth;
+		BlurRow(sourceRows, jobData->weights, jobData->kernelSize, 0, jobData->mapDepth, row);
+		QuantizedDensityMapEncodeRow(&jobData->quantizedTempDensityMap, x, y, 0, jobData->mapDepth, row);
+	}
+}
+
+// Blurs the slices of a slab along y into the scratch slice of the slab, and then along z back into the density map.
+// Only the inner values of the density map are written, so the values within padding of the sides keep their original value like in the reference blur.
+static void SeparableBlurYZPassJob(void* data, u32 slabIndex)
+{
+	SeparableBlurJobData* jobData = data;
+	u32 mapHeightTimesDepth = jobData->mapHeight * jobData->mapDepth;
+	u32 padding = jobData->padding;
+	f32* scratch = jobData->slabSliceScratch + slabIndex * mapHeightTimesDepth;
+
+	u32 xStart = padding + slabIndex * jobData->slabWidth;
+	u32 xEnd = xStart + jobData->slabWidth;
+	if (xEnd > jobData->mapWidth - padding)
+		xEnd = jobData->mapWidth - padding;
+
+	f32* sourceRows[MAX_BLUR_KERNEL_SIZE];
+	for (u32 x = xStart; x < xEnd; x++)
+	{
+		f32* tempSlice;
+		if (jobData->tempDensityMap)
+			tempSlice = jobData->tempDensityMap + x * mapHeightTimesDepth;
+		else
+		{
+			// Dequantizing the whole slice once, the y pass reads every row of it kernelSize times
+			tempSlice = jobData->slabDecodedSliceScratch + slabIndex * mapHeightTimesDepth;
+			DensityMapBox slice = { x, 0, 0, x + 1, jobData->mapHeight, jobData->mapDepth };
+			QuantizedDensityMapDecodeBox(&jobData->quantizedTempDensityMap, &slice, tempSlice);
+		}
+		for (u32 y = padding; y < jobData->mapHeight - padding; y++)
+		{
+			for (u32 k = 0; k < jobData->kernelSize; k++)
+				sourceRows[k] = tempSlice + (y + k - padding) * jobData->mapDepth;
+			BlurRow(sourceRows, jobData->weights, jobData->kernelSize, 0, jobData->mapDepth, scratch + y * jobData->mapDepth);
+		}
+
+		for (u32 y = padding; y < jobData->mapHeight - padding; y++)
+		{
+			for (u32 k = 0; k < jobData->kernelSize; k++)
+				sourceRows[k] = scratch + y * jobData->mapDepth + k - padding;
+			f32* outRow = jobData->densityMap + x * mapHeightTimesDepth + y * jobData->mapDepth;
+
+			if (jobData->uniformBricks == nullptr)
+			{
+				BlurRow(sourceRows, jobData->weights, jobData->kernelSize, padding, jobData->mapDepth - padding, outRow);
+				continue;
+			}
+
+			// Values in bricks surrounded by a uniform area don't change, so only the runs of other bricks are written
+			DensityBrickMap* brickMap = jobData->brickMap;
+			u32 firstBrickIndex = DensityBrickMapGetBrickIndex(brickMap, x / DENSITY_BRICK_SIZE, y / DENSITY_BRICK_SIZE, 0);
+			u32 brickZ = 0;
+			while (brickZ < brickMap->brickCountZ)
+			{
+				if (jobData->uniformBricks[firstBrickIndex + brickZ])
+				{
+					brickZ++;
+					continue;
+				}
+
+				u32 runStart = brickZ;
+				while (brickZ < brickMap->brickCountZ && !jobData->uniformBricks[firstBrickIndex + brickZ])
+					brickZ++;
+
+				u32 zStart = runStart * DENSITY_BRICK_SIZE;
+				u32 zEnd = brickZ * DENSITY_BRICK_SIZE;
+				zStart = zStart < padding ? padding : zStart;
+				zEnd = zEnd > jobData->mapDepth - padding ? jobData->mapDepth - padding : zEnd;
+				if (zStart < zEnd)
+					BlurRow(sourceRows, jobData->weights, jobData->kernelSize, zStart, zEnd, outRow);
+			}
+		}
+	}
+}
+
+void BlurDensityMapGaussian(u32 iterations, u32 kernelSize, f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth, bool skipUniformBricks, DensityMapFormat intermediateFormat, u32 maxThreadCount)
+{
+	GRASSERT_DEBUG(kernelSize & 1);
+	GRASSERT_DEBUG(kernelSize <= MAX_BLUR_KERNEL_SIZE);
+
+	u32 padding = (kernelSize - 1) / 2;
+	if (iterations == 0 || mapWidth <= padding * 2 || mapHeight <= padding * 2 || mapDepth <= padding * 2)
+		return;
+
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	u32 densityMapHeightTimesDepth = mapHeight * mapDepth;
+	u32 densityMapValueCount = mapWidth * densityMapHeightTimesDepth;
+
+	f32 weights[MAX_BLUR_KERNEL_SIZE];
+	GetSeparableBlurWeights(kernelSize, weights);
+
+	u32 innerWidth = mapWidth - padding * 2;
+	u32 slabCount = maxThreadCount < innerWidth ? maxThreadCount : innerWidth;
+
+	SeparableBlurJobData jobData = {};
+	jobData.densityMap = densityMap;
+	jobData.weights = weights;
+	jobData.kernelSize = kernelSize;
+	jobData.padding = padding;
+	jobData.mapWidth = mapWidth;
+	jobData.mapHeight = mapHeight;
+	jobData.mapDepth = mapDepth;
+	jobData.slabWidth = (innerWidth + slabCount - 1) / slabCount;
+	slabCount = (innerWidth + jobData.slabWidth - 1) / jobData.slabWidth;
+
+	// Second half of the double buffer, the y and z passes write back into the density map so no copy is needed at the end
+	if (intermediateFormat == DENSITY_MAP_FORMAT_F32)
+		jobData.tempDensityMap = ArenaAlloc(global->frameArena, densityMapValueCount * sizeof(*densityMap));
+	else
+	{
+		// The blurred values are weighted averages, so they stay within the range of the values before the first iteration
+		f32 minValue;
+		f32 maxValue;
+		DensityMapGetRange(densityMap, densityMapValueCount, &minValue, &maxValue);
+		minValue = minValue > 0 ? 0 : minValue;
+		maxValue = maxValue < 0 ? 0 : maxValue;
+		jobData.quantizedTempDensityMap = QuantizedDensityMapCreateInArena(global->frameArena, intermediateFormat, mapWidth, mapHeight, mapDepth, minValue, maxValue);
+		jobData.xPassRowScratch = ArenaAlloc(global->frameArena, innerWidth * mapDepth * sizeof(*densityMap));
+		jobData.slabDecodedSliceScratch = ArenaAlloc(global->frameArena, slabCount * densityMapHeightTimesDepth * sizeof(*densityMap));
+	}
+	jobData.slabSliceScratch = ArenaAlloc(global->frameArena, slabCount * densityMapHeightTimesDepth * sizeof(*densityMap));
+
+	// Bricks in uniform areas of the density map don't change when blurred, so they can be skipped
+	DensityBrickMap brickMap = {};
+	if (skipUniformBricks)
+	{
+		GRASSERT_DEBUG(padding <= DENSITY_BRICK_SIZE);
+		brickMap = DensityBrickMapCreate(global->gameAllocator, mapWidth, mapHeight, mapDepth);
+		jobData.brickMap = &brickMap;
+		jobData.uniformBricks = ArenaAlloc(global->frameArena, sizeof(*jobData.uniformBricks) * brickMap.brickCountX * brickMap.brickCountY * brickMap.brickCountZ);
+	}
+
+	for (u32 i = 0; i < iterations; i++)
+	{
+		if (skipUniformBricks)
+		{
+			DensityBrickMapUpdate(&brickMap, densityMap);
+			DensityBrickMapGetUniformNeighbourhoods(&brickMap, jobData.uniformBricks);
+		}
+
+		// The x pass reads the neighbouring slices of the density map, so it has to be done before the y and z passes start writing to it
+		JobSystemParallelFor(SeparableBlurXPassJob, &jobData, innerWidth, maxThreadCount);
+		JobSystemParallelFor(SeparableBlurYZPassJob, &jobData, slabCount, maxThreadCount);
+	}
+
+	if (skipUniformBricks)
+		DensityBrickMapDestroy(global->gameAllocator, &brickMap);
+
+	// "Freeing" the temp density map and the scratch slices because these allocations can be quite large
+	ArenaFreeMarker(global->frameArena, marker);
+}
+
+// ================================== Tiled separable gaussian blur ==================================
+// Blurs a bricked density map one column of tiles (all tiles with the same tile x and y) at a time. The values of the column and the values within padding around it
+// along x and y are gathered into a block, which is blurred with the same three 1D passes as BlurDensityMapGaussian. The block is a few hundred KiB at most,
+// so the passes work in the L2 cache instead of streaming whole slices, and the gathered rows are long enough to stay vectorized.
+
+// Largest amount of values along x and y that a column needs, the tile plus padding on both sides
+#define TILE_BLUR_BLOCK_SIZE (DENSITY_TILE_SIZE + MAX_BLUR_KERNEL_SIZE - 1)
+
+typedef struct TiledBlurJobData
+{
+	BrickedDensityMap* sourceMap;
+	BrickedDensityMap* destinationMap;
+	f32* slabScratch;				// For every slab: the gathered block, the result of the x pass, the result of the y pass and one output row
+	u64 slabScratchValueCount;
+	f32* weights;
+	u32 kernelSize;
+	u32 padding;
+	u32 slabWidth;					// Amount of tile layers along x in every slab (the last slab can be smaller)
+} TiledBlurJobData;
+
+// Blurs the columns of tiles in the tile layers of the slab from the source map into the destination map
+static void TiledBlurJob(void* data, u32 slabIndex)
+{
+	TiledBlurJobData* jobData = data;
+	BrickedDensityMap* sourceMap = jobData->sourceMap;
+	BrickedDensityMap* destinationMap = jobData->destinationMap;
+	u32 padding = jobData->padding;
+	u32 mapDepth = sourceMap->mapDepth;
+	f32* block = jobData->slabScratch + slabIndex * jobData->slabScratchValueCount;
+	f32* xPassBlock = block + TILE_BLUR_BLOCK_SIZE * TILE_BLUR_BLOCK_SIZE * mapDepth;
+	f32* yPassBlock = xPassBlock + DENSITY_TILE_SIZE * TILE_BLUR_BLOCK_SIZE * mapDepth;
+	f32* outRow = yPassBlock + DENSITY_TILE_SIZE * DENSITY_TILE_SIZE * mapDepth;
+
+	// Only the inner values of the map are blurred, the values within padding of the sides keep their original value like in the reference blur
+	u32 innerEndX = sourceMap->mapWidth - padding;
+	u32 innerEndY = sourceMap->mapHeight - padding;
+
+	u32 tileXStart = slabIndex * jobData->slabWidth;
+	u32 tileXEnd = tileXStart + jobData->slabWidth < sourceMap->tileCountX ? tileXStart + jobData->slabWidth : sourceMap->tileCountX;
+
+	f32* sourceRows[MAX_BLUR_KERNEL_SIZE];
+	for (u32 tileX = tileXStart; tileX < tileXEnd; tileX++)
+	{
+		for (u32 tileY = 0; tileY < sourceMap->tileCountY; tileY++)
+		{
+			// Values of the tiles [start, end), of the block around them [blockStart, blockEnd) and the blurred values [innerStart, innerEnd) along x and y
+			u32 startX = tileX * DENSITY_TILE_SIZE;
+			u32 startY = tileY * DENSITY_TILE_SIZE;
+			u32 endX = startX + DENSITY_TILE_SIZE < sourceMap->mapWidth ? startX + DENSITY_TILE_SIZE : sourceMap->mapWidth;
+			u32 endY = startY + DENSITY_TILE_SIZE < sourceMap->mapHeight ? startY + DENSITY_TILE_SIZE : sourceMap->mapHeight;
+			u32 blockStartX = startX < padding ? 0 : startX - padding;
+			u32 blockStartY = startY < padding ? 0 : startY - padding;
+			u32 blockEndX = endX + padding < sourceMap->mapWidth ? endX + padding : sourceMap->mapWidth;
+			u32 blockEndY = endY + padding < sourceMap->mapHeight ? endY + padding : sourceMap->mapHeight;
+			u32 innerStartX = startX < padding ? padding : startX;
+			u32 innerStartY = startY < padding ? padding : startY;
+			u32 tileInnerEndX = endX < innerEndX ? endX : innerEndX;
+			u32 tileInnerEndY = endY < innerEndY ? endY : innerEndY;
+			u32 blockHeight = blockEndY - blockStartY;
+
+			DensityMapBox blockBox = { blockStartX, blockStartY, 0, blockEndX, blockEndY, mapDepth };
+			BrickedDensityMapDecodeBox(sourceMap, &blockBox, block);
+
+			// x pass over every row of the block in the blurred x range, the y pass needs all of them
+			for (u32 x = innerStartX; x < tileInnerEndX; x++)
+			{
+				for (u32 y = blockStartY; y < blockEndY; y++)
+				{
+					for (u32 k = 0; k < jobData->kernelSize; k++)
+						sourceRows[k] = block + ((u64)(x + k - padding - blockStartX) * blockHeight + y - blockStartY) * mapDepth;
+					BlurRow(sourceRows, jobData->weights, jobData->kernelSize, 0, mapDepth, xPassBlock + ((u64)(x - startX) * blockHeight + y - blockStartY) * mapDepth);
+				}
+			}
+
+			// y pass over the blurred x and y range, every z because the z pass needs them
+			for (u32 x = innerStartX; x < tileInnerEndX; x++)
+			{
+				for (u32 y = innerStartY; y < tileInnerEndY; y++)
+				{
+					for (u32 k = 0; k < jobData->kernelSize; k++)
+						sourceRows[k] = xPassBlock + ((u64)(x - startX) * blockHeight + y + k - padding - blockStartY) * mapDepth;
+					BlurRow(sourceRows, jobData->weights, jobData->kernelSize, 0, mapDepth, yPassBlock + ((u64)(x - startX) * DENSITY_TILE_SIZE + y - startY) * mapDepth);
+				}
+			}
+
+			// z pass, every row of the tiles gets written once with the original values on the sides of the map
+			for (u32 x = startX; x < endX; x++)
+			{
+				for (u32 y = startY; y < endY; y++)
+				{
+					MemoryCopy(outRow, block + ((u64)(x - blockStartX) * blockHeight + y - blockStartY) * mapDepth, sizeof(*outRow) * mapDepth);
+					if (x >= innerStartX && x < tileInnerEndX && y >= innerStartY && y < tileInnerEndY)
+					{
+						f32* yPassRow = yPassBlock + ((u64)(x - startX) * DENSITY_TILE_SIZE + y - startY) * mapDepth;
+						for (u32 k = 0; k < jobData->kernelSize; k++)
+							sourceRows[k] = yPassRow + k - padding;
+						BlurRow(sourceRows, jobData->weights, jobData->kernelSize, padding, mapDepth - padding, outRow);
+					}
+					BrickedDensityMapEncodeRow(destinationMap, x, y, 0, mapDepth, outRow);
+				}
+			}
+		}
+	}
+}
+
+void BlurDensityMapGaussianBricked(u32 iterations, u32 kernelSize, BrickedDensityMap* densityMap, u32 maxThreadCount)
+{
+	GRASSERT_DEBUG(kernelSize & 1);
+	GRASSERT_DEBUG(kernelSize <= MAX_BLUR_KERNEL_SIZE);
+
+	u32 padding = (kernelSize - 1) / 2;
+	if (iterations == 0 || densityMap->mapWidth <= padding * 2 || densityMap->mapHeight <= padding * 2 || densityMap->mapDepth <= padding * 2)
+		return;
+
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	f32 weights[MAX_BLUR_KERNEL_SIZE];
+	GetSeparableBlurWeights(kernelSize, weights);
+
+	u32 slabCount = maxThreadCount < densityMap->tileCountX ? maxThreadCount : densityMap->tileCountX;
+
+	TiledBlurJobData jobData = {};
+	jobData.weights = weights;
+	jobData.kernelSize = kernelSize;
+	jobData.padding = padding;
+	jobData.slabWidth = (densityMap->tileCountX + slabCount - 1) / slabCount;
+	slabCount = (densityMap->tileCountX + jobData.slabWidth - 1) / jobData.slabWidth;
+	jobData.slabScratchValueCount = (u64)(TILE_BLUR_BLOCK_SIZE * TILE_BLUR_BLOCK_SIZE + DENSITY_TILE_SIZE * TILE_BLUR_BLOCK_SIZE + DENSITY_TILE_SIZE * DENSITY_TILE_SIZE + 1) * densityMap->mapDepth;
+	jobData.slabScratch = ArenaAlloc(global->frameArena, sizeof(*jobData.slabScratch) * jobData.slabScratchValueCount * slabCount);
+
+	// Every iteration reads one map and writes the other, starting with the density map as the source
+	BrickedDensityMap tempDensityMap = BrickedDensityMapCreateInArena(global->frameArena, densityMap->mapWidth, densityMap->mapHeight, densityMap->mapDepth);
+	for (u32 i = 0; i < iterations; i++)
+	{
+		jobData.sourceMap = i & 1 ? &tempDensityMap : densityMap;
+		jobData.destinationMap = i & 1 ? densityMap : &tempDensityMap;
+		JobSystemParallelFor(TiledBlurJob, &jobData, slabCount, maxThreadCount);
+	}
+
+	if (iterations & 1)
+		MemoryCopy(densityMap->values, tempDensityMap.values, sizeof(*densityMap->values) * BrickedDensityMapGetValueCount(densityMap));
+
+	// "Freeing" the temp density map and the scratch blocks
+	ArenaFreeMarker(global->frameArena, marker);
+}
+
+void BlurDensityMapBokehReference(u32 iterations, u32 kernelSize, f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth, bool skipUniformBricks)
 {
 	if (iterations == 0)
 		return;
@@ -369,15 +1141,37 @@ void BlurDensityMapBokeh(u32 iterations, u32 kernelSize, f32* densityMap, u32 ma
     densityMap = ArenaAlloc(global->frameArena, densityMapValueCount * sizeof(*densityMap));
 	MemoryCopy(densityMap, nonBlurredDensityMap, densityMapValueCount * sizeof(*densityMap));
 
+	// Bricks in uniform areas of the density map don't change when blurred, so they can be skipped
+	DensityBrickMap brickMap = {};
+	bool* uniformBricks = nullptr;
+	if (skipUniformBricks)
+	{
+		GRASSERT_DEBUG(padding <= DENSITY_BRICK_SIZE);
+		brickMap = DensityBrickMapCreate(global->gameAllocator, mapWidth, mapHeight, mapDepth);
+		uniformBricks = ArenaAlloc(global->frameArena, sizeof(*uniformBricks) * brickMap.brickCountX * brickMap.brickCountY * brickMap.brickCountZ);
+	}
+
     // Looping over every kernel sized area in the density map
     for (u32 i = 0; i < iterations; i++)
     {
+		if (skipUniformBricks)
+		{
+			DensityBrickMapUpdate(&brickMap, nonBlurredDensityMap);
+			DensityBrickMapGetUniformNeighbourhoods(&brickMap, uniformBricks);
+		}
+
         for (u32 x = padding; x < mapWidth - padding; x++)
         {
             for (u32 y = padding; y < mapHeight - padding; y++)
             {
                 for (u32 z = padding; z < mapDepth - padding; z++)
                 {
+					if (skipUniformBricks && uniformBricks[DensityBrickMapGetBrickIndex(&brickMap, x / DENSITY_BRICK_SIZE, y / DENSITY_BRICK_SIZE, z / DENSITY_BRICK_SIZE)])
+					{
+						*GetDensityValueRef(densityMap, densityMapHeightTimesDepth, mapDepth, x, y, z) = GetDensityValueRaw(nonBlurredDensityMap, densityMapHeightTimesDepth, mapDepth, x, y, z);
+						continue;
+					}
+
                     f32 sum = 0;
 
                     // Looping over the kernel and multiplying each element of the kernel with its respective element of the kernel sized area in the density map
@@ -415,8 +1209,114 @@ void BlurDensityMapBokeh(u32 iterations, u32 kernelSize, f32* densityMap, u32 ma
 		MemoryCopy(originalDensityMap, densityMap, densityMapValueCount * sizeof(*densityMap));
 	}
 
+	if (skipUniformBricks)
+		DensityBrickMapDestroy(global->gameAllocator, &brickMap);
+
 	// "Freeing" the kernel and temp density map because these allocations can be quite large
 	ArenaFreeMarker(global->frameArena, marker);
 }
 
 
+
+// ================================== Summed volume table box blur ==================================
+void BlurDensityMapBokeh(u32 iterations, u32 kernelSize, f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth, bool skipUniformBricks)
+{
+	GRASSERT_DEBUG(kernelSize & 1);
+
+	u32 padding = (kernelSize - 1) / 2;
+	if (iterations == 0 || mapWidth <= padding * 2 || mapHeight <= padding * 2 || mapDepth <= padding * 2)
+		return;
+
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	u32 densityMapHeightTimesDepth = mapHeight * mapDepth;
+
+	// Summed volume table, every entry holds the sum of all density values with lower coordinates (so it has one more entry along every axis than the density map).
+	// Doubles keep the sums of large maps exact enough that the difference of two large sums still gives the sum of a small box.
+	u32 tableHeight = mapHeight + 1;
+	u32 tableDepth = mapDepth + 1;
+	u32 tableHeightTimesDepth = tableHeight * tableDepth;
+	f64* table = ArenaAlloc(global->frameArena, sizeof(*table) * (mapWidth + 1) * tableHeightTimesDepth);
+	MemoryZero(table, sizeof(*table) * tableHeightTimesDepth);
+
+	f64 inverseKernelVolume = 1.0 / ((f64)kernelSize * kernelSize * kernelSize);
+
+	// Bricks in uniform areas of the density map don't change when blurred, so they can be skipped
+	DensityBrickMap brickMap = {};
+	bool* uniformBricks = nullptr;
+	if (skipUniformBricks)
+	{
+		GRASSERT_DEBUG(padding <= DENSITY_BRICK_SIZE);
+		brickMap = DensityBrickMapCreate(global->gameAllocator, mapWidth, mapHeight, mapDepth);
+		uniformBricks = ArenaAlloc(global->frameArena, sizeof(*uniformBricks) * brickMap.brickCountX * brickMap.brickCountY * brickMap.brickCountZ);
+	}
+
+	for (u32 i = 0; i < iterations; i++)
+	{
+		if (skipUniformBricks)
+		{
+			DensityBrickMapUpdate(&brickMap, densityMap);
+			DensityBrickMapGetUniformNeighbourhoods(&brickMap, uniformBricks);
+		}
+
+		// Building the table, the sum of a value is the running sum of its row plus the sums of the previous row and slice minus what those two have in common
+		for (u32 x = 0; x < mapWidth; x++)
+		{
+			f64* previousSlice = table + x * tableHeightTimesDepth;
+			f64* slice = previousSlice + tableHeightTimesDepth;
+			MemoryZero(slice, sizeof(*slice) * tableDepth);
+
+			for (u32 y = 0; y < mapHeight; y++)
+			{
+				f32* densityRow = densityMap + x * densityMapHeightTimesDepth + y * mapDepth;
+				f64* row = slice + (y + 1) * tableDepth;
+				f64* previousRow = row - tableDepth;
+				f64* previousSliceRow = previousSlice + (y + 1) * tableDepth;
+				f64* previousSlicePreviousRow = previousSliceRow - tableDepth;
+
+				f64 rowSum = 0;
+				row[0] = 0;
+				for (u32 z = 0; z < mapDepth; z++)
+				{
+					rowSum += densityRow[z];
+					row[z + 1] = rowSum + previousRow[z + 1] + previousSliceRow[z + 1] - previousSlicePreviousRow[z + 1];
+				}
+			}
+		}
+
+		// Every blurred value is the sum of the box around it (eight table lookups) divided by the volume of the box.
+		// The table holds all the values that are needed, so the result is written straight into the density map.
+		for (u32 x = padding; x < mapWidth - padding; x++)
+		{
+			f64* lowSlice = table + (x - padding) * tableHeightTimesDepth;
+			f64* highSlice = table + (x + padding + 1) * tableHeightTimesDepth;
+
+			for (u32 y = padding; y < mapHeight - padding; y++)
+			{
+				f64* lowLow = lowSlice + (y - padding) * tableDepth;
+				f64* lowHigh = lowSlice + (y + padding + 1) * tableDepth;
+				f64* highLow = highSlice + (y - padding) * tableDepth;
+				f64* highHigh = highSlice + (y + padding + 1) * tableDepth;
+				f32* densityRow = densityMap + x * densityMapHeightTimesDepth + y * mapDepth;
+
+				for (u32 z = padding; z < mapDepth - padding; z++)
+				{
+					if (skipUniformBricks && uniformBricks[DensityBrickMapGetBrickIndex(&brickMap, x / DENSITY_BRICK_SIZE, y / DENSITY_BRICK_SIZE, z / DENSITY_BRICK_SIZE)])
+						continue;
+
+					u32 zLow = z - padding;
+					u32 zHigh = z + padding + 1;
+					f64 boxSum = (highHigh[zHigh] - highHigh[zLow] - highLow[zHigh] + highLow[zLow]) -
+								 (lowHigh[zHigh] - lowHigh[zLow] - lowLow[zHigh] + lowLow[zLow]);
+					densityRow[z] = boxSum * inverseKernelVolume;
+				}
+			}
+		}
+	}
+
+	if (skipUniformBricks)
+		DensityBrickMapDestroy(global->gameAllocator, &brickMap);
+
+	// "Freeing" the summed volume table because it is larger than the density map
+	ArenaFreeMarker(global->frameArena, marker);
+}
@@ -4,9 +4,13 @@
 #include "core/meminc.h"
 #include "math/lin_alg.h"
 #include "math/random_utils.h"
+#include "density_brick_map.h"
+#include "quantized_density_map.h"
+#include "bricked_density_map.h"
 
 
 
+// The density functions are evaluated in batches on the job system, see density_evaluation.h
 void DensityFuncSphereHole(f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth);
 
 #define MIN_BEZIER_TUNNEL_COUNT 0
@@ -33,15 +37,44 @@ typedef struct BezierDensityFuncSettings
 } BezierDensityFuncSettings;
 
 
-void DensityFuncBezierCurveHole(u32* seed, BezierDensityFuncSettings* generationSettings, f32* densityMap, u32 mapSize);
+// Only tests the tunnel samples and sphere holes that are within their radius of a density value by bucketing them in a uniform grid.
+// The result is exactly the same as DensityFuncBezierCurveHoleReference, which tests every sample and sphere hole for every density value.
+// narrowBandBrickMap is optional, if given only the values near the surface of the current density map are evaluated (see DensityMapEvaluate).
+void DensityFuncBezierCurveHole(u32* seed, BezierDensityFuncSettings* generationSettings, f32* densityMap, u32 mapSize, DensityBrickMap* narrowBandBrickMap);
+// Same as DensityFuncBezierCurveHole for a cubic density map in the bricked layout, the values are exactly the same
+void DensityFuncBezierCurveHoleBricked(u32* seed, BezierDensityFuncSettings* generationSettings, BrickedDensityMap* densityMap, DensityBrickMap* narrowBandBrickMap);
+void DensityFuncBezierCurveHoleReference(u32* seed, BezierDensityFuncSettings* generationSettings, f32* densityMap, u32 mapSize);
 
 void DensityFuncRandomSpheres(f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth);
 
+// Digs (removes solid) or fills (adds solid) a sphere with its center in density map space, values stay within [-1, 1] so the edit blends with the blurred terrain.
+// The outermost layer of density values is never edited so the contour stays closed. Returns false if the edit didn't touch the density map,
+// otherwise out_editStart and out_editEnd (3 values each) are set to the range of density values (inclusive) that might have changed.
+bool DensityMapEditSphere(f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth, vec3 center, f32 radius, bool fill, u32* out_editStart, u32* out_editEnd);
+// Same as DensityMapEditSphere for a quantized density map, the edited values are dequantized into the frame arena, edited and quantized again
+bool DensityMapEditSphereQuantized(QuantizedDensityMap* densityMap, vec3 center, f32 radius, bool fill, u32* out_editStart, u32* out_editEnd);
+
 
 #define MIN_BLUR_ITERATIONS 0
 #define MAX_BLUR_ITERATIONS 20
 #define POSSIBLE_BLUR_KERNEL_SIZES {3, 5, 7}
 #define POSSIBLE_BLUR_KERNEL_SIZES_COUNT 3
-void BlurDensityMapGaussian(u32 iterations, u32 kernelSize, f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth);
-void BlurDensityMapBokeh(u32 iterations, u32 kernelSize, f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth);
+#define MAX_BLUR_KERNEL_SIZE 7
+#define MIN_BOX_BLUR_RADIUS 1
+#define MAX_BOX_BLUR_RADIUS 16
+// If skipUniformBricks is true, bricks (see density_brick_map.h) that are surrounded by a uniform area of the density map are copied instead of blurred.
+// Blurs with three 1D passes (x, y and z), spread over at most maxThreadCount threads. The 1D kernel is derived from the reference kernel,
+// the result is close to BlurDensityMapGaussianReference but not exactly the same.
+// The result of the x pass is stored in the frame arena in intermediateFormat, a quantized format uses 2-4x less memory for it but adds the quantization error to the result.
+void BlurDensityMapGaussian(u32 iterations, u32 kernelSize, f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth, bool skipUniformBricks, DensityMapFormat intermediateFormat, u32 maxThreadCount);
+// Same blur as BlurDensityMapGaussian without skipping (exactly the same result) for a density map in the bricked layout. Every column of tiles is blurred from a block of
+// the column and its surrounding values along x and y, so the passes work on a few hundred KiB at a time and the only large allocation is a second bricked map in the frame arena.
+void BlurDensityMapGaussianBricked(u32 iterations, u32 kernelSize, BrickedDensityMap* densityMap, u32 maxThreadCount);
+// Convolves the full 3D kernel per value, single threaded and slow. Used to check the output of BlurDensityMapGaussian.
+void BlurDensityMapGaussianReference(u32 iterations, u32 kernelSize, f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth, bool skipUniformBricks);
+// Box blur using a summed volume table, the cost per value doesn't depend on the kernel size so any odd kernel size can be used.
+// The table takes (mapWidth + 1) * (mapHeight + 1) * (mapDepth + 1) doubles of the frame arena.
+void BlurDensityMapBokeh(u32 iterations, u32 kernelSize, f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth, bool skipUniformBricks);
+// Convolves the full box kernel per value, used to check the output of BlurDensityMapBokeh.
+void BlurDensityMapBokehReference(u32 iterations, u32 kernelSize, f32* densityMap, u32 mapWidth, u32 mapHeight, u32 mapDepth, bool skipUniformBricks);
 
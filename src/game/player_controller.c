@@ -4,6 +4,16 @@
 #include "game_rendering.h"
 #include "renderer/camera.h"
 #include "core/engine.h"
+#include "world_generation.h"
+
+// Radius of the sphere (world space) that collides with the terrain when terrain collision is on
+#define PLAYER_COLLISION_RADIUS 1.0f
+// Distance the sphere keeps to the terrain, so rounding never leaves it touching the surface at the start of the next sweep
+#define PLAYER_COLLISION_SKIN_WIDTH 0.01f
+// Every slide along a surface is a sweep, movement that is left after this many contacts (e.g. in a tight corner) is dropped
+#define PLAYER_MAX_SLIDE_ITERATIONS 4
+// Remaining movement shorter than this isn't swept anymore
+#define PLAYER_MIN_MOVE_DISTANCE 0.0001f
 
 typedef struct ControllerState
 {
@@ -15,6 +25,7 @@ typedef struct ControllerState
 	Camera arcballCameraState;
     bool cameraControlActive; // Whether the player can currently control the camera or not.
 	bool controllingArcball;
+	bool terrainCollision; // The free camera collides with the terrain as a sphere and slides along it
     bool controlCameraButtonPressed;
 	bool controlArcballCameraButtonPressed;
 } ControllerState;
@@ -29,6 +40,7 @@ void PlayerControllerInit()
     controllerState->mouseSensitivity = 0.5f;
     controllerState->movementSpeed = 300.f;
 	controllerState->controllingArcball = false;
+	controllerState->terrainCollision = false;
     controllerState->cameraControlActive = true;
     controllerState->controlCameraButtonPressed = false;
 	controllerState->controlArcballCameraButtonPressed = false;
@@ -41,11 +53,39 @@ void PlayerControllerInit()
     DebugUIAddSliderLog(controllerState->controllerSettingMenu, "mouse sensitivity", 10.f, 0.0001f, 0.01f, &controllerState->mouseSensitivity);
     DebugUIAddSliderLog(controllerState->controllerSettingMenu, "move speed", 10.f, 1.f, 1000.f, &controllerState->movementSpeed);
 	DebugUIAddSliderFloat(controllerState->controllerSettingMenu, "Arcball Radius", 10, 200, &controllerState->arcballRadius);
+	DebugUIAddToggleButton(controllerState->controllerSettingMenu, "terrain collision", &controllerState->terrainCollision);
 
 	controllerState->arcballCameraState.position = vec3_create(0, 0, 0);
 	controllerState->arcballCameraState.rotation = vec3_create(0, 0, 0);
 }
 
+// Moves the sphere by movement and returns its new position, the part of the movement into the terrain is replaced by sliding along it (collide and slide)
+static vec3 MoveWithTerrainCollision(vec3 position, vec3 movement)
+{
+	for (u32 i = 0; i < PLAYER_MAX_SLIDE_ITERATIONS; i++)
+	{
+		f32 distance = vec3_magnitude(movement);
+		if (distance < PLAYER_MIN_MOVE_DISTANCE)
+			break;
+
+		vec3 direction = vec3_div_float(movement, distance);
+		SweepHit hit = WorldGenerationSweepSphere(position, PLAYER_COLLISION_RADIUS, direction, distance + PLAYER_COLLISION_SKIN_WIDTH);
+		if (!hit.hit)
+		{
+			position = vec3_add_vec3(position, movement);
+			break;
+		}
+
+		// Moving up to the contact and sliding the rest of the way along the surface
+		f32 moveDistance = hit.hitDistance > PLAYER_COLLISION_SKIN_WIDTH ? hit.hitDistance - PLAYER_COLLISION_SKIN_WIDTH : 0;
+		position = vec3_add_vec3(position, vec3_mul_f32(direction, moveDistance));
+		movement = vec3_mul_f32(direction, distance - moveDistance);
+		movement = vec3_sub_vec3(movement, vec3_mul_f32(hit.contactNormal, vec3_dot(movement, hit.contactNormal)));
+	}
+
+	return position;
+}
+
 void PlayerControllerUpdate()
 {
     Camera* sceneCamera = controllerState->sceneCamera;
@@ -108,7 +148,11 @@ void PlayerControllerUpdate()
             frameMovement.y -= 1;
         if (GetKeyDown(KEY_SPACE))
             frameMovement.y += 1;
-        sceneCamera->position = vec3_add_vec3(sceneCamera->position, vec3_mul_f32(frameMovement, controllerState->movementSpeed * global->deltaTime));
+        frameMovement = vec3_mul_f32(frameMovement, controllerState->movementSpeed * global->deltaTime);
+		if (controllerState->terrainCollision)
+			sceneCamera->position = MoveWithTerrainCollision(sceneCamera->position, frameMovement);
+		else
+			sceneCamera->position = vec3_add_vec3(sceneCamera->position, frameMovement);
     }
 	// Camera movement in case arcball control is enabled
 	else if (controllerState->cameraControlActive && controllerState->controllingArcball)
@@ -71,12 +71,12 @@ void RaycastDemoInit()
 	state.rayVertices[1] = vertex;
 	state.rayOrbPosition = vec3_create(RAY_ORBIT_DISTANCE, 0, 0);
 	state.rayVertices[1].position = state.rayOrbPosition;
-	u32 indices[TRIANGLE_VERTEX_COUNT];	// This array is used to initialize the index buffer of the ray and of the triangle which is why it is size 3
+	u16 indices[TRIANGLE_VERTEX_COUNT];	// This array is used to initialize the index buffer of the ray and of the triangle which is why it is size 3
 	indices[0] = 0;
 	indices[1] = 1;
 	indices[2] = 2;	// Only for triangle IB
 	state.rayMesh.vertexBuffer = VertexBufferCreate(state.rayVertices, sizeof(state.rayVertices));
-	state.rayMesh.indexBuffer = IndexBufferCreate(indices, RAY_VERTEX_COUNT);
+	state.rayMesh.indexBuffer = IndexBufferCreate16(indices, RAY_VERTEX_COUNT);
 	state.movingRayOrb = false;
 
 	// Initializing ray hit indicator
@@ -84,7 +84,7 @@ void RaycastDemoInit()
 	state.triangleVertices[1] = vertex;
 	state.triangleVertices[2] = vertex;
 	state.triangleMesh.vertexBuffer = VertexBufferCreate(state.triangleVertices, sizeof(state.triangleVertices));
-	state.triangleMesh.indexBuffer = IndexBufferCreate(indices, TRIANGLE_VERTEX_COUNT);
+	state.triangleMesh.indexBuffer = IndexBufferCreate16(indices, TRIANGLE_VERTEX_COUNT);
 	CalculateRayMeshIntersect();
 }
 
@@ -233,11 +233,11 @@ void RaycastDemoShutdown()
 
 static inline void CalculateRayMeshIntersect()
 {
-	MeshData colliderMesh = WorldGenerationGetColliderMesh();
 	vec3 origin = state.rayVertices[1].position;
 	vec3 direction = vec3_normalize(vec3_sub_vec3(state.rayVertices[0].position, state.rayVertices[1].position));
-	mat4 model = WorldGenerationGetModelMatrix();
-	RaycastHit hit = RaycastMesh(origin, direction, colliderMesh, model, offsetof(VertexT2, position), offsetof(VertexT2, normal));
+
+	MeshData colliderMesh = {};
+	RaycastHit hit = WorldGenerationRaycast(origin, direction, &colliderMesh);
 
 	state.rayHitting = hit.hit;
 	if (hit.hit)
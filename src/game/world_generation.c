@@ -1,29 +1,111 @@
 #include "world_generation.h"
 
 #include "marching_cubes/marching_cubes.h"
+#include "marching_cubes/density_map_cache.h"
+#include "marching_cubes/density_map_raycast.h"
+#include "renderer/mesh_optimizer.h"
 #include "renderer/ui/debug_ui.h"
 #include "game_rendering.h"
 #include "core/input.h"
-#include "renderer/mesh_optimizer.h"
+#include "renderer/camera.h"
 #include "core/profiler.h"
+#include "core/job_system.h"
+#include "core/logger.h"
+#include "core/platform.h"
+#include "math/random_utils.h"
+#include <float.h>
 
 #define DEFAULT_DENSITY_MAP_RESOLUTION 100
+// Scratch memory of the background generation thread, it takes the place of the frame arena
+#define BACKGROUND_GENERATION_ARENA_SIZE (100 * MiB)
+// Memory of a background generated world on top of its f32 and 16 bit density maps, for the brick map, the chunks and the chunk meshes and bvhs
+#define BACKGROUND_WORLD_ALLOCATOR_HEADROOM (64 * MiB)
+// Density map cache files are kept in this directory (relative to the working directory) up to the size budget
+#define DENSITY_MAP_CACHE_DIRECTORY "density_cache"
+#define DENSITY_MAP_CACHE_SIZE_BUDGET (1 * GiB)
+// Amount of jobs per thread of a world raycast batch, and the least amount of rays in a job
+#define WORLD_RAYCAST_BATCH_JOBS_PER_THREAD 8
+#define WORLD_RAYCAST_BATCH_MIN_JOB_SIZE 64
+// Side length of the packing bounds of the gpu meshes of chunks, they start a cube before the region because surface nets also puts vertices there
+#define WORLD_CHUNK_PACKING_EXTENT (WORLD_CHUNK_SIZE + 1)
+
+// Start value of the FNV-1a hashes that key the generation stages
+#define STAGE_KEY_HASH_START 0xcbf29ce484222325ull
+#define HASH_STAGE_INPUT(hash, value) hash = HashStageInput(hash, &(value), sizeof(value))
+
+// Keys of the stages of the generation pipeline, every key hashes the inputs of its stage and the key of the stage it depends on.
+// The brick map and quantizing are part of the blur stage. The upload stage runs again exactly when the mesh stage does.
+typedef struct WorldGenStageKeys
+{
+	u64 density;					// Seed, bezier settings and resolution
+	u64 blur;						// Blur parameters, brick skipping and density map bits
+	u64 mesh;						// Mesher and mesh optimization
+} WorldGenStageKeys;
+
+// Unblurred density map of the last density stage that ran, regenerating with the same density inputs blurs a copy of it
+// instead of evaluating the density function again
+typedef struct DensityStageCache
+{
+	f32* densityMap;
+	DensityMapCacheFile diskCacheFile;	// Mapped if densityMap was loaded from the disk cache, densityMap points into it and is read only then
+	u32 resolution;
+	u64 key;						// 0 if the density map doesn't hold a finished density stage
+} DensityStageCache;
+
+// A world that is being generated on a separate thread while the current world keeps being drawn and edited.
+// The thread gets its own copy of the engine globals with its own arena and allocator, so nothing it allocates from is used by the main thread.
+// Edits made to the current world during the generation are lost when the new world is swapped in.
+typedef struct BackgroundWorldGeneration
+{
+	GRGlobals globals;
+	Arena arena;
+	World world;
+	WorldGenParameters params;		// Copy of the parameters at the time the generation started
+	WorldGenStageKeys keys;
+	bool densityStageHit;
+	PlatformThread thread;
+	volatile i32 finished;			// Set by the generation thread once the world (without gpu meshes) is complete
+	bool running;
+} BackgroundWorldGeneration;
 
 // World data (meshes and related data)
 static World world;
 static WorldGenParameters worldGenParams;
 static DebugMenu* worldGenParamDebugMenu;
+static BackgroundWorldGeneration backgroundGeneration;
+static DensityStageCache densityStageCache;
 
 
-static inline void GenerateMarchingCubesWorld();
-static inline void DestroyMarchingCubesWorld();
+static void RegenerateWorld(bool background);
+static void ReleaseDensityStageCache();
+static void GenerateMarchingCubesWorld(World* target, WorldGenParameters* params, WorldGenStageKeys keys, bool densityStageHit, bool mainThread);
+static void DestroyMarchingCubesWorld(World* target, bool hasGpuMeshes);
+static void UploadWorldMeshes(World* target);
+static void StartBackgroundWorldGeneration(WorldGenStageKeys keys, bool densityStageHit);
+static void JoinBackgroundWorldGeneration();
+static inline void MeshWorldChunk(World* target, WorldChunk* chunk, bool brickSkipping);
+static inline void UploadWorldChunkMesh(WorldChunk* chunk);
+static inline vec3 GetChunkPackingOrigin(WorldChunk* chunk);
+static inline void DestroyWorldChunkMesh(WorldChunk* chunk, bool hasGpuMesh);
 
 
 void WorldGenerationInit()
 {
 	i64 blurKernelSizeOptions[POSSIBLE_BLUR_KERNEL_SIZES_COUNT] = POSSIBLE_BLUR_KERNEL_SIZES;
 	MemoryCopy(worldGenParams.blurKernelSizeOptions, blurKernelSizeOptions, sizeof(blurKernelSizeOptions));
+	i64 densityMapBitsOptions[POSSIBLE_DENSITY_MAP_BITS_COUNT] = POSSIBLE_DENSITY_MAP_BITS;
+	MemoryCopy(worldGenParams.densityMapBitsOptions, densityMapBitsOptions, sizeof(densityMapBitsOptions));
 	worldGenParams.densityMapResolution = 50;
+	worldGenParams.brickSkipping = true;
+	worldGenParams.referenceBlur = false;
+	worldGenParams.boxBlur = false;
+	worldGenParams.boxBlurRadius = 2;
+	worldGenParams.editRadius = 4;
+	worldGenParams.densityMapBits = 32;
+	worldGenParams.backgroundGeneration = true;
+	worldGenParams.densityMapDiskCache = true;
+	worldGenParams.surfaceNets = false;
+	worldGenParams.optimizeChunkMeshes = true;
 
 	worldGenParamDebugMenu = DebugUICreateMenu("World Gen Parameters", DEBUG_UI_DEFAULT_MENU_GROUP_NAME, 0);
 	DebugUIAddSliderInt(worldGenParamDebugMenu, "Density map resolution", 10, 200, &worldGenParams.densityMapResolution);
@@ -34,23 +116,81 @@ void WorldGenerationInit()
 	DebugUIAddSliderInt(worldGenParamDebugMenu, "Bezier tunnel control points", MIN_BEZIER_TUNNEL_CONTROL_POINTS, MAX_BEZIER_TUNNEL_CONTROL_POINTS, &worldGenParams.bezierDensityFuncSettings.bezierTunnelControlPoints);
 	DebugUIAddSliderInt(worldGenParamDebugMenu, "Sphere hole count", MIN_SPHERE_HOLE_COUNT, MAX_SPHERE_HOLE_COUNT, &worldGenParams.bezierDensityFuncSettings.sphereHoleCount);
 	DebugUIAddSliderFloat(worldGenParamDebugMenu, "Sphere hole radius", MIN_SPHERE_HOLE_RADIUS, MAX_SPHERE_HOLE_RADIUS, &worldGenParams.bezierDensityFuncSettings.sphereHoleRadius);
+	DebugUIAddToggleButton(worldGenParamDebugMenu, "Brick skipping", &worldGenParams.brickSkipping);
+	DebugUIAddToggleButton(worldGenParamDebugMenu, "Reference blur kernel (slow)", &worldGenParams.referenceBlur);
+	DebugUIAddToggleButton(worldGenParamDebugMenu, "Box blur (any radius)", &worldGenParams.boxBlur);
+	DebugUIAddSliderInt(worldGenParamDebugMenu, "Box blur radius", MIN_BOX_BLUR_RADIUS, MAX_BOX_BLUR_RADIUS, &worldGenParams.boxBlurRadius);
+	DebugUIAddSliderFloat(worldGenParamDebugMenu, "Edit radius (middle mouse, shift fills)", MIN_SPHERE_HOLE_RADIUS, MAX_SPHERE_HOLE_RADIUS, &worldGenParams.editRadius);
+	DebugUIAddSliderDiscrete(worldGenParamDebugMenu, "Density map bits", worldGenParams.densityMapBitsOptions, POSSIBLE_DENSITY_MAP_BITS_COUNT, &worldGenParams.densityMapBits);
+	DebugUIAddToggleButton(worldGenParamDebugMenu, "Generate in background", &worldGenParams.backgroundGeneration);
+	DebugUIAddToggleButton(worldGenParamDebugMenu, "Density map disk cache", &worldGenParams.densityMapDiskCache);
+	DebugUIAddToggleButton(worldGenParamDebugMenu, "Surface nets mesher (fewer triangles)", &worldGenParams.surfaceNets);
+	DebugUIAddToggleButton(worldGenParamDebugMenu, "Optimize chunk meshes (vertex cache, overdraw)", &worldGenParams.optimizeChunkMeshes);
 
-	// Generating marching cubes terrain
-	world.terrainSeed = 0;
-	GenerateMarchingCubesWorld();
+	// Generating marching cubes terrain, the first world is generated right away because there is nothing to draw until then
+	worldGenParams.terrainSeed = 0;
+	RegenerateWorld(false);
 }
 
 void WorldGenerationUpdate()
 {
-	if (GetButtonDown(BUTTON_RIGHTMOUSEBTN) && !GetButtonDownPrevious(BUTTON_RIGHTMOUSEBTN))
+	// Swapping in the background generated world, uploading its meshes is the only work left for the main thread.
+	// The buffers of the old world are destroyed through the deferred destruction queue, so the frames in flight can still draw them.
+	if (backgroundGeneration.running && PlatformAtomicAdd(&backgroundGeneration.finished, 0) != 0)
 	{
-		START_SCOPE("Destroy marching cubes world");
-		DestroyMarchingCubesWorld();
-		END_SCOPE();
-		START_SCOPE("Create marching cubes world");
-		GenerateMarchingCubesWorld();
+		START_SCOPE("Swap in background generated world");
+		JoinBackgroundWorldGeneration();
+		UploadWorldMeshes(&backgroundGeneration.world);
+		DestroyMarchingCubesWorld(&world, true);
+		world = backgroundGeneration.world;
 		END_SCOPE();
 	}
+
+	// Regenerating with the current parameters, with shift held a new seed is picked first.
+	// Regenerating is ignored while a background generation is still running.
+	if (GetButtonDown(BUTTON_RIGHTMOUSEBTN) && !GetButtonDownPrevious(BUTTON_RIGHTMOUSEBTN) && !backgroundGeneration.running)
+	{
+		if (GetKeyDown(KEY_SHIFT))
+			worldGenParams.terrainSeed = PCG_Hash(worldGenParams.terrainSeed);
+		RegenerateWorld(worldGenParams.backgroundGeneration);
+	}
+
+	// Digging into (or filling with shift held) the terrain where the cursor points
+	if (GetButtonDown(BUTTON_MIDMOUSEBTN) && !GetButtonDownPrevious(BUTTON_MIDMOUSEBTN) && !DebugUIGetInputConsumed())
+	{
+		Camera* sceneCamera = GetGameCameras().sceneCamera;
+		CameraRecalculateInverseViewProjection(sceneCamera);
+		vec4 mouseWorldPos = CameraScreenToWorldSpace(sceneCamera, vec2_create(GetMousePos().x, GetMousePos().y));
+		vec3 rayOrigin = sceneCamera->position;
+		vec3 rayDirection = vec3_normalize(vec3_sub_vec3(vec3_create(mouseWorldPos.x, mouseWorldPos.y, mouseWorldPos.z), rayOrigin));
+
+		// Edits only change the density map, so it is raycast directly
+		RaycastHit hit = WorldGenerationRaycastDensity(rayOrigin, rayDirection);
+		if (hit.hit)
+		{
+			// The hit distance is along the ray in density map space
+			mat4 inverseModel = mat4_inverse(world.terrainModelMatrix);
+			vec3 densityMapSpaceOrigin = mat4_mul_vec3_extend(inverseModel, rayOrigin, 1);
+			vec3 densityMapSpaceDirection = vec3_normalize(mat4_mul_vec3_extend(inverseModel, rayDirection, 0));
+			vec3 hitPosition = mat4_mul_vec3_extend(world.terrainModelMatrix, vec3_add_vec3(densityMapSpaceOrigin, vec3_mul_f32(densityMapSpaceDirection, hit.hitDistance)), 1);
+
+			WorldGenerationEditSphere(hitPosition, worldGenParams.editRadius, GetKeyDown(KEY_SHIFT));
+		}
+	}
+
+	// Remeshing the chunks that were edited
+	START_SCOPE("Remesh dirty chunks");
+	u32 chunkCount = world.chunksPerAxis * world.chunksPerAxis * world.chunksPerAxis;
+	for (u32 i = 0; i < chunkCount; i++)
+	{
+		if (!world.chunks[i].dirty)
+			continue;
+
+		DestroyWorldChunkMesh(&world.chunks[i], true);
+		MeshWorldChunk(&world, &world.chunks[i], worldGenParams.brickSkipping);
+		UploadWorldChunkMesh(&world.chunks[i]);
+	}
+	END_SCOPE();
 }
 
 void WorldGenerationShutdown()
@@ -58,79 +198,689 @@ void WorldGenerationShutdown()
 	// Destroying debug menu for world gen parameters
 	DebugUIDestroyMenu(worldGenParamDebugMenu);
 
-	// Destroying world data
-	DestroyMarchingCubesWorld();
+	// Destroying world data, a world that is still being generated is finished first because the thread can't be interrupted
+	if (backgroundGeneration.running)
+	{
+		JoinBackgroundWorldGeneration();
+		DestroyMarchingCubesWorld(&backgroundGeneration.world, false);
+	}
+	DestroyMarchingCubesWorld(&world, true);
+	ReleaseDensityStageCache();
 }
 
 void WorldGenerationDrawWorld()
 {
-	Draw(1, &world.marchingCubesGpuMesh.vertexBuffer, world.marchingCubesGpuMesh.indexBuffer, &world.terrainModelMatrix, 1);
+	u32 chunkCount = world.chunksPerAxis * world.chunksPerAxis * world.chunksPerAxis;
+	for (u32 i = 0; i < chunkCount; i++)
+	{
+		if (world.chunks[i].colliderMesh.vertexCount == 0)
+			continue;
+
+		// The gpu meshes have packed vertices, the unpack matrix turns their positions back into density map space
+		mat4 chunkModelMatrix = mat4_mul_mat4(world.terrainModelMatrix, MeshOptimizerGetUnpackMatrix(GetChunkPackingOrigin(&world.chunks[i]), WORLD_CHUNK_PACKING_EXTENT));
+		Draw(1, &world.chunks[i].gpuMesh.vertexBuffer, world.chunks[i].gpuMesh.indexBuffer, &chunkModelMatrix, 1);
+	}
 }
 
-MeshData WorldGenerationGetColliderMesh()
+// Raycast in density map space against the chunks of the world, out_hitChunk is set to the chunk that was hit. Only reads the world, so it can run in jobs.
+static RaycastHit RaycastWorldChunks(World* target, vec3 densityMapSpaceOrigin, vec3 densityMapSpaceDirection, u32* out_hitChunk)
 {
-	return world.colliderMesh;
+	RaycastHit closestHit = {};
+	closestHit.hit = false;
+	closestHit.hitDistance = -1;
+	closestHit.triangleFirstIndex = UINT32_MAX;
+
+	// Rays that don't pass through a brick of the density map that contains surface can't hit the terrain, so the triangles don't have to be tested
+	if (!DensityBrickMapRayMayHitSurface(&target->terrainBrickMap, densityMapSpaceOrigin, densityMapSpaceDirection))
+		return closestHit;
+
+	// Every chunk after a hit only looks for closer hits, the root node bounds of the bvh make chunks the ray misses cheap
+	u32 chunkCount = target->chunksPerAxis * target->chunksPerAxis * target->chunksPerAxis;
+	for (u32 i = 0; i < chunkCount; i++)
+	{
+		WorldChunk* chunk = &target->chunks[i];
+		if (chunk->colliderMesh.vertexCount == 0)
+			continue;
+
+		f32 maxDistance = closestHit.hit ? closestHit.hitDistance : FLT_MAX;
+		RaycastHit hit = RaycastMeshBvh(densityMapSpaceOrigin, densityMapSpaceDirection, chunk->colliderBvh, maxDistance);
+		if (hit.hit)
+		{
+			closestHit = hit;
+			*out_hitChunk = i;
+		}
+	}
+
+	return closestHit;
 }
 
-mat4 WorldGenerationGetModelMatrix()
+RaycastHit WorldGenerationRaycast(vec3 origin, vec3 direction, MeshData* out_hitMesh)
+{
+	// The chunk bvhs are in density map space, so the ray is transformed once for all chunks
+	mat4 inverseModel = mat4_inverse(world.terrainModelMatrix);
+	vec3 densityMapSpaceOrigin = mat4_mul_vec3_extend(inverseModel, origin, 1);
+	vec3 densityMapSpaceDirection = mat4_mul_vec3_extend(inverseModel, direction, 0);
+
+	u32 hitChunk;
+	RaycastHit hit = RaycastWorldChunks(&world, densityMapSpaceOrigin, densityMapSpaceDirection, &hitChunk);
+	if (hit.hit && out_hitMesh)
+		*out_hitMesh = world.chunks[hitChunk].colliderMesh;
+	return hit;
+}
+
+typedef struct WorldRaycastBatchJobData
+{
+	vec3* origins;
+	vec3* directions;
+	RaycastHit* hits;
+	MeshData* hitMeshes;
+	mat4 inverseModel;
+	u32 rayCount;
+	u32 raysPerJob;
+} WorldRaycastBatchJobData;
+
+static void WorldRaycastBatchJob(void* data, u32 jobIndex)
+{
+	WorldRaycastBatchJobData* jobData = data;
+	u32 start = jobIndex * jobData->raysPerJob;
+	u32 end = start + jobData->raysPerJob < jobData->rayCount ? start + jobData->raysPerJob : jobData->rayCount;
+
+	for (u32 ray = start; ray < end; ray++)
+	{
+		vec3 densityMapSpaceOrigin = mat4_mul_vec3_extend(jobData->inverseModel, jobData->origins[ray], 1);
+		vec3 densityMapSpaceDirection = mat4_mul_vec3_extend(jobData->inverseModel, jobData->directions[ray], 0);
+		u32 hitChunk;
+		jobData->hits[ray] = RaycastWorldChunks(&world, densityMapSpaceOrigin, densityMapSpaceDirection, &hitChunk);
+		if (jobData->hitMeshes)
+			jobData->hitMeshes[ray] = jobData->hits[ray].hit ? world.chunks[hitChunk].colliderMesh : (MeshData){};
+	}
+}
+
+void WorldGenerationRaycastBatch(vec3* origins, vec3* directions, u32 rayCount, RaycastHit* out_hits, MeshData* out_hitMeshes, u32 maxThreadCount)
+{
+	if (rayCount == 0)
+		return;
+
+	START_SCOPE("World raycast batch");
+
+	WorldRaycastBatchJobData jobData = {};
+	jobData.origins = origins;
+	jobData.directions = directions;
+	jobData.hits = out_hits;
+	jobData.hitMeshes = out_hitMeshes;
+	jobData.inverseModel = mat4_inverse(world.terrainModelMatrix);
+	jobData.rayCount = rayCount;
+
+	u32 jobCount = maxThreadCount * WORLD_RAYCAST_BATCH_JOBS_PER_THREAD;
+	u32 maxJobCount = (rayCount + WORLD_RAYCAST_BATCH_MIN_JOB_SIZE - 1) / WORLD_RAYCAST_BATCH_MIN_JOB_SIZE;
+	jobCount = jobCount < maxJobCount ? jobCount : maxJobCount;
+	jobCount = jobCount > 0 ? jobCount : 1;
+	jobData.raysPerJob = (rayCount + jobCount - 1) / jobCount;
+	jobCount = (rayCount + jobData.raysPerJob - 1) / jobData.raysPerJob;
+
+	JobSystemParallelFor(WorldRaycastBatchJob, &jobData, jobCount, maxThreadCount);
+
+	END_SCOPE_THROUGHPUT(rayCount, "rays");
+}
+
+RaycastHit WorldGenerationRaycastDensity(vec3 origin, vec3 direction)
+{
+	mat4 inverseModel = mat4_inverse(world.terrainModelMatrix);
+	vec3 densityMapSpaceOrigin = mat4_mul_vec3_extend(inverseModel, origin, 1);
+	vec3 densityMapSpaceDirection = mat4_mul_vec3_extend(inverseModel, direction, 0);
+
+	u32 resolution = world.densityMapResolution;
+	if (world.terrainDensityMap)
+		return DensityMapRaycast(world.terrainDensityMap, resolution, resolution, resolution, &world.terrainBrickMap, densityMapSpaceOrigin, densityMapSpaceDirection, FLT_MAX);
+	return DensityMapRaycastQuantized(&world.terrainQuantizedDensityMap, &world.terrainBrickMap, densityMapSpaceOrigin, densityMapSpaceDirection, FLT_MAX);
+}
+
+// Sweep in density map space against the chunks of the world, a sphere is a capsule with a segment of length 0. Only reads the world, so it can run in jobs.
+static SweepHit SweepWorldChunks(World* target, vec3 segmentStart, vec3 segmentEnd, f32 radius, vec3 direction, f32 maxDistance)
+{
+	SweepHit closestHit = {};
+	closestHit.hit = false;
+	closestHit.hitDistance = -1;
+	closestHit.triangleFirstIndex = UINT32_MAX;
+
+	// Only the chunks that overlap the bounds of the whole sweep can be touched, the meshes of chunks reach a cube below their region (surface nets)
+	direction = vec3_normalize(direction);
+	i32 chunksPerAxis = target->chunksPerAxis;
+	i32 chunkStart[3] = { 0, 0, 0 };
+	i32 chunkEnd[3] = { chunksPerAxis - 1, chunksPerAxis - 1, chunksPerAxis - 1 };
+	if (maxDistance < FLT_MAX)
+	{
+		for (u32 axis = 0; axis < 3; axis++)
+		{
+			f32 start = ((f32*)&segmentStart)[axis];
+			f32 end = ((f32*)&segmentEnd)[axis];
+			f32 movement = ((f32*)&direction)[axis] * maxDistance;
+			f32 boundsMin = (start < end ? start : end) - radius + (movement < 0 ? movement : 0);
+			f32 boundsMax = (start > end ? start : end) + radius + (movement > 0 ? movement : 0);
+			f32 firstChunk = floorf((boundsMin - 1) / WORLD_CHUNK_SIZE);
+			f32 lastChunk = floorf((boundsMax + 1) / WORLD_CHUNK_SIZE);
+			chunkStart[axis] = firstChunk > 0 ? (firstChunk < chunksPerAxis ? (i32)firstChunk : chunksPerAxis) : 0;
+			chunkEnd[axis] = lastChunk < chunksPerAxis - 1 ? (lastChunk > -1 ? (i32)lastChunk : -1) : chunksPerAxis - 1;
+		}
+	}
+
+	for (i32 chunkX = chunkStart[0]; chunkX <= chunkEnd[0]; chunkX++)
+	{
+		for (i32 chunkY = chunkStart[1]; chunkY <= chunkEnd[1]; chunkY++)
+		{
+			for (i32 chunkZ = chunkStart[2]; chunkZ <= chunkEnd[2]; chunkZ++)
+			{
+				WorldChunk* chunk = &target->chunks[(chunkX * chunksPerAxis + chunkY) * chunksPerAxis + chunkZ];
+				if (chunk->colliderMesh.vertexCount == 0)
+					continue;
+
+				f32 chunkMaxDistance = closestHit.hit ? closestHit.hitDistance : maxDistance;
+				SweepHit hit = SweepCapsuleMeshBvh(segmentStart, segmentEnd, radius, direction, chunkMaxDistance, chunk->colliderBvh);
+				if (hit.hit)
+					closestHit = hit;
+			}
+		}
+	}
+
+	return closestHit;
+}
+
+// Converts the sweep to density map space and the hit back to world space, the model matrix scales uniformly so distances scale by the same factor
+static SweepHit SweepWorld(vec3 segmentStart, vec3 segmentEnd, f32 radius, vec3 direction, f32 maxDistance)
+{
+	f32 densityMapSpaceScale = world.densityMapResolution / (f32)DEFAULT_DENSITY_MAP_RESOLUTION;
+	mat4 inverseModel = mat4_inverse(world.terrainModelMatrix);
+	vec3 densityMapSpaceStart = mat4_mul_vec3_extend(inverseModel, segmentStart, 1);
+	vec3 densityMapSpaceEnd = mat4_mul_vec3_extend(inverseModel, segmentEnd, 1);
+	vec3 densityMapSpaceDirection = mat4_mul_vec3_extend(inverseModel, direction, 0);
+	f32 densityMapSpaceMaxDistance = maxDistance < FLT_MAX ? maxDistance * densityMapSpaceScale : FLT_MAX;
+
+	SweepHit hit = SweepWorldChunks(&world, densityMapSpaceStart, densityMapSpaceEnd, radius * densityMapSpaceScale, densityMapSpaceDirection, densityMapSpaceMaxDistance);
+	if (hit.hit)
+	{
+		hit.hitDistance /= densityMapSpaceScale;
+		hit.contactPoint = mat4_mul_vec3_extend(world.terrainModelMatrix, hit.contactPoint, 1);
+	}
+	return hit;
+}
+
+SweepHit WorldGenerationSweepSphere(vec3 center, f32 radius, vec3 direction, f32 maxDistance)
+{
+	return SweepWorld(center, center, radius, direction, maxDistance);
+}
+
+SweepHit WorldGenerationSweepCapsule(vec3 segmentStart, vec3 segmentEnd, f32 radius, vec3 direction, f32 maxDistance)
+{
+	return SweepWorld(segmentStart, segmentEnd, radius, direction, maxDistance);
+}
+
+void WorldGenerationEditSphere(vec3 center, f32 radius, bool fill)
+{
+	START_SCOPE("Edit density map");
+
+	// Converting the sphere to density map space, the model matrix scales uniformly
+	f32 densityMapSpaceScale = world.densityMapResolution / (f32)DEFAULT_DENSITY_MAP_RESOLUTION;
+	vec3 densityMapSpaceCenter = mat4_mul_vec3_extend(mat4_inverse(world.terrainModelMatrix), center, 1);
+	f32 densityMapSpaceRadius = radius * densityMapSpaceScale;
+
+	u32 resolution = world.densityMapResolution;
+	u32 editStart[3];
+	u32 editEnd[3];
+	bool edited;
+	if (world.terrainDensityMap)
+		edited = DensityMapEditSphere(world.terrainDensityMap, resolution, resolution, resolution, densityMapSpaceCenter, densityMapSpaceRadius, fill, editStart, editEnd);
+	else
+		edited = DensityMapEditSphereQuantized(&world.terrainQuantizedDensityMap, densityMapSpaceCenter, densityMapSpaceRadius, fill, editStart, editEnd);
+
+	if (!edited)
+	{
+		END_SCOPE();
+		return;
+	}
+
+	// The density map no longer is the output of its generation stages, so regenerating has to run the blur stage again
+	world.blurStageKey = 0;
+
+	if (world.terrainDensityMap)
+		DensityBrickMapUpdateRegion(&world.terrainBrickMap, world.terrainDensityMap, editStart[0], editStart[1], editStart[2], editEnd[0], editEnd[1], editEnd[2]);
+	else
+		DensityBrickMapUpdateRegionQuantized(&world.terrainBrickMap, &world.terrainQuantizedDensityMap, editStart[0], editStart[1], editStart[2], editEnd[0], editEnd[1], editEnd[2]);
+
+	// A density value is a corner of the cubes with their origin one value lower up to the value itself, the chunks containing those cubes are marked dirty.
+	// Surface nets chunks also build the vertices of the cube layer below their region, so the chunk after the last touched cube is marked dirty as well
+	u32 cubeCount = resolution - 1;
+	u32 firstChunk[3];
+	u32 lastChunk[3];
+	for (u32 axis = 0; axis < 3; axis++)
+	{
+		u32 firstCube = editStart[axis] > 0 ? editStart[axis] - 1 : 0;
+		u32 lastCube = editEnd[axis] < cubeCount ? editEnd[axis] : cubeCount - 1;
+		firstChunk[axis] = firstCube / WORLD_CHUNK_SIZE;
+		lastChunk[axis] = (world.surfaceNets ? lastCube + 1 : lastCube) / WORLD_CHUNK_SIZE;
+		if (lastChunk[axis] > world.chunksPerAxis - 1)
+			lastChunk[axis] = world.chunksPerAxis - 1;
+	}
+
+	for (u32 chunkX = firstChunk[0]; chunkX <= lastChunk[0]; chunkX++)
+		for (u32 chunkY = firstChunk[1]; chunkY <= lastChunk[1]; chunkY++)
+			for (u32 chunkZ = firstChunk[2]; chunkZ <= lastChunk[2]; chunkZ++)
+				world.chunks[(chunkX * world.chunksPerAxis + chunkY) * world.chunksPerAxis + chunkZ].dirty = true;
+
+	END_SCOPE();
+}
+
+DensityBrickMap* WorldGenerationGetDensityBrickMap()
+{
+	return &world.terrainBrickMap;
+}
+
+// Model matrix that centers the density map and scales it to the size of a DEFAULT_DENSITY_MAP_RESOLUTION map
+static mat4 CalculateTerrainModelMatrix(u32 densityMapResolution)
 {
-	// Calculating the model matrix to center 
-	mat4 scale = mat4_3Dscale(vec3_from_float(DEFAULT_DENSITY_MAP_RESOLUTION / (f32)worldGenParams.densityMapResolution));
+	mat4 scale = mat4_3Dscale(vec3_from_float(DEFAULT_DENSITY_MAP_RESOLUTION / (f32)densityMapResolution));
 	mat4 translation = mat4_3Dtranslate(vec3_from_float(-DEFAULT_DENSITY_MAP_RESOLUTION * 0.5f));
-	world.terrainModelMatrix =  mat4_mul_mat4(translation, scale);
+	return mat4_mul_mat4(translation, scale);
+}
+
+mat4 WorldGenerationGetModelMatrix()
+{
+	world.terrainModelMatrix = CalculateTerrainModelMatrix(world.densityMapResolution);
 	return world.terrainModelMatrix;
 }
 
-static inline void GenerateMarchingCubesWorld()
+// FNV-1a over the bytes of a stage input
+static inline u64 HashStageInput(u64 hash, const void* data, u64 size)
 {
-	START_SCOPE("Allocate memory");
-	// Allocating memory for the density map
-	u32 densityMapValueCount = worldGenParams.densityMapResolution * worldGenParams.densityMapResolution * worldGenParams.densityMapResolution;
-	world.terrainDensityMap = Alloc(GetGlobalAllocator(), sizeof(*world.terrainDensityMap) * densityMapValueCount);
+	const u8* bytes = data;
+	for (u64 i = 0; i < size; i++)
+		hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+	return hash;
+}
+
+// Only the parameters that are used with the selected blur are part of the blur key, so changing an unused one doesn't regenerate anything
+static WorldGenStageKeys CalculateStageKeys(WorldGenParameters* params)
+{
+	WorldGenStageKeys keys = {};
+	BezierDensityFuncSettings* densitySettings = &params->bezierDensityFuncSettings;
+	u64 hash = STAGE_KEY_HASH_START;
+	HASH_STAGE_INPUT(hash, params->terrainSeed);
+	HASH_STAGE_INPUT(hash, params->densityMapResolution);
+	HASH_STAGE_INPUT(hash, densitySettings->bezierTunnelCount);
+	HASH_STAGE_INPUT(hash, densitySettings->bezierTunnelRadius);
+	HASH_STAGE_INPUT(hash, densitySettings->bezierTunnelControlPoints);
+	HASH_STAGE_INPUT(hash, densitySettings->sphereHoleCount);
+	HASH_STAGE_INPUT(hash, densitySettings->sphereHoleRadius);
+	keys.density = hash;
+
+	HASH_STAGE_INPUT(hash, params->blurIterations);
+	HASH_STAGE_INPUT(hash, params->boxBlur);
+	HASH_STAGE_INPUT(hash, params->brickSkipping);
+	HASH_STAGE_INPUT(hash, params->densityMapBits);
+	if (params->boxBlur)
+	{
+		HASH_STAGE_INPUT(hash, params->boxBlurRadius);
+	}
+	else
+	{
+		HASH_STAGE_INPUT(hash, params->referenceBlur);
+		HASH_STAGE_INPUT(hash, params->blurKernelSize);
+	}
+	keys.blur = hash;
+
+	HASH_STAGE_INPUT(hash, params->surfaceNets);
+	HASH_STAGE_INPUT(hash, params->optimizeChunkMeshes);
+	keys.mesh = hash;
+	return keys;
+}
+
+// Regenerates the world from worldGenParams, only the stages whose key differs from the current world's run again.
+// If background is true the world is generated on a separate thread and swapped in by WorldGenerationUpdate once it's done.
+static void RegenerateWorld(bool background)
+{
+	WorldGenStageKeys keys = CalculateStageKeys(&worldGenParams);
+	bool densityStageHit = densityStageCache.key == keys.density;
+	bool blurStageHit = densityStageHit && world.chunks && world.blurStageKey == keys.blur;
+	bool meshStageHit = blurStageHit && world.meshStageKey == keys.mesh;
+
+	INCREMENT_COUNTER(densityStageHit ? "World gen density stage hit" : "World gen density stage miss");
+	INCREMENT_COUNTER(blurStageHit ? "World gen blur stage hit" : "World gen blur stage miss");
+	INCREMENT_COUNTER(meshStageHit ? "World gen mesh stage hit" : "World gen mesh stage miss");
+	INCREMENT_COUNTER(meshStageHit ? "World gen upload stage hit" : "World gen upload stage miss");
+
+	// Nothing changed since the current world was generated
+	if (meshStageHit)
+		return;
+
+	// Only the mesher or mesh optimization changed, the chunks of the current world are remeshed by WorldGenerationUpdate like edited chunks
+	if (blurStageHit)
+	{
+		u32 chunkCount = world.chunksPerAxis * world.chunksPerAxis * world.chunksPerAxis;
+		for (u32 i = 0; i < chunkCount; i++)
+		{
+			world.chunks[i].dirty = true;
+		}
+		world.surfaceNets = worldGenParams.surfaceNets;
+		world.optimizeChunkMeshes = worldGenParams.optimizeChunkMeshes;
+		world.meshStageKey = keys.mesh;
+		return;
+	}
+
+	// Density maps that were generated before (also in earlier runs) are mapped from the disk cache instead of evaluating the density function
+	u32 resolution = worldGenParams.densityMapResolution;
+	if (!densityStageHit && worldGenParams.densityMapDiskCache)
+	{
+		DensityMapCacheFile diskCacheFile;
+		if (DensityMapCacheLoad(DENSITY_MAP_CACHE_DIRECTORY, resolution, worldGenParams.terrainSeed, keys.density, &diskCacheFile))
+		{
+			ReleaseDensityStageCache();
+			densityStageCache.diskCacheFile = diskCacheFile;
+			densityStageCache.densityMap = diskCacheFile.densityMap;
+			densityStageCache.resolution = resolution;
+			densityStageCache.key = keys.density;
+			densityStageHit = true;
+			INCREMENT_COUNTER("World gen density stage disk cache hit");
+			_INFO("Density map loaded from the disk cache");
+		}
+	}
+
+	// The density stage writes to the cache, it's (re)allocated here because the generation thread can't use the global allocator
+	if (!densityStageHit && (densityStageCache.diskCacheFile.densityMap || densityStageCache.resolution != resolution))
+	{
+		ReleaseDensityStageCache();
+		densityStageCache.densityMap = Alloc(GetGlobalAllocator(), sizeof(*densityStageCache.densityMap) * resolution * resolution * resolution);
+		densityStageCache.resolution = resolution;
+	}
+	if (!densityStageHit)
+		densityStageCache.key = 0;
+
+	if (background)
+	{
+		StartBackgroundWorldGeneration(keys, densityStageHit);
+		return;
+	}
+
+	if (world.chunks)
+	{
+		START_SCOPE("Destroy marching cubes world");
+		DestroyMarchingCubesWorld(&world, true);
+		END_SCOPE();
+	}
+	START_SCOPE("Create marching cubes world");
+	world = (World){};
+	world.allocator = GetGlobalAllocator();
+	GenerateMarchingCubesWorld(&world, &worldGenParams, keys, densityStageHit, true);
+	UploadWorldMeshes(&world);
 	END_SCOPE();
+}
 
-	// Calculating the model matrix to center 
-	mat4 scale = mat4_3Dscale(vec3_from_float(DEFAULT_DENSITY_MAP_RESOLUTION / (f32)worldGenParams.densityMapResolution));
-	mat4 translation = mat4_3Dtranslate(vec3_from_float(-DEFAULT_DENSITY_MAP_RESOLUTION * 0.5f));
-	world.terrainModelMatrix =  mat4_mul_mat4(translation, scale);
+static void ReleaseDensityStageCache()
+{
+	if (densityStageCache.diskCacheFile.densityMap)
+		DensityMapCacheUnload(&densityStageCache.diskCacheFile);
+	else if (densityStageCache.densityMap)
+		Free(GetGlobalAllocator(), densityStageCache.densityMap);
+	densityStageCache = (DensityStageCache){};
+}
+
+// The profiler and the logger aren't thread safe, so generation only uses them when it runs on the main thread
+#define GENERATION_START_SCOPE(mainThread, name) { if (mainThread) { START_SCOPE(name); } }
+#define GENERATION_END_SCOPE(mainThread) { if (mainThread) { END_SCOPE(); } }
+
+// Generates the density map, the brick map and the chunk meshes of the target without uploading the meshes, the target needs its allocator set.
+// If densityStageHit is true the density stage cache already holds the density map for keys.density, otherwise it is written to the cache.
+// Only uses the allocators and arena in global and the target's allocator, so it can run on any thread that has its own globals.
+static void GenerateMarchingCubesWorld(World* target, WorldGenParameters* params, WorldGenStageKeys keys, bool densityStageHit, bool mainThread)
+{
+	u32 resolution = params->densityMapResolution;
+	target->densityMapResolution = resolution;
+
+	GENERATION_START_SCOPE(mainThread, "Allocate memory");
+	// Allocating memory for the density map
+	u32 densityMapValueCount = resolution * resolution * resolution;
+	target->terrainDensityMap = Alloc(target->allocator, sizeof(*target->terrainDensityMap) * densityMapValueCount);
+	GENERATION_END_SCOPE(mainThread);
+
+	target->terrainModelMatrix = CalculateTerrainModelMatrix(resolution);
 
 	// Generating the density map
-	BezierDensityFuncSettings densitySettingsCopy = worldGenParams.bezierDensityFuncSettings;
-	densitySettingsCopy.baseSphereRadius = 0.4f * worldGenParams.densityMapResolution;
-	densitySettingsCopy.bezierTunnelRadius = densitySettingsCopy.bezierTunnelRadius * worldGenParams.densityMapResolution / DEFAULT_DENSITY_MAP_RESOLUTION;
-	densitySettingsCopy.sphereHoleRadius = densitySettingsCopy.sphereHoleRadius * worldGenParams.densityMapResolution / DEFAULT_DENSITY_MAP_RESOLUTION;
+	BezierDensityFuncSettings densitySettingsCopy = params->bezierDensityFuncSettings;
+	densitySettingsCopy.baseSphereRadius = 0.4f * resolution;
+	densitySettingsCopy.bezierTunnelRadius = densitySettingsCopy.bezierTunnelRadius * resolution / DEFAULT_DENSITY_MAP_RESOLUTION;
+	densitySettingsCopy.sphereHoleRadius = densitySettingsCopy.sphereHoleRadius * resolution / DEFAULT_DENSITY_MAP_RESOLUTION;
 
-	START_SCOPE("Generating voxel data");
-	DensityFuncBezierCurveHole(&world.terrainSeed, &densitySettingsCopy, world.terrainDensityMap, worldGenParams.densityMapResolution);
-	END_SCOPE();
-	START_SCOPE("Blurring voxel data");
-	BlurDensityMapGaussian(worldGenParams.blurIterations, worldGenParams.blurKernelSize, world.terrainDensityMap, worldGenParams.densityMapResolution, worldGenParams.densityMapResolution, worldGenParams.densityMapResolution);
-	END_SCOPE();
+	if (!densityStageHit)
+	{
+		GENERATION_START_SCOPE(mainThread, "Generating voxel data");
+		u32 seed = params->terrainSeed;
+		DensityFuncBezierCurveHole(&seed, &densitySettingsCopy, densityStageCache.densityMap, resolution, nullptr);
+		densityStageCache.key = keys.density;
+		GENERATION_END_SCOPE(mainThread);
 
-	// Generating the mesh
-	START_SCOPE("Generating mesh with marching cubes");
-	MeshData mcMeshData = MarchingCubesGenerateMesh(world.terrainDensityMap, worldGenParams.densityMapResolution, worldGenParams.densityMapResolution, worldGenParams.densityMapResolution);
-	END_SCOPE();
+		if (params->densityMapDiskCache)
+		{
+			GENERATION_START_SCOPE(mainThread, "Storing density map in the disk cache");
+			DensityMapCacheStore(DENSITY_MAP_CACHE_DIRECTORY, resolution, params->terrainSeed, keys.density, densityStageCache.densityMap, DENSITY_MAP_CACHE_SIZE_BUDGET);
+			GENERATION_END_SCOPE(mainThread);
+		}
+	}
+	MemoryCopy(target->terrainDensityMap, densityStageCache.densityMap, sizeof(*target->terrainDensityMap) * densityMapValueCount);
+	// A quantized density map also quantizes the intermediate result of the blur, 16 bits so the error doesn't build up over the iterations
+	DensityMapFormat densityMapFormat = params->densityMapBits == 8 ? DENSITY_MAP_FORMAT_8BIT : params->densityMapBits == 16 ? DENSITY_MAP_FORMAT_16BIT : DENSITY_MAP_FORMAT_F32;
+	DensityMapFormat blurIntermediateFormat = densityMapFormat == DENSITY_MAP_FORMAT_F32 ? DENSITY_MAP_FORMAT_F32 : DENSITY_MAP_FORMAT_16BIT;
 
-	// This is for smoothing the mesh normals and removing duplicate vertices, used for raycasting
-	START_SCOPE("Merge normals");
-	world.colliderMesh = MeshOptimizerMergeNormals(mcMeshData, offsetof(VertexT2, position), offsetof(VertexT2, normal));
-	END_SCOPE();
+	GENERATION_START_SCOPE(mainThread, "Blurring voxel data");
+	// The brick map can only skip blurring bricks if the kernel doesn't reach past the neighbouring bricks
+	if (params->boxBlur)
+		BlurDensityMapBokeh(params->blurIterations, params->boxBlurRadius * 2 + 1, target->terrainDensityMap, resolution, resolution, resolution, params->brickSkipping && params->boxBlurRadius <= DENSITY_BRICK_SIZE);
+	else if (params->referenceBlur)
+		BlurDensityMapGaussianReference(params->blurIterations, params->blurKernelSize, target->terrainDensityMap, resolution, resolution, resolution, params->brickSkipping);
+	else
+		BlurDensityMapGaussian(params->blurIterations, params->blurKernelSize, target->terrainDensityMap, resolution, resolution, resolution, params->brickSkipping, blurIntermediateFormat, JobSystemGetThreadCount());
+	GENERATION_END_SCOPE(mainThread);
 
-	// Uploading the mesh
-	START_SCOPE("Upload mesh and free cpu data");
-	world.marchingCubesGpuMesh.vertexBuffer = VertexBufferCreate(mcMeshData.vertices, mcMeshData.vertexStride * mcMeshData.vertexCount);
-	world.marchingCubesGpuMesh.indexBuffer = IndexBufferCreate(mcMeshData.indices, mcMeshData.indexCount);
+	// The brick map is kept up to date with the density map, it's used to skip the parts of the map without surface when meshing and raycasting
+	GENERATION_START_SCOPE(mainThread, "Building density brick map");
+	target->terrainBrickMap = DensityBrickMapCreate(target->allocator, resolution, resolution, resolution);
+	DensityBrickMapUpdate(&target->terrainBrickMap, target->terrainDensityMap);
+	GENERATION_END_SCOPE(mainThread);
 
-	MarchingCubesFreeMeshData(mcMeshData);
+	// Quantizing keeps the inside/outside of every value, so the brick map made from the f32 values is still up to date.
+	// Edits stay within [-1, 1], so that range is always included.
+	// Quantizing clamps the values above QUANTIZED_TERRAIN_MAX_DENSITY, which are so far outside of the surface that the mesh barely changes.
+	if (densityMapFormat != DENSITY_MAP_FORMAT_F32)
+	{
+		GENERATION_START_SCOPE(mainThread, "Quantizing density map");
+		f32 minValue;
+		f32 maxValue;
+		DensityMapGetRange(target->terrainDensityMap, densityMapValueCount, &minValue, &maxValue);
+		minValue = minValue > -1 ? -1 : minValue;
+		maxValue = maxValue < 1 ? 1 : maxValue;
+		maxValue = maxValue > QUANTIZED_TERRAIN_MAX_DENSITY ? QUANTIZED_TERRAIN_MAX_DENSITY : maxValue;
+		target->terrainQuantizedDensityMap = QuantizedDensityMapCreate(target->allocator, densityMapFormat, resolution, resolution, resolution, minValue, maxValue);
+		QuantizedDensityMapEncodeBox(&target->terrainQuantizedDensityMap, nullptr, target->terrainDensityMap);
+		Free(target->allocator, target->terrainDensityMap);
+		target->terrainDensityMap = nullptr;
+		if (mainThread)
+			_INFO("Density map quantized to %u bits: %.2f MiB instead of %.2f MiB", (u32)params->densityMapBits, QuantizedDensityMapGetSize(&target->terrainQuantizedDensityMap) / (f64)MiB, sizeof(f32) * densityMapValueCount / (f64)MiB);
+		GENERATION_END_SCOPE(mainThread);
+	}
+
+	// Creating the chunks, all of them get meshed right away
+	GENERATION_START_SCOPE(mainThread, "Generating chunk meshes");
+	target->surfaceNets = params->surfaceNets;
+	target->optimizeChunkMeshes = params->optimizeChunkMeshes;
+	u32 cubeCount = resolution - 1;
+	target->chunksPerAxis = (cubeCount + WORLD_CHUNK_SIZE - 1) / WORLD_CHUNK_SIZE;
+	u32 chunkCount = target->chunksPerAxis * target->chunksPerAxis * target->chunksPerAxis;
+	target->chunks = Alloc(target->allocator, sizeof(*target->chunks) * chunkCount);
+	for (u32 chunkX = 0; chunkX < target->chunksPerAxis; chunkX++)
+	{
+		for (u32 chunkY = 0; chunkY < target->chunksPerAxis; chunkY++)
+		{
+			for (u32 chunkZ = 0; chunkZ < target->chunksPerAxis; chunkZ++)
+			{
+				WorldChunk* chunk = &target->chunks[(chunkX * target->chunksPerAxis + chunkY) * target->chunksPerAxis + chunkZ];
+				chunk->region.startX = chunkX * WORLD_CHUNK_SIZE;
+				chunk->region.startY = chunkY * WORLD_CHUNK_SIZE;
+				chunk->region.startZ = chunkZ * WORLD_CHUNK_SIZE;
+				chunk->region.endX = chunk->region.startX + WORLD_CHUNK_SIZE < cubeCount ? chunk->region.startX + WORLD_CHUNK_SIZE : cubeCount;
+				chunk->region.endY = chunk->region.startY + WORLD_CHUNK_SIZE < cubeCount ? chunk->region.startY + WORLD_CHUNK_SIZE : cubeCount;
+				chunk->region.endZ = chunk->region.startZ + WORLD_CHUNK_SIZE < cubeCount ? chunk->region.startZ + WORLD_CHUNK_SIZE : cubeCount;
+				MeshWorldChunk(target, chunk, params->brickSkipping);
+			}
+		}
+	}
+	GENERATION_END_SCOPE(mainThread);
+
+	target->blurStageKey = keys.blur;
+	target->meshStageKey = keys.mesh;
+}
+
+static void UploadWorldMeshes(World* target)
+{
+	START_SCOPE("Uploading chunk meshes");
+	u32 chunkCount = target->chunksPerAxis * target->chunksPerAxis * target->chunksPerAxis;
+	for (u32 i = 0; i < chunkCount; i++)
+	{
+		UploadWorldChunkMesh(&target->chunks[i]);
+	}
 	END_SCOPE();
 }
 
-static inline void DestroyMarchingCubesWorld()
+static void BackgroundWorldGenerationThread(void* userData)
 {
-	MeshOptimizerFreeMeshData(world.colliderMesh);
-	Free(GetGlobalAllocator(), world.terrainDensityMap);
-	VertexBufferDestroy(world.marchingCubesGpuMesh.vertexBuffer);
-	IndexBufferDestroy(world.marchingCubesGpuMesh.indexBuffer);
+	BackgroundWorldGeneration* generation = userData;
+	global = &generation->globals;
+
+	GenerateMarchingCubesWorld(&generation->world, &generation->params, generation->keys, generation->densityStageHit, false);
+
+	PlatformAtomicAdd(&generation->finished, 1);
 }
 
+static void StartBackgroundWorldGeneration(WorldGenStageKeys keys, bool densityStageHit)
+{
+	GRASSERT_DEBUG(!backgroundGeneration.running);
+
+	backgroundGeneration.params = worldGenParams;
+	backgroundGeneration.keys = keys;
+	backgroundGeneration.densityStageHit = densityStageHit;
+	backgroundGeneration.finished = 0;
+
+	u64 densityMapValueCount = (u64)worldGenParams.densityMapResolution * worldGenParams.densityMapResolution * worldGenParams.densityMapResolution;
+	backgroundGeneration.world = (World){};
+	backgroundGeneration.world.ownsAllocator = true;
+	CreateFreelistAllocator("Background world allocator", GetGlobalAllocator(), densityMapValueCount * (sizeof(f32) + sizeof(u16)) + BACKGROUND_WORLD_ALLOCATOR_HEADROOM, &backgroundGeneration.world.allocator, false);
+
+	// The thread's meshes are allocated with the world's allocator, so they stay valid after the thread is done
+	backgroundGeneration.arena = ArenaCreate(GetGlobalAllocator(), BACKGROUND_GENERATION_ARENA_SIZE);
+	backgroundGeneration.globals = *global;
+	backgroundGeneration.globals.frameArena = &backgroundGeneration.arena;
+	backgroundGeneration.globals.gameAllocator = backgroundGeneration.world.allocator;
+	backgroundGeneration.globals.largeObjectAllocator = backgroundGeneration.world.allocator;
+
+	backgroundGeneration.thread = PlatformThreadCreate(BackgroundWorldGenerationThread, &backgroundGeneration);
+	backgroundGeneration.running = true;
+}
+
+// Waits for the generation thread to finish and frees its arena, the generated world is left in backgroundGeneration.world
+static void JoinBackgroundWorldGeneration()
+{
+	PlatformThreadJoin(backgroundGeneration.thread);
+	ArenaDestroy(&backgroundGeneration.arena, GetGlobalAllocator());
+	backgroundGeneration.running = false;
+}
+
+// Meshes the chunk with indexed marching cubes or surface nets (the mesher of the world), the chunk can't have a mesh already.
+// The mesh is uploaded separately with UploadWorldChunkMesh.
+static inline void MeshWorldChunk(World* target, WorldChunk* chunk, bool brickSkipping)
+{
+	u32 resolution = target->densityMapResolution;
+	DensityBrickMap* meshingBrickMap = brickSkipping ? &target->terrainBrickMap : nullptr;
+
+	// Both indexed meshes already have shared vertices and smooth normals, so they are used for both rendering and raycasting
+	if (target->surfaceNets && target->terrainDensityMap)
+		chunk->colliderMesh = MarchingCubesGenerateMeshSurfaceNetsRegion(target->terrainDensityMap, resolution, resolution, resolution, meshingBrickMap, chunk->region);
+	else if (target->surfaceNets)
+		chunk->colliderMesh = MarchingCubesGenerateMeshSurfaceNetsRegionQuantized(&target->terrainQuantizedDensityMap, meshingBrickMap, chunk->region);
+	else if (target->terrainDensityMap)
+		chunk->colliderMesh = MarchingCubesGenerateMeshIndexedRegion(target->terrainDensityMap, resolution, resolution, resolution, meshingBrickMap, chunk->region);
+	else
+		chunk->colliderMesh = MarchingCubesGenerateMeshIndexedRegionQuantized(&target->terrainQuantizedDensityMap, meshingBrickMap, chunk->region);
+
+	// Only changes the order of the triangles and vertices, so raycasts against the collider mesh give the same results
+	if (target->optimizeChunkMeshes)
+	{
+		MeshOptimizerOptimizeVertexCache(&chunk->colliderMesh);
+		MeshOptimizerOptimizeOverdraw(&chunk->colliderMesh, offsetof(VertexT2, position));
+		MeshOptimizerOptimizeVertexFetch(&chunk->colliderMesh);
+	}
+	// Built after the optimization because it stores the triangle order
+	chunk->colliderBvh = MeshBvhCreate(chunk->colliderMesh, offsetof(VertexT2, position), global->largeObjectAllocator);
+	chunk->meshAllocator = global->largeObjectAllocator;
+	chunk->dirty = false;
+}
+
+// Needs to run on the main thread. The vertex buffer gets packed vertices (half the size of the VertexT2 collider mesh) and the index buffer the narrowest indices
+// the chunk allows (16 bits for every full chunk mesh so far), the collider mesh is kept as it is for raycasting.
+static inline void UploadWorldChunkMesh(WorldChunk* chunk)
+{
+	if (chunk->colliderMesh.vertexCount > 0)
+	{
+		ArenaMarker marker = ArenaGetMarker(global->frameArena);
+		VertexPacked* packedVertices = ArenaAlloc(global->frameArena, sizeof(*packedVertices) * chunk->colliderMesh.vertexCount);
+		MeshOptimizerPackVertices(chunk->colliderMesh, offsetof(VertexT2, position), offsetof(VertexT2, normal), GetChunkPackingOrigin(chunk), WORLD_CHUNK_PACKING_EXTENT, packedVertices);
+		chunk->gpuMesh.vertexBuffer = VertexBufferCreate(packedVertices, sizeof(*packedVertices) * chunk->colliderMesh.vertexCount);
+		if (MeshOptimizerGetIndexSize(chunk->colliderMesh) == sizeof(u16))
+		{
+			u16* narrowIndices = ArenaAlloc(global->frameArena, sizeof(*narrowIndices) * chunk->colliderMesh.indexCount);
+			MeshOptimizerNarrowIndices(chunk->colliderMesh, narrowIndices);
+			chunk->gpuMesh.indexBuffer = IndexBufferCreate16(narrowIndices, chunk->colliderMesh.indexCount);
+		}
+		else
+		{
+			chunk->gpuMesh.indexBuffer = IndexBufferCreate(chunk->colliderMesh.indices, chunk->colliderMesh.indexCount);
+		}
+		ArenaFreeMarker(global->frameArena, marker);
+	}
+}
+
+// Origin of the packing bounds of the chunk's gpu mesh in density map space
+static inline vec3 GetChunkPackingOrigin(WorldChunk* chunk)
+{
+	return vec3_create(chunk->region.startX - 1.0f, chunk->region.startY - 1.0f, chunk->region.startZ - 1.0f);
+}
+
+static inline void DestroyWorldChunkMesh(WorldChunk* chunk, bool hasGpuMesh)
+{
+	if (chunk->colliderMesh.vertexCount == 0)
+		return;
+
+	Free(chunk->meshAllocator, chunk->colliderMesh.vertices);
+	Free(chunk->meshAllocator, chunk->colliderMesh.indices);
+	MeshBvhDestroy(&chunk->colliderBvh, chunk->meshAllocator);
+	if (hasGpuMesh)
+	{
+		VertexBufferDestroy(chunk->gpuMesh.vertexBuffer);
+		IndexBufferDestroy(chunk->gpuMesh.indexBuffer);
+	}
+	chunk->colliderMesh = (MeshData){};
+}
+
+// hasGpuMeshes is false for a background generated world that was never uploaded
+static void DestroyMarchingCubesWorld(World* target, bool hasGpuMeshes)
+{
+	u32 chunkCount = target->chunksPerAxis * target->chunksPerAxis * target->chunksPerAxis;
+	for (u32 i = 0; i < chunkCount; i++)
+	{
+		DestroyWorldChunkMesh(&target->chunks[i], hasGpuMeshes);
+	}
+	Free(target->allocator, target->chunks);
+	if (target->terrainDensityMap)
+		Free(target->allocator, target->terrainDensityMap);
+	else
+		QuantizedDensityMapDestroy(target->allocator, &target->terrainQuantizedDensityMap);
+	DensityBrickMapDestroy(target->allocator, &target->terrainBrickMap);
+
+	if (target->ownsAllocator)
+		DestroyFreelistAllocator(target->allocator);
+}
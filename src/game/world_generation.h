@@ -1,8 +1,14 @@
 #pragma once
 #include "defines.h"
 #include "marching_cubes/terrain_density_functions.h"
+#include "marching_cubes/density_brick_map.h"
+#include "marching_cubes/marching_cubes.h"
+#include "collision.h"
 #include "renderer/renderer_types.h"
 
+#define POSSIBLE_DENSITY_MAP_BITS {8, 16, 32}
+#define POSSIBLE_DENSITY_MAP_BITS_COUNT 3
+
 typedef struct WorldGenParameters
 {
 	BezierDensityFuncSettings bezierDensityFuncSettings;
@@ -11,15 +17,50 @@ typedef struct WorldGenParameters
 	i64 blurIterations;
 	i64 blurKernelSize;
 	i64 blurKernelSizeOptions[POSSIBLE_BLUR_KERNEL_SIZES_COUNT];
+	bool brickSkipping;
+	bool referenceBlur;
+	bool boxBlur;					// Uses the summed volume table box blur with boxBlurRadius instead of the gaussian blur with blurKernelSize
+	i64 boxBlurRadius;
+	f32 editRadius;
+	i64 densityMapBits;				// 32 keeps the f32 density map, 16 and 8 quantize it after blurring
+	i64 densityMapBitsOptions[POSSIBLE_DENSITY_MAP_BITS_COUNT];
+	u32 terrainSeed;				// Seed of the density function, shift + right click picks a new one
+	bool densityMapDiskCache;		// Density maps are stored in and loaded from the on-disk cache
+	bool backgroundGeneration;		// Regenerating generates the new world on a separate thread and swaps it in when it's done, the current world keeps being drawn until then
+	bool surfaceNets;				// Meshes the chunks with surface nets instead of marching cubes
+	bool optimizeChunkMeshes;		// Reorders the chunk meshes for the vertex cache, overdraw and vertex fetch after meshing
 } WorldGenParameters;
 
+// Amount of cubes along every side of a chunk, chunks at the far sides of the density map can be smaller
+#define WORLD_CHUNK_SIZE 32
+
+// Part of the terrain that is meshed, uploaded and raycast separately, so editing the density map only requires remeshing the chunks around the edit.
+// Vertex positions are relative to the origin of the density map, so every chunk uses the terrain model matrix.
+typedef struct WorldChunk
+{
+	MeshData colliderMesh;			// Empty (vertexCount 0, no allocations or gpu buffers) if the chunk has no surface
+	MeshBvh colliderBvh;			// Built over the collider mesh when the chunk is meshed, raycasts only test the triangles of the leaves the ray passes through
+	Allocator* meshAllocator;		// Large object allocator of the thread that meshed the chunk, the collider mesh and bvh are freed with it
+	GPUMesh gpuMesh;
+	MarchingCubesRegion region;
+	bool dirty;						// The density map changed in the chunk since it was meshed
+} WorldChunk;
+
 typedef struct World
 {
-    f32* terrainDensityMap;
-	MeshData colliderMesh;
-    GPUMesh marchingCubesGpuMesh;
+	Allocator* allocator;				// Allocates the density maps and chunks
+	bool ownsAllocator;					// Worlds generated in the background have their own freelist allocator, it's destroyed with the world
+	u32 densityMapResolution;
+    f32* terrainDensityMap;				// nullptr if the density map is quantized
+	QuantizedDensityMap terrainQuantizedDensityMap;	// Only used if the density map is quantized
+	DensityBrickMap terrainBrickMap;
+	WorldChunk* chunks;
+	u32 chunksPerAxis;
 	mat4 terrainModelMatrix;
-    u32 terrainSeed;
+	u64 blurStageKey;					// Key of the generation stages the density map was made with, 0 once the density map is edited
+	u64 meshStageKey;					// Key of the mesh stage the chunks were meshed with
+	bool surfaceNets;					// Mesher of the chunks, edited chunks are remeshed with the same mesher
+	bool optimizeChunkMeshes;			// Chunk meshes are reordered by the mesh optimizer after meshing
 } World;
 
 void WorldGenerationInit();
@@ -27,6 +68,21 @@ void WorldGenerationUpdate();
 void WorldGenerationShutdown();
 
 void WorldGenerationDrawWorld();
-MeshData WorldGenerationGetColliderMesh();
+// Raycasts the terrain in world space, returns the closest hit of all chunks. If there is a hit, out_hitMesh (optional) is set to the collider mesh of the chunk that was hit.
+RaycastHit WorldGenerationRaycast(vec3 origin, vec3 direction, MeshData* out_hitMesh);
+// Raycasts rayCount rays like WorldGenerationRaycast, spread over at most maxThreadCount threads of the job system. out_hitMeshes (optional) gets the collider mesh
+// of the chunk every ray hit (empty for rays that don't hit). The chunks can't be remeshed while the batch runs. The throughput of the batch is reported through the profiler.
+void WorldGenerationRaycastBatch(vec3* origins, vec3* directions, u32 rayCount, RaycastHit* out_hits, MeshData* out_hitMeshes, u32 maxThreadCount);
+// Raycasts the terrain in world space against the density map instead of the chunk meshes, so edits are visible before the chunks are remeshed.
+// hitDistance is along the ray in density map space like WorldGenerationRaycast, triangleFirstIndex is UINT32_MAX.
+RaycastHit WorldGenerationRaycastDensity(vec3 origin, vec3 direction);
+// Moves a sphere (world space) along the direction and returns the first contact with the chunk collider meshes closer than maxDistance.
+// Unlike the raycasts the hit distance, contact point and normal are in world space. Only the chunks around the path are tested, see SweepSphereMeshBvh.
+SweepHit WorldGenerationSweepSphere(vec3 center, f32 radius, vec3 direction, f32 maxDistance);
+// Same as WorldGenerationSweepSphere for a capsule around the segment from segmentStart to segmentEnd
+SweepHit WorldGenerationSweepCapsule(vec3 segmentStart, vec3 segmentEnd, f32 radius, vec3 direction, f32 maxDistance);
+// Digs or fills a sphere (world space) in the terrain, the chunks it touches are remeshed on the next WorldGenerationUpdate
+void WorldGenerationEditSphere(vec3 center, f32 radius, bool fill);
+DensityBrickMap* WorldGenerationGetDensityBrickMap();
 mat4 WorldGenerationGetModelMatrix();
 
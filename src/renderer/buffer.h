@@ -20,4 +20,6 @@ void VertexBufferDestroy(VertexBuffer clientBuffer);
 /// <param name="indexCount"></param>
 /// <returns></returns>
 IndexBuffer IndexBufferCreate(u32* indices, size_t indexCount);
+// Creates an index buffer with 16 bit indices, for meshes with at most MAX_16_BIT_INDEXED_VERTEX_COUNT vertices. Draw calls bind the buffer with its own index type.
+IndexBuffer IndexBufferCreate16(u16* indices, size_t indexCount);
 void IndexBufferDestroy(IndexBuffer clientBuffer);
\ No newline at end of file
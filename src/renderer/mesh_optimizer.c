@@ -2,150 +2,1166 @@
 
 #include "math/lin_alg.h"
 #include "core/profiler.h"
+#include "core/job_system.h"
+#include <float.h>
 
-#define HASH_BACKING_ARRAY_SIZE_FACTOR 1.6f
-#define VEC3_BYTE_COUNT 12
+// Amount of jobs per thread of the parallel parts of welding and normal recalculation, more jobs than threads balance uneven jobs
+#define MESH_OPTIMIZER_JOBS_PER_THREAD 4
+// Parts of meshes smaller than this aren't split into more jobs, the job overhead would be larger than the work
+#define MESH_OPTIMIZER_MIN_JOB_SIZE 4096
+// The weld hash table is a power of two with at least this many slots per vertex
+#define WELD_HASH_TABLE_SLOTS_PER_VERTEX 2
+// Normal accumulation falls back to a single job if the vertex windows of the triangle ranges add up to more than this many times the vertex count
+#define NORMAL_WINDOW_SIZE_LIMIT_FACTOR 4
+
+static inline u32 GetJobCount(u32 elementCount, u32 threadCount)
+{
+	u32 jobCount = threadCount * MESH_OPTIMIZER_JOBS_PER_THREAD;
+	u32 maxJobCount = (elementCount + MESH_OPTIMIZER_MIN_JOB_SIZE - 1) / MESH_OPTIMIZER_MIN_JOB_SIZE;
+	jobCount = jobCount < maxJobCount ? jobCount : maxJobCount;
+	return jobCount > 0 ? jobCount : 1;
+}
+
+// ================================== Normal recalculation ==================================
+// Every job accumulates the cross products of a range of triangles into its own window of the vertices, from the lowest to the highest vertex its triangles use.
+// Triangles that are close in the index buffer use vertices that are close in the vertex buffer in (welded) meshes, so the windows barely overlap.
+// The windows are then summed per vertex range, where every vertex only gets the windows that contain it.
+typedef struct NormalJobData
+{
+	u8* vertices;
+	u32* indices;
+	u32 vertexStride;
+	u32 positionOffset;
+	u32 normalOffset;
+	u32 triangleCount;
+	u32 vertexCount;
+	u32 trianglesPerJob;
+	u32 verticesPerJob;
+	u32 jobCount;
+	u32* windowStarts;			// Lowest vertex of every job's triangles
+	u32* windowEnds;			// One past the highest vertex
+	u64* windowOffsets;			// Offset of every job's window in windowNormals
+	vec3* windowNormals;
+} NormalJobData;
+
+static void NormalWindowJob(void* data, u32 jobIndex)
+{
+	NormalJobData* jobData = data;
+	u32 triangleStart = jobIndex * jobData->trianglesPerJob;
+	u32 triangleEnd = triangleStart + jobData->trianglesPerJob < jobData->triangleCount ? triangleStart + jobData->trianglesPerJob : jobData->triangleCount;
+
+	u32 windowStart = UINT32_MAX;
+	u32 windowEnd = 0;
+	for (u32 i = triangleStart * 3; i < triangleEnd * 3; i++)
+	{
+		u32 vertex = jobData->indices[i];
+		windowStart = vertex < windowStart ? vertex : windowStart;
+		windowEnd = vertex + 1 > windowEnd ? vertex + 1 : windowEnd;
+	}
+	jobData->windowStarts[jobIndex] = windowStart < windowEnd ? windowStart : 0;
+	jobData->windowEnds[jobIndex] = windowEnd;
+}
+
+static void NormalAccumulateJob(void* data, u32 jobIndex)
+{
+	NormalJobData* jobData = data;
+	u32 triangleStart = jobIndex * jobData->trianglesPerJob;
+	u32 triangleEnd = triangleStart + jobData->trianglesPerJob < jobData->triangleCount ? triangleStart + jobData->trianglesPerJob : jobData->triangleCount;
+	u32 windowStart = jobData->windowStarts[jobIndex];
+	vec3* windowNormals = jobData->windowNormals + jobData->windowOffsets[jobIndex];
+	MemoryZero(windowNormals, sizeof(*windowNormals) * (jobData->windowEnds[jobIndex] - windowStart));
+
+	u8* positions = jobData->vertices + jobData->positionOffset;
+	u32 stride = jobData->vertexStride;
+	for (u32 i = triangleStart * 3; i < triangleEnd * 3; i += 3)
+	{
+		u32 i1 = jobData->indices[i];
+		u32 i2 = jobData->indices[i + 1];
+		u32 i3 = jobData->indices[i + 2];
+		vec3 v1 = *(vec3*)(positions + stride * i1);
+		vec3 v2 = *(vec3*)(positions + stride * i2);
+		vec3 v3 = *(vec3*)(positions + stride * i3);
+		vec3 crossProduct = vec3_cross_vec3(vec3_sub_vec3(v2, v3), vec3_sub_vec3(v1, v3));
+		windowNormals[i1 - windowStart] = vec3_add_vec3(windowNormals[i1 - windowStart], crossProduct);
+		windowNormals[i2 - windowStart] = vec3_add_vec3(windowNormals[i2 - windowStart], crossProduct);
+		windowNormals[i3 - windowStart] = vec3_add_vec3(windowNormals[i3 - windowStart], crossProduct);
+	}
+}
+
+static void NormalResolveJob(void* data, u32 jobIndex)
+{
+	NormalJobData* jobData = data;
+	u32 vertexStart = jobIndex * jobData->verticesPerJob;
+	u32 vertexEnd = vertexStart + jobData->verticesPerJob < jobData->vertexCount ? vertexStart + jobData->verticesPerJob : jobData->vertexCount;
+	u8* normals = jobData->vertices + jobData->normalOffset;
+
+	for (u32 v = vertexStart; v < vertexEnd; v++)
+		*(vec3*)(normals + jobData->vertexStride * v) = vec3_create(0, 0, 0);
+
+	for (u32 window = 0; window < jobData->jobCount; window++)
+	{
+		u32 windowStart = jobData->windowStarts[window];
+		u32 start = windowStart > vertexStart ? windowStart : vertexStart;
+		u32 end = jobData->windowEnds[window] < vertexEnd ? jobData->windowEnds[window] : vertexEnd;
+		vec3* windowNormals = jobData->windowNormals + jobData->windowOffsets[window];
+		for (u32 v = start; v < end; v++)
+		{
+			vec3* normal = (vec3*)(normals + jobData->vertexStride * v);
+			*normal = vec3_add_vec3(*normal, windowNormals[v - windowStart]);
+		}
+	}
+
+	for (u32 v = vertexStart; v < vertexEnd; v++)
+	{
+		vec3* normal = (vec3*)(normals + jobData->vertexStride * v);
+		*normal = vec3_normalize(*normal);
+	}
+}
+
+// Sets the normal of every vertex to the area weighted average of the normals of the triangles that use it, spread over the job system
+static void RecalculateNormals(MeshData* mesh, u32 positionOffset, u32 normalOffset)
+{
+	if (mesh->vertexCount == 0)
+		return;
+
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	u32 threadCount = JobSystemGetThreadCount();
+	NormalJobData jobData = {};
+	jobData.vertices = mesh->vertices;
+	jobData.indices = mesh->indices;
+	jobData.vertexStride = mesh->vertexStride;
+	jobData.positionOffset = positionOffset;
+	jobData.normalOffset = normalOffset;
+	jobData.triangleCount = mesh->indexCount / 3;
+	jobData.vertexCount = mesh->vertexCount;
+	jobData.jobCount = GetJobCount(jobData.triangleCount, threadCount);
+	jobData.trianglesPerJob = (jobData.triangleCount + jobData.jobCount - 1) / jobData.jobCount;
+	jobData.windowStarts = ArenaAlloc(global->frameArena, sizeof(*jobData.windowStarts) * jobData.jobCount);
+	jobData.windowEnds = ArenaAlloc(global->frameArena, sizeof(*jobData.windowEnds) * jobData.jobCount);
+	jobData.windowOffsets = ArenaAlloc(global->frameArena, sizeof(*jobData.windowOffsets) * jobData.jobCount);
+
+	JobSystemParallelFor(NormalWindowJob, &jobData, jobData.jobCount, threadCount);
+
+	u64 totalWindowSize = 0;
+	for (u32 i = 0; i < jobData.jobCount; i++)
+	{
+		jobData.windowOffsets[i] = totalWindowSize;
+		totalWindowSize += jobData.windowEnds[i] - jobData.windowStarts[i];
+	}
+
+	// Meshes with vertices in an order unrelated to the triangles would need a window of (almost) every vertex per job
+	if (totalWindowSize > (u64)mesh->vertexCount * NORMAL_WINDOW_SIZE_LIMIT_FACTOR)
+	{
+		jobData.jobCount = 1;
+		jobData.trianglesPerJob = jobData.triangleCount;
+		NormalWindowJob(&jobData, 0);
+		jobData.windowOffsets[0] = 0;
+		totalWindowSize = jobData.windowEnds[0] - jobData.windowStarts[0];
+	}
+
+	jobData.windowNormals = ArenaAlignedAlloc(global->frameArena, sizeof(*jobData.windowNormals) * totalWindowSize, CACHE_ALIGN);
+	JobSystemParallelFor(NormalAccumulateJob, &jobData, jobData.jobCount, threadCount);
+
+	u32 resolveJobCount = GetJobCount(mesh->vertexCount, threadCount);
+	jobData.verticesPerJob = (mesh->vertexCount + resolveJobCount - 1) / resolveJobCount;
+	JobSystemParallelFor(NormalResolveJob, &jobData, resolveJobCount, threadCount);
+
+	ArenaFreeMarker(global->frameArena, marker);
+}
+
+// ================================== Welding ==================================
+// Vertices are welded by a key of three u32's: the bits of the position for exact welding, or the grid cell of the position for welding with a grid.
+// The keys and their hashes are made in parallel, inserting them into the hash table is serial so the first vertex with a key is kept and the vertex order stays the same.
+typedef struct WeldKeyJobData
+{
+	u8* vertices;
+	u32 vertexStride;
+	u32 positionOffset;
+	u32 vertexCount;
+	u32 verticesPerJob;
+	f32 inverseGridSize;		// 0 for exact welding
+	u32* keys;					// Three per vertex
+	u32* hashes;
+	u32* indices;
+	u32* remap;
+	u32 indexCount;
+	u32 indicesPerJob;
+} WeldKeyJobData;
+
+// Murmur3 finalizer of the mixed key values
+static inline u32 HashWeldKey(const u32* key)
+{
+	u32 hash = key[0] * 0x9e3779b1u ^ key[1] * 0x85ebca77u ^ key[2] * 0xc2b2ae3du;
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35u;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+static void WeldKeyJob(void* data, u32 jobIndex)
+{
+	WeldKeyJobData* jobData = data;
+	u32 vertexStart = jobIndex * jobData->verticesPerJob;
+	u32 vertexEnd = vertexStart + jobData->verticesPerJob < jobData->vertexCount ? vertexStart + jobData->verticesPerJob : jobData->vertexCount;
+
+	for (u32 i = vertexStart; i < vertexEnd; i++)
+	{
+		vec3 position = *(vec3*)(jobData->vertices + jobData->positionOffset + jobData->vertexStride * i);
+		u32* key = jobData->keys + i * 3;
+		if (jobData->inverseGridSize > 0)
+		{
+			key[0] = (u32)(i32)floorf(position.x * jobData->inverseGridSize);
+			key[1] = (u32)(i32)floorf(position.y * jobData->inverseGridSize);
+			key[2] = (u32)(i32)floorf(position.z * jobData->inverseGridSize);
+		}
+		else
+		{
+			key[0] = *(u32*)&position.x;
+			key[1] = *(u32*)&position.y;
+			key[2] = *(u32*)&position.z;
+		}
+		jobData->hashes[i] = HashWeldKey(key);
+	}
+}
+
+static void WeldRemapIndicesJob(void* data, u32 jobIndex)
+{
+	WeldKeyJobData* jobData = data;
+	u32 indexStart = jobIndex * jobData->indicesPerJob;
+	u32 indexEnd = indexStart + jobData->indicesPerJob < jobData->indexCount ? indexStart + jobData->indicesPerJob : jobData->indexCount;
+
+	for (u32 i = indexStart; i < indexEnd; i++)
+		jobData->indices[i] = jobData->remap[jobData->indices[i]];
+}
 
 MeshData MeshOptimizerMergeNormals(MeshData originalMesh, u32 positionOffset, u32 normalOffset)
 {
-	// Creating a new mesh that can be edited without destroying the original
+	return MeshOptimizerWeldVertices(originalMesh, positionOffset, normalOffset, 0);
+}
+
+MeshData MeshOptimizerWeldVertices(MeshData originalMesh, u32 positionOffset, u32 normalOffset, f32 weldGridSize)
+{
+	u32 vertexCount = originalMesh.vertexCount;
+	u32 vertexStride = originalMesh.vertexStride;
+	GRASSERT_DEBUG(vertexCount > 0);
+
 	MeshData newMesh = {};
+	newMesh.vertexStride = vertexStride;
 	newMesh.indexCount = originalMesh.indexCount;
 	newMesh.indices = AlignedAlloc(global->largeObjectAllocator, sizeof(*newMesh.indices) * originalMesh.indexCount, CACHE_ALIGN);
 	MemoryCopy(newMesh.indices, originalMesh.indices, sizeof(*newMesh.indices) * originalMesh.indexCount);
-	newMesh.vertices = AlignedAlloc(global->largeObjectAllocator, originalMesh.vertexCount * originalMesh.vertexStride, CACHE_ALIGN);
-	MemoryCopy(newMesh.vertices, originalMesh.vertices, originalMesh.vertexCount * originalMesh.vertexStride);
-	newMesh.vertexStride = originalMesh.vertexStride;
-
-	u8* vertices = newMesh.vertices;
-	u64 verticesMaxAddress = (u64)vertices + originalMesh.vertexCount * originalMesh.vertexStride;
+	newMesh.vertices = AlignedAlloc(global->largeObjectAllocator, vertexCount * vertexStride, CACHE_ALIGN);
 
 	ArenaMarker marker = ArenaGetMarker(global->frameArena);
 
-	START_SCOPE("Merge normals - Creating a map from old verts to new verts");
-	// Finding indices of duplicate vertices, 
-	// making a mapping from the old vertex indices to the new vertex indices
-	u32* duplicateVertexIndices = ArenaAlignedAlloc(global->frameArena, sizeof(*duplicateVertexIndices) * originalMesh.vertexCount, CACHE_ALIGN);
-	u32* originalVertexIndexToNewVertexIndex = ArenaAlignedAlloc(global->frameArena, sizeof(*originalVertexIndexToNewVertexIndex) * originalMesh.vertexCount, CACHE_ALIGN);
-	u32* hashToOldVertexIndex = ArenaAlignedAlloc(global->frameArena, sizeof(*hashToOldVertexIndex) * originalMesh.vertexCount * HASH_BACKING_ARRAY_SIZE_FACTOR, CACHE_ALIGN);
-	MemorySet(hashToOldVertexIndex, INT32_MAX, sizeof(*hashToOldVertexIndex) * originalMesh.vertexCount * HASH_BACKING_ARRAY_SIZE_FACTOR);
-	u32 duplicateVertexCount = 0;
-	originalVertexIndexToNewVertexIndex[0] = 0;
-	for (u32 i = 0; i < originalMesh.vertexCount; i++)
-	{
-		bool duplicate = false;
-		vec3* iPosition = (vec3*)(vertices + positionOffset + originalMesh.vertexStride * i);
-		originalVertexIndexToNewVertexIndex[i] = i - duplicateVertexCount;
-
-		// Calculating jenkins one at a time hash of the vec3
-		u32 hash = 0;
-		u8* key = (u8*)iPosition;
-		for (u32 i = 0; i < VEC3_BYTE_COUNT; i++)
-		{
-			hash += key[i];
-			hash += hash << 10;
-			hash ^= hash >> 6;
-		}
-		hash += hash << 3;
-		hash ^= hash >> 11;
-		hash += hash << 15;
-		hash %= (size_t)(originalMesh.vertexCount * HASH_BACKING_ARRAY_SIZE_FACTOR);
-
-		while (hashToOldVertexIndex[hash] != UINT32_MAX)
-		{
-			vec3* possibleDuplicatePosition = (vec3*)(vertices + positionOffset + originalMesh.vertexStride * hashToOldVertexIndex[hash]);
-			if (MemoryCompare(iPosition, possibleDuplicatePosition, sizeof(vec3)))
-			{
-				duplicate = true;
-				duplicateVertexIndices[duplicateVertexCount] = i;
-				duplicateVertexCount++;
+	u32 threadCount = JobSystemGetThreadCount();
+	WeldKeyJobData jobData = {};
+	jobData.vertices = originalMesh.vertices;
+	jobData.vertexStride = vertexStride;
+	jobData.positionOffset = positionOffset;
+	jobData.vertexCount = vertexCount;
+	jobData.inverseGridSize = weldGridSize > 0 ? 1.0f / weldGridSize : 0;
+	jobData.keys = ArenaAlignedAlloc(global->frameArena, sizeof(*jobData.keys) * 3 * vertexCount, CACHE_ALIGN);
+	jobData.hashes = ArenaAlignedAlloc(global->frameArena, sizeof(*jobData.hashes) * vertexCount, CACHE_ALIGN);
+	jobData.remap = ArenaAlignedAlloc(global->frameArena, sizeof(*jobData.remap) * vertexCount, CACHE_ALIGN);
+	jobData.indices = newMesh.indices;
+	jobData.indexCount = newMesh.indexCount;
+
+	START_SCOPE("Merge normals - Hashing positions");
+	u32 keyJobCount = GetJobCount(vertexCount, threadCount);
+	jobData.verticesPerJob = (vertexCount + keyJobCount - 1) / keyJobCount;
+	JobSystemParallelFor(WeldKeyJob, &jobData, keyJobCount, threadCount);
+	END_SCOPE();
 
-				originalVertexIndexToNewVertexIndex[i] = originalVertexIndexToNewVertexIndex[hashToOldVertexIndex[hash]];
+	START_SCOPE("Merge normals - Welding vertices");
+	// Open addressing with linear probing, slots hold the original index of the first vertex with a key.
+	// The kept vertices are copied to the new mesh in the same pass, so they stay in their original order.
+	u32 tableSize = 1;
+	while (tableSize < vertexCount * WELD_HASH_TABLE_SLOTS_PER_VERTEX)
+		tableSize <<= 1;
+	u32 tableMask = tableSize - 1;
+	u32* table = ArenaAlignedAlloc(global->frameArena, sizeof(*table) * tableSize, CACHE_ALIGN);
+	MemorySet(table, 0xFF, sizeof(*table) * tableSize);
 
+	u8* originalVertices = originalMesh.vertices;
+	u8* newVertices = newMesh.vertices;
+	u32 newVertexCount = 0;
+	for (u32 i = 0; i < vertexCount; i++)
+	{
+		u32* key = jobData.keys + i * 3;
+		u32 slot = jobData.hashes[i] & tableMask;
+		while (true)
+		{
+			u32 candidate = table[slot];
+			if (candidate == UINT32_MAX)
+			{
+				table[slot] = i;
+				jobData.remap[i] = newVertexCount;
+				MemoryCopy(newVertices + vertexStride * newVertexCount, originalVertices + vertexStride * i, vertexStride);
+				newVertexCount++;
 				break;
 			}
-			hash++;
-			hash %= (size_t)(originalMesh.vertexCount * HASH_BACKING_ARRAY_SIZE_FACTOR);
-		}
 
-		if (!duplicate)
-		{
-			hashToOldVertexIndex[hash] = i;
+			u32* candidateKey = jobData.keys + candidate * 3;
+			if (key[0] == candidateKey[0] && key[1] == candidateKey[1] && key[2] == candidateKey[2])
+			{
+				jobData.remap[i] = jobData.remap[candidate];
+				break;
+			}
+			slot = (slot + 1) & tableMask;
 		}
 	}
 	END_SCOPE();
 
 	START_SCOPE("Merge normals - Mapping vertices");
-	// Mapping the old indices to the new indices
-	for (u32 i = 0; i < newMesh.indexCount; i++)
+	u32 remapJobCount = GetJobCount(newMesh.indexCount, threadCount);
+	jobData.indicesPerJob = (newMesh.indexCount + remapJobCount - 1) / remapJobCount;
+	JobSystemParallelFor(WeldRemapIndicesJob, &jobData, remapJobCount, threadCount);
+
+	// Vertices of a triangle can end up in the same grid cell, those triangles have no area anymore
+	if (weldGridSize > 0)
 	{
-		newMesh.indices[i] = originalVertexIndexToNewVertexIndex[newMesh.indices[i]];
+		u32 keptIndexCount = 0;
+		for (u32 i = 0; i < newMesh.indexCount; i += 3)
+		{
+			u32 i1 = newMesh.indices[i];
+			u32 i2 = newMesh.indices[i + 1];
+			u32 i3 = newMesh.indices[i + 2];
+			if (i1 == i2 || i2 == i3 || i1 == i3)
+				continue;
+			newMesh.indices[keptIndexCount] = i1;
+			newMesh.indices[keptIndexCount + 1] = i2;
+			newMesh.indices[keptIndexCount + 2] = i3;
+			keptIndexCount += 3;
+		}
+		newMesh.indexCount = keptIndexCount;
 	}
 	END_SCOPE();
 
-	START_SCOPE("Merge normals - Removing obsolete vertices");
-	// Removing obsolete vertices
-	u32 removedVertexCount = 0;
-	u32 nextDuplicateVertexIndex = duplicateVertexIndices[0];
-	for (u32 i = duplicateVertexIndices[0]; i < originalMesh.vertexCount; i++)
+	START_SCOPE("Merge normals - Freeing excess memory now that verts have been deduplicated");
+	newMesh.vertexCount = newVertexCount;
+	newMesh.vertices = Realloc(global->largeObjectAllocator, newMesh.vertices, newMesh.vertexCount * newMesh.vertexStride);
+	END_SCOPE();
+
+	// "Freeing" the memory from the temporary arrays, because they could be quite large and this function might be run multiple times per frame
+	ArenaFreeMarker(global->frameArena, marker);
+
+	START_SCOPE("Merge normals - Recalculating normals");
+	RecalculateNormals(&newMesh, positionOffset, normalOffset);
+	END_SCOPE();
+
+	return newMesh;
+}
+
+// ================================== Simplification ==================================
+// Quadric error metric simplification (Garland and Heckbert). Every vertex has a quadric that measures the squared distance to the planes of
+// the triangles around it, collapsing an edge moves one of its vertices onto the other and sums their quadrics, the error of a collapse is the
+// quadric of the sum evaluated at the kept vertex. Collapses only keep one of the two vertices (no new positions), so every vertex attribute stays valid.
+// Collapses are done in passes: the candidate edges are sorted by error and collapsed in order, each vertex is touched by at most one collapse per pass
+// so the triangle adjacency only has to be rebuilt between passes.
+
+// Symmetric 4x4 matrix of the sum of the squared plane distances, weight is the sum of the triangle areas so the error can be averaged
+typedef struct Quadric
+{
+	f32 a2, b2, c2, ab, ac, bc, ad, bd, cd, d2;
+	f32 weight;
+} Quadric;
+
+// Amount of buckets of the counting sort of the collapses, the buckets are the upper 16 bits of the (non negative) f32 error
+#define COLLAPSE_SORT_BUCKET_COUNT 65536
+
+// Collapses with an error above the error of the collapse that would reach the target times this factor wait for the next pass
+#define PASS_ERROR_LIMIT_FACTOR 1.5f
+// Every pass does at least this part of the collapses that would reach the target, even if they are above the error limit
+#define PASS_MIN_COLLAPSE_GOAL_DIVISOR 4
+
+// Corner that follows a corner of a triangle, the edges of a triangle run from every corner to the next one
+static const u32 nextTriangleCorner[3] = { 1, 2, 0 };
+
+typedef struct EdgeCollapse
+{
+	u32 from;
+	u32 to;
+	f32 error;
+} EdgeCollapse;
+
+static inline vec3 GetVertexPosition(u8* vertices, u32 vertexStride, u32 positionOffset, u32 vertexIndex)
+{
+	return *(vec3*)(vertices + positionOffset + vertexStride * vertexIndex);
+}
+
+static inline void QuadricAdd(Quadric* quadric, Quadric* other)
+{
+	quadric->a2 += other->a2;
+	quadric->b2 += other->b2;
+	quadric->c2 += other->c2;
+	quadric->ab += other->ab;
+	quadric->ac += other->ac;
+	quadric->bc += other->bc;
+	quadric->ad += other->ad;
+	quadric->bd += other->bd;
+	quadric->cd += other->cd;
+	quadric->d2 += other->d2;
+	quadric->weight += other->weight;
+}
+
+// Quadric of the plane of the triangle weighted by its area
+static inline Quadric QuadricFromTriangle(vec3 p0, vec3 p1, vec3 p2)
+{
+	vec3 normal = vec3_cross_vec3(vec3_sub_vec3(p1, p0), vec3_sub_vec3(p2, p0));
+	f32 doubleArea = vec3_magnitude(normal);
+
+	Quadric quadric = {};
+	if (doubleArea == 0)
+		return quadric;
+
+	normal = vec3_div_float(normal, doubleArea);
+	f32 d = -vec3_dot(normal, p0);
+	f32 weight = doubleArea * 0.5f;
+	quadric.a2 = normal.x * normal.x * weight;
+	quadric.b2 = normal.y * normal.y * weight;
+	quadric.c2 = normal.z * normal.z * weight;
+	quadric.ab = normal.x * normal.y * weight;
+	quadric.ac = normal.x * normal.z * weight;
+	quadric.bc = normal.y * normal.z * weight;
+	quadric.ad = normal.x * d * weight;
+	quadric.bd = normal.y * d * weight;
+	quadric.cd = normal.z * d * weight;
+	quadric.d2 = d * d * weight;
+	quadric.weight = weight;
+	return quadric;
+}
+
+// Area weighted average of the squared distances from the position to the planes of the quadric
+static inline f32 QuadricError(Quadric* quadric, vec3 p)
+{
+	f32 error = quadric->a2 * p.x * p.x + quadric->b2 * p.y * p.y + quadric->c2 * p.z * p.z +
+		2 * (quadric->ab * p.x * p.y + quadric->ac * p.x * p.z + quadric->bc * p.y * p.z) +
+		2 * (quadric->ad * p.x + quadric->bd * p.y + quadric->cd * p.z) + quadric->d2;
+	return quadric->weight > 0 ? fabsf(error) / quadric->weight : 0;
+}
+
+// Builds the list of triangles around every vertex, the triangles of vertex v are out_triangles[out_offsets[v]] up to out_triangles[out_offsets[v + 1]]
+static void BuildVertexTriangleAdjacency(u32* indices, u32 indexCount, u32 vertexCount, u32* out_offsets, u32* out_triangles)
+{
+	MemorySet(out_offsets, 0, sizeof(*out_offsets) * (vertexCount + 1));
+	for (u32 i = 0; i < indexCount; i++)
+		out_offsets[indices[i] + 1]++;
+	for (u32 v = 0; v < vertexCount; v++)
+		out_offsets[v + 1] += out_offsets[v];
+
+	// Filling the lists using the offsets as write cursors, which shifts them one vertex up, so they are shifted back afterwards
+	for (u32 i = 0; i < indexCount; i++)
+		out_triangles[out_offsets[indices[i]]++] = i / 3;
+	for (u32 v = vertexCount; v > 0; v--)
+		out_offsets[v] = out_offsets[v - 1];
+	out_offsets[0] = 0;
+}
+
+// Checks that collapsing from onto to keeps the mesh manifold and doesn't flip any triangle, the adjacency of both vertices needs to be up to date
+static bool IsCollapseValid(u8* vertices, u32 vertexStride, u32 positionOffset, u32* indices, u32* adjacencyOffsets, u32* adjacencyTriangles, u32 from, u32 to)
+{
+	// Link condition: the only vertices connected to both from and to are the opposite corners of the two triangles on the edge,
+	// otherwise the collapse would fold the surface onto itself and create edges shared by more than two triangles
+	u32 sharedNeighbourCount = 0;
+	for (u32 i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; i++)
 	{
-		if (i == nextDuplicateVertexIndex)
+		u32* triangle = indices + adjacencyTriangles[i] * 3;
+		for (u32 corner = 0; corner < 3; corner++)
 		{
-			removedVertexCount++;
-			if (removedVertexCount < duplicateVertexCount)
-				nextDuplicateVertexIndex = duplicateVertexIndices[removedVertexCount];
+			u32 neighbour = triangle[corner];
+			if (neighbour == from || neighbour == to)
+				continue;
+
+			// Every neighbour is seen twice around a closed fan, only the first time counts
+			bool seenBefore = false;
+			for (u32 j = adjacencyOffsets[from]; j < i && !seenBefore; j++)
+			{
+				u32* otherTriangle = indices + adjacencyTriangles[j] * 3;
+				seenBefore = otherTriangle[0] == neighbour || otherTriangle[1] == neighbour || otherTriangle[2] == neighbour;
+			}
+			if (seenBefore)
+				continue;
+
+			for (u32 j = adjacencyOffsets[to]; j < adjacencyOffsets[to + 1]; j++)
+			{
+				u32* otherTriangle = indices + adjacencyTriangles[j] * 3;
+				if (otherTriangle[0] == neighbour || otherTriangle[1] == neighbour || otherTriangle[2] == neighbour)
+				{
+					sharedNeighbourCount++;
+					break;
+				}
+			}
 		}
-		else
+	}
+	if (sharedNeighbourCount != 2)
+		return false;
+
+	// The triangles around from that stay (the ones that don't contain to) can't flip when from moves onto to
+	vec3 toPosition = GetVertexPosition(vertices, vertexStride, positionOffset, to);
+	for (u32 i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; i++)
+	{
+		u32* triangle = indices + adjacencyTriangles[i] * 3;
+		if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+			continue;
+
+		vec3 p[3];
+		for (u32 corner = 0; corner < 3; corner++)
+			p[corner] = GetVertexPosition(vertices, vertexStride, positionOffset, triangle[corner]);
+		vec3 normalBefore = vec3_cross_vec3(vec3_sub_vec3(p[1], p[0]), vec3_sub_vec3(p[2], p[0]));
+		for (u32 corner = 0; corner < 3; corner++)
+			p[corner] = triangle[corner] == from ? toPosition : p[corner];
+		vec3 normalAfter = vec3_cross_vec3(vec3_sub_vec3(p[1], p[0]), vec3_sub_vec3(p[2], p[0]));
+
+		if (vec3_dot(normalBefore, normalAfter) <= 0)
+			return false;
+
+		// A triangle around to that already uses the other two corners would become a duplicate of the moved triangle (e.g. when collapsing a tetrahedron)
+		u32 other0 = triangle[0] == from ? triangle[1] : triangle[0];
+		u32 other1 = triangle[2] == from ? triangle[1] : triangle[2];
+		for (u32 j = adjacencyOffsets[to]; j < adjacencyOffsets[to + 1]; j++)
 		{
-			GRASSERT_DEBUG((u64)vertices + newMesh.vertexStride * i < verticesMaxAddress);
-			MemoryCopy(vertices + newMesh.vertexStride * (i - removedVertexCount), vertices + newMesh.vertexStride * i, newMesh.vertexStride);
+			u32* otherTriangle = indices + adjacencyTriangles[j] * 3;
+			bool hasOther0 = otherTriangle[0] == other0 || otherTriangle[1] == other0 || otherTriangle[2] == other0;
+			bool hasOther1 = otherTriangle[0] == other1 || otherTriangle[1] == other1 || otherTriangle[2] == other1;
+			if (hasOther0 && hasOther1)
+				return false;
 		}
 	}
-	END_SCOPE();
 
-	START_SCOPE("Merge normals - Freeing excess memory now that verts have been deduplicated");
-	// Readjusting the allocation of the new mesh's vertices depending on how many duplicate verts were found
-	newMesh.vertexCount = originalMesh.vertexCount - removedVertexCount;
-	newMesh.vertices = Realloc(global->largeObjectAllocator, newMesh.vertices, newMesh.vertexCount * newMesh.vertexStride);
+	return true;
+}
+
+MeshData MeshOptimizerSimplify(MeshData originalMesh, u32 positionOffset, u32 normalOffset, u32 targetIndexCount, f32 targetError, f32* out_error)
+{
+	GRASSERT_DEBUG(originalMesh.indexCount % 3 == 0);
+
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	u8* vertices = originalMesh.vertices;
+	u32 vertexStride = originalMesh.vertexStride;
+	u32 vertexCount = originalMesh.vertexCount;
+	u32 indexCount = originalMesh.indexCount;
+	f32 maxSquaredError = targetError * targetError;
+	f32 resultSquaredError = 0;
+
+	u32* indices = ArenaAlloc(global->frameArena, sizeof(*indices) * indexCount);
+	MemoryCopy(indices, originalMesh.indices, sizeof(*indices) * indexCount);
+	u32* adjacencyOffsets = ArenaAlloc(global->frameArena, sizeof(*adjacencyOffsets) * (vertexCount + 1));
+	u32* adjacencyTriangles = ArenaAlloc(global->frameArena, sizeof(*adjacencyTriangles) * indexCount);
+	u32* remap = ArenaAlloc(global->frameArena, sizeof(*remap) * vertexCount);
+	bool* locked = ArenaAlloc(global->frameArena, sizeof(*locked) * vertexCount);
+	bool* touched = ArenaAlloc(global->frameArena, sizeof(*touched) * vertexCount);
+	Quadric* quadrics = ArenaAlloc(global->frameArena, sizeof(*quadrics) * vertexCount);
+	EdgeCollapse* collapses = ArenaAlloc(global->frameArena, sizeof(*collapses) * indexCount);
+	EdgeCollapse* sortedCollapses = ArenaAlloc(global->frameArena, sizeof(*sortedCollapses) * indexCount);
+	u32* bucketOffsets = ArenaAlloc(global->frameArena, sizeof(*bucketOffsets) * (COLLAPSE_SORT_BUCKET_COUNT + 1));
+
+	START_SCOPE("Simplify - Quadrics and borders");
+	MemorySet(quadrics, 0, sizeof(*quadrics) * vertexCount);
+	for (u32 i = 0; i < indexCount; i += 3)
+	{
+		Quadric triangleQuadric = QuadricFromTriangle(GetVertexPosition(vertices, vertexStride, positionOffset, indices[i]),
+			GetVertexPosition(vertices, vertexStride, positionOffset, indices[i + 1]), GetVertexPosition(vertices, vertexStride, positionOffset, indices[i + 2]));
+		for (u32 corner = 0; corner < 3; corner++)
+			QuadricAdd(&quadrics[indices[i + corner]], &triangleQuadric);
+	}
+
+	// Vertices on edges that don't have exactly one triangle on either side (borders of open meshes, like the sides of a chunk, and non manifold edges)
+	// are never moved, so the borders stay where they are and the meshes of neighbouring chunks still meet without holes
+	BuildVertexTriangleAdjacency(indices, indexCount, vertexCount, adjacencyOffsets, adjacencyTriangles);
+	MemorySet(locked, 0, sizeof(*locked) * vertexCount);
+	for (u32 i = 0; i < indexCount; i++)
+	{
+		u32 a = indices[i];
+		u32 b = indices[i - i % 3 + nextTriangleCorner[i % 3]];
+		u32 oppositeEdgeCount = 0;
+		u32 sameEdgeCount = 0;
+		for (u32 j = adjacencyOffsets[a]; j < adjacencyOffsets[a + 1]; j++)
+		{
+			u32* triangle = indices + adjacencyTriangles[j] * 3;
+			for (u32 corner = 0; corner < 3; corner++)
+			{
+				oppositeEdgeCount += triangle[corner] == b && triangle[nextTriangleCorner[corner]] == a;
+				sameEdgeCount += triangle[corner] == a && triangle[nextTriangleCorner[corner]] == b;
+			}
+		}
+		if (oppositeEdgeCount != 1 || sameEdgeCount != 1)
+		{
+			locked[a] = true;
+			locked[b] = true;
+		}
+	}
 	END_SCOPE();
 
-	START_SCOPE("Merge normals - Recalculating normals");
-	// ======================================== Recalculating normals
-	// Zeroing the normals
-	for (u32 i = 0; i < newMesh.vertexCount; i++)
+	START_SCOPE("Simplify - Collapsing edges");
+	while (indexCount > targetIndexCount)
 	{
-		vec3* v = (vec3*)(vertices + normalOffset + originalMesh.vertexStride * i);
-		*v = vec3_create(0, 0, 0);
+		if (indexCount != originalMesh.indexCount)
+			BuildVertexTriangleAdjacency(indices, indexCount, vertexCount, adjacencyOffsets, adjacencyTriangles);
+
+		// Every interior edge is in two triangles, once in either direction, only the direction with the lower vertex first is a candidate.
+		// The collapse direction with the lower error is used.
+		u32 collapseCount = 0;
+		for (u32 i = 0; i < indexCount; i++)
+		{
+			u32 a = indices[i];
+			u32 b = indices[i - i % 3 + nextTriangleCorner[i % 3]];
+			if (a > b || (locked[a] && locked[b]))
+				continue;
+
+			Quadric sum = quadrics[a];
+			QuadricAdd(&sum, &quadrics[b]);
+			f32 errorAToB = locked[a] ? FLT_MAX : QuadricError(&sum, GetVertexPosition(vertices, vertexStride, positionOffset, b));
+			f32 errorBToA = locked[b] ? FLT_MAX : QuadricError(&sum, GetVertexPosition(vertices, vertexStride, positionOffset, a));
+			EdgeCollapse collapse = errorAToB <= errorBToA ? (EdgeCollapse){ a, b, errorAToB } : (EdgeCollapse){ b, a, errorBToA };
+			if (collapse.error <= maxSquaredError)
+			{
+				collapses[collapseCount] = collapse;
+				collapseCount++;
+			}
+		}
+
+		// Counting sort on the upper bits of the error, which orders the collapses up to the first few bits of the mantissa
+		MemorySet(bucketOffsets, 0, sizeof(*bucketOffsets) * (COLLAPSE_SORT_BUCKET_COUNT + 1));
+		for (u32 i = 0; i < collapseCount; i++)
+			bucketOffsets[(*(u32*)&collapses[i].error >> 16) + 1]++;
+		for (u32 bucket = 0; bucket < COLLAPSE_SORT_BUCKET_COUNT; bucket++)
+			bucketOffsets[bucket + 1] += bucketOffsets[bucket];
+		for (u32 i = 0; i < collapseCount; i++)
+			sortedCollapses[bucketOffsets[*(u32*)&collapses[i].error >> 16]++] = collapses[i];
+
+		// Collapsing the cheapest edges first. The triangles around the moved vertex are the only ones that change, so its neighbours can't be part of
+		// another collapse in the same pass (the triangle lists of the other neighbours of the kept vertex are still correct)
+		// A pass stops at collapses much more expensive than the one that would reach the target if every collapse could be done,
+		// so the blocked cheap collapses get done in the next pass before expensive ones
+		for (u32 v = 0; v < vertexCount; v++)
+			remap[v] = v;
+		MemorySet(touched, 0, sizeof(*touched) * vertexCount);
+		u32 removedIndexCount = 0;
+		u32 appliedCollapseCount = 0;
+		u32 collapseGoal = (indexCount - targetIndexCount) / 6;
+		f32 passErrorLimit = collapseCount > 0 ? sortedCollapses[collapseGoal < collapseCount ? collapseGoal : collapseCount - 1].error * PASS_ERROR_LIMIT_FACTOR : 0;
+		for (u32 i = 0; i < collapseCount && indexCount - removedIndexCount > targetIndexCount; i++)
+		{
+			EdgeCollapse collapse = sortedCollapses[i];
+			// Many of the cheap collapses can be invalid, the limit is ignored until a part of the goal is done so every pass makes progress
+			if (collapse.error > passErrorLimit && appliedCollapseCount >= collapseGoal / PASS_MIN_COLLAPSE_GOAL_DIVISOR)
+				break;
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+			if (!IsCollapseValid(vertices, vertexStride, positionOffset, indices, adjacencyOffsets, adjacencyTriangles, collapse.from, collapse.to))
+				continue;
+
+			remap[collapse.from] = collapse.to;
+			QuadricAdd(&quadrics[collapse.to], &quadrics[collapse.from]);
+			resultSquaredError = collapse.error > resultSquaredError ? collapse.error : resultSquaredError;
+			appliedCollapseCount++;
+
+			for (u32 j = adjacencyOffsets[collapse.from]; j < adjacencyOffsets[collapse.from + 1]; j++)
+			{
+				u32* triangle = indices + adjacencyTriangles[j] * 3;
+				touched[triangle[0]] = true;
+				touched[triangle[1]] = true;
+				touched[triangle[2]] = true;
+				// The two triangles on the collapsed edge disappear
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+					removedIndexCount += 3;
+			}
+		}
+
+		if (appliedCollapseCount == 0)
+			break;
+
+		// Moving the collapsed vertices and removing the triangles that became degenerate
+		u32 writtenIndexCount = 0;
+		for (u32 i = 0; i < indexCount; i += 3)
+		{
+			u32 a = remap[indices[i]];
+			u32 b = remap[indices[i + 1]];
+			u32 c = remap[indices[i + 2]];
+			if (a == b || b == c || c == a)
+				continue;
+
+			indices[writtenIndexCount] = a;
+			indices[writtenIndexCount + 1] = b;
+			indices[writtenIndexCount + 2] = c;
+			writtenIndexCount += 3;
+		}
+		GRASSERT_DEBUG(writtenIndexCount == indexCount - removedIndexCount);
+		indexCount = writtenIndexCount;
 	}
+	END_SCOPE();
 
-	// Accumulating cross products of all triangles connected to each vertex
-	for (u32 i = 0; i < newMesh.indexCount / 3; i++)
+	START_SCOPE("Simplify - Creating the simplified mesh");
+	// Keeping the vertices that are still used in their original order, remap now maps old vertex indices to new ones
+	for (u32 v = 0; v < vertexCount; v++)
+		remap[v] = UINT32_MAX;
+	for (u32 i = 0; i < indexCount; i++)
+		remap[indices[i]] = 0;
+	u32 newVertexCount = 0;
+	for (u32 v = 0; v < vertexCount; v++)
 	{
-		u32 triangleStartIndex = i * 3;
-		vec3 v1 = *((vec3*)(vertices + positionOffset + originalMesh.vertexStride * newMesh.indices[triangleStartIndex]));
-		vec3 v2 = *((vec3*)(vertices + positionOffset + originalMesh.vertexStride * newMesh.indices[triangleStartIndex + 1]));
-		vec3 v3 = *((vec3*)(vertices + positionOffset + originalMesh.vertexStride * newMesh.indices[triangleStartIndex + 2]));
-		vec3 edge1 = vec3_sub_vec3(v2, v3);
-		vec3 edge2 = vec3_sub_vec3(v1, v3);
-		vec3 crossProduct = vec3_cross_vec3(edge1, edge2);
-		vec3* n1 = (vec3*)(vertices + normalOffset + originalMesh.vertexStride * newMesh.indices[triangleStartIndex]);
-		vec3* n2 = (vec3*)(vertices + normalOffset + originalMesh.vertexStride * newMesh.indices[triangleStartIndex + 1]);
-		vec3* n3 = (vec3*)(vertices + normalOffset + originalMesh.vertexStride * newMesh.indices[triangleStartIndex + 2]);
-		*n1 = vec3_add_vec3(*n1, crossProduct);
-		*n2 = vec3_add_vec3(*n2, crossProduct);
-		*n3 = vec3_add_vec3(*n3, crossProduct);
+		if (remap[v] != UINT32_MAX)
+		{
+			remap[v] = newVertexCount;
+			newVertexCount++;
+		}
 	}
 
-	// normalizing vertex normals
-	for (u32 i = 0; i < newMesh.vertexCount; i++)
+	MeshData newMesh = {};
+	newMesh.vertexStride = vertexStride;
+	newMesh.vertexCount = newVertexCount;
+	newMesh.indexCount = indexCount;
+	newMesh.vertices = AlignedAlloc(global->largeObjectAllocator, newVertexCount * vertexStride, CACHE_ALIGN);
+	newMesh.indices = AlignedAlloc(global->largeObjectAllocator, sizeof(*newMesh.indices) * indexCount, CACHE_ALIGN);
+	for (u32 v = 0; v < vertexCount; v++)
 	{
-		vec3* newVertexNormal = (vec3*)(vertices + normalOffset + originalMesh.vertexStride * i);
-		*newVertexNormal = vec3_normalize(*newVertexNormal);
+		if (remap[v] != UINT32_MAX)
+			MemoryCopy((u8*)newMesh.vertices + vertexStride * remap[v], vertices + vertexStride * v, vertexStride);
 	}
+	for (u32 i = 0; i < indexCount; i++)
+		newMesh.indices[i] = remap[indices[i]];
+
+	RecalculateNormals(&newMesh, positionOffset, normalOffset);
 	END_SCOPE();
 
-	// "Freeing" the memory from the temporary vert and indices array, because they could be quite large and this function might be run multiple times per frame
+	if (out_error)
+		*out_error = sqrtf(resultSquaredError);
+
+	// "Freeing" the working copy of the indices, the adjacency and the collapse lists
 	ArenaFreeMarker(global->frameArena, marker);
 
 	return newMesh;
 }
+
+// ================================== Gpu ordering ==================================
+// Reorders the triangles and vertices of a mesh so the gpu does less work drawing it, the mesh itself stays the same.
+// Vertex cache: triangles that share vertices are drawn close together (Tipsify, Sander et al. 2007), so the transformed vertices are still in the post transform cache.
+// Overdraw: the clusters of triangles that the vertex cache order made are sorted so the ones facing away from the center of the mesh are drawn first,
+// which are the ones most likely to occlude the rest. Vertex fetch: vertices are stored in the order they are first used by the triangles.
+
+// Amount of vertices in the simulated post transform cache, a fifo cache of this size is a conservative model of current gpus
+#define VERTEX_CACHE_SIZE 16
+// Amount of buckets of the counting sort of the overdraw clusters
+#define CLUSTER_SORT_BUCKET_COUNT 65536
+
+// Returns the next vertex to fan around: the neighbour of the last fan that stays in the cache longest after its remaining triangles are drawn,
+// otherwise the most recent vertex on the dead end stack that still has triangles, otherwise the next vertex with triangles in index order
+static u32 GetNextFanningVertex(u32* candidates, u32 candidateCount, u32* cacheTimestamps, u32 timestamp, u32* liveTriangleCounts, u32* deadEndStack, u32* deadEndStackSize, u32* nextInputVertex, u32 vertexCount)
+{
+	u32 bestVertex = UINT32_MAX;
+	i32 bestPriority = -1;
+	for (u32 i = 0; i < candidateCount; i++)
+	{
+		u32 vertex = candidates[i];
+		if (liveTriangleCounts[vertex] == 0)
+			continue;
+
+		// Vertices that would fall out of the cache while their fan is drawn get the lowest priority
+		i32 priority = 0;
+		if (timestamp - cacheTimestamps[vertex] + 2 * liveTriangleCounts[vertex] <= VERTEX_CACHE_SIZE)
+			priority = timestamp - cacheTimestamps[vertex];
+		if (priority > bestPriority)
+		{
+			bestPriority = priority;
+			bestVertex = vertex;
+		}
+	}
+	if (bestVertex != UINT32_MAX)
+		return bestVertex;
+
+	while (*deadEndStackSize > 0)
+	{
+		(*deadEndStackSize)--;
+		u32 vertex = deadEndStack[*deadEndStackSize];
+		if (liveTriangleCounts[vertex] > 0)
+			return vertex;
+	}
+
+	while (*nextInputVertex < vertexCount)
+	{
+		u32 vertex = *nextInputVertex;
+		(*nextInputVertex)++;
+		if (liveTriangleCounts[vertex] > 0)
+			return vertex;
+	}
+
+	return UINT32_MAX;
+}
+
+void MeshOptimizerOptimizeVertexCache(MeshData* mesh)
+{
+	if (mesh->indexCount == 0)
+		return;
+
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	u32 vertexCount = mesh->vertexCount;
+	u32 indexCount = mesh->indexCount;
+	u32* adjacencyOffsets = ArenaAlloc(global->frameArena, sizeof(*adjacencyOffsets) * (vertexCount + 1));
+	u32* adjacencyTriangles = ArenaAlloc(global->frameArena, sizeof(*adjacencyTriangles) * indexCount);
+	BuildVertexTriangleAdjacency(mesh->indices, indexCount, vertexCount, adjacencyOffsets, adjacencyTriangles);
+
+	u32* liveTriangleCounts = ArenaAlloc(global->frameArena, sizeof(*liveTriangleCounts) * vertexCount);
+	for (u32 v = 0; v < vertexCount; v++)
+		liveTriangleCounts[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+	u32* cacheTimestamps = ArenaAlloc(global->frameArena, sizeof(*cacheTimestamps) * vertexCount);
+	MemorySet(cacheTimestamps, 0, sizeof(*cacheTimestamps) * vertexCount);
+	bool* emitted = ArenaAlloc(global->frameArena, sizeof(*emitted) * indexCount / 3);
+	MemorySet(emitted, 0, sizeof(*emitted) * indexCount / 3);
+	// Every vertex of every emitted triangle is pushed once, so the dead end stack and the candidates can't be longer than the index count
+	u32* deadEndStack = ArenaAlloc(global->frameArena, sizeof(*deadEndStack) * indexCount);
+	u32 deadEndStackSize = 0;
+	u32* candidates = ArenaAlloc(global->frameArena, sizeof(*candidates) * indexCount);
+	u32* newIndices = ArenaAlloc(global->frameArena, sizeof(*newIndices) * indexCount);
+	u32 newIndexCount = 0;
+
+	// Timestamps start above the cache size, so every vertex starts out of the cache
+	u32 timestamp = VERTEX_CACHE_SIZE + 1;
+	u32 nextInputVertex = 0;
+	u32 fanningVertex = 0;
+	if (liveTriangleCounts[0] == 0)
+		fanningVertex = GetNextFanningVertex(nullptr, 0, cacheTimestamps, timestamp, liveTriangleCounts, deadEndStack, &deadEndStackSize, &nextInputVertex, vertexCount);
+
+	while (fanningVertex != UINT32_MAX)
+	{
+		// Drawing all remaining triangles around the fanning vertex, their vertices are the candidates for the next fan
+		u32 candidateCount = 0;
+		for (u32 i = adjacencyOffsets[fanningVertex]; i < adjacencyOffsets[fanningVertex + 1]; i++)
+		{
+			u32 triangle = adjacencyTriangles[i];
+			if (emitted[triangle])
+				continue;
+
+			for (u32 corner = 0; corner < 3; corner++)
+			{
+				u32 vertex = mesh->indices[triangle * 3 + corner];
+				newIndices[newIndexCount] = vertex;
+				newIndexCount++;
+				deadEndStack[deadEndStackSize] = vertex;
+				deadEndStackSize++;
+				candidates[candidateCount] = vertex;
+				candidateCount++;
+				liveTriangleCounts[vertex]--;
+				if (timestamp - cacheTimestamps[vertex] > VERTEX_CACHE_SIZE)
+				{
+					cacheTimestamps[vertex] = timestamp;
+					timestamp++;
+				}
+			}
+			emitted[triangle] = true;
+		}
+
+		fanningVertex = GetNextFanningVertex(candidates, candidateCount, cacheTimestamps, timestamp, liveTriangleCounts, deadEndStack, &deadEndStackSize, &nextInputVertex, vertexCount);
+	}
+	GRASSERT_DEBUG(newIndexCount == indexCount);
+
+	MemoryCopy(mesh->indices, newIndices, sizeof(*newIndices) * indexCount);
+
+	ArenaFreeMarker(global->frameArena, marker);
+}
+
+void MeshOptimizerOptimizeOverdraw(MeshData* mesh, u32 positionOffset)
+{
+	if (mesh->indexCount == 0)
+		return;
+
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	u8* vertices = mesh->vertices;
+	u32 vertexStride = mesh->vertexStride;
+	u32 indexCount = mesh->indexCount;
+	u32 triangleCount = indexCount / 3;
+
+	// Clusters start at the triangles where all three vertices miss the simulated cache, which is where the vertex cache order restarted somewhere else.
+	// Reordering whole clusters keeps the cache efficiency within the clusters.
+	u32* clusterStarts = ArenaAlloc(global->frameArena, sizeof(*clusterStarts) * (triangleCount + 1));
+	u32 clusterCount = 0;
+	u32* cacheTimestamps = ArenaAlloc(global->frameArena, sizeof(*cacheTimestamps) * mesh->vertexCount);
+	MemorySet(cacheTimestamps, 0, sizeof(*cacheTimestamps) * mesh->vertexCount);
+	u32 timestamp = VERTEX_CACHE_SIZE + 1;
+	for (u32 triangle = 0; triangle < triangleCount; triangle++)
+	{
+		u32 missCount = 0;
+		for (u32 corner = 0; corner < 3; corner++)
+		{
+			u32 vertex = mesh->indices[triangle * 3 + corner];
+			if (timestamp - cacheTimestamps[vertex] > VERTEX_CACHE_SIZE)
+			{
+				cacheTimestamps[vertex] = timestamp;
+				timestamp++;
+				missCount++;
+			}
+		}
+		if (missCount == 3 || triangle == 0)
+		{
+			clusterStarts[clusterCount] = triangle;
+			clusterCount++;
+		}
+	}
+	clusterStarts[clusterCount] = triangleCount;
+
+	// Center of the mesh, the area weighted average of the triangle centroids
+	vec3 meshCenter = vec3_create(0, 0, 0);
+	f32 meshArea = 0;
+	for (u32 i = 0; i < indexCount; i += 3)
+	{
+		vec3 p0 = GetVertexPosition(vertices, vertexStride, positionOffset, mesh->indices[i]);
+		vec3 p1 = GetVertexPosition(vertices, vertexStride, positionOffset, mesh->indices[i + 1]);
+		vec3 p2 = GetVertexPosition(vertices, vertexStride, positionOffset, mesh->indices[i + 2]);
+		f32 area = vec3_magnitude(vec3_cross_vec3(vec3_sub_vec3(p1, p0), vec3_sub_vec3(p2, p0)));
+		meshCenter = vec3_add_vec3(meshCenter, vec3_mul_f32(vec3_add_vec3(vec3_add_vec3(p0, p1), p2), area / 3));
+		meshArea += area;
+	}
+	meshCenter = meshArea > 0 ? vec3_div_float(meshCenter, meshArea) : meshCenter;
+
+	// Clusters that face away from the center are more likely to occlude the rest of the mesh, the sort key is the distance of the cluster's plane
+	// from the center (the triangle winding gives the front side). The key is flipped so the largest distance comes first in the ascending sort.
+	u32* clusterKeys = ArenaAlloc(global->frameArena, sizeof(*clusterKeys) * clusterCount);
+	for (u32 cluster = 0; cluster < clusterCount; cluster++)
+	{
+		vec3 clusterCenter = vec3_create(0, 0, 0);
+		vec3 clusterNormal = vec3_create(0, 0, 0);
+		f32 clusterArea = 0;
+		for (u32 i = clusterStarts[cluster] * 3; i < clusterStarts[cluster + 1] * 3; i += 3)
+		{
+			vec3 p0 = GetVertexPosition(vertices, vertexStride, positionOffset, mesh->indices[i]);
+			vec3 p1 = GetVertexPosition(vertices, vertexStride, positionOffset, mesh->indices[i + 1]);
+			vec3 p2 = GetVertexPosition(vertices, vertexStride, positionOffset, mesh->indices[i + 2]);
+			vec3 normal = vec3_cross_vec3(vec3_sub_vec3(p1, p0), vec3_sub_vec3(p2, p0));
+			f32 area = vec3_magnitude(normal);
+			clusterCenter = vec3_add_vec3(clusterCenter, vec3_mul_f32(vec3_add_vec3(vec3_add_vec3(p0, p1), p2), area / 3));
+			clusterNormal = vec3_add_vec3(clusterNormal, normal);
+			clusterArea += area;
+		}
+		clusterCenter = clusterArea > 0 ? vec3_div_float(clusterCenter, clusterArea) : clusterCenter;
+		f32 normalLength = vec3_magnitude(clusterNormal);
+		f32 distance = normalLength > 0 ? vec3_dot(vec3_sub_vec3(clusterCenter, meshCenter), clusterNormal) / normalLength : 0;
+
+		// Making the float bits sort like unsigned integers (flipping all bits of negative values, the sign bit of positive ones), then reversing the order
+		u32 bits = *(u32*)&distance;
+		bits = bits & 0x80000000 ? ~bits : bits | 0x80000000;
+		clusterKeys[cluster] = ~bits;
+	}
+
+	// Counting sort of the clusters on the upper bits of their key
+	u32* bucketOffsets = ArenaAlloc(global->frameArena, sizeof(*bucketOffsets) * (CLUSTER_SORT_BUCKET_COUNT + 1));
+	MemorySet(bucketOffsets, 0, sizeof(*bucketOffsets) * (CLUSTER_SORT_BUCKET_COUNT + 1));
+	for (u32 cluster = 0; cluster < clusterCount; cluster++)
+		bucketOffsets[(clusterKeys[cluster] >> 16) + 1]++;
+	for (u32 bucket = 0; bucket < CLUSTER_SORT_BUCKET_COUNT; bucket++)
+		bucketOffsets[bucket + 1] += bucketOffsets[bucket];
+	u32* sortedClusters = ArenaAlloc(global->frameArena, sizeof(*sortedClusters) * clusterCount);
+	for (u32 cluster = 0; cluster < clusterCount; cluster++)
+		sortedClusters[bucketOffsets[clusterKeys[cluster] >> 16]++] = cluster;
+
+	u32* newIndices = ArenaAlloc(global->frameArena, sizeof(*newIndices) * indexCount);
+	u32 newIndexCount = 0;
+	for (u32 i = 0; i < clusterCount; i++)
+	{
+		u32 cluster = sortedClusters[i];
+		u32 clusterIndexCount = (clusterStarts[cluster + 1] - clusterStarts[cluster]) * 3;
+		MemoryCopy(newIndices + newIndexCount, mesh->indices + clusterStarts[cluster] * 3, sizeof(*newIndices) * clusterIndexCount);
+		newIndexCount += clusterIndexCount;
+	}
+	MemoryCopy(mesh->indices, newIndices, sizeof(*newIndices) * indexCount);
+
+	ArenaFreeMarker(global->frameArena, marker);
+}
+
+void MeshOptimizerOptimizeVertexFetch(MeshData* mesh)
+{
+	if (mesh->indexCount == 0)
+		return;
+
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	u32 vertexStride = mesh->vertexStride;
+	u32* remap = ArenaAlloc(global->frameArena, sizeof(*remap) * mesh->vertexCount);
+	MemorySet(remap, 0xFF, sizeof(*remap) * mesh->vertexCount);
+	u8* oldVertices = ArenaAlloc(global->frameArena, vertexStride * mesh->vertexCount);
+	MemoryCopy(oldVertices, mesh->vertices, vertexStride * mesh->vertexCount);
+
+	// Vertices get their new index the first time a triangle uses them, unused vertices are removed
+	u32 newVertexCount = 0;
+	for (u32 i = 0; i < mesh->indexCount; i++)
+	{
+		u32 vertex = mesh->indices[i];
+		if (remap[vertex] == UINT32_MAX)
+		{
+			remap[vertex] = newVertexCount;
+			MemoryCopy((u8*)mesh->vertices + vertexStride * newVertexCount, oldVertices + vertexStride * vertex, vertexStride);
+			newVertexCount++;
+		}
+		mesh->indices[i] = remap[vertex];
+	}
+
+	if (newVertexCount != mesh->vertexCount)
+	{
+		mesh->vertices = Realloc(global->largeObjectAllocator, mesh->vertices, vertexStride * newVertexCount);
+		mesh->vertexCount = newVertexCount;
+	}
+
+	ArenaFreeMarker(global->frameArena, marker);
+}
+
+VertexCacheStatistics MeshOptimizerAnalyzeVertexCache(MeshData mesh)
+{
+	VertexCacheStatistics statistics = {};
+	if (mesh.indexCount == 0)
+		return statistics;
+
+	ArenaMarker marker = ArenaGetMarker(global->frameArena);
+
+	u32* cacheTimestamps = ArenaAlloc(global->frameArena, sizeof(*cacheTimestamps) * mesh.vertexCount);
+	MemorySet(cacheTimestamps, 0, sizeof(*cacheTimestamps) * mesh.vertexCount);
+	bool* used = ArenaAlloc(global->frameArena, sizeof(*used) * mesh.vertexCount);
+	MemorySet(used, 0, sizeof(*used) * mesh.vertexCount);
+
+	u32 timestamp = VERTEX_CACHE_SIZE + 1;
+	u32 missCount = 0;
+	u32 usedVertexCount = 0;
+	for (u32 i = 0; i < mesh.indexCount; i++)
+	{
+		u32 vertex = mesh.indices[i];
+		if (timestamp - cacheTimestamps[vertex] > VERTEX_CACHE_SIZE)
+		{
+			cacheTimestamps[vertex] = timestamp;
+			timestamp++;
+			missCount++;
+		}
+		if (!used[vertex])
+		{
+			used[vertex] = true;
+			usedVertexCount++;
+		}
+	}
+
+	statistics.acmr = missCount / (f32)(mesh.indexCount / 3);
+	statistics.atvr = missCount / (f32)usedVertexCount;
+
+	ArenaFreeMarker(global->frameArena, marker);
+
+	return statistics;
+}
+
+// ================================== Vertex packing ==================================
+#define PACKED_POSITION_MAX 65535.0f
+#define PACKED_NORMAL_MAX 32767.0f
+
+static inline f32 SignNotZero(f32 value)
+{
+	return value >= 0 ? 1.0f : -1.0f;
+}
+
+// Decodes a normal the same way the vertex shaders do
+static vec3 OctahedralDecode(const i16* encoded)
+{
+	f32 u = encoded[0] / PACKED_NORMAL_MAX;
+	f32 v = encoded[1] / PACKED_NORMAL_MAX;
+	vec3 normal = vec3_create(u, v, 1 - fabsf(u) - fabsf(v));
+	if (normal.z < 0)
+	{
+		normal.x = (1 - fabsf(v)) * SignNotZero(u);
+		normal.y = (1 - fabsf(u)) * SignNotZero(v);
+	}
+	return vec3_normalize(normal);
+}
+
+// Projects the normal onto the octahedron |x| + |y| + |z| = 1 and folds the lower half over the upper half, so it's stored in two values in [-1, 1].
+// Of the four ways to round the two values the one that decodes closest to the original normal is used.
+static void OctahedralEncode(vec3 normal, i16* out_encoded)
+{
+	f32 length = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+	out_encoded[0] = 0;
+	out_encoded[1] = 0;
+	if (length == 0)
+		return;
+
+	f32 u = normal.x / length;
+	f32 v = normal.y / length;
+	if (normal.z < 0)
+	{
+		f32 foldedU = (1 - fabsf(v)) * SignNotZero(u);
+		f32 foldedV = (1 - fabsf(u)) * SignNotZero(v);
+		u = foldedU;
+		v = foldedV;
+	}
+
+	vec3 normalized = vec3_div_float(normal, vec3_magnitude(normal));
+	f32 bestDot = -2;
+	for (u32 i = 0; i < 4; i++)
+	{
+		f32 roundedU = i & 1 ? ceilf(u * PACKED_NORMAL_MAX) : floorf(u * PACKED_NORMAL_MAX);
+		f32 roundedV = i & 2 ? ceilf(v * PACKED_NORMAL_MAX) : floorf(v * PACKED_NORMAL_MAX);
+		i16 candidate[2];
+		candidate[0] = (i16)(roundedU > PACKED_NORMAL_MAX ? PACKED_NORMAL_MAX : roundedU < -PACKED_NORMAL_MAX ? -PACKED_NORMAL_MAX : roundedU);
+		candidate[1] = (i16)(roundedV > PACKED_NORMAL_MAX ? PACKED_NORMAL_MAX : roundedV < -PACKED_NORMAL_MAX ? -PACKED_NORMAL_MAX : roundedV);
+		f32 dot = vec3_dot(normalized, OctahedralDecode(candidate));
+		if (dot > bestDot)
+		{
+			bestDot = dot;
+			out_encoded[0] = candidate[0];
+			out_encoded[1] = candidate[1];
+		}
+	}
+}
+
+void MeshOptimizerPackVertices(MeshData mesh, u32 positionOffset, u32 normalOffset, vec3 origin, f32 extent, VertexPacked* out_vertices)
+{
+	START_SCOPE("Packing vertices");
+
+	u8* vertices = mesh.vertices;
+	f32 positionScale = PACKED_POSITION_MAX / extent;
+	for (u32 i = 0; i < mesh.vertexCount; i++)
+	{
+		vec3 position = GetVertexPosition(vertices, mesh.vertexStride, positionOffset, i);
+		vec3 normal = *(vec3*)(vertices + mesh.vertexStride * i + normalOffset);
+
+		vec3 normalizedPosition = vec3_mul_f32(vec3_sub_vec3(position, origin), positionScale);
+		for (u32 axis = 0; axis < 3; axis++)
+		{
+			f32 value = ((f32*)&normalizedPosition)[axis] + 0.5f;
+			value = value < 0 ? 0 : value > PACKED_POSITION_MAX ? PACKED_POSITION_MAX : value;
+			out_vertices[i].position[axis] = (u16)value;
+		}
+		out_vertices[i].position[3] = 0;
+		OctahedralEncode(normal, out_vertices[i].normal);
+	}
+
+	END_SCOPE();
+}
+
+void MeshOptimizerUnpackVertices(VertexPacked* vertices, u32 vertexCount, vec3 origin, f32 extent, VertexT2* out_vertices)
+{
+	f32 positionScale = extent / PACKED_POSITION_MAX;
+	for (u32 i = 0; i < vertexCount; i++)
+	{
+		vec3 normalizedPosition = vec3_create(vertices[i].position[0], vertices[i].position[1], vertices[i].position[2]);
+		out_vertices[i].position = vec3_add_vec3(origin, vec3_mul_f32(normalizedPosition, positionScale));
+		out_vertices[i].normal = OctahedralDecode(vertices[i].normal);
+	}
+}
+
+mat4 MeshOptimizerGetUnpackMatrix(vec3 origin, f32 extent)
+{
+	return mat4_mul_mat4(mat4_3Dtranslate(origin), mat4_3Dscale(vec3_from_float(extent)));
+}
+
+// ================================== Index size ==================================
+u32 MeshOptimizerGetIndexSize(MeshData mesh)
+{
+	return mesh.vertexCount <= MAX_16_BIT_INDEXED_VERTEX_COUNT ? sizeof(u16) : sizeof(u32);
+}
+
+void MeshOptimizerNarrowIndices(MeshData mesh, u16* out_indices)
+{
+	GRASSERT_DEBUG(MeshOptimizerGetIndexSize(mesh) == sizeof(u16));
+
+	for (u32 i = 0; i < mesh.indexCount; i++)
+		out_indices[i] = (u16)mesh.indices[i];
+}
@@ -3,7 +3,51 @@
 #include "renderer_types.h"
 #include "core/engine.h"
 
+// Welds vertices with exactly the same position and recalculates the normals as the area weighted average of the triangles around every vertex
 MeshData MeshOptimizerMergeNormals(MeshData originalMesh, u32 positionOffset, u32 normalOffset);
+// Same as MeshOptimizerMergeNormals, but if weldGridSize is above 0 vertices are welded when their positions fall in the same cell of a grid with that cell size
+// (vertices closer than weldGridSize in different cells aren't welded) and triangles that lose their area are removed. The first vertex of every cell is kept.
+// Hashing, index remapping and the normals are spread over the job system.
+MeshData MeshOptimizerWeldVertices(MeshData originalMesh, u32 positionOffset, u32 normalOffset, f32 weldGridSize);
+
+// Reduces the triangle count of a welded mesh (triangles share vertices through the indices) by collapsing edges in order of quadric error,
+// until the mesh has at most targetIndexCount indices or every remaining collapse has an error above targetError (a distance in the units of the positions).
+// Collapses move a vertex onto a neighbour, so the kept vertices are copied unchanged (any stride and attributes) and only the normals are recalculated.
+// Vertices on borders of open meshes and on non manifold edges are never moved and collapses that would make the mesh non manifold or flip triangles
+// are skipped, so a watertight mesh stays watertight and meshes of neighbouring chunks still meet. out_error (optional) is set to the largest error of the collapses.
+MeshData MeshOptimizerSimplify(MeshData originalMesh, u32 positionOffset, u32 normalOffset, u32 targetIndexCount, f32 targetError, f32* out_error);
+
+// Transformed vertices per triangle (average cache miss ratio, 0.5 is the best a big regular mesh can get, 3 means no reuse at all)
+// and transformed vertices per vertex (1 is the best possible) of a mesh drawn in index order with a simulated fifo post transform cache
+typedef struct VertexCacheStatistics
+{
+	f32 acmr;
+	f32 atvr;
+} VertexCacheStatistics;
+
+// The functions below reorder a mesh in place for drawing without changing what is drawn, they are meant to be used in this order:
+// the overdraw optimization sorts the clusters of triangles that the vertex cache optimization made, and the vertex fetch optimization uses the final triangle order.
+// Reorders the triangles so vertices are reused while they are in the post transform cache (Tipsify)
+void MeshOptimizerOptimizeVertexCache(MeshData* mesh);
+// Sorts the clusters of triangles in the vertex cache order so the clusters facing away from the center of the mesh are drawn first
+void MeshOptimizerOptimizeOverdraw(MeshData* mesh, u32 positionOffset);
+// Reorders the vertices to the order the triangles first use them and removes unused vertices, the vertices need to be allocated with the large object allocator
+void MeshOptimizerOptimizeVertexFetch(MeshData* mesh);
+VertexCacheStatistics MeshOptimizerAnalyzeVertexCache(MeshData mesh);
+
+// Packed vertices store their position as a fraction of the packing bounds, a cube with side length extent starting at origin (positions outside are clamped),
+// so the precision is extent / 65535. Normals are octahedral encoded in two 16 bit values, with an error below 0.01 degrees.
+// Both are written to out_vertices, which needs space for mesh.vertexCount vertices. The indices of the mesh can be used with the packed vertices as they are.
+void MeshOptimizerPackVertices(MeshData mesh, u32 positionOffset, u32 normalOffset, vec3 origin, f32 extent, VertexPacked* out_vertices);
+void MeshOptimizerUnpackVertices(VertexPacked* vertices, u32 vertexCount, vec3 origin, f32 extent, VertexT2* out_vertices);
+// Transforms the normalized positions the gpu reads from packed vertices to positions in the space of the unpacked mesh,
+// the model matrix of the unpacked mesh multiplied with this one is the model matrix of the packed mesh
+mat4 MeshOptimizerGetUnpackMatrix(vec3 origin, f32 extent);
+
+// Returns the narrowest index size (in bytes) the mesh can be drawn with: 2 if it has at most MAX_16_BIT_INDEXED_VERTEX_COUNT vertices, otherwise 4
+u32 MeshOptimizerGetIndexSize(MeshData mesh);
+// Writes the indices of the mesh as 16 bit indices to out_indices (space for mesh.indexCount u16's), MeshOptimizerGetIndexSize has to return 2 for the mesh
+void MeshOptimizerNarrowIndices(MeshData mesh, u16* out_indices);
 
 static inline void MeshOptimizerFreeMeshData(MeshData meshData)
 {
@@ -3,6 +3,7 @@
 #include "containers/darray.h"
 #include "core/logger.h"
 #include "math/math_types.h"
+#include "mesh_optimizer.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -209,7 +210,22 @@ bool LoadObj(const char* filename, VertexBuffer* out_vb, IndexBuffer* out_ib, bo
 
     // ============================== Uploading the vertices and indices to the GPU ===============================================
     *out_vb = VertexBufferCreate(objVerticesDarray->data, objVerticesDarray->stride * objVerticesDarray->size);
-    *out_ib = IndexBufferCreate(objIndices->data, objIndices->size);
+    // Meshes with few enough vertices get 16 bit indices
+    MeshData meshData = {};
+    meshData.indices = objIndices->data;
+    meshData.indexCount = objIndices->size;
+    meshData.vertexCount = objVerticesDarray->size;
+    if (MeshOptimizerGetIndexSize(meshData) == sizeof(u16))
+    {
+        u16* narrowIndices = Alloc(GetGlobalAllocator(), sizeof(*narrowIndices) * meshData.indexCount);
+        MeshOptimizerNarrowIndices(meshData, narrowIndices);
+        *out_ib = IndexBufferCreate16(narrowIndices, meshData.indexCount);
+        Free(GetGlobalAllocator(), narrowIndices);
+    }
+    else
+    {
+        *out_ib = IndexBufferCreate(objIndices->data, objIndices->size);
+    }
 
     // ============================== Cleanup ===============================================
     DarrayDestroy(objVerticesDarray);
@@ -43,6 +43,13 @@ typedef struct VertexT2
 	vec3 normal;
 } VertexT2;
 
+// VertexT2 in half the size, for meshes that only live on the gpu. See MeshOptimizerPackVertices for the encoding.
+typedef struct VertexPacked
+{
+	u16 position[4];	// Unorm position in the packing bounds of the mesh, the fourth component is padding
+	i16 normal[2];		// Snorm octahedral encoded normal
+} VertexPacked;
+
 typedef struct VertexT3
 {
 	vec3 position;
@@ -50,6 +57,9 @@ typedef struct VertexT3
 	vec2 uvCoord;
 } VertexT3;
 
+// Meshes with at most this many vertices can use 16 bit index buffers, the index 0xFFFF is left unused so it can't be read as a primitive restart
+#define MAX_16_BIT_INDEXED_VERTEX_COUNT 65535
+
 typedef struct MeshData
 {
 	void* vertices;
@@ -91,6 +101,8 @@ typedef enum VertexAttributeType
     VERTEX_ATTRIBUTE_TYPE_VEC3,
     VERTEX_ATTRIBUTE_TYPE_VEC4,
     VERTEX_ATTRIBUTE_TYPE_MAT4,
+    VERTEX_ATTRIBUTE_TYPE_UNORM16_VEC4,     // Four u16's that the shader reads as a vec4 in [0, 1]
+    VERTEX_ATTRIBUTE_TYPE_SNORM16_VEC2,     // Two i16's that the shader reads as a vec2 in [-1, 1]
 } VertexAttributeType;
 
 #define MAX_VERTEX_ATTRIBUTES 15
@@ -32,3 +32,11 @@ vec4 ToLinearRGB(vec4 sRGB)
     return vec4(mix(higher, lower, cutoff), sRGB.a);
 }
 
+// Decodes an octahedral encoded normal of a packed vertex (see MeshOptimizerPackVertices), the result isn't normalized
+vec3 OctahedralDecode(vec2 encoded)
+{
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (normal.z < 0.0)
+        normal.xy = (1.0 - abs(encoded.yx)) * mix(vec2(-1.0), vec2(1.0), greaterThanEqual(encoded, vec2(0.0)));
+    return normal;
+}
@@ -54,10 +54,10 @@ bool InitializeTextRenderer()
 	charRectVertexData[2].position = vec2_create(0, 1);
 	charRectVertexData[3].position = vec2_create(1, 1);
 
-	u32 charRectIndexData[RECT_INDEX_COUNT] = { 0, 1, 2, 3, 2, 1 };
+	u16 charRectIndexData[RECT_INDEX_COUNT] = { 0, 1, 2, 3, 2, 1 };
 
 	state->glyphRectVB = VertexBufferCreate(charRectVertexData, sizeof(charRectVertexData));
-	state->glyphRectIB = IndexBufferCreate(charRectIndexData, RECT_INDEX_COUNT);
+	state->glyphRectIB = IndexBufferCreate16(charRectIndexData, RECT_INDEX_COUNT);
 
 	// Creating the bezier shader and material
 	ShaderCreateInfo shaderCreateInfo = {};
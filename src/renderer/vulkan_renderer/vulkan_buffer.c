@@ -90,13 +90,14 @@ void VertexBufferDestroy(VertexBuffer clientBuffer)
 	Free(vk_state->rendererAllocator, buffer);
 }
 
-IndexBuffer IndexBufferCreate(u32* indices, size_t indexCount)
+static IndexBuffer CreateIndexBuffer(void* indices, size_t indexCount, size_t indexSize, VkIndexType indexType)
 {
 	IndexBuffer clientBuffer;
 	clientBuffer.internalState = Alloc(vk_state->rendererAllocator, sizeof(VulkanIndexBuffer));
 	VulkanIndexBuffer* buffer = (VulkanIndexBuffer*)clientBuffer.internalState;
-	buffer->size = indexCount * sizeof(u32);
+	buffer->size = indexCount * indexSize;
 	buffer->indexCount = indexCount;
+	buffer->indexType = indexType;
 
 	// ================ Staging buffer =========================
 	VkBuffer stagingBuffer;
@@ -126,6 +127,16 @@ IndexBuffer IndexBufferCreate(u32* indices, size_t indexCount)
 	return clientBuffer;
 }
 
+IndexBuffer IndexBufferCreate(u32* indices, size_t indexCount)
+{
+	return CreateIndexBuffer(indices, indexCount, sizeof(*indices), VK_INDEX_TYPE_UINT32);
+}
+
+IndexBuffer IndexBufferCreate16(u16* indices, size_t indexCount)
+{
+	return CreateIndexBuffer(indices, indexCount, sizeof(*indices), VK_INDEX_TYPE_UINT16);
+}
+
 void IndexBufferDestroy(IndexBuffer clientBuffer)
 {
 	VulkanIndexBuffer* buffer = (VulkanIndexBuffer*)clientBuffer.internalState;
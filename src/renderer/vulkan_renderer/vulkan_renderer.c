@@ -699,9 +699,9 @@ bool InitializeRenderer(RendererInitSettings settings)
 		3, -1, 0.f, 		2, 0,
 		-1, -1, 0.f, 		0, 0,
 	};
-	u32 fullscreenTriangleIndices[FULLSCREEN_TRIANGLE_VERT_COUNT] = { 0, 1, 2 };
+	u16 fullscreenTriangleIndices[FULLSCREEN_TRIANGLE_VERT_COUNT] = { 0, 1, 2 };
 	basicMeshDataArray[currentBasicMeshIndex].vertexBuffer = VertexBufferCreate(fullscreenTriangleVertices, sizeof(fullscreenTriangleVertices));
-	basicMeshDataArray[currentBasicMeshIndex].indexBuffer = IndexBufferCreate(fullscreenTriangleIndices, FULLSCREEN_TRIANGLE_VERT_COUNT);
+	basicMeshDataArray[currentBasicMeshIndex].indexBuffer = IndexBufferCreate16(fullscreenTriangleIndices, FULLSCREEN_TRIANGLE_VERT_COUNT);
 	SimpleMapInsert(vk_state->basicMeshMap, BASIC_MESH_NAME_FULL_SCREEN_TRIANGLE, basicMeshDataArray + currentBasicMeshIndex);
 	currentBasicMeshIndex++;
 
@@ -1248,7 +1248,7 @@ void Draw(u32 vertexBufferCount, VertexBuffer* clientVertexBuffers, IndexBuffer
 	// binding index and vertex buffers
 	VkDeviceSize offsets[2] = { 0, 0 };
 	vkCmdBindVertexBuffers(currentCommandBuffer, 0, vertexBufferCount, vertexBuffers, offsets);
-	vkCmdBindIndexBuffer(currentCommandBuffer, indexBuffer->handle, offsets[0], VK_INDEX_TYPE_UINT32);
+	vkCmdBindIndexBuffer(currentCommandBuffer, indexBuffer->handle, offsets[0], indexBuffer->indexType);
 
 	if (pushConstantValues)
 		vkCmdPushConstants(currentCommandBuffer, vk_state->boundShader->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(*pushConstantValues), pushConstantValues);
@@ -1273,7 +1273,7 @@ void DrawInstancedIndexed(u32 vertexBufferCount, VertexBuffer* clientVertexBuffe
 	// binding index and vertex buffers
 	VkDeviceSize offsets[2] = { 0, 0 };
 	vkCmdBindVertexBuffers(currentCommandBuffer, 0, vertexBufferCount, vertexBuffers, offsets);
-	vkCmdBindIndexBuffer(currentCommandBuffer, indexBuffer->handle, offsets[0], VK_INDEX_TYPE_UINT32);
+	vkCmdBindIndexBuffer(currentCommandBuffer, indexBuffer->handle, offsets[0], indexBuffer->indexType);
 
 	if (pushConstantValues)
 		vkCmdPushConstants(currentCommandBuffer, vk_state->boundShader->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(*pushConstantValues), pushConstantValues);
@@ -1299,7 +1299,7 @@ void DrawBufferRange(u32 vertexBufferCount, VertexBuffer* clientVertexBuffers, u
 
 	// binding index and vertex buffers
 	vkCmdBindVertexBuffers(currentCommandBuffer, 0, vertexBufferCount, vertexBuffers, offsets);
-	vkCmdBindIndexBuffer(currentCommandBuffer, indexBuffer->handle, 0, VK_INDEX_TYPE_UINT32);
+	vkCmdBindIndexBuffer(currentCommandBuffer, indexBuffer->handle, 0, indexBuffer->indexType);
 
 	if (pushConstantValues)
 		vkCmdPushConstants(currentCommandBuffer, vk_state->boundShader->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(*pushConstantValues), pushConstantValues);
@@ -228,11 +228,15 @@ void ShaderCreate(const char* shaderName, ShaderCreateInfo* pCreateInfo)
     attributeSizes[VERTEX_ATTRIBUTE_TYPE_VEC2] = 8;
     attributeSizes[VERTEX_ATTRIBUTE_TYPE_VEC3] = 12;
     attributeSizes[VERTEX_ATTRIBUTE_TYPE_VEC4] = 16;
+    attributeSizes[VERTEX_ATTRIBUTE_TYPE_UNORM16_VEC4] = 8;
+    attributeSizes[VERTEX_ATTRIBUTE_TYPE_SNORM16_VEC2] = 4;
     VkFormat attributeFormats[20] = {};
     attributeFormats[VERTEX_ATTRIBUTE_TYPE_FLOAT] = VK_FORMAT_R32_SFLOAT;
     attributeFormats[VERTEX_ATTRIBUTE_TYPE_VEC2] = VK_FORMAT_R32G32_SFLOAT;
     attributeFormats[VERTEX_ATTRIBUTE_TYPE_VEC3] = VK_FORMAT_R32G32B32_SFLOAT;
     attributeFormats[VERTEX_ATTRIBUTE_TYPE_VEC4] = VK_FORMAT_R32G32B32A32_SFLOAT;
+    attributeFormats[VERTEX_ATTRIBUTE_TYPE_UNORM16_VEC4] = VK_FORMAT_R16G16B16A16_UNORM;
+    attributeFormats[VERTEX_ATTRIBUTE_TYPE_SNORM16_VEC2] = VK_FORMAT_R16G16_SNORM;
 
     // ================ Preprocessing vertex attributes to turn matrices into 4 vec4's
     VertexBufferLayout vbLayoutCopy = pCreateInfo->vertexBufferLayout;
@@ -68,6 +68,7 @@ typedef struct VulkanIndexBuffer
 	VkBuffer handle;
 	VulkanAllocation memory;
 	size_t indexCount;
+	VkIndexType indexType;		// VK_INDEX_TYPE_UINT32 or VK_INDEX_TYPE_UINT16
 } VulkanIndexBuffer;
 
 typedef struct VulkanImage